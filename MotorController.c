@@ -1,6 +1,7 @@
 /*
 
 	A single file version of the project
+	Generated from main.c by tools/amalgamate.py, edit the modular sources and regenerate instead of editing this file
 	
 	Main file. This is where the compilation starts and ends.
 	
@@ -10,6 +11,10 @@
 	
 */
 
+// No guard blocks here, as this file is not supposed to be included in any other
+
+
+
 // Standard libraries and processor type includes
 #include "deps/16F690.h"
 #include "deps/int16Cxx.h"
@@ -21,52 +26,258 @@
 
 
 
+// Header includes before interrupt routine
+// Config definitions
+// Internal oscillator frequency in Hz, one of 8000000, 4000000 or 2000000 (slower clocks leave too few cycles per tick)
+#ifndef CONFIG_F_OSC
+#define CONFIG_F_OSC		4000000
+#endif
+
+// Console baud rate, and how far off (in 1/1000ths) the divisor is allowed to make it
+#ifndef CONFIG_BAUD
+#define CONFIG_BAUD			9600
+#endif
+#define CONFIG_BAUD_TOLERANCE	15
+
+// OSCCON for CONFIG_F_OSC (IRCF bits, the system clock comes from the config word)
+#if CONFIG_F_OSC == 8000000
+#define CONFIG_OSCCON		0b01110000
+#elif CONFIG_F_OSC == 4000000
+#define CONFIG_OSCCON		0b01100000
+#elif CONFIG_F_OSC == 2000000
+#define CONFIG_OSCCON		0b01010000
+#else
+#error CONFIG_F_OSC must be a frequency the internal oscillator makes (8, 4 or 2 MHz)
+#endif
+
+
 // Time definitions
 #pragma bit IF_TIME @ T0IF
 
-#define TIME_TICK_PERIOD	159
-#define TIME_PRESCALE		0b001	// 1:16
+// Speeds and delays are counted in ticks, so the tick is the same length at every clock, only the cycles in it change
+#define TIME_TICK_US		640		// tick length in microseconds (1562.5 Hz)
+#define TIME_CYCLE_RATE		(CONFIG_F_OSC / 4)	// instruction cycles per second
+#define TIME_TICK_CYCLES	(TIME_TICK_US * (CONFIG_F_OSC / 1000) / 4000)	// instruction cycles per tick
+
+#if TIME_TICK_US * (CONFIG_F_OSC / 1000) % 4000
+#error TIME_TICK_US isn't a whole number of instruction cycles at CONFIG_F_OSC
+#endif
+#if TIME_TICK_CYCLES < 320
+#error Fewer than 320 cycles per tick leave too little for the interrupt and the core loop
+#endif
+
+// Smallest Timer0 prescale that fits a tick into 256 counts, 1:4 at least so that TIME_TRIM fits in a count
+#if TIME_TICK_CYCLES <= 4 * 256
+#define TIME_PRESCALE		0b001	// 1:4
+#define TIME_PRESCALE_DIV	4
+#elif TIME_TICK_CYCLES <= 8 * 256
+#define TIME_PRESCALE		0b010	// 1:8
+#define TIME_PRESCALE_DIV	8
+#elif TIME_TICK_CYCLES <= 16 * 256
+#define TIME_PRESCALE		0b011	// 1:16
+#define TIME_PRESCALE_DIV	16
+#else
+#error A tick doesn't fit into Timer0 at CONFIG_F_OSC
+#endif
+
+#if TIME_TICK_CYCLES % TIME_PRESCALE_DIV
+#error A tick isn't a whole number of Timer0 counts at CONFIG_F_OSC
+#endif
+
+#define TIME_TICK_PERIOD	(TIME_TICK_CYCLES / TIME_PRESCALE_DIV - 1)
 #define TIME_RESET			(255 - TIME_TICK_PERIOD)	// this will make the timer overflow every tick period
 
-// Current tick (roughly 1/1580th of a second, because we want 2 ticks in 1 motor pulse (we presume motor's max pulserate is 790))
+/*
+	Reloading TMR0 costs cycles: it doesn't count for 2 cycles after the write and the write clears the prescaler,
+	which throws away another (prescale - 1) / 2 on average. time_trim adds that much back, as a fraction of a TMR0 count
+	(in 1/256ths) per tick. One step of it is 1 / (256 * (TIME_TICK_PERIOD + 1)) of the tick, about 24 ppm.
+*/
+#ifndef TIME_TRIM
+#define TIME_TRIM			((TIME_PRESCALE_DIV + 3) * 128 / TIME_PRESCALE_DIV)	// 224 (3.5 cycles) at 1:4
+#endif
+
+// Set to 0 to leave out the cal command (it borrows Timer1 while measuring)
+#ifndef TIME_CALIBRATE
+#define TIME_CALIBRATE 1
+#endif
+
+#define TIME_CAL_TICKS		4096	// ticks to measure over (about 2.6 seconds)
+
+/*
+	Timer1 is the reference. By default it counts instruction cycles, which shows what the reload loses, not how far off
+	the oscillator is. For that put a 32768 Hz crystal on T1OSO/T1OSI (RA4/RA5) and set TIME_CAL_T1CON to 0b00001111
+	and TIME_CAL_COUNTS to 85899 (the 32768 Hz counts TIME_CAL_TICKS of TIME_TICK_US take).
+*/
+#ifndef TIME_CAL_T1CON
+#define TIME_CAL_T1CON		0b00000001	// Timer1 on, internal clock, 1:1 prescale
+#define TIME_CAL_COUNTS		((uns24)TIME_CAL_TICKS * TIME_TICK_CYCLES)	// Timer1 counts of TIME_CAL_TICKS perfect ticks
+#endif
+
+// Current tick (1/1562.5th of a second, about 2 ticks in 1 pulse at motor's max pulserate of 790)
 extern unsigned long time_tick;
 
+// Fraction of a TMR0 count added to every tick (see TIME_TRIM), cal sets it
+extern char time_trim;
+
 // Initialized the timer and timer-related interrupt
 void time_init();
 
 // Is to be called on timer interrupt, this will update the tick
 void time_update();
 
+// Returns time_tick as it is now, read whole: the interrupt can move it on between the two bytes of a plain read,
+// which outside of the interrupt gives a value that is neither the old tick nor the new one
+unsigned long time_now();
+
 // Wait until provided number of ticks pass
 void time_wait(unsigned long);
 
+#if TIME_CALIBRATE
+
+extern bit time_calRunning;		// 1 from time_calStart() until the result is taken
+extern bit time_calDone;		// set by the interrupt once TIME_CAL_TICKS ticks are measured
+extern bit time_calNew;			// a result the console task is to print (see io_notice)
+
+// Start measuring the tick rate against Timer1, Timer1 must not be in use by anything else than prof
+void time_calStart();
+
+// Is to be called once time_calDone is set, sets time_trim from the measurement and leaves the result to be printed
+void time_calFinish();
+
+// Prints the given part of the last measured error and the trim, returns 0 past the last one
+bit time_calPrint(char part);
+
+// Give up on a measurement (something else needs Timer1)
+#define time_calCancel()	time_calRunning = 0
+
+#else
+
+#define time_calCancel()
+
+#endif // TIME_CALIBRATE
 
 
 // IO definitions
-// Max size of the input string (should be of length |max legal command| + 1)
-#define IO_SIZE_IN 16
+// Baud rate generator value for CONFIG_BAUD, with BRG16 and BRGH set: baud = F_OSC / (4 * (IO_BRG + 1))
+#define IO_BRG				((CONFIG_F_OSC + 2 * CONFIG_BAUD) / (4 * CONFIG_BAUD) - 1)
+#define IO_BAUD_ACTUAL		(CONFIG_F_OSC / 4 / (IO_BRG + 1))
+
+#if IO_BAUD_ACTUAL * 1000 > CONFIG_BAUD * (1000 + CONFIG_BAUD_TOLERANCE) || IO_BAUD_ACTUAL * 1000 < CONFIG_BAUD * (1000 - CONFIG_BAUD_TOLERANCE)
+#error CONFIG_BAUD can't be made within CONFIG_BAUD_TOLERANCE at CONFIG_F_OSC
+#endif
+
+// Max size of the input string, a line can hold several commands separated by ';'
+// A longer line is dropped as a whole and answered with "Line too long"
+// The lines that come in while one runs and replies wait behind it in the same buffer
+#define IO_SIZE_IN 48
+
+/*
+	Output. Nothing waits for the transmitter: io_print() and io_printStr() put what they print into io_out, and
+	io_printMore() (the console task) sends it a character at a time whenever TXREG has room. Replies are printed a
+	part at a time, a few numbers and words that fit into io_out and one io_printLater() message at the end, the
+	next part only once the last one is out. A part that doesn't fit waits for the transmitter.
+*/
+#define IO_SIZE_OUT 32	// a power of two, the index wraps with it
+
+/*
+	Flow control. The next lines come in behind the one that runs and replies, until they fill io_in (or
+	make 8 lines). Nothing reads the receiver then until the running line's reply is out and they move up,
+	and a host that goes on sending overruns it. The host can be held off with XOFF/XON (the flow command)
+	or with a CTS line, RC4 is high while it's held. That happens IO_HOLD_ROOM characters before io_in is
+	full, and it has to stop within those and the two characters the receiver holds. Neither can be used
+	on a bus, the line is shared there and the host waits for each reply.
+*/
+#define IO_HOLD_ROOM		4	// an XOFF can wait for TXREG and the character being sent before it goes out
+#ifndef IO_CTS_ENABLE
+#define IO_CTS_ENABLE 0
+#endif
+
+#define IO_XON				0x11
+#define IO_XOFF				0x13
+
+#pragma bit PORT_IO_CTS		@ PORTC.4	// to the host's CTS, high while it's to hold off
 
 // An input string buffer, is to be used by parsing functions
 extern char io_in[IO_SIZE_IN];	
 
+// A character received outside of EUSART (see power_sleep()), 0 if there's none
+extern char io_pending;
+
+// Sequence number of the last line: the number it started with (0-255, followed by a space), or one more than
+// the one before. A bigger number isn't a sequence number, it stays in the line
+extern char io_seq;
+
+// While set, every line is answered with "ack <seq>" once it's checked, or "nak <seq> <n>" if command n is wrong
+// (0 for the line itself: too long, or characters were lost) and it doesn't run (ack command)
+extern bit io_acks;
+
+// While set, XOFF goes out when io_in is about to fill up and XON once it has room again (flow command, not on a bus)
+extern bit io_xon;
+
+// Is to be called once a line has run and its reply is written, the lines behind it move up to the front
+void io_resume();
+
 // Initialize everything IO-related (uart ports, control registers and interrupts)
 void io_init();
 
 // Will return pointer to the first character of input string, or 0 if still receiveing input
+// The line stays at the front of io_in until io_resume(), what comes in meanwhile waits behind it
 const char * io_getInput();
 
-// Returns 1 if strings are the same until a becomes null
-// Will always return 1 if compares a null pointer to anything
-bit strcmp(const char * a, const char * b);
+// The line io_getInput() returned is to be answered with "Line too long" (or nak with acks on) and not run
+extern bit io_dropped;
+
+// Something came up in the tick task that the console task is to print once no reply is going out
+// (a limit switch, a stall, the result of cal), whatever sets it has a flag of its own that says what
+extern bit io_notice;
+
+// Returns 1 if no line is being received and nothing is waiting in or coming into the receiver
+bit io_idle();
+
+// Returns 1 if io_getInput() has something to do: a character, an overrun to clear or an address byte
+bit io_received();
+
+// Splits the line in io_in into commands at ';' (and drops the spaces they start with), returns how many there are
+char io_split();
 
-// Retuns a number, represented by provided string (assumed it's base 10) or 0 if the string is garbage
-unsigned long stoi(const char *);
+// Prints "ack <seq>"
+void io_printAck();
 
-// Simply prints the given string
+// Prints "nak <seq> <n>"
+void io_printNak(char);
+
+// Returns the command after the given one, in a line split by io_split()
+const char * io_next(const char *);
+
+// Returns 1 if b is the word a, on its own or followed by a space and whatever comes after it
+// ("speed 5" is speed, "speedy" isn't)
+bit cmdcmp(const char * a, const char * b);
+
+// Retuns a number, represented by provided string (assumed it's base 10, spaces around it are fine) or 0 if
+// the string is garbage or the number doesn't fit into 32 bits
+uns32 stoi(const char *);
+
+// Puts the given string into io_out
 void io_print(const char *);
 
-size2 const char * toString(unsigned long);
+// Prints a signed number
+void io_printInt(int32);
+
+// Puts a message from the string table into io_out, takes one of the STR_ ids from strings.h
+void io_printStr(unsigned long);
+
+// Something printed is still going out, from io_out or the io_printLater() message
+extern bit io_later;
+
+// Starts printing a message from the string table after what's in io_out, however long it is, it's the last thing
+// in a part
+void io_printLater(unsigned long);
+
+// Puts out the next character if the transmitter has room for it, io_out first and then the io_printLater()
+// message, returns 1 once all of it is out
+bit io_printMore();
 
+size2 const char * toString(uns32);
 
 
 // Motor definitions
@@ -79,14 +290,721 @@ size2 const char * toString(unsigned long);
 
 #pragma bit PORT_MOTOR_STEP_SIZE	@ PORTC.0	// Should be either MOTOR_FULL_STEP or MOTOR_HALF_STEP
 #pragma bit PORT_MOTOR_DIRECTION	@ PORTC.1	// Should be either MOTOR_CLOCKWISE or MOTOR_COUNTERCLOCKWISE
-#pragma bit PORT_MOTOR_STEP			@ PORTC.2	// Used internally by motor_step()
+#pragma bit PORT_MOTOR_STEP			@ PORTC.2	// Used internally by motor_step(), also P1D output of ECCP
+
+#define MOTOR_SETTLE_US		15		// time between changing DIR or !HSM and the next step
+#define MOTOR_SETTLE		((MOTOR_SETTLE_US * (TIME_CYCLE_RATE / 1000) + 2999) / 3000)	// delay loop passes (3 cycles each)
+
+#define MOTOR_MIN_STEP_US	1920	// shortest step period the motor is rated for
+#define MOTOR_MIN_PERIOD	((MOTOR_MIN_STEP_US + TIME_TICK_US - 1) / TIME_TICK_US)	// the same in ticks
+
+// Set to 1 to let ECCP generate the steps of continuous runs that are fast enough
+#ifndef MOTOR_PWM
+#define MOTOR_PWM 0
+#endif
+
+// Set to 0 if STEP (RC2) isn't wired to T1CKI (RA5), steps made by ECCP won't be counted in motor_position then
+#ifndef MOTOR_PWM_COUNT
+#define MOTOR_PWM_COUNT 1
+#endif
+
+#define MOTOR_PWM_MIN_CYCLES	64		// shortest step period ECCP is allowed to make (in instruction cycles)
+#define MOTOR_PWM_MAX_CYCLES	4096	// longest step period ECCP can make (Timer2 with 1:16 prescale)
+#define MOTOR_PWM_MIN_RATE		(TIME_CYCLE_RATE / MOTOR_PWM_MAX_CYCLES + 1)	// rate command range, in steps per second
+#define MOTOR_PWM_MAX_RATE		(TIME_CYCLE_RATE / MOTOR_PWM_MIN_CYCLES)
+
+#if MOTOR_PWM && MOTOR_PWM_MAX_RATE > 65535
+#error The rate command can't take rates ECCP makes at CONFIG_F_OSC, raise MOTOR_PWM_MIN_CYCLES
+#endif
+
+// Position in steps, counted up for clockwise steps and down for counterclockwise ones
+extern int32 motor_position;
+
+/*
+	Commands don't touch the period, DIR and !HSM directly, they set these and motor_pending instead.
+	The step engine switches to them at the next step (motor_latch()), so no step is cut short or made with DIR changing.
+*/
+extern unsigned long motor_nextPeriod;
+extern bit motor_nextDirection;
+extern bit motor_nextSize;
+extern bit motor_pending;
 
 // Initialize motor-related pins
 void motor_init();
 
-// Run a single step
+// Run a single step and count it in motor_position
 void motor_step();
 
+// Switch to the next period, direction and step size, is to be called right before a step (or while stopped)
+void motor_latch();
+
+#if MOTOR_PWM
+
+// 1 while ECCP is generating steps
+extern bit motor_pwm;
+
+// Step period ECCP is running with (in instruction cycles)
+extern unsigned long motor_pwmCycles;
+
+// Start generating a step every given number of instruction cycles in hardware
+// Returns 0 (and leaves the motor alone) if ECCP can't make that period
+bit motor_pwmStart(unsigned long cycles);
+
+// Switch a running ECCP to the given period and to the next direction and step size at a period boundary
+// Returns 0 (and changes nothing) if ECCP can't make that period
+bit motor_pwmRetune(unsigned long cycles);
+
+// Is to be called on Timer2 interrupt, does the switching for motor_pwmRetune()
+void motor_pwmUpdate();
+
+// Stop generating steps and count the ones that were made
+void motor_pwmStop();
+
+#else
+
+#define motor_pwmStop()
+
+#endif // MOTOR_PWM
+
+
+// Bus definitions
+// Set to 1 to take commands in addressed frames only (see above)
+#ifndef BUS_ENABLE
+#define BUS_ENABLE 0
+#endif
+
+#define BUS_BROADCAST	0		// address every controller takes commands from, none of them replies to it
+#define BUS_EE_ID		0x00	// EEPROM address of the ID, erased (0xFF) means the jumpers decide
+#define BUS_TRIGGER		0xFF	// address byte that fires every armed controller (see trigger.h), never an ID
+
+#pragma bit PORT_BUS_DE		@ PORTC.3	// transceiver driver enable, high only while we transmit
+#pragma bit PORT_BUS_ID0	@ PORTC.6	// ID jumpers, low when fitted (need external pull-ups)
+#pragma bit PORT_BUS_ID1	@ PORTC.7
+
+#if BUS_ENABLE
+
+#if IO_CTS_ENABLE
+#error The CTS line is point to point, build without IO_CTS_ENABLE
+#endif
+
+// Our address, 1-254
+extern char bus_id;
+
+// The frame being received is addressed to us alone, so we may reply
+extern bit bus_talk;
+
+// Read the ID (EEPROM, or the jumpers: 1 + the number they make, ID1 being the high bit) and start listening
+void bus_init();
+
+// Is to be called with every address byte, opens the receiver for our frames and closes it for others
+void bus_address(char);
+
+// Is to be called once a line is complete, lets only address bytes in again
+#define bus_lineEnd()	ADDEN = 1
+
+// Is to be called once the reply to a frame is written, waits for it to leave and releases the line
+void bus_release();
+
+// Store a new ID (1-254) in EEPROM, 255 erases it and gives the choice back to the jumpers, applies right away
+void bus_setId(char);
+
+#else
+
+#define bus_release()
+
+#endif // BUS_ENABLE
+
+
+// Trigger definitions
+// Set to 0 to leave out arm and the trigger
+#ifndef TRIGGER_ENABLE
+#define TRIGGER_ENABLE 1
+#endif
+
+#pragma bit PORT_TRIGGER	@ PORTA.2	// trigger line, active low, has the weak pull-up so it may be left open
+
+// Trigger phases
+#define TRIGGER_IDLE	0
+#define TRIGGER_ARMED	1	// waiting for the trigger
+#define TRIGGER_FIRED	2	// the interrupt saw it, the tick started over
+#define TRIGGER_DUE		3	// the first tick after it came, the core loop starts the move
+
+#if TRIGGER_ENABLE
+
+extern char trigger_phase;
+extern bit trigger_start;		// the move is a start
+extern uns32 trigger_steps;		// or this many steps, no move if neither
+
+// Set up the trigger pin
+void trigger_init();
+
+// Stop the motor and wait for the trigger, start and step load the move from here on
+void trigger_arm();
+
+// Stop waiting and forget the move
+void trigger_disarm();
+
+// Is to be called on INT interrupt (and by trigger_receive()), starts the tick over
+void trigger_fire();
+
+// Is to be called by the core loop once the phase is TRIGGER_DUE, starts the move
+void trigger_release();
+
+#if BUS_ENABLE
+
+/*
+	While armed the receive interrupt is on, so that BUS_TRIGGER is seen the moment it arrives.
+	The interrupt takes address bytes only, data is left in the receiver for io_getInput() as usual.
+*/
+extern bit trigger_heard;		// an address byte other than BUS_TRIGGER is waiting in trigger_address
+extern char trigger_address;
+
+// Is to be called on RCIF interrupt
+void trigger_receive();
+
+// Is to be called from the core loop, turns the receive interrupt back on once the receiver is empty
+void trigger_listen();
+
+#else
+
+#define trigger_listen()
+
+#endif // BUS_ENABLE
+
+#else
+
+#define trigger_phase		TRIGGER_IDLE
+#define trigger_disarm()
+#define trigger_listen()
+
+#endif // TRIGGER_ENABLE
+
+
+// Power definitions
+// Set to 0 to keep the core loop spinning while the motor is stopped
+// On a bus every character would wake us, address detection only spares the ones awake (see bus.h)
+#ifndef POWER_IDLE_SLEEP
+#if BUS_ENABLE
+#define POWER_IDLE_SLEEP 0
+#else
+#define POWER_IDLE_SLEEP 1
+#endif
+#endif
+
+#define POWER_BIT_CYCLES	(IO_BRG + 1)	// instruction cycles per UART bit, the same as EUSART's (see IO_BRG)
+#define POWER_WAKE_CYCLES	12		// rough cycles between the start bit edge and the first instruction after SLEEP
+
+/*
+	The tick stops in sleep, the watchdog times it instead. It runs on LFINTOSC (31 kHz, 15% either way), so the
+	time asleep is a rough figure: whole watchdog periods and half of the one the start bit came in. Every time-out
+	wakes the controller for a few instructions, a longer period makes fewer of them but a rougher figure.
+*/
+#define POWER_WDTPS			7		// watchdog period 32 << 7 LFINTOSC cycles, about 132 ms
+#define POWER_WDTCON		((POWER_WDTPS << 1) | 1)	// SWDTEN, the configuration word leaves the watchdog off
+#define POWER_LFINTOSC		31000
+#define POWER_WDT_TICKS		(((32L << POWER_WDTPS) * 1000000 / POWER_LFINTOSC + TIME_TICK_US / 2) / TIME_TICK_US)	// 206
+
+#if POWER_IDLE_SLEEP && POWER_BIT_CYCLES > 256
+#error A UART bit is too long for Timer2 at CONFIG_F_OSC and CONFIG_BAUD, set POWER_IDLE_SLEEP to 0
+#endif
+
+// Number of times the controller slept until a character came
+extern uns32 power_sleeps;
+
+// Number of ticks the controller spent awake with nothing to do
+extern uns32 power_idleTicks;
+
+// About how many ticks it would have counted while asleep
+extern uns32 power_asleep;
+
+// Initialize the counters
+void power_init();
+
+// Stop the tick and sleep until a byte starts arriving on RX, then receive that byte in software
+// Returns with the tick running again and the byte handed to io_getInput(), or right away if EUSART already has one coming in
+void power_sleep();
+
+
+// Prof definitions
+// Set to 1 to build with profiling (uses Timer1)
+#ifndef PROF_ENABLE
+#define PROF_ENABLE 0
+#endif
+
+// Profiled regions
+#define PROF_ISR		0	// int_server()
+#define PROF_CHECK		1	// splitting a line and checking it before it runs (only a batch, or with acks on)
+#define PROF_CMD		2	// command handlers, all of a line's
+#define PROF_TICK		3	// tick section of the core loop
+#define PROF_REGIONS	4
+
+#if PROF_ENABLE
+
+#if MOTOR_PWM && MOTOR_PWM_COUNT
+#error "Profiling and counting hardware steps both need Timer1"
+#endif
+
+// One region is measured at a time, the prof command selects it
+// PROF_WAIT is set in prof_region until the region starts after that, so a half counted run isn't a sample
+#define PROF_WAIT		0x80
+extern char prof_region;
+
+// Cycle counts of the region, min and max are exact
+// Regions in the core loop include the time spent in int_server() while they ran
+// Counts wrap at 65536 cycles
+extern unsigned long prof_min;
+extern unsigned long prof_max;
+
+// Start stamp and last sample of the region, these are used by the macros below
+extern unsigned long prof_start;
+extern unsigned long prof_last;
+
+// Read Timer1 into a 16-bit variable, re-reading if the high byte changed underneath us
+#define PROF_READ(v)	do { v.high8 = TMR1H; v.low8 = TMR1L; } while (v.high8 != TMR1H)
+
+// These are macros and not functions, because Cc5x won't let int_server() share functions with main()
+#define PROF_BEGIN(r)	if ((prof_region | PROF_WAIT) == (r | PROF_WAIT)) {		\
+							prof_region = r;								\
+							PROF_READ(prof_start);							\
+						}
+#define PROF_END(r)		if (prof_region == r) {								\
+							PROF_READ(prof_last);							\
+							prof_last -= prof_start;						\
+							if (prof_last < prof_min)						\
+								prof_min = prof_last;						\
+							if (prof_last > prof_max)						\
+								prof_max = prof_last;						\
+						}
+
+// A region that runs over several passes of the core loop (a line's commands) stops counting in between
+#define PROF_PAUSE(r)	if (prof_region == r) {								\
+							PROF_READ(prof_last);							\
+							prof_last -= prof_start;						\
+						}
+#define PROF_RESUME(r)	if (prof_region == r) {								\
+							PROF_READ(prof_start);							\
+							prof_start -= prof_last;						\
+						}
+
+// Start Timer1 and measure the interrupt
+void prof_init();
+
+// Measures region r from its next start on, without what was counted so far
+void prof_select(char r);
+
+// Prints min/max of the region, returns 0 past that part
+bit prof_print(char part);
+
+#else
+
+#define PROF_BEGIN(r)
+#define PROF_END(r)
+#define PROF_PAUSE(r)
+#define PROF_RESUME(r)
+
+#endif // PROF_ENABLE
+
+
+// Sched definitions
+// Tasks, in order of priority
+#define SCHED_TICK		0	// once a tick: the trigger, limit switches, calibration and the step
+#define SCHED_INPUT		1	// takes characters out of the receiver
+#define SCHED_COMMAND	2	// checks and runs a received line, a command at a time
+#define SCHED_CONSOLE	3	// puts out replies and notices
+#define SCHED_IDLE		4	// sleeps if it may, it runs when nothing else is ready
+#define SCHED_TASKS		4	// the ones with a deadline, idle has none
+
+// A character on the line in ticks, rounded up
+#if BUS_ENABLE
+#define SCHED_CHAR_TICKS	((11 * 1000000 / CONFIG_BAUD + TIME_TICK_US - 1) / TIME_TICK_US)
+#else
+#define SCHED_CHAR_TICKS	((10 * 1000000 / CONFIG_BAUD + TIME_TICK_US - 1) / TIME_TICK_US)
+#endif
+
+// Deadlines in ticks, input has none of its own, its overruns are the receiver's (OERR)
+#define SCHED_TICK_DEADLINE		0						// any later and a step is late
+#define SCHED_COMMAND_DEADLINE	(2 * SCHED_CHAR_TICKS)	// from its end, the end of the reply before it or its last pass
+#define SCHED_CONSOLE_DEADLINE	(2 * SCHED_CHAR_TICKS)	// from the last character of a reply, TXREG and the shift register run dry after that
+
+// Overruns per task, and the worst lateness in ticks (up to 255)
+extern unsigned long sched_overruns[SCHED_TASKS];
+extern char sched_worst[SCHED_TASKS];
+
+// The tick each task became ready at, whatever makes a task ready sets it
+extern unsigned long sched_since[SCHED_TASKS];
+
+// The last tick the tick task ran for
+extern unsigned long sched_tick;
+
+// A line is waiting for the command task, or it's part way through it
+extern bit sched_line;
+
+// The line has run and the console task is putting out its reply, the next line waits in io_in for it to end
+extern bit sched_reply;
+
+// Reset the counters
+void sched_init();
+
+// Returns the first task that is ready
+char sched_next();
+
+// Is to be called as a task runs, counts an overrun if it's past its deadline
+void sched_account(char task);
+
+// Prints the given part of the overruns of every task, returns 0 past the last one
+bit sched_print(char part);
+
+
+// Limit definitions
+// Set to 1 if the switches are connected (unconnected pins would stop the motor at random)
+#ifndef LIMIT_ENABLE
+#define LIMIT_ENABLE 0
+#endif
+
+#define LIMIT_HOME_DIRECTION	MOTOR_COUNTERCLOCKWISE	// direction in which the home switch is
+#define LIMIT_HOME_FAST			6		// period while looking for the home switch
+#define LIMIT_HOME_SLOW			40		// period while approaching it for the second time
+#define LIMIT_BACKOFF_STEPS		MOTOR_HALF_REVOLUTION	// steps to move away from the switch between the two
+
+#pragma bit PORT_LIMIT_CCW	@ PORTB.4	// 0 when at the counterclockwise end of travel
+#pragma bit PORT_LIMIT_CW	@ PORTB.6	// 0 when at the clockwise end of travel
+#pragma bit PORT_HOME		@ PORTA.3	// 0 when at home, needs an external pull-up
+
+// Homing phases
+#define LIMIT_IDLE		0
+#define LIMIT_SEEK		1	// fast towards the switch
+#define LIMIT_BACKOFF	2	// away from the switch
+#define LIMIT_CREEP		3	// slowly back to the switch
+
+#if LIMIT_ENABLE
+
+extern char limit_phase;
+
+// What the console task is to report (see io_notice)
+#define LIMIT_REPORT_NONE	0
+#define LIMIT_REPORT_HOMED	1
+#define LIMIT_REPORT_FAILED	2	// homing ran into a limit switch
+#define LIMIT_REPORT_HIT	3
+
+extern char limit_report;
+
+// Initialize switch pins and their interrupt-on-change
+void limit_init();
+
+// Is to be called on RABIF interrupt, latches the switches that closed
+void limit_update();
+
+// Returns 1 if the next step in the current direction would go past a limit switch
+// Clears whatever limit_update() latched
+bit limit_check();
+
+// Start homing, the motor will run towards the home switch
+void limit_home();
+
+// Is to be called every motor period (at the step boundary), advances homing
+void limit_homeUpdate();
+
+// Stop homing (if it's in progress) and go back to the speed and direction from before
+void limit_cancel();
+
+// Prints limit_report and clears it
+void limit_print();
+
+#else
+
+#define limit_phase		LIMIT_IDLE
+#define limit_cancel()
+
+#endif // LIMIT_ENABLE
+
+
+// Encoder definitions
+// Set to 1 if an encoder is connected (Timer1 counts it, so prof, cal and ECCP step counting have to be left out)
+#ifndef ENCODER_ENABLE
+#define ENCODER_ENABLE 0
+#endif
+
+#ifndef ENCODER_COUNTS
+#define ENCODER_COUNTS		4	// rising edges per full step, even (a half step makes half of them)
+#endif
+#define ENCODER_WINDOW		16	// steps per check until the stall command sets it
+#define ENCODER_SLACK		ENCODER_COUNTS	// counts a window may come up short, the rotor lags the step
+#define ENCODER_BACKOFFS	3	// stalled windows in a row that slow the motor down, the next one stops it
+
+#if ENCODER_ENABLE
+
+#if PROF_ENABLE || TIME_CALIBRATE || MOTOR_PWM && MOTOR_PWM_COUNT
+#error The encoder needs Timer1 to itself, build without prof, cal (TIME_CALIBRATE 0) and ECCP step counting
+#endif
+#if ENCODER_COUNTS % 2 || ENCODER_COUNTS > 256
+#error ENCODER_COUNTS must be even and no more than 256 (a window of 255 steps has to fit into Timer1)
+#endif
+
+// Position of the shaft in encoder counts, clockwise is positive as for motor_position
+extern int32 encoder_position;
+
+// Steps per check, 0 for none (the position is still counted)
+extern char encoder_window;
+
+// Number of stalls found
+extern unsigned long encoder_stalls;
+
+// Period to go back to once the move is over, 0 if a stall didn't slow it down
+extern unsigned long encoder_period;
+
+// What the console task is to report (see io_notice)
+#define ENCODER_REPORT_NONE		0
+#define ENCODER_REPORT_SLOWED	1	// down to motor_nextPeriod
+#define ENCODER_REPORT_STOPPED	2
+
+extern char encoder_report;
+
+// Start counting the encoder
+void encoder_init();
+
+// Is to be called for every step made in software, adds what it should make to the window
+void encoder_step();
+
+// Is to be called at every step boundary before the step (and motor_latch()), checks the window once it's full
+// or the motor stopped, returns 1 if it slowed the motor down
+bit encoder_update();
+
+// Start a new window, the steps so far aren't checked
+void encoder_reset();
+
+// Is to be called when nothing is stepping, the period a stall slowed the last move down from comes back
+void encoder_restore();
+
+// Prints encoder_report and clears it
+void encoder_print();
+
+// Is to be called when a new speed is asked for, it stays after the move
+#define encoder_forget()	encoder_period = 0
+
+#else
+
+#define encoder_step()
+#define encoder_restore()
+#define encoder_forget()
+
+#endif // ENCODER_ENABLE
+
+
+// Queue definitions
+// Set to 0 to leave out at and tick
+#ifndef QUEUE_ENABLE
+#define QUEUE_ENABLE 1
+#endif
+
+// Commands that may wait at once, every one takes 5 bytes of RAM
+#ifndef QUEUE_SIZE
+#define QUEUE_SIZE		4
+#endif
+
+#define QUEUE_AHEAD		32767	// furthest a deadline may be, half the wrap so that it can't be mistaken for a past one
+
+#if QUEUE_ENABLE
+
+extern char queue_count;
+extern unsigned long queue_tick[QUEUE_SIZE];	// deadlines, the next one at queue_count - 1
+extern char queue_cmd[QUEUE_SIZE];				// Command
+extern unsigned long queue_arg[QUEUE_SIZE];		// period, steps, or MOTOR_ direction or step size
+extern unsigned long queue_late;				// commands that ran after their tick
+extern bit queue_timed;							// the host reads the tick, it's to keep counting
+
+// What queue_take() took off
+extern char queue_nextCmd;
+extern unsigned long queue_nextArg;
+
+// Empty the queue and the count of late ones
+void queue_init();
+
+// Forget what's waiting, and that the host reads the tick
+void queue_clear();
+
+// Add a command to run on the given tick, after any that are for the same one (a tick that has passed counts as now),
+// returns 0 if it's full
+bit queue_add(unsigned long tick, char cmd, unsigned long arg);
+
+// Returns 1 if the next command is for the given tick or one before it
+bit queue_due(unsigned long tick);
+
+// Takes the next command off into queue_nextCmd and queue_nextArg, the tick is the one it's run on
+void queue_take(unsigned long tick);
+
+// Prints the given part of the current tick and how many are waiting, and with list set of what they are, in the
+// order they'll run, returns 0 past the last one
+bit queue_print(char part, bit list);
+
+#else
+
+#define queue_count		0
+#define queue_timed		0
+#define queue_clear()
+
+#endif // QUEUE_ENABLE
+
+
+// Strings definitions
+// Message ids, to be passed to io_printStr()
+#define STR_HELP               245
+#define STR_HELP_END           0
+#define STR_HELP_TASKS         421
+#define STR_HELP_ACK           340
+#define STR_HELP_BATCH         127
+#define STR_MOTOR_IS           711
+#define STR_ON                 916
+#define STR_OFF                838
+#define STR_PERIOD             619
+#define STR_TICKS_OF           970
+#define STR_US_EACH            844
+#define STR_DIRECTION_IS       974
+#define STR_STEP_SIZE_IS       850
+#define STR_POSITION           856
+#define STR_IDLE_FOR           719
+#define STR_TICKS_SLEPT        629
+#define STR_TIMES              978
+#define STR_TIMES_FOR          608
+#define STR_STEPPING_EVERY     862
+#define STR_TICKS              982
+#define STR_UNKNOWN_DIRECTION  868
+#define STR_MOTOR_DIRECTION_IS 727
+#define STR_UNKNOWN_STEP_SIZE  735
+#define STR_STEPPING_WITH      874
+#define STR_STEPPING_FOR       559
+#define STR_STEPS_RANGE        504
+#define STR_OK                 986
+#define STR_ERR                921
+#define STR_RUN_ON             990
+#define STR_RUN_OFF            926
+#define STR_RUN_CW             994
+#define STR_RUN_CC             998
+#define STR_QUIET_IS           572
+#define STR_LINE_TOO_LONG      584
+#define STR_ACK                931
+#define STR_NAK                936
+#define STR_ACKS_ARE           639
+#define STR_TASK_TICK          941
+#define STR_TASK_INPUT         880
+#define STR_TASK_COMMAND       1002
+#define STR_TASK_CONSOLE       743
+#define STR_LATE               800
+#define STR_TIMES_WORST        649
+#define STR_COUNTER            686
+#define STR_CLOCKWISE          596
+#define STR_FULL               1005
+#define STR_HALF               1007
+#define STR_STEPS              807
+#define STR_MINUS              1009
+#define STR_SPACE              502
+#define STR_NEWLINE            124
+
+// Messages of features that can be left out
+#define STR_PART_0             1011
+#if PROF_ENABLE
+#define STR_HELP_PROF          (STR_PART_0 + 0)
+#define STR_PROF_ISR           (STR_PART_0 + 215)
+#define STR_PROF_CHECK         (STR_PART_0 + 200)
+#define STR_PROF_CMD           (STR_PART_0 + 221)
+#define STR_PROF_TICK          (STR_PART_0 + 208)
+#define STR_SLASH              (STR_PART_0 + 227)
+#define STR_PROF_CYCLES        (STR_PART_0 + 169)
+#define STR_PROF_NO_SAMPLES    (STR_PART_0 + 187)
+#define STR_PART_1             (STR_PART_0 + 229)
+#else
+#define STR_PART_1             STR_PART_0
+#endif
+#if LIMIT_ENABLE
+#define STR_HELP_HOME          (STR_PART_1 + 43)
+#define STR_HOMING             (STR_PART_1 + 127)
+#define STR_HOMED              (STR_PART_1 + 113)
+#define STR_HOME_FAILED        (STR_PART_1 + 0)
+#define STR_LIMIT_HIT          (STR_PART_1 + 85)
+#define STR_PART_2             (STR_PART_1 + 136)
+#else
+#define STR_PART_2             STR_PART_1
+#endif
+#if MOTOR_PWM
+#define STR_HELP_RATE          (STR_PART_2 + 0)
+#define STR_HELP_RATE_END      (STR_PART_2 + 36)
+#define STR_HARDWARE_EVERY     (STR_PART_2 + 55)
+#define STR_CYCLES             (STR_PART_2 + 87)
+#define STR_RATE_RANGE         (STR_PART_2 + 73)
+#define STR_PART_3             (STR_PART_2 + 97)
+#else
+#define STR_PART_3             STR_PART_2
+#endif
+#if TIME_CALIBRATE
+#define STR_HELP_CAL           (STR_PART_3 + 0)
+#define STR_TICK_ERROR         (STR_PART_3 + 78)
+#define STR_NOT_MEASURED       (STR_PART_3 + 122)
+#define STR_PPM_TRIM           (STR_PART_3 + 95)
+#define STR_TRIM_UNIT          (STR_PART_3 + 109)
+#define STR_CALIBRATING        (STR_PART_3 + 54)
+#define STR_PART_4             (STR_PART_3 + 130)
+#else
+#define STR_PART_4             STR_PART_3
+#endif
+#if BUS_ENABLE
+#define STR_HELP_ID            (STR_PART_4 + 0)
+#define STR_BUS_ID_IS          (STR_PART_4 + 53)
+#define STR_PART_5             (STR_PART_4 + 63)
+#else
+#define STR_PART_5             STR_PART_4
+#endif
+#if TRIGGER_ENABLE
+#define STR_HELP_ARM           (STR_PART_5 + 0)
+#define STR_ARMED              (STR_PART_5 + 44)
+#define STR_PART_6             (STR_PART_5 + 76)
+#else
+#define STR_PART_6             STR_PART_5
+#endif
+#if ENCODER_ENABLE
+#define STR_HELP_STALL         (STR_PART_6 + 0)
+#define STR_ENCODER_IS         (STR_PART_6 + 173)
+#define STR_COUNTS_STALLED     (STR_PART_6 + 155)
+#define STR_CHECKING_EVERY     (STR_PART_6 + 113)
+#define STR_NOT_CHECKING       (STR_PART_6 + 88)
+#define STR_STALLED_SLOWING    (STR_PART_6 + 62)
+#define STR_STALLED_AT         (STR_PART_6 + 134)
+#define STR_PART_7             (STR_PART_6 + 184)
+#else
+#define STR_PART_7             STR_PART_6
+#endif
+#if !BUS_ENABLE
+#define STR_HELP_FLOW          (STR_PART_7 + 0)
+#define STR_FLOW_IS            (STR_PART_7 + 68)
+#define STR_PART_8             (STR_PART_7 + 82)
+#else
+#define STR_PART_8             STR_PART_7
+#endif
+#if QUEUE_ENABLE
+#define STR_HELP_AT            (STR_PART_8 + 0)
+#define STR_TICK_IS            (STR_PART_8 + 268)
+#define STR_COMMA              (STR_PART_8 + 309)
+#define STR_QUEUED_LATE        (STR_PART_8 + 239)
+#define STR_AT                 (STR_PART_8 + 301)
+#define STR_AT_START           (STR_PART_8 + 312)
+#define STR_AT_STOP            (STR_PART_8 + 284)
+#define STR_AT_SPEED           (STR_PART_8 + 276)
+#define STR_AT_DIR             (STR_PART_8 + 290)
+#define STR_AT_SIZE            (STR_PART_8 + 305)
+#define STR_AT_STEP            (STR_PART_8 + 296)
+#define STR_CC                 (STR_PART_8 + 315)
+#define STR_CW                 (STR_PART_8 + 318)
+#define STR_AT_RANGE           (STR_PART_8 + 163)
+#define STR_QUEUE_FULL         (STR_PART_8 + 258)
+#define STR_PART_9             (STR_PART_8 + 321)
+#else
+#define STR_PART_9             STR_PART_8
+#endif
+#if TIME_CALIBRATE && MOTOR_PWM && MOTOR_PWM_COUNT
+#define STR_CAL_BUSY           (STR_PART_9 + 0)
+#define STR_PART_10            (STR_PART_9 + 44)
+#else
+#define STR_PART_10            STR_PART_9
+#endif
+
 
 
 // Type definitions:
@@ -99,7 +1017,20 @@ typedef enum {
 	CMD_SPEED,
 	CMD_DIR,
 	CMD_SIZE,
-	CMD_STEP
+	CMD_STEP,
+	CMD_PROF,
+	CMD_HOME,
+	CMD_RATE,
+	CMD_CAL,
+	CMD_QUIET,
+	CMD_ID,
+	CMD_ARM,
+	CMD_TASKS,
+	CMD_STALL,
+	CMD_ACK,
+	CMD_FLOW,
+	CMD_AT,
+	CMD_TICK
 } Command;
 #define TRUE	1
 #define FALSE	0
@@ -108,37 +1039,136 @@ typedef enum {
 
 // Variable definitions
 bit motor_enable;				// start command sets this to 1 until stop or step command
-unsigned long motor_steps;		// step command will set this to some value, that will go down with each motor tick
+uns32 motor_steps;				// step command will set this to some value, that will go down with each motor tick
+bit motor_counting;				// motor_steps isn't 0, one bit is cheaper to test than 4 bytes
 unsigned long motor_period;		// period of the motor's step
 const char * pArg;				// pointer to the first char of argument in input string
 Command cmd;					// command enum, necessary due to compiler limitation
+bit quiet;						// quiet command, no replies but to queries
+unsigned long motor_tick;		// ticks into the current step period
+// The reply to the line that ran, the console task puts it out a part at a time (see replyNext())
+const char * replyAt;			// the command it's answering
+char replyLeft;					// commands still to answer, that one too
+char replyPart;					// the part of the answer that's next
+char replyBad;					// the command that was wrong, 0 for the line itself
+bit replyHead;					// the ack, nak, err or "Line too long" is still to go
+bit replyRan;					// the line ran, otherwise replyBad says why not
+bit replyAck;					// acks were on when the line came
+bit replyQuiet;					// only queries answer: it's a batch, or quiet was on
+bit replyNoted;					// the command had something to say before its answer
+bit replyStatus;				// the batch status line is still to go
+unsigned long replyNote;		// what that was
+char noticePart;				// the part of a notice that's going out, 0 between them
+// The line the command task is on, it checks or runs a command of it a pass (see runBatch())
+bit batchChecking;				// its commands are being checked
+bit batchRunning;				// and then run
+bit batchChecked;				// it was checked before it ran
+bit batchStopped;				// nothing was stepping when it started to run
+#if MOTOR_PWM
+bit batchRetune, batchRetuneSpeed;	// it changed what ECCP is making
+#endif
+char batchCount;				// commands in it
+char batchLeft;					// still to check or run
+#define HELP_PARTS		15
+#define INFO_PARTS		15		// and then the queue
+#if QUEUE_ENABLE
+unsigned long atTick;			// what parseAt() read
+unsigned long atWait;			// ticks from then to atTick
+unsigned long atArg;
+char atBatch;					// at commands of the line checked so far, they need that much room in the queue
+#endif
 
 
 // Function definitions
 void parseInput(const char *);
+bit checkCommand();
+bit printStatus(char);
+void runTick();
+bit runBatch();
+void runQueued();
+bit parseAt();
+bit atAhead();
+void replyAlso(unsigned long);
+void replyInstead(unsigned long);
+bit replyNext();
+bit replyPrint();
+bit helpNext();
+bit infoNext();
+void noticeNext();
 
 
 // Interrupt routine, because of the compiler spicifics, we need to define it before any other code...
 #pragma origin 4
 interrupt int_server() {
 	int_save_registers
+	PROF_BEGIN(PROF_ISR);
 	/* New interrupts are automaticaly disabled            */
 	/* "Interrupt on change" at pin RA1 from PK2 UART-tool */
 
+#if TRIGGER_ENABLE
+	// first, so that the trigger takes the same number of cycles on every controller
+	if (INTF && INTE)
+		trigger_fire();
+#if BUS_ENABLE
+	if (RCIF && RCIE)
+		trigger_receive();
+#endif
+#endif
+
 	if (IF_TIME)
 		time_update();
 
+#if LIMIT_ENABLE
+	if (RABIF)
+		limit_update();
+#endif
+
+#if MOTOR_PWM
+	if (TMR2IF && TMR2IE)
+		motor_pwmUpdate();
+#endif
+
 	RABIF = 0;    /* Reset the RABIF-flag before leaving   */
+	PROF_END(PROF_ISR);
 	int_restore_registers
 }
 
 
 
+// Source file definitions
+// In standard C this would not be necessary, but Cc5x is not a standard compiler, so we assist it a little
 // Time source
+#if TIME_CALIBRATE && (TIME_CAL_T1CON & 0b00001000) && (PROF_ENABLE || MOTOR_PWM && MOTOR_PWM_COUNT)
+#error A Timer1 crystal for cal takes RA5 and Timer1 away from prof and ECCP step counting
+#endif
+
 unsigned long time_tick;
+char time_trim;
+char time_trimAcc;
+
+#if TIME_CALIBRATE
+bit time_calRunning;
+bit time_calDone;
+bit time_calMeasured;		// time_calPpm holds a measurement
+bit time_calNew;
+unsigned long time_calTicks;
+unsigned long time_calLast;	// Timer1 at the previous tick
+uns24 time_calCounts;		// Timer1 counts since the first tick
+long time_calPpm;			// tick rate error of the last measurement
+#endif
 
 void time_init() {
+	OSCCON = CONFIG_OSCCON;		// switch the internal oscillator to CONFIG_F_OSC
+	while (!HTS);				// and wait for it to settle
+	
 	time_tick = 0;
+	time_trim = TIME_TRIM;
+	time_trimAcc = 0;
+#if TIME_CALIBRATE
+	time_calRunning = 0;
+	time_calMeasured = 0;
+	time_calNew = 0;
+#endif
 
 	T0CS = 0;					// Timer0 will use internal oscilator
 	TMR0 = 0;					// reset timer
@@ -152,9 +1182,47 @@ void time_init() {
 }
 
 void time_update() {
+	/*
+		TMR0 kept counting while we were getting here, so the reload is added to it instead of written over it.
+		That way the interrupt latency doesn't make the tick longer, only the reload itself does (see TIME_TRIM).
+	*/
+	time_trimAcc += time_trim;
+	if (Carry)
+		TMR0 += TIME_RESET + 1;
+	else
+		TMR0 += TIME_RESET;
 	time_tick++;
-	TMR0 = TIME_RESET;	// This will give roughly 1/790th of a second period if used with 1:32 prescale
 	IF_TIME = 0;		// reset interrupt flag
+	
+#if TRIGGER_ENABLE
+	// not sooner, the core loop may have been halfway through the last tick when the trigger came
+	if (trigger_phase == TRIGGER_FIRED)
+		trigger_phase = TRIGGER_DUE;
+#endif
+	
+#if TIME_CALIBRATE
+	if (time_calRunning && !time_calDone) {
+		unsigned long t;
+		do {
+			t.high8 = TMR1H;
+			t.low8 = TMR1L;
+		} while (t.high8 != TMR1H);
+		
+		if (time_calTicks)
+			time_calCounts += (unsigned long)(t - time_calLast);	// Timer1 wraps, the difference doesn't
+		time_calLast = t;
+		if (++time_calTicks > TIME_CAL_TICKS)
+			time_calDone = 1;
+	}
+#endif
+}
+
+unsigned long time_now() {
+	unsigned long t;
+	do {
+		t = time_tick;
+	} while (t != time_tick);	// a tick is far longer than this, the second read can't be torn as well
+	return t;
 }
 
 void time_wait(unsigned long t) {
@@ -162,346 +1230,3263 @@ void time_wait(unsigned long t) {
 	while (time_tick != end);
 }
 
+#if TIME_CALIBRATE
+
+void time_calStart() {
+	time_calRunning = 0;		// keep the interrupt out while we set up
+	time_calTicks = 0;
+	time_calCounts = 0;
+	time_calDone = 0;
+	T1CON = TIME_CAL_T1CON;		// the same as prof_init() with the default reference, so prof keeps working
+	time_calRunning = 1;
+}
+
+void time_calFinish() {
+	int32 error;
+	int32 trim;
+	
+	time_calRunning = 0;
+#if !PROF_ENABLE
+	T1CON = 0;
+#endif
+	
+	// A slow tick takes more counts than it should. Error in ppm is (expected - counts) * 1000000 / counts,
+	// counts are shifted down by 6 (and 1000000 with them) to keep it within 32 bits
+	error = (int32)TIME_CAL_COUNTS - time_calCounts;
+	error = error * 15625 / (int32)(time_calCounts >> 6);
+	if (error > 32767)
+		error = 32767;
+	else if (error < -32767)
+		error = -32767;
+	time_calPpm = error;
+	time_calMeasured = 1;
+	
+	// Every 1/256th of a TMR0 count added per tick makes it shorter by 1 / (256 * (TIME_TICK_PERIOD + 1))
+	trim = error * ((TIME_TICK_PERIOD + 1) * 256 / 64) / (1000000 / 64);
+	trim = time_trim - trim;
+	if (trim < 0)
+		trim = 0;
+	else if (trim > 255)
+		trim = 255;		// out of reach of the trim, OSCTUNE is the next thing to look at
+	time_trim = trim;
+	
+	time_calNew = 1;
+	io_notice = 1;
+}
+
+bit time_calPrint(char part) {
+	if (part == 0) {
+		io_printStr(STR_TICK_ERROR);
+		if (!time_calMeasured)
+			io_printStr(STR_NOT_MEASURED);
+		else
+			io_printInt(time_calPpm);
+		io_printLater(STR_PPM_TRIM);
+		return 1;
+	}
+	if (part == 1) {
+		io_print(toString(time_trim));
+		io_printLater(STR_TRIM_UNIT);
+		return 1;
+	}
+	return 0;
+}
+
+#endif // TIME_CALIBRATE
+
+
+// Strings source
+// Offsets of the fragments in str_table
+const unsigned long str_frag[] = {
+	487, 946, 751, 520, 659, 950, 758, 886, 668, 814, 533, 546,
+	765, 954, 772, 891, 820, 826, 958, 832, 677, 962, 896, 695,
+	703, 901, 906, 911, 966, 779, 786, 793
+};
+
+// Messages and fragments, a byte 0x80 + n stands for fragment n, a 0 ends an entry
+// The messages of features that can be left out follow in #if blocks, see strings.h for where each starts
+const char str_table[] = {
+	'-', '6', '5', '5', '3', '5', 0x9C, 'd', 'i', 'r', 0x80, 'd',
+	0x84, ' ', 0x8C, '"', 'c', 'c', '"', ' ', 0x81, '"', 'c', 'w',
+	'"', 0x9C, 0x8F, 0x80, 's', 0x85, ' ', 0x8F, ' ', 0x8C, '"', 0x9A,
+	'"', ' ', 0x81, '"', 0x99, '"', 0x9C, 's', 0x85, ' ', '[', 'x',
+	']', ' ', '-', ' ', 'm', 'a', 'k', 'e', 's', ' ', 'm', 'o',
+	't', 0x81, 's', 0x85, ' ', 'x', ' ', '(', 0x8A, ')', 0x86, '\r',
+	'\n', 'q', 'u', 'i', 'e', 't', 0x8B, 't', 'u', 'r', 'n', 's',
+	' ', 'r', 'e', 'p', 'l', 'i', 'e', 's', ' ', 't', 'o', ' ',
+	'c', 0x82, 's', 0x92, 'f', ' ', '(', 0x81, 'o', 'n', ')', ',',
+	' ', 'q', 'u', 'e', 'r', 'i', 'e', 's', ' ', 's', 't', 'i',
+	'l', 'l', ' ', 0x9E, '\r', '\n', 0x00, 'C', 0x82, 's', ' ', 's',
+	'e', 'p', 'a', 'r', 'a', 't', 'e', 'd', ' ', 'b', 'y', ' ',
+	'\'', ';', '\'', ' ', 'r', 'u', 'n', ' ', 't', 'o', 'g', 'e',
+	0x95, 'r', ' ', 0x9B, 'r', 'e', 'p', 'l', 'y', 0x89, '\r', '\n',
+	'o', 'k', ' ', '<', 'o', 'n', '/', 'o', 'f', 'f', 0x8D, 'c',
+	'w', '/', 'c', 'c', 0x8D, 0x9A, '/', 0x99, 0x8D, 'p', 'e', 'r',
+	'i', 'o', 'd', 0x8D, 's', 0x85, 's', ' ', 'l', 'e', 'f', 't',
+	0x8D, 'p', 0x97, '>', '\r', '\n', 0x81, 'e', 'r', 'r', ' ', '<',
+	'n', '>', ' ', '(', 0x9B, 'd', 'o', 0x98, ' ', 'a', 't', ' ',
+	'a', 'l', 'l', ')', ' ', 'i', 'f', ' ', 'c', 0x82, ' ', 'n',
+	0x87, 'w', 'r', 0x91, 0x00, 'A', 'v', 'a', 'i', 'l', 'a', 'b',
+	'e', ' ', 'c', 0x82, 's', ':', '\r', '\n', '?', '/', 'h', 'e',
+	'l', 'p', 0x83, 't', 'h', 'i', 's', ' ', 'm', 'e', 's', 's',
+	'a', 'g', 'e', '\r', '\n', 'i', 'n', 'f', 'o', 0x83, 'm', 'o',
+	't', 0x81, 'i', 'n', 'f', 'o', '\r', '\n', 0x90, ' ', '-', ' ',
+	0x90, 's', 0x88, 'o', 'r', '\r', '\n', 's', 't', 'o', 'p', ' ',
+	'-', ' ', 's', 't', 'o', 'p', 's', 0x88, 'o', 'r', '\r', '\n',
+	's', 'p', 'e', 'e', 'd', 0x80, 's', 'p', 'e', 'e', 'd', 0x92,
+	0x88, 0x81, 0x8C, 0x00, 'a', 'c', 'k', 0x8B, 0x9E, 's', 0x9F, 0x93,
+	0x89, ' ', 'a', 'c', 0x9D, '>', ',', ' ', 0x81, 'n', 'a', 0x9D,
+	0x8D, 'n', '>', ' ', 'i', 'f', ' ', 'c', 0x82, ' ', 'n', 0x87,
+	'w', 'r', 0x91, '(', '0', ' ', 'f', 0x81, 0x95, 0x93, ')', ' ',
+	0x9B, 'i', 't', ' ', 'd', 'o', 'e', 's', 0x98, ',', ' ', 'a',
+	0x93, ' ', 'm', 'a', 'y', ' ', 0x90, 0x89, ' ', 'i', 't', 's',
+	' ', 's', 'e', 'q', ' ', '(', '0', '-', '2', '5', '5', 0x9C,
+	0x00, 't', 'a', 's', 'k', 's', ' ', '[', 'r', 'e', 's', 'e',
+	't', ']', 0x83, '(', 0x81, 'r', 'e', 's', 'e', 't', 's', ')',
+	' ', 'h', 'o', 'w', 0x92, 't', 'e', 'n', ' ', 'e', 'a', 'c',
+	'h', ' ', 'p', 'a', 'r', 't', 0x92, ' ', 0x95, ' ', 'c', 'o',
+	'r', 'e', ' ', 'l', 'o', 'o', 'p', ' ', 'r', 'a', 'n', ' ',
+	'l', 'a', 't', 'e', '\r', '\n', 0x00, ' ', '[', 'x', ']', ' ',
+	'-', ' ', 's', 'e', 't', 's', ' ', 't', 'h', 'e', ' ', 0x00,
+	'S', 0x85, 's', ' ', 'm', 'u', 's', 't', ' ', 'b', 'e', ' ',
+	0x8A, '\r', '\n', 0x00, ' ', '-', ' ', 'd', 'i', 's', 'p', 'l',
+	'a', 'y', 's', ' ', 0x00, '1', '-', '4', '2', '9', '4', '9',
+	'6', '7', '2', '9', '5', 0x00, ' ', '[', 'o', 'n', '/', 'o',
+	'f', 'f', ']', ' ', '-', ' ', 0x00, 'S', 0x85, 0x96, ' ', 'f',
+	0x81, 'a', 'n', 'o', 0x95, 'r', ' ', 0x00, 'Q', 'u', 'i', 'e',
+	't', ' ', 'm', 'o', 'd', 'e', 0x87, 0x00, 'L', 'i', 'n', 'e',
+	' ', 't', 'o', 'o', ' ', 'l', 0x91, 0x00, 'c', 'l', 'o', 'c',
+	'k', 'w', 'i', 's', 'e', '\r', '\n', 0x00, 0x86, ' ', 'f', 0x81,
+	'a', 'b', 'o', 'u', 't', ' ', 0x00, 'P', 'e', 'r', 'i', 'o',
+	'd', ' ', '=', ' ', 0x00, 0x8E, ',', ' ', 's', 'l', 'e', 'p',
+	't', ' ', 0x00, 'A', 'c', 'k', 's', ' ', 'a', 'r', 'e', ' ',
+	0x00, 0x86, ',', ' ', 'w', 'o', 'r', 's', 't', ' ', 0x00, 'i',
+	'r', 'e', 'c', 't', 'i', 'o', 'n', 0x00, ' ', 't', 'h', 'e',
+	' ', 'm', 'o', 't', 0x00, 'U', 'n', 'k', 'n', 'o', 'w', 'n',
+	' ', 0x00, 'c', 'o', 'u', 'n', 't', 'e', 'r', ' ', 0x00, 'o',
+	's', 'i', 't', 'i', 'o', 'n', 0x00, 'n', '\'', 't', ' ', 'r',
+	'u', 'n', 0x00, 'M', 'o', 't', 0x81, 'i', 's', ' ', 0x00, 'I',
+	'd', 'l', 'e', ' ', 'f', 0x81, 0x00, 'M', 'o', 't', 0x81, 'd',
+	0x84, 0x87, 0x00, 0x94, 's', 0x85, ' ', 0x8F, '\r', '\n', 0x00, 'c',
+	'o', 'n', 's', 'o', 'l', 'e', 0x00, 'o', 'm', 'm', 'a', 'n',
+	'd', 0x00, ' ', 't', 'i', 'm', 'e', 's', 0x00, 't', 'o', ' ',
+	'x', ' ', '(', 0x00, ' ', 't', 'i', 'c', 'k', 's', 0x00, 'k',
+	' ', '<', 's', 'e', 'q', 0x00, 'a', 'n', 's', 'w', 'e', 'r',
+	0x00, ' ', 'e', 'v', 'e', 'r', 'y', 0x00, ' ', 'l', 'a', 't',
+	'e', ' ', 0x00, ' ', 's', 0x85, 's', '\r', '\n', 0x00, ' ', 'w',
+	'i', 't', 'h', 0x00, 's', 't', 'a', 'r', 't', 0x00, 'o', 'n',
+	'g', '\r', '\n', 0x00, ' ', 'l', 'i', 'n', 'e', 0x00, 'O', 'F',
+	'F', '\r', '\n', 0x00, ' ', 'u', 's', '\r', '\n', 0x00, 'S', 0x85,
+	' ', 0x8F, 0x87, 0x00, 'P', 0x97, ' ', '=', ' ', 0x00, 'S', 0x85,
+	0x96, 0x9F, ' ', 0x00, 0x94, 'd', 0x84, '\r', '\n', 0x00, 'S', 0x85,
+	0x96, 0x89, ' ', 0x00, 'i', 'n', 'p', 'u', 't', 0x00, ' ', 'i',
+	's', ' ', 0x00, 's', 'i', 'z', 'e', 0x00, 'p', 'i', 'n', 'g',
+	0x00, 'h', 'a', 'l', 'f', 0x00, 'f', 'u', 'l', 'l', 0x00, 'a',
+	'n', 'd', ' ', 0x00, 'O', 'N', '\r', '\n', 0x00, 'e', 'r', 'r',
+	' ', 0x00, 'o', 'f', 'f', ' ', 0x00, 'a', 'c', 'k', ' ', 0x00,
+	'n', 'a', 'k', ' ', 0x00, 't', 'i', 'c', 'k', 0x00, 'o', 'r',
+	' ', 0x00, 't', 'e', 'p', 0x00, '>', ' ', '<', 0x00, ' ', 'o',
+	'f', 0x00, 't', 'h', 'e', 0x00, ')', '\r', '\n', 0x00, 0x8E, 0x92,
+	' ', 0x00, 'D', 0x84, 0x87, 0x00, 0x86, '\r', '\n', 0x00, 0x8E, '\r',
+	'\n', 0x00, 'o', 'k', ' ', 0x00, 'o', 'n', ' ', 0x00, 'c', 'w',
+	' ', 0x00, 'c', 'c', ' ', 0x00, 'c', 0x82, 0x00, 0x9A, 0x00, 0x99,
+	0x00, '-', 0x00
+#if PROF_ENABLE
+	, 'p', 'r', 'o', 'f', ' ', '[', 'r', 'e', 's', 'e', 't', ']',
+	0x83, '(', 0x81, 'r', 'e', 's', 'e', 't', 's', ')', ' ', 'c',
+	'y', 'c', 'l', 'e', ' ', 'c', 'o', 'u', 'n', 't', 's', 0x92,
+	' ', 0x95, ' ', 'r', 'e', 'g', 'i', 'o', 'n', ' ', 'i', 't',
+	' ', 'm', 'e', 'a', 's', 'u', 'r', 'e', 's', ',', ' ', 'p',
+	'r', 'o', 'f', ' ', '<', 'r', 'e', 'g', 'i', 'o', 'n', '>',
+	' ', 'm', 'e', 'a', 's', 'u', 'r', 'e', 's', '\r', '\n', 'i',
+	's', 'r', ',', ' ', 'c', 'h', 'e', 'c', 'k', ' ', '(', 'a',
+	0x93, ' ', 'b', 'e', 'f', 'o', 'r', 'e', ' ', 'i', 't', ' ',
+	'r', 'u', 'n', 's', ')', ',', ' ', 'c', 'm', 'd', ' ', '(',
+	'i', 't', 's', ' ', 'c', 0x82, 's', ')', ' ', 0x81, 't', 'i',
+	'c', 'k', ' ', '(', 0x95, ' ', 't', 'i', 'c', 'k', '\'', 's',
+	' ', 'p', 'a', 'r', 't', 0x92, ' ', 0x95, ' ', 'l', 'o', 'o',
+	'p', ')', ' ', 'i', 'n', 's', 't', 'e', 'a', 'd', '\r', '\n',
+	0x00, ' ', 'c', 'y', 'c', 'l', 'e', 's', ' ', '(', 'm', 'i',
+	'n', '/', 'm', 'a', 'x', 0x9C, 0x00, 'n', 'o', ' ', 's', 'a',
+	'm', 'p', 'l', 'e', 's', '\r', '\n', 0x00, 'c', 'h', 'e', 'c',
+	'k', ':', ' ', 0x00, 't', 'i', 'c', 'k', ':', ' ', 0x00, 'i',
+	's', 'r', ':', ' ', 0x00, 'c', 'm', 'd', ':', ' ', 0x00, '/',
+	0x00
+#endif
+#if LIMIT_ENABLE
+	, 'H', 'o', 'm', 'i', 'n', 'g', ' ', 'f', 'a', 'i', 'l', 'e',
+	'd', ',', ' ', 's', 't', 'o', 'p', 'p', 'e', 'd', ' ', 'a',
+	't', ' ', 'a', ' ', 'l', 'i', 'm', 'i', 't', ' ', 's', 'w',
+	'i', 't', 'c', 'h', '\r', '\n', 0x00, 'h', 'o', 'm', 'e', ' ',
+	'-', ' ', 'f', 'i', 'n', 'd', 's', ' ', 0x95, ' ', 'h', 'o',
+	'm', 'e', ' ', 's', 'w', 'i', 't', 'c', 'h', ' ', 0x9B, 'z',
+	'e', 'r', 'o', 'e', 's', ' ', 0x95, ' ', 'p', 0x97, '\r', '\n',
+	0x00, 'S', 't', 'o', 'p', 'p', 'e', 'd', ' ', 'a', 't', ' ',
+	'a', ' ', 'l', 'i', 'm', 'i', 't', ' ', 's', 'w', 'i', 't',
+	'c', 'h', '\r', '\n', 0x00, 'H', 'o', 'm', 'e', 'd', ',', ' ',
+	'p', 0x97, 0x87, '0', '\r', '\n', 0x00, 'H', 'o', 'm', 'i', 'n',
+	'g', '\r', '\n', 0x00
+#endif
+#if MOTOR_PWM
+	, 'r', 'a', 't', 'e', ' ', '[', 'x', ']', ' ', '-', ' ', 'r',
+	'u', 'n', 's', 0x88, 0x81, 'i', 'n', ' ', 'h', 'a', 'r', 'd',
+	'w', 'a', 'r', 'e', ' ', 'a', 't', ' ', 'x', ' ', '(', 0x00,
+	')', ' ', 's', 0x85, 's', ' ', 'p', 'e', 'r', ' ', 's', 'e',
+	'c', 'o', 'n', 'd', '\r', '\n', 0x00, 'S', 0x85, 0x96, ' ', 'i',
+	'n', ' ', 'h', 'a', 'r', 'd', 'w', 'a', 'r', 'e', 0x9F, ' ',
+	0x00, 'R', 'a', 't', 'e', ' ', 'm', 'u', 's', 't', ' ', 'b',
+	'e', ' ', 0x00, ' ', 'c', 'y', 'c', 'l', 'e', 's', '\r', '\n',
+	0x00
+#endif
+#if TIME_CALIBRATE
+	, 'c', 'a', 'l', ' ', '-', ' ', 'm', 'e', 'a', 's', 'u', 'r',
+	'e', 's', ' ', 0x95, ' ', 't', 'i', 'c', 'k', ' ', 'r', 'a',
+	't', 'e', ' ', 'a', 'g', 'a', 'i', 'n', 's', 't', ' ', 'T',
+	'i', 'm', 'e', 'r', '1', ' ', 0x9B, 't', 'r', 'i', 'm', 's',
+	' ', 'i', 't', '\r', '\n', 0x00, 'M', 'e', 'a', 's', 'u', 'r',
+	'i', 'n', 'g', ' ', 0x95, ' ', 't', 'i', 'c', 'k', ' ', 'r',
+	'a', 't', 'e', '\r', '\n', 0x00, 'T', 'i', 'c', 'k', ' ', 'r',
+	'a', 't', 'e', ' ', 'e', 'r', 'r', 0x81, '=', ' ', 0x00, ' ',
+	'p', 'p', 'm', ',', ' ', 't', 'r', 'i', 'm', ' ', '=', ' ',
+	0x00, '/', '2', '5', '6', ' ', 'c', 'o', 'u', 'n', 't', '\r',
+	'\n', 0x00, 'u', 'n', 'k', 'n', 'o', 'w', 'n', 0x00
+#endif
+#if BUS_ENABLE
+	, 'i', 'd', 0x80, 'b', 'u', 's', ' ', 'a', 'd', 'd', 'r', 'e',
+	's', 's', ' ', 0x8C, '1', '-', '2', '5', '4', ')', ',', ' ',
+	'2', '5', '5', ' ', 'g', 'o', 'e', 's', ' ', 'b', 'a', 'c',
+	'k', ' ', 't', 'o', ' ', 0x95, ' ', 'j', 'u', 'm', 'p', 'e',
+	'r', 's', '\r', '\n', 0x00, 'B', 'u', 's', ' ', 'I', 'D', ' ',
+	'=', ' ', 0x00
+#endif
+#if TRIGGER_ENABLE
+	, 'a', 'r', 'm', ' ', '-', ' ', 's', 't', 'o', 'p', 's', 0x88,
+	'o', 'r', ',', ' ', 0x90, ' ', 0x9B, 's', 0x85, ' ', 0x95, 'n',
+	' ', 'w', 'a', 'i', 't', ' ', 'f', 0x81, 0x95, ' ', 't', 'r',
+	'i', 'g', 'g', 'e', 'r', '\r', '\n', 0x00, 'A', 'r', 'm', 'e',
+	'd', ',', ' ', 0x90, ' ', 0x9B, 's', 0x85, ' ', 'w', 'a', 'i',
+	't', ' ', 'f', 0x81, 0x95, ' ', 't', 'r', 'i', 'g', 'g', 'e',
+	'r', '\r', '\n', 0x00
+#endif
+#if ENCODER_ENABLE
+	, 's', 't', 'a', 'l', 'l', ' ', '[', 'x', ']', ' ', '-', ' ',
+	'c', 'h', 'e', 'c', 'k', 's', ' ', 0x95, ' ', 'e', 'n', 'c',
+	'o', 'd', 'e', 'r', 0x9F, ' ', 'x', ' ', '(', '1', '-', '2',
+	'5', '5', ')', ' ', 's', 0x85, 's', ',', ' ', '0', ' ', 't',
+	'u', 'r', 'n', 's', ' ', 't', 'h', 'a', 't', 0x92, 'f', '\r',
+	'\n', 0x00, 'S', 't', 'a', 'l', 'l', 'e', 'd', ',', ' ', 's',
+	'l', 'o', 'w', 'i', 'n', 'g', ' ', 'd', 'o', 'w', 'n', ' ',
+	't', 'o', ' ', 0x00, 'N', 'o', 't', ' ', 'c', 'h', 'e', 'c',
+	'k', 'i', 'n', 'g', ' ', 0x95, ' ', 'e', 'n', 'c', 'o', 'd',
+	'e', 'r', '\r', '\n', 0x00, 'C', 'h', 'e', 'c', 'k', 'i', 'n',
+	'g', ' ', 0x95, ' ', 'e', 'n', 'c', 'o', 'd', 'e', 'r', 0x9F,
+	' ', 0x00, 'S', 't', 'a', 'l', 'l', 'e', 'd', ',', ' ', 's',
+	't', 'o', 'p', 'p', 'e', 'd', ' ', 'a', 't', ' ', 0x00, ' ',
+	'c', 'o', 'u', 'n', 't', 's', ',', ' ', 's', 't', 'a', 'l',
+	'l', 'e', 'd', ' ', 0x00, 'E', 'n', 'c', 'o', 'd', 'e', 'r',
+	' ', '=', ' ', 0x00
+#endif
+#if !BUS_ENABLE
+	, 'f', 'l', 'o', 'w', 0x8B, 's', 'e', 'n', 'd', 's', ' ', 'X',
+	'O', 'F', 'F', ' ', 'w', 'h', 'e', 'n', ' ', 0x95, ' ', 'i',
+	'n', 'p', 'u', 't', ' ', 'b', 'u', 'f', 'f', 'e', 'r', 0x87,
+	'a', 'b', 'o', 'u', 't', ' ', 0x9A, ' ', 0x9B, 'X', 'O', 'N',
+	' ', 'o', 'n', 'c', 'e', ' ', 'i', 't', ' ', 'h', 'a', 's',
+	' ', 'r', 'o', 'o', 'm', '\r', '\n', 0x00, 'F', 'l', 'o', 'w',
+	' ', 'c', 'o', 'n', 't', 'r', 'o', 'l', 0x87, 0x00
+#endif
+#if QUEUE_ENABLE
+	, 'a', 't', ' ', '<', 't', 'i', 'c', 'k', 0x8D, 'c', 0x82, '>',
+	' ', '-', ' ', 'r', 'u', 'n', 's', ' ', 0x90, ',', ' ', 's',
+	't', 'o', 'p', ',', ' ', 's', 'p', 'e', 'e', 'd', ',', ' ',
+	'd', 'i', 'r', ',', ' ', 0x8F, ' ', 0x81, 's', 0x85, ' ', 'o',
+	'n', ' ', 't', 'h', 'a', 't', ' ', 't', 'i', 'c', 'k', ' ',
+	'(', 0x81, '+', 'n', ',', ' ', 'n', 0x8E, ' ', 'f', 'r', 'o',
+	'm', '\r', '\n', 'n', 'o', 'w', ',', ' ', '1', '-', '3', '2',
+	'7', '6', '7', ' ', 'a', 'h', 'e', 'a', 'd', ')', ',', ' ',
+	'a', 't', ' ', '[', 'c', 'l', 'e', 'a', 'r', ']', ' ', 'l',
+	'i', 's', 't', 's', ' ', '(', 0x81, 'e', 'm', 'p', 't', 'i',
+	'e', 's', ')', ' ', 'w', 'h', 'a', 't', '\'', 's', ' ', 'w',
+	'a', 'i', 't', 'i', 'n', 'g', ',', ' ', 't', 'i', 'c', 'k',
+	' ', 'd', 'i', 's', 'p', 'l', 'a', 'y', 's', ' ', 0x95, ' ',
+	't', 'i', 'c', 'k', '\r', '\n', 0x00, 'T', 'i', 'c', 'k', ' ',
+	'm', 'u', 's', 't', ' ', 'b', 'e', ' ', '1', '-', '3', '2',
+	'7', '6', '7', ' ', 'a', 'h', 'e', 'a', 'd', ',', ' ', 0x95,
+	'n', ' ', 0x90, ',', ' ', 's', 't', 'o', 'p', ',', ' ', 's',
+	'p', 'e', 'e', 'd', ' ', 'x', ',', ' ', 'd', 'i', 'r', ' ',
+	'x', ',', ' ', 0x8F, ' ', 'x', ' ', 0x81, 's', 0x85, ' ', 'x',
+	' ', '(', '1', '-', '6', '5', '5', '3', '5', 0x9C, 0x00, ' ',
+	'q', 'u', 'e', 'u', 'e', 'd', ',', ' ', 'r', 'a', 'n', ' ',
+	'l', 'a', 't', 'e', ' ', 0x00, 'Q', 'u', 'e', 'u', 'e', 0x87,
+	0x9A, '\r', '\n', 0x00, 'T', 'i', 'c', 'k', ' ', '=', ' ', 0x00,
+	' ', 's', 'p', 'e', 'e', 'd', ' ', 0x00, ' ', 's', 't', 'o',
+	'p', 0x00, ' ', 'd', 'i', 'r', ' ', 0x00, ' ', 's', 0x85, ' ',
+	0x00, 'a', 't', ' ', 0x00, ' ', 0x8F, ' ', 0x00, ',', ' ', 0x00,
+	' ', 0x90, 0x00, 'c', 'c', 0x00, 'c', 'w', 0x00
+#endif
+#if TIME_CALIBRATE && MOTOR_PWM && MOTOR_PWM_COUNT
+	, 'T', 'i', 'm', 'e', 'r', '1', 0x87, 'c', 'o', 'u', 'n', 't',
+	'i', 'n', 'g', ' ', 'h', 'a', 'r', 'd', 'w', 'a', 'r', 'e',
+	' ', 's', 0x85, 's', ',', ' ', 's', 't', 'o', 'p', 0x88, 0x81,
+	'f', 'i', 'r', 's', 't', '\r', '\n', 0x00
+#endif
+};
+
 
 // IO source
-char inputPos;
+char inputPos;					// where the next character goes
+char io_lineAt;					// where the line coming in starts, the ones before it are whole
+char io_nextAt;					// where what came in behind the running line starts
+char io_lines;					// whole lines waiting behind it
+char io_lostLines;				// bit n is set if the nth of them lost characters
+bit io_busy;					// the line at the front of io_in is running or replying
+bit io_held;					// the host is held off
+bit io_tooLong;					// the line didn't fit, it's dropped once it ends
+bit io_lost;					// the receiver overran while the line came in
 char io_in[IO_SIZE_IN];
+char io_pending;
+bit io_dropped;
+bit io_notice;
 bit io_echo;
+char io_out[IO_SIZE_OUT];
+char io_outAt;					// where the next character comes out of io_out
+char io_outCount;				// characters in it
+bit io_later;
+bit io_laterMsg;				// the io_printLater() message hasn't all gone out
+unsigned long io_laterAt;		// where io_printMore() is in str_table
+unsigned long io_laterFrag;		// and in the fragment it's in, if io_laterInFrag
+bit io_laterInFrag;
+char io_seq;
+bit io_acks;
+bit io_xon;
+bit io_xoff;					// XOFF went out, XON is due
+
+#define IO_LINES	8			// whole lines that can wait, one bit each in io_lostLines
+
+// Nowhere for the next character to go until the running line is done, the receiver holds it meanwhile
+#define IO_FULL		(io_busy && (inputPos >= IO_SIZE_IN - 1 || io_lines == IO_LINES))
 
 void io_init() {
 	
 	io_echo = FALSE;
+	io_dropped = FALSE;
+	io_notice = FALSE;
+	io_outAt = 0;
+	io_outCount = 0;
+	io_later = FALSE;
+	io_laterMsg = FALSE;
+	io_pending = 0;
+	inputPos = 0;
+	io_lineAt = 0;
+	io_lines = 0;
+	io_lostLines = 0;
+	io_busy = FALSE;
+	io_held = FALSE;
+	io_tooLong = FALSE;
+	io_lost = FALSE;
+	io_seq = 0;
+	io_acks = FALSE;
+	io_xon = FALSE;
+	io_xoff = FALSE;
 	
 	// Enable pins, EUSART will reconfigure them as necessary
 	TRISB.6 = 1;
 	TRISB.7 = 1;
+#if IO_CTS_ENABLE
+	PORT_IO_CTS = 0;
+	TRISC.4 = 0;
+#endif
 	
 	/*
 		To calculate baud rate period:
-		T = Main oscilator time (4 MHz in our case)
-		D = Desired baud rate (9600 in our case)
-		p = period, value we're calculating
+		T = Main oscilator frequency (CONFIG_F_OSC)
+		D = Desired baud rate (CONFIG_BAUD)
+		p = period, value we're calculating (IO_BRG)
 		
-		D = T/(16 *(p+1))
+		D = T/(4 *(p+1))
 		
-		p = T/D/16-1
-		p = 4 000 000 / 6900 / 16 - 1 = 25
+		p = T/D/4-1
+		p = 4 000 000 / 9600 / 4 - 1 = 103 (9615 baud, 0.16% off)
 	*/
-	BRGH = 1;	// Make period more precise (divide D by 16 not 64)
-	SPBRGH = 0;	// high byte of desired baud rate 
-	SPBRG = 25;	// specify our period
+	BRG16 = 1;	// 16-bit period, so that slow clocks and fast rates still get a close divisor
+	BRGH = 1;	// Make period more precise (divide D by 4 not 16)
+	SPBRGH = IO_BRG >> 8;	// high byte of our period
+	SPBRG = IO_BRG & 0xFF;	// specify our period
 	
+#if BUS_ENABLE
+	TX9 = 1;	// use 9-bit characters on the bus, ours are never addresses
+	TX9D = 0;
+#else
 	TX9 = 0;	// use 8-bit characters
+#endif
 	SYNC = 0;	// set it to asynchrounous transmishion
 	TXEN = 1;	// enable UART circuitry
 	
 	SPEN = 1;	// enable EUSART and automatically configure TX/CK as output
 	
 	CREN = 1;	// enable reciever circuitry
+#if BUS_ENABLE
+	RX9 = 1;	// the 9th bit marks address bytes, bus_init() turns address detection on
+#else
 	RX9 = 0;	// use 8-bit characters
+#endif
 }
 
-const char * io_getInput() {
-	
-	CREN = 1;	// Just in case an error occured
+void io_takeSeq() {
+	char i = 0;
+	unsigned long n = 0;
 	
-	// Receiveing data
-	if (RCIF) {
-		if (inputPos >= IO_SIZE_IN)
-			inputPos = 0;	// silently wrap around, bad practice but functional
-
-		io_in[inputPos] = RCREG;	// read input here
+	while (i < 4 && io_in[i] >= '0' && io_in[i] <= '9') {	// a fourth digit is enough to tell it's too big
+		n = n * 10 + io_in[i] - '0';
+		i++;
+	}
+	if (!i || n > 255 || (io_in[i] && io_in[i] != ' ')) {
+		io_seq++;	// no number, one that's too big to be a seq, or one that goes on into a command
+		return;
+	}
+	io_seq = n;
+	while (i) {
+		i--;
+		io_in[i] = ' ';		// io_split() drops it with the spaces
+	}
+}
+
+#if BUS_ENABLE
+#define io_flow()		// the line is shared, the host waits for the reply before it sends the next one
+#else
+// Holds the host off once the lines behind the running one are close to filling io_in, and lets it go again
+// when the running line is done and they have moved up
+void io_flow() {
+	if (io_busy && (inputPos >= IO_SIZE_IN - 1 - IO_HOLD_ROOM || io_lines >= IO_LINES - 2)) {
+		if (io_held)
+			return;
+		io_held = TRUE;
+#if IO_CTS_ENABLE
+		PORT_IO_CTS = 1;
+#endif
+		if (io_xon) {
+			while (!TXIF);	// a reply may be in TXREG
+			TXREG = IO_XOFF;
+			io_xoff = TRUE;
+		}
+	} else if (io_held) {
+		io_held = FALSE;
+#if IO_CTS_ENABLE
+		PORT_IO_CTS = 0;
+#endif
+		if (io_xoff) {		// even if a line turned flow control off, the host is waiting for it
+			while (!TXIF);
+			TXREG = IO_XON;
+			io_xoff = FALSE;
+		}
+	}
+}
+#endif
+
+// Hands out the line at the front of io_in, it stays there until io_resume()
+const char * io_takeLine() {
+	char i = 0;
+	bit lost = io_lostLines.0;
+	
+	while (io_in[i])
+		i++;
+	io_nextAt = i + 1;
+	io_busy = TRUE;
+	io_lines--;
+	io_lostLines >>= 1;
+	io_flow();
+	io_takeSeq();
+	if (io_tooLong || (lost && io_acks))
+		io_dropped = TRUE;	// what's left of it could be a command of its own, none of it runs
+	io_tooLong = FALSE;
+	return io_in;
+}
+
+const char * io_getInput() {
+	char c, i;
+	
+	if (OERR) {	// an overrun stops the receiver until CREN is cleared
+		sched_overruns[SCHED_INPUT]++;
+		CREN = 0;
+		CREN = 1;
+		io_lost = TRUE;
+	}
+	
+#if TRIGGER_ENABLE && BUS_ENABLE
+	if (trigger_heard) {	// an address byte the interrupt took while armed
+		trigger_heard = 0;
+		bus_address(trigger_address);
+		return 0;
+	}
+#endif
+	
+	if (io_lines && !io_busy)
+		return io_takeLine();	// it came in while the last one ran
+	if (IO_FULL)
+		return 0;
+	
+	// Receiveing data
+#if TRIGGER_ENABLE && BUS_ENABLE
+	if ((RCIF && !RCIE) || io_pending) {	// while RCIE is on the receiver is the interrupt's (see trigger.h)
+#else
+	if (RCIF || io_pending) {
+#endif
+		if (io_pending) {
+			c = io_pending;	// it came first, so it goes first
+			io_pending = 0;
+		} else {
+#if BUS_ENABLE
+			if (RX9D) {		// 9th bit comes first, RCREG moves on to the next character
+				bus_address(RCREG);
+				return 0;
+			}
+#endif
+			c = RCREG;	// read input here
+		}
 		if (io_echo)
-			TXREG = io_in[inputPos];
-		if (io_in[inputPos] == '\0' || io_in[inputPos] == '\n' || io_in[inputPos] == '\r') {
+			TXREG = c;
+		if (c == '\0' || c == '\n' || c == '\r') {
+#if BUS_ENABLE
+			bus_lineEnd();	// our own reply echoes back on a half duplex line, it has to be kept out
+#endif
+			if (inputPos == io_lineAt && !io_lost)
+				return 0;	// nothing in it, like the '\n' of "\r\n": no seq, no ack
 			io_in[inputPos] = '\0';
-			inputPos = 0;
-			return io_in;
-		} else
 			inputPos++;
+			io_lineAt = inputPos;
+			if (io_lost) {
+				c = 1;		// the line's bit in io_lostLines
+				for (i = io_lines; i; i--)
+					c <<= 1;
+				io_lostLines |= c;
+			}
+			io_lost = FALSE;
+			io_lines++;
+			if (!io_busy)
+				return io_takeLine();
+			io_flow();
+			return 0;
+		}
+		if (inputPos < IO_SIZE_IN - 1) {	// the last one is for the '\0'
+			io_in[inputPos] = c;
+			inputPos++;
+			io_flow();
+		} else
+			io_tooLong = TRUE;	// a line with nothing ahead of it, one behind the running line waits for room
+	}
+	
+	return 0;
+}
+
+bit io_idle() {
+	if (!RCIDL)
+		return FALSE;	// a character is on its way in, sleeping now would cut it off
+	if (inputPos || RCIF || io_pending)	// after RCIDL, one that just came in is in RCIF by now
+		return FALSE;
+	return TRUE;
+}
+
+bit io_received() {
+	if (io_lines && !io_busy)
+		return TRUE;	// a line came in while the last one ran
+#if TRIGGER_ENABLE && BUS_ENABLE
+	if (trigger_heard)
+		return TRUE;
+	if (RCIE)
+		return OERR || io_pending;	// the receiver is the interrupt's
+#endif
+	if (IO_FULL)
+		return OERR;
+	return RCIF || OERR || io_pending;
+}
+
+char io_split() {
+	char r = 0;		// where we read
+	char w = 0;		// where we write, never ahead of r
+	char n = 1;
+	char c;
+	bit start = TRUE;
+	
+	while (1) {
+		c = io_in[r];
+		r++;
+		if (c == ' ' && start)
+			continue;
+		start = FALSE;
+		if (c == ';') {
+			c = '\0';
+			n++;
+			start = TRUE;
+		} else if (!c)
+			break;	// the end of the line
+		io_in[w] = c;
+		w++;
+	}
+	io_in[w] = '\0';
+	return n;
+}
+
+void io_resume() {
+	char i;
+	
+	io_lineAt -= io_nextAt;
+	inputPos -= io_nextAt;
+	for (i = 0; i < inputPos; i++)
+		io_in[i] = io_in[i + io_nextAt];
+	io_busy = FALSE;
+	io_flow();
+}
+
+void io_printAck() {
+	io_printStr(STR_ACK);
+	io_print(toString(io_seq));
+	io_printLater(STR_NEWLINE);
+}
+
+void io_printNak(char n) {
+	io_printStr(STR_NAK);
+	io_print(toString(io_seq));
+	io_printStr(STR_SPACE);
+	io_print(toString(n));
+	io_printLater(STR_NEWLINE);
+}
+
+const char * io_next(const char * s) {
+	while (*s)
+		s++;
+	return s + 1;
+}
+
+// Puts a character into io_out, only a part that doesn't fit waits for the transmitter
+void io_put(char c) {
+	if (io_outCount == IO_SIZE_OUT) {
+		while (!TXIF);
+		TXREG = io_out[io_outAt];
+		io_outAt = (io_outAt + 1) & (IO_SIZE_OUT - 1);
+		io_outCount--;
+	}
+	io_out[(io_outAt + io_outCount) & (IO_SIZE_OUT - 1)] = c;
+	io_outCount++;
+	io_later = TRUE;
+}
+
+void io_print(const char * s) {
+#if BUS_ENABLE
+	if (!bus_talk)
+		return;		// nobody asked, the line may be someone else's
+	PORT_BUS_DE = 1;
+#endif
+	while (*s) {
+		io_put(*s);
+		s++;
+	}
+}
+
+void io_printStr(unsigned long s) {
+	char c;
+	unsigned long f;
+	
+#if BUS_ENABLE
+	if (!bus_talk)
+		return;
+	PORT_BUS_DE = 1;
+#endif
+	
+	while (c = str_table[s]) {
+		if (c & 0x80) {
+			// a fragment, these only ever contain plain characters
+			f = str_frag[c & 0x7F];
+			while (c = str_table[f]) {
+				io_put(c);
+				f++;
+			}
+		} else
+			io_put(c);
+		s++;
+	}
+}
+
+void io_printLater(unsigned long s) {
+#if BUS_ENABLE
+	if (!bus_talk)
+		return;
+	PORT_BUS_DE = 1;
+#endif
+	io_laterAt = s;
+	io_laterInFrag = FALSE;
+	io_laterMsg = TRUE;
+	io_later = TRUE;
+}
+
+bit io_printMore() {
+	char c;
+	
+	if (io_outCount) {	// io_out came first
+		if (TXIF) {
+			TXREG = io_out[io_outAt];
+			io_outAt = (io_outAt + 1) & (IO_SIZE_OUT - 1);
+			io_outCount--;
+		}
+		return FALSE;
+	}
+	
+	while (io_laterMsg) {
+		if (io_laterInFrag) {
+			c = str_table[io_laterFrag];
+			if (!c) {
+				io_laterInFrag = FALSE;	// back to the message
+				continue;
+			}
+		} else {
+			c = str_table[io_laterAt];
+			if (!c) {
+				io_laterMsg = FALSE;
+				break;
+			}
+			if (c & 0x80) {
+				io_laterAt++;
+				io_laterFrag = str_frag[c & 0x7F];
+				io_laterInFrag = TRUE;
+				continue;
+			}
+		}
+		
+		// one at a time, TXIF only clears a cycle after TXREG is written
+		if (!TXIF)
+			return FALSE;
+		TXREG = c;
+		if (io_laterInFrag)
+			io_laterFrag++;
+		else
+			io_laterAt++;
+		return FALSE;
+	}
+	io_later = FALSE;
+	return TRUE;
+}
+
+bit cmdcmp(const char * a, const char * b) {
+	while (*a) {
+		if (*a != *b)
+			return FALSE;
+		a++;
+		b++;
+	}
+	return !*b || *b == ' ';	// not just the start of a longer word
+}
+
+uns32 stoi(const char * s) {
+	uns32 r = 0;
+	char d;
+	while (*s == ' ')
+		s++;
+	// abuse ASCII notation, numbers follow each other
+	while (*s >= '0' && *s <= '9') {
+		d = *s - '0';
+		if (r > 429496729 || (r == 429496729 && d > 5))
+			return 0;	// r * 10 + d would wrap around
+		r *= 10;
+		r += d;
+		s++;
+	}
+	while (*s == ' ')
+		s++;
+	if (*s)
+		return 0;	// there's more to it than a number
+	return r;
+}
+
+void io_printInt(int32 n) {
+	if (n < 0) {
+		io_printStr(STR_MINUS);
+		n = -n;
+	}
+	io_print(toString(n));
+}
+
+size2 const char * toString(uns32 n) {
+	char str[12];	// 4294967295 is max value, which requires 10 chars + 1 null char (and one more, as str[5] was somehow broken before)
+	str[11] = '\0';
+	int i = 10;
+	int t;
+	str[i] = '0';
+	do {
+		t = n % 10;
+		str[i--] = '0' + t;
+		n /= 10;
+	} while (n);
+	return &str[i + 1];
+}
+
+
+// Motor source
+#define MOTOR_DELAY() time_wait(1)
+
+int32 motor_position;
+unsigned long motor_nextPeriod;
+bit motor_nextDirection;
+bit motor_nextSize;
+bit motor_pending;
+
+#if MOTOR_PWM
+bit motor_pwm;
+unsigned long motor_pwmCycles;
+
+// Register values for the next period, worked out by motor_pwmPrepare() so that the interrupt only copies them
+unsigned long motor_pwmNextCycles;
+char motor_pwmPR2;
+char motor_pwmT2CON;
+char motor_pwmDuty;			// CCPR1L
+bit motor_pwmDC1B;			// DC1B1, DC1B0 is always 0 for 50% duty
+bit motor_pwmSecond;		// motor_pwmUpdate() did the first half of the switch
+
+#if MOTOR_PWM_COUNT
+unsigned long motor_pwmSteps;	// used by the interrupt only
+
+// Add the steps Timer1 counted to motor_position, n is a 16-bit variable to use
+#define MOTOR_PWM_COUNT_STEPS(n)	T1CON.0 = 0;				\
+									n.high8 = TMR1H;			\
+									n.low8 = TMR1L;				\
+									TMR1H = 0;					\
+									TMR1L = 0;					\
+									T1CON.0 = 1;				\
+									if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)	\
+										motor_position += n;	\
+									else						\
+										motor_position -= n
+#else
+#define MOTOR_PWM_COUNT_STEPS(n)
+#endif // MOTOR_PWM_COUNT
+
+#endif // MOTOR_PWM
+
+void motor_init() {
+	motor_position = 0;
+	motor_pending = 0;
+	
+#if MOTOR_PWM
+	motor_pwm = 0;
+	PSTRCON = 0;		// RC2 belongs to PORTC until a hardware run is started
+#endif
+	
+	TRISC &= ~0b111;	// '11111000' for outputs at motor-related pins
+	PORTC &= ~0b111;	// 'xxxxx000' for initial value
+}
+
+void motor_step() {
+	PORT_MOTOR_STEP = 1;
+	MOTOR_DELAY();
+	PORT_MOTOR_STEP = 0;
+	
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+		motor_position++;
+	else
+		motor_position--;
+	encoder_step();
+}
+
+void motor_latch() {
+	char i;
+	
+	motor_period = motor_nextPeriod;
+	motor_pending = 0;
+	
+	if (PORT_MOTOR_DIRECTION == motor_nextDirection && PORT_MOTOR_STEP_SIZE == motor_nextSize)
+		return;
+	
+	PORT_MOTOR_DIRECTION = motor_nextDirection;
+	PORT_MOTOR_STEP_SIZE = motor_nextSize;
+	for (i = MOTOR_SETTLE; i; i--);	// setup time of the driver
+}
+
+#if MOTOR_PWM
+
+// Works out register values for the given period, returns 0 if ECCP can't make it
+bit motor_pwmPrepare(unsigned long cycles) {
+	char prescale = 0b00;
+	
+	if (cycles < MOTOR_PWM_MIN_CYCLES || cycles > MOTOR_PWM_MAX_CYCLES)
+		return FALSE;
+	
+	motor_pwmNextCycles = cycles;
+	
+	// Timer2 counts to 256 at most, so slow periods need the prescaler
+	if (cycles > 1024) {
+		cycles >>= 4;
+		prescale = 0b10;	// 1:16
+	} else if (cycles > 256) {
+		cycles >>= 2;
+		prescale = 0b01;	// 1:4
+	}
+	
+	/*
+		Period = (PR2 + 1) * prescale cycles
+		Duty = (CCPR1L:DC1B) / 4 * prescale cycles, so for 50% duty CCPR1L:DC1B = 2 * (PR2 + 1)
+	*/
+	motor_pwmPR2 = cycles - 1;
+	motor_pwmT2CON = 0b100 | prescale;
+	motor_pwmDuty = cycles >> 1;
+	motor_pwmDC1B = cycles & 1;
+	return TRUE;
+}
+
+bit motor_pwmStart(unsigned long cycles) {
+	if (!motor_pwmPrepare(cycles))
+		return FALSE;
+	
+	motor_pwmStop();
+	motor_latch();
+	
+	motor_pwmCycles = cycles;
+	PR2 = motor_pwmPR2;
+	CCPR1L = motor_pwmDuty;
+	CCP1CON = 0b00001100;	// single output PWM, active high
+	CCP1CON.5 = motor_pwmDC1B;
+	
+#if MOTOR_PWM_COUNT
+	time_calCancel();		// Timer1 is ours now
+	TRISA.5 = 1;
+	TMR1H = 0;
+	TMR1L = 0;
+	T1CON = 0b00000011;		// Timer1 on, counting rising edges on T1CKI
+#endif
+	
+	TMR2 = 0;
+	TMR2IF = 0;
+	TMR2IE = 0;
+	PEIE = 1;
+	T2CON = motor_pwmT2CON;
+	PSTRCON = 0b00011000;	// steer the output to P1D (RC2), starting with the next period
+	
+	motor_pwm = 1;
+	return TRUE;
+}
+
+bit motor_pwmRetune(unsigned long cycles) {
+	while (TMR2IE);			// let a switch in progress finish (two periods at most), it's using the prepared values
+	
+	if (!motor_pwmPrepare(cycles))
+		return FALSE;
+	
+	motor_pwmSecond = 0;
+	TMR2IF = 0;				// start at the next period boundary
+	TMR2IE = 1;
+	return TRUE;
+}
+
+void motor_pwmUpdate() {
+	/*
+		The rising edge of a period is the step. Duty (CCPR1L:DC1B) is double buffered and
+		only used from the period after the one that just started, while PR2 is used right away.
+		So duty is written on one boundary and PR2 on the next, and both apply to the same period.
+		If DIR or !HSM change, that period is made without a pulse and they change at its start,
+		a whole period before the next step.
+	*/
+	TMR2IF = 0;
+	
+	if (!motor_pwmSecond) {
+		if (PORT_MOTOR_DIRECTION != motor_nextDirection || PORT_MOTOR_STEP_SIZE != motor_nextSize) {
+			CCPR1L = 0;
+			CCP1CON.5 = 0;
+		} else {
+			CCPR1L = motor_pwmDuty;
+			CCP1CON.5 = motor_pwmDC1B;
+		}
+		motor_pwmSecond = 1;
+		return;
+	}
+	
+	T2CON = motor_pwmT2CON;
+	PR2 = motor_pwmPR2;
+	if (TMR2 >= motor_pwmPR2)
+		TMR2 = motor_pwmPR2;	// we got here too late for a short period, end it now rather than after a wrap
+	
+	if (PORT_MOTOR_DIRECTION != motor_nextDirection || PORT_MOTOR_STEP_SIZE != motor_nextSize) {
+		MOTOR_PWM_COUNT_STEPS(motor_pwmSteps);	// no pulse in this period, so the count is settled
+		PORT_MOTOR_DIRECTION = motor_nextDirection;
+		PORT_MOTOR_STEP_SIZE = motor_nextSize;
+		CCPR1L = motor_pwmDuty;
+		CCP1CON.5 = motor_pwmDC1B;
+	}
+	
+	motor_pwmCycles = motor_pwmNextCycles;
+	motor_pwmSecond = 0;
+	TMR2IE = 0;
+}
+
+void motor_pwmStop() {
+#if MOTOR_PWM_COUNT
+	unsigned long n;
+#endif
+	
+	if (!motor_pwm)
+		return;
+	
+	// Any bit write of PORTC while P1D drove RC2 copied its level into the latch, so the latch is cleared
+	// before the pin goes back to it, with the interrupt that writes DIR and HSM out of the way
+	TMR2IE = 0;
+	PORT_MOTOR_STEP = 0;
+	PSTRCON = 0;			// RC2 is PORT_MOTOR_STEP again
+	CCP1CON = 0;
+	T2CON = 0;
+	
+	MOTOR_PWM_COUNT_STEPS(n);
+#if MOTOR_PWM_COUNT
+	T1CON = 0;
+#endif
+	motor_pwm = 0;
+	motor_pwmSecond = 0;
+}
+
+#endif // MOTOR_PWM
+
+
+// Power source
+uns32 power_sleeps;
+uns32 power_idleTicks;
+uns32 power_asleep;
+
+void power_init() {
+	power_sleeps = 0;
+	power_idleTicks = 0;
+	power_asleep = 0;
+}
+
+void power_sleep() {
+	char c, i;
+	bit slept = 0;
+#if BUS_ENABLE
+	bit address;
+#endif
+	bit rabie = RABIE;	// limit switches may be using interrupt-on-change too
+	
+	while (!TRMT);		// let the last character leave the shift register
+	
+	T0IE = 0;			// stop the tick, nothing needs it while we sleep
+	GIE = 0;			// wake up right after SLEEP instead of going to int_server()
+	if (!RCIDL || RCIF) {	// a character started coming in since io_idle(), it's EUSART's
+		T0IE = 1;
+		GIE = 1;
+		return;
+	}
+	CREN = 0;			// EUSART can't catch a start bit across the wake-up, we'll receive the first byte ourselves
+	
+	/*
+		We wake up on interrupt-on-change of RB5/Rx, that is on the falling edge of the start bit.
+		EUSART's own wake-up (WUE) would throw the first byte away, so we don't use it.
+		The watchdog wakes us up every POWER_WDT_TICKS or so as well, counting those tells how long we slept.
+	*/
+	WDTCON = POWER_WDTCON;
+	c = PORTB;			// end the mismatch condition
+	RABIF = 0;
+	IOCB.5 = 1;
+	RABIE = 1;
+	
+	// Timer2 will overflow once every bit, first time in the middle of the start bit.
+	// It's loaded before we sleep, all there's left to do after the wake-up is to start it.
+	PR2 = POWER_BIT_CYCLES - 1;
+	TMR2 = POWER_BIT_CYCLES / 2 + POWER_WAKE_CYCLES;
+	TMR2IF = 0;
+	
+	if (c.5) {			// unless the line is low already, then a start bit is under way and we go straight on
+		for (;;) {
+			sleep();
+			T2CON = 0b100;	// 1:1 prescale and postscale, timer on
+			if (TO)
+				break;	// SLEEP set it and the watchdog didn't clear it, so it's the start bit
+			power_asleep += POWER_WDT_TICKS;
+			if (RABIF)
+				break;	// it came while the watchdog woke us, a little after where Timer2 counts from
+			T2CON = 0;
+			TMR2 = POWER_BIT_CYCLES / 2 + POWER_WAKE_CYCLES;
+		}
+		slept = 1;
+	} else
+		T2CON = 0b100;
+	
+	while (!TMR2IF);
+	TMR2IF = 0;
+	
+	if (!PORTB.5) {		// still low, so it's a start bit and not a glitch
+		c = 0;
+		for (i = 0; i < 8; i++) {
+			while (!TMR2IF);
+			TMR2IF = 0;
+			c >>= 1;	// LSB comes first
+			if (PORTB.5)
+				c.7 = 1;
+		}
+		
+#if BUS_ENABLE
+		while (!TMR2IF);	// 9th bit, set for address bytes
+		TMR2IF = 0;
+		address = PORTB.5;
+#endif
+		
+		while (!TMR2IF);	// middle of the stop bit
+#if BUS_ENABLE
+		if (PORTB.5) {
+			if (address)
+				bus_address(c);
+			else if (!ADDEN)
+				io_pending = c;	// part of a frame for us, the rest of it comes through EUSART
+		}
+#else
+		if (PORTB.5)
+			io_pending = c;	// io_getInput() will pick it up before anything else
+#endif
+	}
+	
+	T2CON = 0;
+	CREN = 1;			// we're in the stop bit, EUSART will see the next start bit
+	WDTCON = POWER_WDTCON & ~1;	// SLEEP cleared it, a byte takes no time next to its period
+	
+	IOCB.5 = 0;
+	RABIE = rabie;
+	c = PORTB;
+	RABIF = 0;
+	
+	TMR0 = TIME_RESET;	// restart the tick
+	IF_TIME = 0;
+	T0IE = 1;
+	GIE = 1;
+	
+	power_sleeps++;
+	if (slept)
+		power_asleep += POWER_WDT_TICKS / 2;	// the start bit came about halfway through a period
+}
+
+
+// Prof source
+#if PROF_ENABLE
+
+char prof_region;
+unsigned long prof_min;
+unsigned long prof_max;
+unsigned long prof_start;
+unsigned long prof_last;
+
+void prof_init() {
+	T1CON = 0b00000001;		// Timer1 on, internal clock (one count per instruction cycle), 1:1 prescale
+	prof_select(PROF_ISR);
+}
+
+void prof_select(char r) {
+	prof_min = 0xFFFF;
+	prof_max = 0;
+	prof_region = r | PROF_WAIT;
+}
+
+bit prof_print(char part) {
+	char r;
+	
+	if (part)
+		return FALSE;
+	
+	r = prof_region & ~PROF_WAIT;
+	if (r == PROF_ISR)
+		io_printStr(STR_PROF_ISR);
+	else if (r == PROF_CHECK)
+		io_printStr(STR_PROF_CHECK);
+	else if (r == PROF_CMD)
+		io_printStr(STR_PROF_CMD);
+	else
+		io_printStr(STR_PROF_TICK);
+	
+	if (prof_max) {
+		io_print(toString(prof_min));
+		io_printStr(STR_SLASH);
+		io_print(toString(prof_max));
+		io_printLater(STR_PROF_CYCLES);
+	} else
+		io_printLater(STR_PROF_NO_SAMPLES);
+	return TRUE;
+}
+
+#endif // PROF_ENABLE
+
+
+// Sched source
+unsigned long sched_overruns[SCHED_TASKS];
+char sched_worst[SCHED_TASKS];
+unsigned long sched_since[SCHED_TASKS];
+unsigned long sched_tick;
+bit sched_line;
+bit sched_reply;
+
+const char sched_deadline[] = { SCHED_TICK_DEADLINE, 0, SCHED_COMMAND_DEADLINE, SCHED_CONSOLE_DEADLINE };
+
+void sched_init() {
+	char t;
+	
+	for (t = 0; t < SCHED_TASKS; t++) {
+		sched_overruns[t] = 0;
+		sched_worst[t] = 0;
+	}
+}
+
+char sched_next() {
+	if (sched_tick != time_now())
+		return SCHED_TICK;
+	if (io_received())
+		return SCHED_INPUT;		// even while a reply goes out, the next line waits behind it
+	if (sched_line)
+		return SCHED_COMMAND;
+	if ((sched_reply || io_later || io_notice) && TXIF)
+		return SCHED_CONSOLE;	// a notice goes out between replies
+	return SCHED_IDLE;
+}
+
+void sched_account(char task) {
+	unsigned long late = time_now() - sched_since[task];
+	
+	if (late > sched_deadline[task])
+		sched_overruns[task]++;
+	if (late > 0xFF)
+		late = 0xFF;
+	if (late.low8 > sched_worst[task])
+		sched_worst[task] = late.low8;
+}
+
+// Two parts per task, the overruns and the worst one
+bit sched_print(char part) {
+	char t = part >> 1;
+	
+	if (t >= SCHED_TASKS)
+		return FALSE;
+	
+	if (part & 1) {
+		if (t != SCHED_INPUT) {		// the receiver overran, by how much it can't tell
+			io_print(toString(sched_worst[t]));
+			io_printLater(STR_TICKS);
+		}
+		return TRUE;
+	}
+	
+	if (t == SCHED_TICK)
+		io_printStr(STR_TASK_TICK);
+	else if (t == SCHED_INPUT)
+		io_printStr(STR_TASK_INPUT);
+	else if (t == SCHED_COMMAND)
+		io_printStr(STR_TASK_COMMAND);
+	else
+		io_printStr(STR_TASK_CONSOLE);
+	
+	io_printStr(STR_LATE);
+	io_print(toString(sched_overruns[t]));
+	if (t == SCHED_INPUT)
+		io_printLater(STR_TIMES);
+	else
+		io_printLater(STR_TIMES_WORST);
+	return TRUE;
+}
+
+
+// Limit source
+#if LIMIT_ENABLE
+
+char limit_phase;
+char limit_report;
+bit limit_cw;					// clockwise limit switch closed since the last limit_check()
+bit limit_ccw;					// counterclockwise limit switch closed since the last limit_check()
+bit limit_atHome;				// home switch closed since homing last looked at it
+bit limit_direction;			// direction to go back to after homing
+unsigned long limit_period;		// period to go back to after homing
+
+void limit_init() {
+	char t;
+	
+	limit_phase = LIMIT_IDLE;
+	limit_report = LIMIT_REPORT_NONE;
+	limit_cw = 0;
+	limit_ccw = 0;
+	limit_atHome = 0;
+	
+	OPTION.7 = 0;				// enable weak pull-ups on PORTA/PORTB
+	WPUB.4 = 1;
+	WPUB.6 = 1;
+	
+	IOCB.4 = 1;					// interrupt on change for all the switches
+	IOCB.6 = 1;
+	IOCA.3 = 1;
+	
+	t = PORTA;					// end the mismatch condition
+	t = PORTB;
+	RABIF = 0;
+	RABIE = 1;
+}
+
+void limit_update() {
+#if MOTOR_PWM
+	bit hit;
+#endif
+	
+	// reading the pins ends the mismatch condition as well
+	if (!PORT_LIMIT_CW)
+		limit_cw = 1;
+	if (!PORT_LIMIT_CCW)
+		limit_ccw = 1;
+	if (!PORT_HOME)
+		limit_atHome = 1;
+	
+#if MOTOR_PWM
+	// ECCP doesn't wait for the core loop, so cut the step output right away
+	// the core loop will see the latched switch and do the rest
+	// the same way as motor_pwmStop(), the RC2 latch holds whatever level a PORTC write last found there
+	if (motor_pwm) {
+		hit = limit_ccw;
+		if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+			hit = limit_cw;
+		if (hit) {
+			TMR2IE = 0;
+			PORT_MOTOR_STEP = 0;
+			PSTRCON = 0;
+		}
+	}
+#endif
+}
+
+bit limit_check() {
+	bit hit = FALSE;
+	
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE) {
+		if (limit_cw || !PORT_LIMIT_CW)
+			hit = TRUE;
+	} else if (limit_ccw || !PORT_LIMIT_CCW)
+		hit = TRUE;
+	
+	limit_cw = 0;
+	limit_ccw = 0;
+	return hit;
+}
+
+void limit_home() {
+	limit_cancel();
+	motor_pwmStop();
+	
+	motor_steps = 0;
+	motor_counting = FALSE;
+	motor_enable = FALSE;
+	
+	// homing drives the motor through the same double buffer as commands do
+	limit_direction = motor_nextDirection;
+	limit_period = motor_nextPeriod;
+	motor_nextDirection = LIMIT_HOME_DIRECTION;
+	motor_nextPeriod = LIMIT_HOME_FAST;
+	motor_latch();
+	motor_enable = TRUE;
+	
+	limit_atHome = 0;
+	limit_phase = LIMIT_SEEK;
+}
+
+void limit_homeUpdate() {
+	if (limit_phase == LIMIT_SEEK) {
+		if (limit_atHome || !PORT_HOME) {
+			motor_nextDirection = !LIMIT_HOME_DIRECTION;
+			motor_latch();
+			motor_enable = FALSE;
+			motor_steps = LIMIT_BACKOFF_STEPS;
+			motor_counting = TRUE;
+			limit_phase = LIMIT_BACKOFF;
+		}
+	} else if (limit_phase == LIMIT_BACKOFF) {
+		if (motor_counting)
+			return;
+		if (!PORT_HOME) {
+			motor_steps = 1;	// still on the switch, keep going
+			motor_counting = TRUE;
+			return;
+		}
+		motor_nextDirection = LIMIT_HOME_DIRECTION;
+		motor_nextPeriod = LIMIT_HOME_SLOW;
+		motor_latch();
+		motor_enable = TRUE;
+		limit_atHome = 0;
+		limit_phase = LIMIT_CREEP;
+	} else if (limit_phase == LIMIT_CREEP) {
+		if (limit_atHome || !PORT_HOME) {
+			motor_position = 0;
+			limit_cancel();
+			limit_report = LIMIT_REPORT_HOMED;
+			io_notice = TRUE;
+		}
+	}
+}
+
+void limit_cancel() {
+	if (limit_phase == LIMIT_IDLE)
+		return;
+	
+	motor_enable = FALSE;
+	motor_steps = 0;
+	motor_counting = FALSE;
+	motor_nextDirection = limit_direction;
+	motor_nextPeriod = limit_period;
+	motor_latch();
+	limit_phase = LIMIT_IDLE;
+}
+
+void limit_print() {
+	if (limit_report == LIMIT_REPORT_HOMED)
+		io_printLater(STR_HOMED);
+	else if (limit_report == LIMIT_REPORT_FAILED)
+		io_printLater(STR_HOME_FAILED);
+	else
+		io_printLater(STR_LIMIT_HIT);
+	limit_report = LIMIT_REPORT_NONE;
+}
+
+#endif // LIMIT_ENABLE
+
+
+// Encoder source
+#if ENCODER_ENABLE
+
+int32 encoder_position;
+char encoder_window;
+unsigned long encoder_stalls;
+unsigned long encoder_period;
+char encoder_report;
+unsigned long encoder_last;		// Timer1 at the last step boundary
+unsigned long encoder_counted;	// counts in this window
+unsigned long encoder_expected;	// counts the steps of this window should have made
+char encoder_steps;				// steps in this window
+char encoder_backoffs;			// stalled windows in a row
+
+void encoder_init() {
+	encoder_position = 0;
+	encoder_window = ENCODER_WINDOW;
+	encoder_stalls = 0;
+	encoder_period = 0;
+	encoder_report = ENCODER_REPORT_NONE;
+	encoder_backoffs = 0;
+	encoder_reset();
+
+	TRISA.5 = 1;
+	TMR1H = 0;
+	TMR1L = 0;
+	encoder_last = 0;
+	T1CON = 0b00000011;			// Timer1 on, counting rising edges on T1CKI
+}
+
+void encoder_step() {
+	if (!encoder_window)
+		return;
+	encoder_steps++;
+	if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
+		encoder_expected += ENCODER_COUNTS;
+	else
+		encoder_expected += ENCODER_COUNTS / 2;
+}
+
+void encoder_reset() {
+	encoder_steps = 0;
+	encoder_counted = 0;
+	encoder_expected = 0;
+}
+
+// The window came up short by the given counts, returns 1 if the motor was slowed down
+bit encoder_stall(unsigned long missed) {
+	encoder_stalls++;
+
+	// in steps of the size it's making, those didn't move it and a step move has to make them again
+	if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
+		missed /= ENCODER_COUNTS;
+	else
+		missed /= ENCODER_COUNTS / 2;
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+		motor_position -= missed;
+	else
+		motor_position += missed;
+	if (motor_counting)
+		motor_steps += missed;
+
+	if ((motor_enable || motor_counting) && encoder_backoffs < ENCODER_BACKOFFS && motor_period <= 32767) {
+		encoder_backoffs++;
+		if (!encoder_period)
+			encoder_period = motor_nextPeriod;
+		motor_nextPeriod = motor_period << 1;	// over whatever speed asked for, that's what stalled it
+		motor_pending = TRUE;
+		encoder_report = ENCODER_REPORT_SLOWED;
+		io_notice = TRUE;
+		return TRUE;
+	}
+
+	motor_enable = FALSE;
+	motor_steps = 0;
+	motor_counting = FALSE;
+	encoder_report = ENCODER_REPORT_STOPPED;
+	io_notice = TRUE;
+	return FALSE;
+}
+
+bit encoder_update() {
+	unsigned long t;
+	bit slowed = FALSE;
+
+	do {
+		t.high8 = TMR1H;
+		t.low8 = TMR1L;
+	} while (t.high8 != TMR1H);
+	t -= encoder_last;			// Timer1 wraps, the difference doesn't
+	encoder_last += t;
+
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+		encoder_position += t;
+	else
+		encoder_position -= t;
+
+	if (!encoder_steps)
+		encoder_counted = 0;	// nothing was asked of it, whatever turned the shaft isn't checked
+	else {
+		encoder_counted += t;
+		if (encoder_steps < encoder_window && (motor_enable || motor_counting))
+			return FALSE;
+
+		if (encoder_counted + ENCODER_SLACK < encoder_expected)
+			slowed = encoder_stall(encoder_expected - encoder_counted);
+		else
+			encoder_backoffs = 0;
+		encoder_reset();
+	}
+
+	if (!motor_enable && !motor_counting)
+		encoder_restore();
+	return slowed;
+}
+
+void encoder_restore() {
+	if (!encoder_period)
+		return;
+	motor_nextPeriod = encoder_period;
+	motor_pending = TRUE;
+	encoder_period = 0;
+}
+
+void encoder_print() {
+	if (encoder_report == ENCODER_REPORT_SLOWED) {
+		io_printStr(STR_STALLED_SLOWING);
+		io_print(toString(motor_nextPeriod));
+		io_printLater(STR_TICKS);
+	} else {
+		io_printStr(STR_STALLED_AT);
+		io_printInt(motor_position);
+		io_printLater(STR_STEPS);
+	}
+	encoder_report = ENCODER_REPORT_NONE;
+}
+
+#endif // ENCODER_ENABLE
+
+
+// Queue source
+#if QUEUE_ENABLE
+
+char queue_count;
+unsigned long queue_tick[QUEUE_SIZE];
+char queue_cmd[QUEUE_SIZE];
+unsigned long queue_arg[QUEUE_SIZE];
+unsigned long queue_late;
+bit queue_timed;
+char queue_nextCmd;
+unsigned long queue_nextArg;
+
+void queue_init() {
+	queue_count = 0;
+	queue_late = 0;
+	queue_timed = FALSE;
+}
+
+void queue_clear() {
+	queue_count = 0;
+	queue_timed = FALSE;
+}
+
+// How far off a deadline is, one that has passed is due now
+unsigned long queue_ahead(unsigned long tick, unsigned long now) {
+	tick -= now;
+	if (tick & 0x8000)
+		return 0;
+	return tick;
+}
+
+bit queue_add(unsigned long tick, char cmd, unsigned long arg) {
+	char i;
+	unsigned long now = time_now();	// once, the interrupt moves it on
+	unsigned long ahead = queue_ahead(tick, now);
+
+	if (queue_count == QUEUE_SIZE)
+		return FALSE;
+
+	// The ones that are due sooner (or as soon, they came first) move up to make room
+	for (i = queue_count; i; i--) {
+		if (queue_ahead(queue_tick[i - 1], now) > ahead)
+			break;
+		queue_tick[i] = queue_tick[i - 1];
+		queue_cmd[i] = queue_cmd[i - 1];
+		queue_arg[i] = queue_arg[i - 1];
+	}
+	queue_tick[i] = tick;
+	queue_cmd[i] = cmd;
+	queue_arg[i] = arg;
+	queue_count++;
+	return TRUE;
+}
+
+bit queue_due(unsigned long tick) {
+	if (!queue_count)
+		return FALSE;
+	tick -= queue_tick[queue_count - 1];
+	return !(tick & 0x8000);	// it's not ahead of the tick
+}
+
+void queue_take(unsigned long tick) {
+	queue_count--;
+	if (queue_tick[queue_count] != tick)
+		queue_late++;
+	queue_nextCmd = queue_cmd[queue_count];
+	queue_nextArg = queue_arg[queue_count];
+}
+
+// Two parts for the count, then one for each command
+bit queue_print(char part, bit list) {
+	char i;
+
+	if (part == 0) {
+		io_printStr(STR_TICK_IS);
+		io_print(toString(time_now()));
+		io_printStr(STR_COMMA);
+		io_print(toString(queue_count));
+		io_printLater(STR_QUEUED_LATE);
+		return TRUE;
+	}
+	if (part == 1) {
+		io_print(toString(queue_late));
+		io_printLater(STR_TIMES);
+		return TRUE;
+	}
+	part -= 2;
+	if (!list || part >= queue_count)
+		return FALSE;	// the tick task may have taken some off since the first part
+
+	i = queue_count - 1 - part;
+	io_printStr(STR_AT);
+	io_print(toString(queue_tick[i]));
+	switch (queue_cmd[i]) {
+
+	case CMD_START:
+		io_printStr(STR_AT_START);
+	break;
+
+	case CMD_STOP:
+		io_printStr(STR_AT_STOP);
+	break;
+
+	case CMD_SPEED:
+		io_printStr(STR_AT_SPEED);
+		io_print(toString(queue_arg[i]));
+	break;
+
+	case CMD_DIR:
+		io_printStr(STR_AT_DIR);
+		if (queue_arg[i] == MOTOR_COUNTERCLOCKWISE)
+			io_printStr(STR_CC);
+		else
+			io_printStr(STR_CW);
+	break;
+
+	case CMD_SIZE:
+		io_printStr(STR_AT_SIZE);
+		if (queue_arg[i] == MOTOR_FULL_STEP)
+			io_printStr(STR_FULL);
+		else
+			io_printStr(STR_HALF);
+	break;
+
+	case CMD_STEP:
+		io_printStr(STR_AT_STEP);
+		io_print(toString(queue_arg[i]));
+	break;
+	}
+	io_printLater(STR_NEWLINE);
+	return TRUE;
+}
+
+#endif // QUEUE_ENABLE
+
+
+// Bus source
+#if BUS_ENABLE
+
+char bus_id;
+bit bus_talk;
+
+// The stored ID, or the one the jumpers make if none is stored
+void bus_readId() {
+	EEADR = BUS_EE_ID;
+	EEPGD = 0;
+	RD = 1;
+	bus_id = EEDAT;
+	if (bus_id == 0xFF || bus_id == BUS_BROADCAST) {
+		bus_id = 1;
+		if (!PORT_BUS_ID0)
+			bus_id += 1;
+		if (!PORT_BUS_ID1)
+			bus_id += 2;
+	}
+}
+
+void bus_init() {
+	TRISC.3 = 0;
+	PORT_BUS_DE = 0;
+	TRISC.6 = 1;
+	TRISC.7 = 1;
+	
+	bus_readId();
+	bus_talk = FALSE;
+	ADDEN = 1;			// only address bytes get through until one of them is ours
+}
+
+void bus_address(char a) {
+	if (a == bus_id || a == BUS_BROADCAST) {
+		ADDEN = 0;		// the line that follows is for us
+		bus_talk = a == bus_id;
+	} else {
+		ADDEN = 1;		// someone else's frame, a line of ours that got cut short is dropped with it
+		bus_talk = FALSE;
+	}
+	inputPos = io_lineAt;
+	io_tooLong = FALSE;
+	io_lost = FALSE;
+}
+
+void bus_release() {
+	if (!bus_talk)
+		return;
+	while (!TRMT);		// the stop bit of the last character is out
+	PORT_BUS_DE = 0;
+	bus_talk = FALSE;
+}
+
+void bus_setId(char id) {
+	EEADR = BUS_EE_ID;
+	EEDAT = id;
+	EEPGD = 0;
+	WREN = 1;
+	GIE = 0;			// the unlock sequence must not be interrupted
+	EECON2 = 0x55;
+	EECON2 = 0xAA;
+	WR = 1;
+	GIE = 1;
+	WREN = 0;
+	while (WR);			// a few milliseconds
+	
+	bus_readId();
+}
+
+#endif // BUS_ENABLE
+
+
+// Trigger source
+#if TRIGGER_ENABLE
+
+char trigger_phase;
+bit trigger_start;
+uns32 trigger_steps;
+
+#if BUS_ENABLE
+bit trigger_heard;
+char trigger_address;
+#endif
+
+void trigger_init() {
+	trigger_phase = TRIGGER_IDLE;
+	trigger_start = 0;
+	trigger_steps = 0;
+#if BUS_ENABLE
+	trigger_heard = 0;
+#endif
+
+	TRISA.2 = 1;
+	OPTION.7 = 0;				// enable weak pull-ups on PORTA/PORTB
+	WPUA.2 = 1;
+	OPTION.6 = 0;				// INT on the falling edge
+	INTE = 0;
+}
+
+void trigger_arm() {
+	motor_pwmStop();
+	motor_enable = FALSE;
+	motor_steps = 0;
+	motor_counting = FALSE;
+
+	trigger_start = 0;
+	trigger_steps = 0;
+	trigger_phase = TRIGGER_ARMED;
+	INTF = 0;					// an edge from before doesn't count
+	INTE = 1;
+#if BUS_ENABLE
+	PEIE = 1;
+	trigger_listen();
+#endif
+}
+
+void trigger_disarm() {
+	INTE = 0;
+#if BUS_ENABLE
+	RCIE = 0;
+#endif
+	trigger_phase = TRIGGER_IDLE;
+	trigger_start = 0;
+	trigger_steps = 0;
+}
+
+void trigger_fire() {
+	/*
+		The tick starts over, the one that was due is dropped with it.
+		The interrupt gets here in the same number of cycles on every controller, so their ticks line up
+		to within a cycle or two of the trigger.
+	*/
+	TMR0 = TIME_RESET;
+	IF_TIME = 0;
+	INTE = 0;
+	INTF = 0;
+#if BUS_ENABLE
+	RCIE = 0;
+#endif
+	trigger_phase = TRIGGER_FIRED;	// time_update() moves it on
+}
+
+void trigger_release() {
+	trigger_phase = TRIGGER_IDLE;
+	if (trigger_start) {
+		motor_enable = TRUE;
+#if MOTOR_PWM
+		if (motor_nextPeriod <= MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES)
+			motor_pwmStart(motor_nextPeriod * TIME_TICK_CYCLES);
+#endif
+	} else if (trigger_steps) {
+		motor_steps = trigger_steps;
+		motor_counting = TRUE;
+	}
+	trigger_start = 0;
+	trigger_steps = 0;
+}
+
+#if BUS_ENABLE
+
+void trigger_receive() {
+	RCIE = 0;					// trigger_listen() turns it back on
+	if (!RX9D)
+		return;					// data of a frame for us, io_getInput() reads it
+	trigger_address = RCREG;
+	if (trigger_address == BUS_TRIGGER) {
+		if (trigger_phase == TRIGGER_ARMED)
+			trigger_fire();
+		return;
+	}
+	trigger_heard = 1;
+}
+
+void trigger_listen() {
+	if (trigger_phase == TRIGGER_ARMED && !RCIF && !trigger_heard)
+		RCIE = 1;
+}
+
+#endif // BUS_ENABLE
+
+#endif // TRIGGER_ENABLE
+
+
+
+// Program entry point
+void main(void) {
+
+	time_init();
+	io_init();
+	motor_init();
+	power_init();
+#if PROF_ENABLE
+	prof_init();
+#endif
+#if LIMIT_ENABLE
+	limit_init();
+#endif
+#if TRIGGER_ENABLE
+	trigger_init();
+#endif
+#if ENCODER_ENABLE
+	encoder_init();
+#endif
+#if QUEUE_ENABLE
+	queue_init();
+#endif
+	
+	ANSEL = 0;	// we don't need any AD-inputs
+	ANSELH = 0;
+#if BUS_ENABLE
+	bus_init();	// after ANSELH, the ID jumpers are on analog pins
+#endif
+	GIE = 1;	// enable interrupts
+	
+	motor_enable = FALSE;
+	motor_steps = 0;
+	motor_counting = FALSE;
+	motor_nextDirection = MOTOR_CLOCKWISE;
+	motor_nextSize = MOTOR_FULL_STEP;
+	motor_nextPeriod = 781;	// half second period
+	motor_latch();
+	
+	sched_init();
+	sched_tick = time_now();
+	sched_line = FALSE;
+	sched_reply = FALSE;
+	batchChecking = FALSE;
+	batchRunning = FALSE;
+	motor_tick = 0;
+	noticePart = 0;
+	io_echo = FALSE;
+	quiet = FALSE;
+	
+	// Core loop, see sched.h for the tasks
+	while (1) {
+		PORTC.5 = RCIF;
+		trigger_listen();
+		
+		switch (sched_next()) {
+		
+		case SCHED_TICK:
+			runTick();
+		break;
+		
+		case SCHED_INPUT:
+			if (io_getInput()) {
+				sched_line = TRUE;
+				sched_since[SCHED_COMMAND] = time_now();
+			}
+		break;
+		
+		case SCHED_COMMAND:
+			sched_account(SCHED_COMMAND);
+			if (runBatch())
+				sched_since[SCHED_COMMAND] = time_now();	// the next command of it, after whatever is due first
+			else {
+				sched_line = FALSE;
+				sched_reply = TRUE;
+				sched_since[SCHED_CONSOLE] = time_now();
+			}
+		break;
+		
+		case SCHED_CONSOLE:
+			if (sched_reply)
+				sched_account(SCHED_CONSOLE);	// nobody waits on a notice
+			if (io_printMore()) {	// all of the part is out
+				if (noticePart || !sched_reply)
+					noticeNext();	// one that has begun goes on, new ones wait for the reply
+				else if (!replyNext()) {
+					sched_reply = FALSE;
+					bus_release();	// that was the last of it
+					io_resume();
+				}
+			}
+			sched_since[SCHED_CONSOLE] = time_now();
+		break;
+		
+		case SCHED_IDLE:
+#if POWER_IDLE_SLEEP
+			// Nothing to step and nothing to receive, so there's no point in spinning
+#if TIME_CALIBRATE
+			if (!motor_enable && !motor_counting && io_idle() && !sched_reply && !io_later && !io_notice && !time_calRunning && trigger_phase == TRIGGER_IDLE && limit_phase == LIMIT_IDLE && !queue_timed) {	// the timers stop in sleep
+#else
+			if (!motor_enable && !motor_counting && io_idle() && !sched_reply && !io_later && !io_notice && trigger_phase == TRIGGER_IDLE && limit_phase == LIMIT_IDLE && !queue_timed) {
+#endif
+				power_sleep();
+				sched_tick = time_now();	// ticks didn't run while asleep
+			}
+#endif
+		break;
+		}
+	}
+}
+
+// Everything that happens once a tick, the step first of all
+void runTick() {
+	unsigned long now;
+	unsigned long elapsed;	// ticks since the last run, more than one when a task below took long
+	
+	sched_since[SCHED_TICK] = sched_tick + 1;
+	sched_account(SCHED_TICK);
+	now = time_now();		// once, both have to be of the same tick
+	elapsed = now - sched_tick;
+	sched_tick = now;		// right away, a step takes until the next tick (MOTOR_DELAY) and that one counts too
+	
+	PROF_BEGIN(PROF_TICK);
+	
+	if (!motor_enable && !motor_counting)
+		power_idleTicks++;
+	
+#if TIME_CALIBRATE
+	if (time_calRunning && time_calDone)
+		time_calFinish();
+#endif
+	
+#if TRIGGER_ENABLE
+	if (trigger_phase == TRIGGER_DUE) {
+		trigger_release();
+		motor_tick = motor_period - 1;	// so the first step is on this tick, the first one after the trigger
+	}
+#endif
+	
+#if QUEUE_ENABLE
+	// Timed commands, before the step so that a move they start makes its first step on their tick
+	// (a batch that is part way runs to the end first)
+	while (!batchRunning && queue_due(sched_tick))
+		runQueued();
+#endif
+	
+	// Ticks a task below kept us from count too, a step is late then but the ones after it aren't
+	// A move a batch starts from standstill waits for all of it to run (see runBatch())
+	motor_tick += elapsed;
+	if (motor_tick >= motor_period && !(batchRunning && batchStopped)) {	// not ==, so that a shorter period can't be skipped past
+		motor_tick -= motor_period;
+		
+#if ENCODER_ENABLE
+		if (encoder_update())
+			sched_tick = time_now();	// it fell behind as it was, the ticks that took aren't caught up on
+#endif
+		
+#if LIMIT_ENABLE
+		limit_homeUpdate();
+		
+		if ((motor_enable || motor_counting) && limit_check()) {
+			motor_pwmStop();
+			motor_enable = FALSE;
+			motor_steps = 0;
+			motor_counting = FALSE;
+			
+			if (limit_phase)
+				limit_report = LIMIT_REPORT_FAILED;
+			else
+				limit_report = LIMIT_REPORT_HIT;
+			io_notice = TRUE;
+			limit_cancel();
+		}
+#endif
+
+		// Step boundary, switch to whatever the commands asked for, a batch once all of it has run
+#if MOTOR_PWM
+		if (motor_pending && !batchRunning && !motor_pwm)	// ECCP switches on its own, in motor_pwmUpdate()
+#else
+		if (motor_pending && !batchRunning)
+#endif
+			motor_latch();
+		if (motor_tick > motor_period - MOTOR_MIN_PERIOD)
+			motor_tick = motor_period - MOTOR_MIN_PERIOD;	// catching up, but never two steps closer than the driver takes
+
+#if MOTOR_PWM
+		if (motor_enable && !motor_pwm)
+#else
+		if (motor_enable)
+#endif
+			motor_step();
+
+		if (motor_counting) {
+			// only the low half changes on most steps, the high half just takes the borrow
+			if (!motor_steps.low16)
+				motor_steps.high16--;
+			motor_steps.low16--;
+			if (!motor_steps.low16 && !motor_steps.high16)
+				motor_counting = FALSE;
+			motor_step();
+		}
+	}
+	
+	PROF_END(PROF_TICK);
+}
+
+// Checks or runs the next command of the line in io_in, one a pass so that the tick goes on in between, returns 0
+// once all of it is done and the console task can put out its reply (see replyNext())
+bit runBatch() {
+	uns32 arg;
+	unsigned long behind;
+	
+	if (batchChecking) {
+		PROF_RESUME(PROF_CHECK);
+		// parseInput updates cmd (this is due to compiler limitations, otherwise I'd make it return a value)
+		parseInput(replyAt);
+		if (*replyAt && !checkCommand()) {
+			replyBad = batchCount - batchLeft + 1;
+			batchChecking = FALSE;
+			replyAt = io_in;
+			PROF_END(PROF_CHECK);
+			return FALSE;
+		}
+		replyAt = io_next(replyAt);
+		batchLeft--;
+		if (batchLeft) {
+			PROF_PAUSE(PROF_CHECK);
+			return TRUE;
+		}
+		PROF_END(PROF_CHECK);
+		batchChecking = FALSE;
+		batchRunning = TRUE;	// all of it is right, the next pass runs it from the start
+		batchLeft = batchCount;
+		replyAt = io_in;
+		return TRUE;
+	}
+	
+	if (!batchRunning) {	// the line has just come
+		replyAt = io_in;
+		replyLeft = 0;
+		replyPart = 0;
+		replyBad = 0;
+		replyHead = TRUE;
+		replyRan = FALSE;
+		replyAck = io_acks;		// "ack on" doesn't ack its own line
+		replyNoted = FALSE;
+		replyStatus = FALSE;
+		if (io_dropped) {
+			io_dropped = FALSE;
+			return FALSE;
+		}
+		
+		// A line can hold several commands separated by ';', a batch runs all or nothing
+		// so it's checked as a whole before any of it runs (with acks on, so is a single command)
+		PROF_BEGIN(PROF_CHECK);
+		batchCount = io_split();
+		batchLeft = batchCount;
+		batchChecked = batchCount > 1 || io_acks;
+		batchChecking = batchChecked;
+		batchRunning = !batchChecked;
+#if QUEUE_ENABLE
+		atBatch = 0;
+#endif
+		if (batchChecked) {
+			PROF_PAUSE(PROF_CHECK);
+		} else {
+			PROF_END(PROF_CHECK);
+		}
+		return TRUE;
+	}
+	
+	if (batchLeft == batchCount) {	// the first command to run
+		PROF_BEGIN(PROF_CMD);
+		replyRan = TRUE;
+		replyLeft = batchCount;
+		replyQuiet = batchCount > 1 || quiet;	// a batch gets one status line instead
+#if MOTOR_PWM
+		batchRetune = FALSE;
+		batchRetuneSpeed = FALSE;
+#endif
+		batchStopped = !motor_enable && !motor_counting;
+		if (batchStopped)
+			encoder_restore();
+	} else {
+		PROF_RESUME(PROF_CMD);
+	}
+	parseInput(replyAt);
+	replyAt = io_next(replyAt);
+	
+	// Help, info and the other queries only print, replyPrint() has the rest of what each command says
+	switch (cmd) {
+	
+	case CMD_START:
+		limit_cancel();
+#if TRIGGER_ENABLE
+		if (trigger_phase != TRIGGER_IDLE) {
+			trigger_start = TRUE;	// trigger_release() starts it
+			trigger_steps = 0;
+			replyInstead(STR_ARMED);
+			break;
+		}
+#endif
+		motor_enable = TRUE;
+#if MOTOR_PWM
+		// if ECCP can't make this period, the core loop will do the stepping
+		if (motor_nextPeriod <= MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES)
+			motor_pwmStart(motor_nextPeriod * TIME_TICK_CYCLES);
+#endif
+	break;
+	
+	case CMD_STOP:
+		limit_cancel();
+		trigger_disarm();
+		motor_pwmStop();
+		motor_enable = FALSE;
+		motor_steps = 0;
+		motor_counting = FALSE;
+	break;
+	
+	case CMD_SPEED:
+		arg = stoi(pArg);
+		if (arg >= MOTOR_MIN_PERIOD && arg <= 65535) {		// shorter periods are above rated pulserate
+			limit_cancel();
+			encoder_forget();
+			motor_nextPeriod = arg;	// the current period runs out first
+			motor_pending = TRUE;
+#if MOTOR_PWM
+			batchRetune = TRUE;
+			batchRetuneSpeed = TRUE;
+#endif
+		}
+	break;
+	
+	case CMD_DIR:
+		if (*pArg) {
+			limit_cancel();
+			if (cmdcmp(" cc", pArg))
+				motor_nextDirection = MOTOR_COUNTERCLOCKWISE;
+			else if (cmdcmp(" cw", pArg))
+				motor_nextDirection = MOTOR_CLOCKWISE;
+			else
+				replyAlso(STR_UNKNOWN_DIRECTION);
+			motor_pending = TRUE;
+#if MOTOR_PWM
+			batchRetune = TRUE;
+#endif
+		}
+	break;
+	
+	case CMD_SIZE:
+		if (*pArg) {
+			limit_cancel();
+			if (cmdcmp(" full", pArg))
+				motor_nextSize = MOTOR_FULL_STEP;
+			else if (cmdcmp(" half", pArg))
+				motor_nextSize = MOTOR_HALF_STEP;
+			else
+				replyAlso(STR_UNKNOWN_STEP_SIZE);
+			motor_pending = TRUE;
+#if MOTOR_PWM
+			batchRetune = TRUE;
+#endif
+		}
+	break;
+	
+	case CMD_STEP:
+		arg = stoi(pArg);
+#if TRIGGER_ENABLE
+		if (arg && trigger_phase != TRIGGER_IDLE) {
+			trigger_steps = arg;	// trigger_release() runs them
+			trigger_start = FALSE;
+			replyInstead(STR_ARMED);
+			break;
+		}
+#endif
+		if (arg) {
+			limit_cancel();
+			motor_pwmStop();
+			motor_steps = arg;
+			motor_counting = TRUE;
+			motor_enable = FALSE;
+		} else if (*pArg)
+			replyAlso(STR_STEPS_RANGE);
+	break;
+	
+#if PROF_ENABLE
+	case CMD_PROF:
+		if (cmdcmp(" isr", pArg))
+			prof_select(PROF_ISR);
+		else if (cmdcmp(" check", pArg))
+			prof_select(PROF_CHECK);
+		else if (cmdcmp(" cmd", pArg))
+			prof_select(PROF_CMD);
+		else if (cmdcmp(" tick", pArg))
+			prof_select(PROF_TICK);
+		else if (cmdcmp(" reset", pArg))
+			prof_select(prof_region & ~PROF_WAIT);
+	break;
+#endif
+	
+#if LIMIT_ENABLE
+	case CMD_HOME:
+		limit_home();
+	break;
+#endif
+	
+#if MOTOR_PWM
+	case CMD_RATE:
+		arg = stoi(pArg);
+		if (arg >= MOTOR_PWM_MIN_RATE && arg <= MOTOR_PWM_MAX_RATE) {
+			limit_cancel();
+			motor_steps = 0;
+			motor_counting = FALSE;
+			motor_enable = TRUE;
+			motor_pwmStart(TIME_CYCLE_RATE / arg);
+		}
+	break;
+#endif
+	
+#if TIME_CALIBRATE
+	case CMD_CAL:
+#if MOTOR_PWM && MOTOR_PWM_COUNT
+		if (motor_pwm) {
+			replyInstead(STR_CAL_BUSY);
+			break;
+		}
+#endif
+		time_calStart();
+	break;
+#endif
+	
+#if ENCODER_ENABLE
+	case CMD_STALL:
+		arg = stoi(pArg);
+		if (*pArg && arg <= 0xFF) {
+			encoder_window = arg;
+			encoder_reset();
+		}
+	break;
+#endif
+	
+	case CMD_TASKS:
+		if (cmdcmp(" reset", pArg))
+			sched_init();
+	break;
+	
+	case CMD_QUIET:
+		if (cmdcmp(" on", pArg))
+			quiet = TRUE;
+		else if (cmdcmp(" off", pArg))
+			quiet = FALSE;
+	break;
+	
+	case CMD_ACK:
+		if (cmdcmp(" on", pArg))
+			io_acks = TRUE;
+		else if (cmdcmp(" off", pArg))
+			io_acks = FALSE;
+	break;
+	
+#if !BUS_ENABLE
+	case CMD_FLOW:
+		if (cmdcmp(" on", pArg))
+			io_xon = TRUE;		// XON goes out once this line is done
+		else if (cmdcmp(" off", pArg))
+			io_xon = FALSE;
+	break;
+#endif
+	
+#if BUS_ENABLE
+	case CMD_ID:
+		arg = stoi(pArg);
+		if (arg && arg <= 0xFF)
+			bus_setId(arg);
+	break;
+#endif
+	
+#if TRIGGER_ENABLE
+	case CMD_ARM:
+		limit_cancel();
+		trigger_arm();
+	break;
+#endif
+	
+#if QUEUE_ENABLE
+	case CMD_AT:
+		queue_timed = TRUE;	// until at clear, the host plans against the tick
+		if (!*pArg)
+			break;	// a query then
+		if (cmdcmp(" clear", pArg))
+			queue_clear();
+		else if (!parseAt() || (!batchChecked && !atAhead()))
+			replyAlso(STR_AT_RANGE);
+		else if (!queue_add(atTick, cmd, atArg))	// a checked deadline that has passed since runs on the next tick
+			replyAlso(STR_QUEUE_FULL);
+	break;
+	
+	case CMD_TICK:
+		queue_timed = TRUE;
+	break;
+#endif
 	}
 	
-	return 0;
+	batchLeft--;
+	if (batchLeft) {
+		PROF_PAUSE(PROF_CMD);
+		return TRUE;
+	}
+	batchRunning = FALSE;
+	replyAt = io_in;
+	
+#if MOTOR_PWM
+	// All of the batch goes to ECCP in one switch, if it can't make the new period the core loop takes over
+	if (motor_pwm && batchRetune) {
+		if (!batchRetuneSpeed)
+			motor_pwmRetune(motor_pwmCycles);
+		else if (motor_nextPeriod > MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES || !motor_pwmRetune(motor_nextPeriod * TIME_TICK_CYCLES))
+			motor_pwmStop();
+	}
+#endif
+	
+	// Nothing is stepping (or was until now), so there's no step to wait for
+	if (motor_pending && (batchStopped || (!motor_enable && !motor_counting)))
+		motor_latch();
+	
+	// A move from standstill makes its first step on the next tick, not whenever the idle period runs out,
+	// the ticks the batch took came before the move and runTick() isn't to catch up on them
+	if (batchStopped) {
+		behind = time_now() - sched_tick;	// as runTick() counts them
+		motor_tick = motor_period - 1 - behind;
+	}
+	
+	replyStatus = batchCount > 1 && !quiet;
+	PROF_END(PROF_CMD);
+	return FALSE;
 }
 
-void io_print(const char * s) {
-	while (*s) {
-		while (!TRMT);	// wait until character is transmitted
-		TXREG = *s;
-		s++;
-	}
+// The command has something to say before its answer, only a single one with quiet off says it
+void replyAlso(unsigned long s) {
+	if (replyQuiet)
+		return;
+	replyNoted = TRUE;
+	replyNote = s;
 }
 
-bit strcmp(const char * a, const char * b) {
-	char ac, bc;
-	while (*a) {
-		ac = *a;
-		bc = *b;
-		if (ac != bc)
-			return FALSE;	// Hit a different char
-		a++;
-		b++;
-	}
-	return TRUE;	// Hit a null-char
+// The same, in place of its answer
+void replyInstead(unsigned long s) {
+	replyAlso(s);
+	if (!replyQuiet)
+		replyLeft = 0;
 }
 
-unsigned long stoi(const char * s) {
-	unsigned long r = 0;
-	while (*s) {
-		// abuse ASCII notation, numbers follow each other
-		if (*s >= '0' && *s <= '9') {
-			r *= 10;
-			r += *s - '0';
+// Starts the next part of the reply to the line runBatch() ran, returns 0 once there's none left
+bit replyNext() {
+	bit more;
+	
+	if (replyHead) {
+		replyHead = FALSE;
+		if (!replyRan) {
+			// what's left of a line that was dropped could be a command of its own, none of it ran
+			if (replyAck)
+				io_printNak(replyBad);
+			else if (replyBad) {
+				io_printStr(STR_ERR);
+				io_print(toString(replyBad));
+				io_printLater(STR_NEWLINE);
+			} else
+				io_printLater(STR_LINE_TOO_LONG);
+			return TRUE;
+		}
+		if (replyAck) {
+			io_printAck();	// before the replies
+			return TRUE;
 		}
-		s++;
 	}
-	return r;
+	
+	if (replyNoted) {
+		replyNoted = FALSE;
+		io_printLater(replyNote);
+		return TRUE;
+	}
+	
+	while (replyLeft) {
+		if (!replyPart)
+			parseInput(replyAt);
+		if (cmd == CMD_HELP)
+			more = helpNext();
+		else if (cmd == CMD_INFO)
+			more = infoNext();
+		else
+			more = replyPrint();
+		if (more) {
+			replyPart++;
+			return TRUE;
+		}
+		replyPart = 0;
+		replyAt = io_next(replyAt);
+		replyLeft--;
+	}
+	
+	if (replyStatus) {
+		if (printStatus(replyPart)) {
+			replyPart++;
+			return TRUE;
+		}
+		replyStatus = FALSE;
+	}
+	return FALSE;
 }
 
-size2 const char * toString(unsigned long n) {
-	char str[12];	// 6 + 6, because str[5] is somehow broken (no idea why) 65535 is max value, which requires 5 chars + 1 null char
-	str[11] = '\0';
-	int i = 10;
-	int t;
-	str[i] = '0';
-	do {
-		t = n % 10;
-		str[i--] = '0' + t;
-		n /= 10;
-	} while (n);
-	return &str[i + 1];
+// Starts the next part of the answer to cmd (but help and info), returns 0 once there's none left
+bit replyPrint() {
+	uns32 a;
+	
+	// Queries answer in a batch and with quiet on as well
+	switch (cmd) {
+	
+#if PROF_ENABLE
+	case CMD_PROF:
+		return prof_print(replyPart);
+#endif
+	
+	case CMD_TASKS:
+		return sched_print(replyPart);
+	
+#if QUEUE_ENABLE
+	case CMD_AT:
+		if (*pArg && replyQuiet)
+			return FALSE;
+		return queue_print(replyPart, !*pArg);	// the query lists what's waiting
+	
+	case CMD_TICK:
+		if (replyPart)
+			return FALSE;
+		io_printStr(STR_TICK_IS);
+		io_print(toString(time_now()));
+		io_printLater(STR_NEWLINE);
+		return TRUE;
+#endif
+	}
+	
+	// The others answer in one part
+	if (replyQuiet || replyPart)
+		return FALSE;
+	
+	switch (cmd) {
+	
+	case CMD_SPEED:
+		io_printStr(STR_STEPPING_EVERY);
+		io_print(toString(motor_nextPeriod));
+		io_printLater(STR_TICKS);
+	break;
+	
+	case CMD_DIR:
+		io_printStr(STR_MOTOR_DIRECTION_IS);
+		if (motor_nextDirection == MOTOR_COUNTERCLOCKWISE)
+			io_printStr(STR_COUNTER);
+		io_printLater(STR_CLOCKWISE);
+	break;
+	
+	case CMD_SIZE:
+		io_printStr(STR_STEPPING_WITH);
+		if (motor_nextSize == MOTOR_FULL_STEP)
+			io_printStr(STR_FULL);
+		else
+			io_printStr(STR_HALF);
+		io_printLater(STR_STEPS);
+	break;
+	
+	case CMD_STEP:
+		io_printStr(STR_STEPPING_FOR);
+		io_print(toString(motor_steps));
+		io_printLater(STR_STEPS);
+	break;
+	
+#if LIMIT_ENABLE
+	case CMD_HOME:
+		io_printLater(STR_HOMING);
+	break;
+#endif
+	
+#if MOTOR_PWM
+	case CMD_RATE:
+		a = stoi(pArg);
+		if (a >= MOTOR_PWM_MIN_RATE && a <= MOTOR_PWM_MAX_RATE) {
+			io_printStr(STR_HARDWARE_EVERY);
+			io_print(toString(motor_pwmCycles));
+			io_printLater(STR_CYCLES);
+		} else {
+			io_printStr(STR_RATE_RANGE);
+			io_print(toString(MOTOR_PWM_MIN_RATE));
+			io_printStr(STR_MINUS);
+			io_print(toString(MOTOR_PWM_MAX_RATE));
+			io_printLater(STR_NEWLINE);
+		}
+	break;
+#endif
+	
+#if TIME_CALIBRATE
+	case CMD_CAL:
+		io_printLater(STR_CALIBRATING);
+	break;
+#endif
+	
+#if ENCODER_ENABLE
+	case CMD_STALL:
+		if (encoder_window) {
+			io_printStr(STR_CHECKING_EVERY);
+			io_print(toString(encoder_window));
+			io_printLater(STR_STEPS);
+		} else
+			io_printLater(STR_NOT_CHECKING);
+	break;
+#endif
+	
+	case CMD_QUIET:
+		io_printStr(STR_QUIET_IS);
+		if (quiet)
+			io_printLater(STR_ON);
+		else
+			io_printLater(STR_OFF);
+	break;
+	
+	case CMD_ACK:
+		io_printStr(STR_ACKS_ARE);
+		if (io_acks)
+			io_printLater(STR_ON);
+		else
+			io_printLater(STR_OFF);
+	break;
+	
+#if !BUS_ENABLE
+	case CMD_FLOW:
+		io_printStr(STR_FLOW_IS);
+		if (io_xon)
+			io_printLater(STR_ON);
+		else
+			io_printLater(STR_OFF);
+	break;
+#endif
+	
+#if BUS_ENABLE
+	case CMD_ID:
+		io_printStr(STR_BUS_ID_IS);
+		io_print(toString(bus_id));
+		io_printLater(STR_NEWLINE);
+	break;
+#endif
+	
+#if TRIGGER_ENABLE
+	case CMD_ARM:
+		io_printLater(STR_ARMED);
+	break;
+#endif
+	
+	default:
+		return FALSE;	// start, stop and empty commands say nothing
+	}
+	return TRUE;
 }
 
+#if QUEUE_ENABLE
 
-
-// Motor source
-#define MOTOR_DELAY() time_wait(1)
-
-void motor_init() {
-	TRISC &= ~0b111;	// '11111000' for outputs at motor-related pins
-	PORTC &= ~0b111;	// 'xxxxx000' for initial value
-}
-
-void motor_step() {
-	PORT_MOTOR_STEP = 1;
-	MOTOR_DELAY();
-	PORT_MOTOR_STEP = 0;
+// Runs the next timed command the way runBatch() would, only without a reply
+void runQueued() {
+	bit stopped;
+	
+	stopped = !motor_enable && !motor_counting;
+	if (stopped)
+		encoder_restore();
+	queue_take(sched_tick);
+	switch (queue_nextCmd) {
+	
+	case CMD_START:
+		limit_cancel();
+#if TRIGGER_ENABLE
+		if (trigger_phase != TRIGGER_IDLE) {
+			trigger_start = TRUE;
+			trigger_steps = 0;
+			break;
+		}
+#endif
+		motor_enable = TRUE;
+#if MOTOR_PWM
+		if (motor_nextPeriod <= MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES)
+			motor_pwmStart(motor_nextPeriod * TIME_TICK_CYCLES);
+#endif
+	break;
+	
+	case CMD_STOP:
+		limit_cancel();
+		trigger_disarm();
+		motor_pwmStop();
+		motor_enable = FALSE;
+		motor_steps = 0;
+		motor_counting = FALSE;
+	break;
+	
+	case CMD_SPEED:
+		limit_cancel();
+		encoder_forget();
+		motor_nextPeriod = queue_nextArg;
+		motor_pending = TRUE;
+#if MOTOR_PWM
+		if (motor_pwm && (motor_nextPeriod > MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES || !motor_pwmRetune(motor_nextPeriod * TIME_TICK_CYCLES)))
+			motor_pwmStop();
+#endif
+	break;
+	
+	case CMD_DIR:
+	case CMD_SIZE:
+		limit_cancel();
+		if (queue_nextCmd == CMD_DIR)
+			motor_nextDirection = queue_nextArg == MOTOR_COUNTERCLOCKWISE;
+		else
+			motor_nextSize = queue_nextArg == MOTOR_FULL_STEP;
+		motor_pending = TRUE;
+#if MOTOR_PWM
+		if (motor_pwm)
+			motor_pwmRetune(motor_pwmCycles);
+#endif
+	break;
+	
+	case CMD_STEP:
+#if TRIGGER_ENABLE
+		if (trigger_phase != TRIGGER_IDLE) {
+			trigger_steps = queue_nextArg;
+			trigger_start = FALSE;
+			break;
+		}
+#endif
+		limit_cancel();
+		motor_pwmStop();
+		motor_steps = queue_nextArg;
+		motor_counting = TRUE;
+		motor_enable = FALSE;
+	break;
+	}
+	
+	if (motor_pending && (stopped || (!motor_enable && !motor_counting)))
+		motor_latch();
+	if (stopped && (motor_enable || motor_counting))
+		motor_tick = motor_period - 1;	// a move from standstill makes its first step on this tick
 }
 
-
-
-// Program entry point
-void main(void) {
-
-	time_init();
-	io_init();
-	motor_init();
+// Reads "<tick> <command>" or "+<n> <command>" after at into atTick, cmd and atArg, returns 0 if it's wrong
+bit parseAt() {
+	const char * s = pArg;
+	unsigned long n = 0;
+	uns32 a;
+	char d;
+	bit relative;
 	
-	ANSEL = 0;	// we don't need any AD-inputs
-	ANSELH = 0;
-	GIE = 1;	// enable interrupts
+	while (*s == ' ')
+		s++;
+	relative = *s == '+';
+	if (relative)
+		s++;
+	if (*s < '0' || *s > '9')
+		return FALSE;
+	while (*s >= '0' && *s <= '9') {
+		d = *s - '0';
+		if (n > 6553 || (n == 6553 && d > 5))
+			return FALSE;	// n * 10 + d would wrap around
+		n *= 10;
+		n += d;
+		s++;
+	}
+	if (*s != ' ')
+		return FALSE;
+	while (*s == ' ')
+		s++;
+	atTick = time_now();	// read once, the tick may go on in between
+	if (relative) {
+		atWait = n;
+		atTick += n;
+	} else {
+		atWait = n - atTick;
+		atTick = n;
+	}
 	
-	motor_enable = FALSE;
-	motor_steps = 0;
-	PORT_MOTOR_DIRECTION = MOTOR_CLOCKWISE;
-	PORT_MOTOR_STEP_SIZE = MOTOR_FULL_STEP;
+	// Only the commands that move the motor, with the argument they take (a step move of up to 65535)
+	parseInput(s);
+	switch (cmd) {
 	
-	motor_period = 790;	// half second period
+	case CMD_START:
+	case CMD_STOP:
+		return TRUE;
 	
-	unsigned long motor_tick = 0;	// the tick for motor
-	unsigned long lastTick = 0;
-	unsigned long arg;
+	case CMD_SPEED:
+		a = stoi(pArg);
+		atArg = a;
+		return a >= MOTOR_MIN_PERIOD && a <= 65535;
 	
-	io_echo = FALSE;
+	case CMD_DIR:
+		atArg = MOTOR_COUNTERCLOCKWISE;
+		if (cmdcmp(" cc", pArg))
+			return TRUE;
+		atArg = MOTOR_CLOCKWISE;
+		return cmdcmp(" cw", pArg);
 	
-	const char * input;
+	case CMD_SIZE:
+		atArg = MOTOR_FULL_STEP;
+		if (cmdcmp(" full", pArg))
+			return TRUE;
+		atArg = MOTOR_HALF_STEP;
+		return cmdcmp(" half", pArg);
 	
-	// Core loop
-	while (1) {
-		PORTC.5 = RCIF;
-		input = io_getInput();
-		
-		if (input) {
-			// parseInput updates cmd (this is due to compiler limitations, otherwise I'd make it return a value)
-			parseInput(input);
-			if (cmd) {
-				switch (cmd) {
-				
-				case CMD_HELP:
-					io_print("Availabe commands:\r\n");
-					io_print("?/help - displays this message\r\n");
-					io_print("info - displays motor info\r\n");
-					io_print("start - starts the motor\r\n");
-					io_print("stop - stops the motor\r\n");
-					io_print("speed [x] - sets the speed of the motor to x (3-65535)\r\n");
-					io_print("dir [x] - sets the direction to x (\"cc\" or \"cw\")\r\n");
-					io_print("size [x] - sets the step size to x (\"full\" or \"half)\"\r\n");
-					io_print("step [x] - makes motor step x (1-65535) times\r\n");
-				break;
-				
-				case CMD_INFO:
-					io_print("Motor is ");
-					if (motor_enable || motor_steps)
-						io_print("ON\r\n");
-					else
-						io_print("OFF\r\n");
-					
-					io_print("Period = ");
-					io_print(toString(motor_period));
-					
-					io_print(" ticks (tickrate = 1580 Hz)\r\n");
-					io_print("Direction is ");
-					if (PORT_MOTOR_DIRECTION == MOTOR_COUNTERCLOCKWISE)
-						io_print("counter ");
-					io_print("clockwise\r\n");
-					
-					io_print("Step size is ");
-					if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
-						io_print("full");
-					else
-						io_print("half");
-					io_print(" steps\r\n");
-				break;
-				
-				case CMD_START:
-					motor_enable = TRUE;
-				break;
-				
-				case CMD_STOP:
-					motor_enable = FALSE;
-					motor_steps = 0;
-				break;
-				
-				case CMD_SPEED:
-					arg = stoi(pArg);
-					if (arg >= 3) {		// speeds lower than 3 are below rated pulserate
-						motor_period = arg;
-						motor_tick = 0;	// reset motor tick, so that the new speed applies
-					}
-					
-					io_print("Stepping every ");
-					io_print(toString(motor_period));
-					io_print(" ticks\r\n");
-				break;
-				
-				case CMD_DIR:
-					if (*pArg)
-						if (strcmp(" cc", pArg))
-							PORT_MOTOR_DIRECTION = MOTOR_COUNTERCLOCKWISE;
-						else if (strcmp(" cw", pArg))
-							PORT_MOTOR_DIRECTION = MOTOR_CLOCKWISE;
-						else
-							io_print("Unknown direction\r\n");
-					
-					io_print("Motor direction is ");
-					if (PORT_MOTOR_DIRECTION == MOTOR_COUNTERCLOCKWISE)
-						io_print("counter ");
-					io_print("clockwise\r\n");
-				break;
-				
-				case CMD_SIZE:
-					if (*pArg)
-						if (strcmp(" full", pArg))
-							PORT_MOTOR_STEP_SIZE = MOTOR_FULL_STEP;
-						else if (strcmp(" half", pArg))
-							PORT_MOTOR_STEP_SIZE = MOTOR_HALF_STEP;
-						else
-							io_print("Unknown step size\r\n");
-					
-					io_print("Stepping with ");
-					if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
-						io_print("full");
-					else
-						io_print("half");
-					io_print(" steps\r\n");
-				break;
-				
-				case CMD_STEP:
-					arg = stoi(pArg);
-					if (arg) {
-						motor_steps = arg;
-						motor_enable = FALSE;
-					}
-					
-					io_print("Stepping for another ");
-					io_print(toString(motor_steps));
-					io_print(" steps\n");
-				break;
-				}
-			}
-		}
+	case CMD_STEP:
+		a = stoi(pArg);
+		atArg = a;
+		return a && a <= 65535;
+	}
+	return FALSE;
+}
+
+// Returns 1 if atTick was 1 to QUEUE_AHEAD ticks away when parseAt() read it
+bit atAhead() {
+	return atWait && atWait <= QUEUE_AHEAD;
+}
+
+#endif // QUEUE_ENABLE
+
+// Starts the next part of help, returns 0 once there's none left
+bit helpNext() {
+	while (replyPart < HELP_PARTS) {
+		switch (replyPart) {
 		
-		// Run io_update again, but ignore everything else
-		if (lastTick == time_tick)
-			continue;
+		case 0:
+			io_printLater(STR_HELP);
+			return TRUE;
+		
+		case 1:
+			io_print(toString(MOTOR_MIN_PERIOD));
+			io_printLater(STR_HELP_END);
+			return TRUE;
+		
+#if PROF_ENABLE
+		case 2:
+			io_printLater(STR_HELP_PROF);
+			return TRUE;
+#endif
+		
+#if LIMIT_ENABLE
+		case 3:
+			io_printLater(STR_HELP_HOME);
+			return TRUE;
+#endif
+		
+#if MOTOR_PWM
+		case 4:
+			io_printLater(STR_HELP_RATE);
+			return TRUE;
+		
+		case 5:
+			io_print(toString(MOTOR_PWM_MIN_RATE));
+			io_printStr(STR_MINUS);
+			io_print(toString(MOTOR_PWM_MAX_RATE));
+			io_printLater(STR_HELP_RATE_END);
+			return TRUE;
+#endif
+		
+#if TIME_CALIBRATE
+		case 6:
+			io_printLater(STR_HELP_CAL);
+			return TRUE;
+#endif
+		
+#if BUS_ENABLE
+		case 7:
+			io_printLater(STR_HELP_ID);
+			return TRUE;
+#endif
+		
+#if TRIGGER_ENABLE
+		case 8:
+			io_printLater(STR_HELP_ARM);
+			return TRUE;
+#endif
+		
+#if ENCODER_ENABLE
+		case 9:
+			io_printLater(STR_HELP_STALL);
+			return TRUE;
+#endif
+		
+		case 10:
+			io_printLater(STR_HELP_TASKS);
+			return TRUE;
 		
-		// We assume time_tick is equal to lastTick + 1
-		if (++motor_tick == motor_period) {
-			motor_tick = 0;
+		case 11:
+			io_printLater(STR_HELP_ACK);
+			return TRUE;
+		
+#if !BUS_ENABLE
+		case 12:
+			io_printLater(STR_HELP_FLOW);
+			return TRUE;
+#endif
+		
+#if QUEUE_ENABLE
+		case 13:
+			io_printLater(STR_HELP_AT);
+			return TRUE;
+#endif
+		
+		case 14:
+			io_printLater(STR_HELP_BATCH);
+			return TRUE;
+		}
+		replyPart++;	// a part that isn't built in
+	}
+	return FALSE;
+}
 
-			if (motor_enable)
-				motor_step();
+// Starts the next part of info, returns 0 once there's none left
+bit infoNext() {
+	while (replyPart < INFO_PARTS) {
+		switch (replyPart) {
+		
+		case 0:
+			io_printStr(STR_MOTOR_IS);
+			if (motor_enable || motor_counting)
+				io_printLater(STR_ON);
+			else
+				io_printLater(STR_OFF);
+			return TRUE;
+		
+		case 1:
+			io_printStr(STR_PERIOD);
+			io_print(toString(motor_nextPeriod));
+			io_printStr(STR_TICKS_OF);
+			io_print(toString(TIME_TICK_US));
+			io_printLater(STR_US_EACH);
+			return TRUE;
+		
+#if MOTOR_PWM
+		case 2:
+			if (!motor_pwm)
+				break;
+			io_printStr(STR_HARDWARE_EVERY);
+			io_print(toString(motor_pwmCycles));
+			io_printLater(STR_CYCLES);
+			return TRUE;
+#endif
+		
+		case 3:
+			io_printStr(STR_DIRECTION_IS);
+			if (motor_nextDirection == MOTOR_COUNTERCLOCKWISE)
+				io_printStr(STR_COUNTER);
+			io_printLater(STR_CLOCKWISE);
+			return TRUE;
+		
+		case 4:
+			io_printStr(STR_STEP_SIZE_IS);
+			if (motor_nextSize == MOTOR_FULL_STEP)
+				io_printStr(STR_FULL);
+			else
+				io_printStr(STR_HALF);
+			io_printLater(STR_STEPS);
+			return TRUE;
+		
+		case 5:
+			io_printStr(STR_POSITION);
+			io_printInt(motor_position);
+			io_printLater(STR_STEPS);
+			return TRUE;
+		
+		case 6:
+			io_printStr(STR_IDLE_FOR);
+			io_print(toString(power_idleTicks));
+			io_printLater(STR_TICKS_SLEPT);
+			return TRUE;
+		
+		case 7:
+			io_print(toString(power_sleeps));
+			io_printLater(STR_TIMES_FOR);
+			return TRUE;
+		
+		case 8:
+			io_print(toString(power_asleep));
+			io_printLater(STR_TICKS);
+			return TRUE;
+		
+#if ENCODER_ENABLE
+		case 9:
+			io_printStr(STR_ENCODER_IS);
+			io_printInt(encoder_position);
+			io_printLater(STR_COUNTS_STALLED);
+			return TRUE;
+		
+		case 10:
+			io_print(toString(encoder_stalls));
+			io_printLater(STR_TIMES);
+			return TRUE;
+#endif
+		
+#if TIME_CALIBRATE
+		case 11:
+		case 12:
+			return time_calPrint(replyPart - 11);
+#endif
+		
+#if BUS_ENABLE
+		case 13:
+			io_printStr(STR_BUS_ID_IS);
+			io_print(toString(bus_id));
+			io_printLater(STR_NEWLINE);
+			return TRUE;
+#endif
+		
+#if TRIGGER_ENABLE
+		case 14:
+			if (trigger_phase == TRIGGER_IDLE)
+				break;
+			io_printLater(STR_ARMED);
+			return TRUE;
+#endif
+		}
+		replyPart++;
+	}
+#if QUEUE_ENABLE
+	return queue_print(replyPart - INFO_PARTS, TRUE);
+#else
+	return FALSE;
+#endif
+}
 
-			if (motor_steps) {
-				motor_steps--;
-				motor_step();
-			}
+// Starts the next part of what the tick task had to report, clears io_notice once there's none left
+void noticeNext() {
+#if TIME_CALIBRATE
+	if (time_calNew) {
+		if (time_calPrint(noticePart)) {
+			noticePart++;
+			return;
 		}
-		lastTick = time_tick;
+		time_calNew = FALSE;
+		noticePart = 0;
+		return;
+	}
+#endif
+#if LIMIT_ENABLE
+	if (limit_report) {
+		limit_print();
+		return;
+	}
+#endif
+#if ENCODER_ENABLE
+	if (encoder_report) {
+		encoder_print();
+		return;
 	}
+#endif
+	io_notice = FALSE;
 }
 
 void parseInput(const char * s) {
 	cmd = CMD_NULL;
 	
-	if (strcmp("?", s)) {
+	if (cmdcmp("?", s)) {
 		cmd = CMD_HELP;
 		return;
 	}
 	
-	if (strcmp("help", s)){
+	if (cmdcmp("help", s)){
 		cmd = CMD_HELP;
 		return;
 	}
 	
-	if (strcmp("info", s)){
+	if (cmdcmp("info", s)){
 		cmd = CMD_INFO;
 		return;
 	}
 	
-	if (strcmp("start", s)){
+	if (cmdcmp("start", s)){
 		cmd = CMD_START;
 		return;
 	}
 		
-	if (strcmp("stop", s)){
+	if (cmdcmp("stop", s)){
 		cmd = CMD_STOP;
 		return;
 	}
 	
-	if (strcmp("speed", s)){
+	if (cmdcmp("speed", s)){
 		cmd = CMD_SPEED;
 		pArg = &s[5];
 		return;
 	}
 	
-	if (strcmp("dir", s)){
+	if (cmdcmp("dir", s)){
 		cmd = CMD_DIR;
 		pArg = &s[3];
 		return;
 	}
 	
-	if (strcmp("size", s)) {
+	if (cmdcmp("size", s)) {
 		cmd = CMD_SIZE;
 		pArg = &s[4];
 		return;
 	}
 	
-	if (strcmp("step", s)){
+	if (cmdcmp("step", s)){
 		cmd = CMD_STEP;
 		pArg = &s[4];
 		return;
 	}
+	
+#if PROF_ENABLE
+	if (cmdcmp("prof", s)) {
+		cmd = CMD_PROF;
+		pArg = &s[4];
+		return;
+	}
+#endif
+	
+#if LIMIT_ENABLE
+	if (cmdcmp("home", s)) {
+		cmd = CMD_HOME;
+		return;
+	}
+#endif
+	
+#if MOTOR_PWM
+	if (cmdcmp("rate", s)) {
+		cmd = CMD_RATE;
+		pArg = &s[4];
+		return;
+	}
+#endif
+
+#if TIME_CALIBRATE
+	if (cmdcmp("cal", s)) {
+		cmd = CMD_CAL;
+		return;
+	}
+#endif
+	
+	if (cmdcmp("quiet", s)) {
+		cmd = CMD_QUIET;
+		pArg = &s[5];
+		return;
+	}
+	
+#if BUS_ENABLE
+	if (cmdcmp("id", s)) {
+		cmd = CMD_ID;
+		pArg = &s[2];
+		return;
+	}
+#endif
+	
+#if TRIGGER_ENABLE
+	if (cmdcmp("arm", s)) {
+		cmd = CMD_ARM;
+		return;
+	}
+#endif
+	
+	if (cmdcmp("tasks", s)) {
+		cmd = CMD_TASKS;
+		pArg = &s[5];
+		return;
+	}
+	
+#if ENCODER_ENABLE
+	if (cmdcmp("stall", s)) {
+		cmd = CMD_STALL;
+		pArg = &s[5];
+		return;
+	}
+#endif
+	
+	if (cmdcmp("ack", s)) {
+		cmd = CMD_ACK;
+		pArg = &s[3];
+		return;
+	}
+	
+#if !BUS_ENABLE
+	if (cmdcmp("flow", s)) {
+		cmd = CMD_FLOW;
+		pArg = &s[4];
+		return;
+	}
+#endif
+	
+#if QUEUE_ENABLE
+	if (cmdcmp("at", s)) {
+		cmd = CMD_AT;
+		pArg = &s[2];
+		return;
+	}
+	
+	if (cmdcmp("tick", s)) {
+		cmd = CMD_TICK;
+		return;
+	}
+#endif
+}
+
+bit checkCommand() {
+	uns32 a;
+	
+	// A missing argument is fine, the command just reports the setting then
+	switch (cmd) {
+	
+	case CMD_NULL:
+		return FALSE;
+	
+	case CMD_SPEED:
+		a = stoi(pArg);
+		return !*pArg || (a >= MOTOR_MIN_PERIOD && a <= 65535);
+	
+	case CMD_DIR:
+		return !*pArg || cmdcmp(" cc", pArg) || cmdcmp(" cw", pArg);
+	
+	case CMD_SIZE:
+		return !*pArg || cmdcmp(" full", pArg) || cmdcmp(" half", pArg);
+	
+	case CMD_STEP:
+		return !*pArg || stoi(pArg);
+	
+#if MOTOR_PWM
+	case CMD_RATE:
+		a = stoi(pArg);
+		return a >= MOTOR_PWM_MIN_RATE && a <= MOTOR_PWM_MAX_RATE;
+#endif
+	
+	case CMD_QUIET:
+	case CMD_ACK:
+	case CMD_FLOW:
+		return !*pArg || cmdcmp(" on", pArg) || cmdcmp(" off", pArg);
+	
+#if BUS_ENABLE
+	case CMD_ID:
+		a = stoi(pArg);
+		return !*pArg || (a && a <= 0xFF);
+#endif
+	
+#if ENCODER_ENABLE
+	case CMD_STALL:
+		return !*pArg || stoi(pArg) <= 0xFF;
+#endif
+	
+#if QUEUE_ENABLE
+	case CMD_AT:
+		if (!*pArg || cmdcmp(" clear", pArg))
+			return TRUE;
+		if (!parseAt() || !atAhead() || queue_count + atBatch >= QUEUE_SIZE)
+			return FALSE;
+		atBatch++;	// its room is taken, for the ones after it in the line
+		return TRUE;
+#endif
+	}
+	return TRUE;
+}
+
+// Prints the given part of the batch status line, returns 0 past the last one
+bit printStatus(char part) {
+	// ok <on/off> <cw/cc> <full/half> <period> <steps left> <position>
+	if (part == 1) {
+		io_printStr(STR_SPACE);
+		io_print(toString(motor_steps));
+		io_printStr(STR_SPACE);
+		io_printInt(motor_position);
+		io_printLater(STR_NEWLINE);
+		return TRUE;
+	}
+	if (part)
+		return FALSE;
+	
+	io_printStr(STR_OK);
+	if (motor_enable || motor_counting)
+		io_printStr(STR_RUN_ON);
+	else
+		io_printStr(STR_RUN_OFF);
+	if (motor_nextDirection == MOTOR_COUNTERCLOCKWISE)
+		io_printStr(STR_RUN_CC);
+	else
+		io_printStr(STR_RUN_CW);
+	if (motor_nextSize == MOTOR_FULL_STEP)
+		io_printStr(STR_FULL);
+	else
+		io_printStr(STR_HALF);
+	io_printStr(STR_SPACE);
+	io_print(toString(motor_nextPeriod));
+	return TRUE;
 }
 
 /* *********************************** */
@@ -511,15 +4496,15 @@ void parseInput(const char * s) {
 /*           _____________  _____________ 
             |             \/             |
       +5V---|Vdd        16F690        Vss|---Gnd
-	    |RA5            RA0/AN0/(PGD)|
-	    |RA4/AN3            RA1/(PGC)|
-            |RA3/!MCLR/(Vpp)  RA2/AN2/INT|
+    T1CKI->-|RA5            RA0/AN0/(PGD)|
+            |RA4/AN3            RA1/(PGC)|
+     HOME->-|RA3/!MCLR/(Vpp)  RA2/AN2/INT|-<-TRIGGER
             |RC5/CCP                  RC0|->-!HSM
             |RC4                      RC1|->-DIR
-            |RC3/AN7                  RC2|->-!STEP
-            |RC6/AN8             AN10/RB4|
-            |RC7/AN9               RB5/Rx|-<-UART_IN
- UART_OUT-<-|RB7/Tx                   RB6|
+       DE-<-|RC3/AN7                  RC2|->-!STEP
+      ID0->-|RC6/AN8             AN10/RB4|-<-LIMIT_CCW
+      ID1->-|RC7/AN9               RB5/Rx|-<-UART_IN
+ UART_OUT-<-|RB7/Tx                   RB6|-<-LIMIT_CW
             |____________________________|                                      
 */ 
 /*           _____________  _____________ 
@@ -533,4 +4518,4 @@ void parseInput(const char * s) {
       RC2->-|!STEP                   !HSM|-<-RC0
             |OB                        OA|
             |____________________________|                                      
-*/
+*/
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef _SOURCE_BUS
+#define _SOURCE_BUS
+
+#if BUS_ENABLE
+
+char bus_id;
+bit bus_talk;
+
+// The stored ID, or the one the jumpers make if none is stored
+void bus_readId() {
+	EEADR = BUS_EE_ID;
+	EEPGD = 0;
+	RD = 1;
+	bus_id = EEDAT;
+	if (bus_id == 0xFF || bus_id == BUS_BROADCAST) {
+		bus_id = 1;
+		if (!PORT_BUS_ID0)
+			bus_id += 1;
+		if (!PORT_BUS_ID1)
+			bus_id += 2;
+	}
+}
+
+void bus_init() {
+	TRISC.3 = 0;
+	PORT_BUS_DE = 0;
+	TRISC.6 = 1;
+	TRISC.7 = 1;
+	
+	bus_readId();
+	bus_talk = FALSE;
+	ADDEN = 1;			// only address bytes get through until one of them is ours
+}
+
+void bus_address(char a) {
+	if (a == bus_id || a == BUS_BROADCAST) {
+		ADDEN = 0;		// the line that follows is for us
+		bus_talk = a == bus_id;
+	} else {
+		ADDEN = 1;		// someone else's frame, a line of ours that got cut short is dropped with it
+		bus_talk = FALSE;
+	}
+	inputPos = io_lineAt;
+	io_tooLong = FALSE;
+	io_lost = FALSE;
+}
+
+void bus_release() {
+	if (!bus_talk)
+		return;
+	while (!TRMT);		// the stop bit of the last character is out
+	PORT_BUS_DE = 0;
+	bus_talk = FALSE;
+}
+
+void bus_setId(char id) {
+	EEADR = BUS_EE_ID;
+	EEDAT = id;
+	EEPGD = 0;
+	WREN = 1;
+	GIE = 0;			// the unlock sequence must not be interrupted
+	EECON2 = 0x55;
+	EECON2 = 0xAA;
+	WR = 1;
+	GIE = 1;
+	WREN = 0;
+	while (WR);			// a few milliseconds
+	
+	bus_readId();
+}
+
+#endif // BUS_ENABLE
+
+#endif // !_SOURCE_BUS
\ No newline at end of file
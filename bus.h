@@ -0,0 +1,61 @@
+/*
+
+	Multi-drop bus mode.
+	Several controllers share one serial line through RS-485 (or similar) transceivers, each one has an ID.
+	The host sends frames of 9-bit characters: an address byte with the 9th bit set (the ID, or BUS_BROADCAST),
+	then one line with the 9th bit clear. EUSART address detection (ADDEN) keeps the characters of other
+	controllers' frames out of the receiver altogether, so they cost nothing.
+	Only the addressed controller replies, and it only drives the line while it does.
+	
+*/
+
+#ifndef _HEAD_BUS
+#define _HEAD_BUS
+
+// Set to 1 to take commands in addressed frames only (see above)
+#ifndef BUS_ENABLE
+#define BUS_ENABLE 0
+#endif
+
+#define BUS_BROADCAST	0		// address every controller takes commands from, none of them replies to it
+#define BUS_EE_ID		0x00	// EEPROM address of the ID, erased (0xFF) means the jumpers decide
+#define BUS_TRIGGER		0xFF	// address byte that fires every armed controller (see trigger.h), never an ID
+
+#pragma bit PORT_BUS_DE		@ PORTC.3	// transceiver driver enable, high only while we transmit
+#pragma bit PORT_BUS_ID0	@ PORTC.6	// ID jumpers, low when fitted (need external pull-ups)
+#pragma bit PORT_BUS_ID1	@ PORTC.7
+
+#if BUS_ENABLE
+
+#if IO_CTS_ENABLE
+#error The CTS line is point to point, build without IO_CTS_ENABLE
+#endif
+
+// Our address, 1-254
+extern char bus_id;
+
+// The frame being received is addressed to us alone, so we may reply
+extern bit bus_talk;
+
+// Read the ID (EEPROM, or the jumpers: 1 + the number they make, ID1 being the high bit) and start listening
+void bus_init();
+
+// Is to be called with every address byte, opens the receiver for our frames and closes it for others
+void bus_address(char);
+
+// Is to be called once a line is complete, lets only address bytes in again
+#define bus_lineEnd()	ADDEN = 1
+
+// Is to be called once the reply to a frame is written, waits for it to leave and releases the line
+void bus_release();
+
+// Store a new ID (1-254) in EEPROM, 255 erases it and gives the choice back to the jumpers, applies right away
+void bus_setId(char);
+
+#else
+
+#define bus_release()
+
+#endif // BUS_ENABLE
+
+#endif // !_HEAD_BUS
\ No newline at end of file
@@ -0,0 +1,34 @@
+/*
+
+	Clock and baud rate settings.
+	Every timing constant of the project (baud divisor, Timer0 reload and prescale, speed limits, ...) is worked out
+	from these at compile time, a setting that can't be made within tolerance stops the build with an #error.
+	
+*/
+
+#ifndef _HEAD_CONFIG
+#define _HEAD_CONFIG
+
+// Internal oscillator frequency in Hz, one of 8000000, 4000000 or 2000000 (slower clocks leave too few cycles per tick)
+#ifndef CONFIG_F_OSC
+#define CONFIG_F_OSC		4000000
+#endif
+
+// Console baud rate, and how far off (in 1/1000ths) the divisor is allowed to make it
+#ifndef CONFIG_BAUD
+#define CONFIG_BAUD			9600
+#endif
+#define CONFIG_BAUD_TOLERANCE	15
+
+// OSCCON for CONFIG_F_OSC (IRCF bits, the system clock comes from the config word)
+#if CONFIG_F_OSC == 8000000
+#define CONFIG_OSCCON		0b01110000
+#elif CONFIG_F_OSC == 4000000
+#define CONFIG_OSCCON		0b01100000
+#elif CONFIG_F_OSC == 2000000
+#define CONFIG_OSCCON		0b01010000
+#else
+#error CONFIG_F_OSC must be a frequency the internal oscillator makes (8, 4 or 2 MHz)
+#endif
+
+#endif // !_HEAD_CONFIG
\ No newline at end of file
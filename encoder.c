@@ -0,0 +1,142 @@
+#ifndef _SOURCE_ENCODER
+#define _SOURCE_ENCODER
+
+#if ENCODER_ENABLE
+
+int32 encoder_position;
+char encoder_window;
+unsigned long encoder_stalls;
+unsigned long encoder_period;
+char encoder_report;
+unsigned long encoder_last;		// Timer1 at the last step boundary
+unsigned long encoder_counted;	// counts in this window
+unsigned long encoder_expected;	// counts the steps of this window should have made
+char encoder_steps;				// steps in this window
+char encoder_backoffs;			// stalled windows in a row
+
+void encoder_init() {
+	encoder_position = 0;
+	encoder_window = ENCODER_WINDOW;
+	encoder_stalls = 0;
+	encoder_period = 0;
+	encoder_report = ENCODER_REPORT_NONE;
+	encoder_backoffs = 0;
+	encoder_reset();
+
+	TRISA.5 = 1;
+	TMR1H = 0;
+	TMR1L = 0;
+	encoder_last = 0;
+	T1CON = 0b00000011;			// Timer1 on, counting rising edges on T1CKI
+}
+
+void encoder_step() {
+	if (!encoder_window)
+		return;
+	encoder_steps++;
+	if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
+		encoder_expected += ENCODER_COUNTS;
+	else
+		encoder_expected += ENCODER_COUNTS / 2;
+}
+
+void encoder_reset() {
+	encoder_steps = 0;
+	encoder_counted = 0;
+	encoder_expected = 0;
+}
+
+// The window came up short by the given counts, returns 1 if the motor was slowed down
+bit encoder_stall(unsigned long missed) {
+	encoder_stalls++;
+
+	// in steps of the size it's making, those didn't move it and a step move has to make them again
+	if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
+		missed /= ENCODER_COUNTS;
+	else
+		missed /= ENCODER_COUNTS / 2;
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+		motor_position -= missed;
+	else
+		motor_position += missed;
+	if (motor_counting)
+		motor_steps += missed;
+
+	if ((motor_enable || motor_counting) && encoder_backoffs < ENCODER_BACKOFFS && motor_period <= 32767) {
+		encoder_backoffs++;
+		if (!encoder_period)
+			encoder_period = motor_nextPeriod;
+		motor_nextPeriod = motor_period << 1;	// over whatever speed asked for, that's what stalled it
+		motor_pending = TRUE;
+		encoder_report = ENCODER_REPORT_SLOWED;
+		io_notice = TRUE;
+		return TRUE;
+	}
+
+	motor_enable = FALSE;
+	motor_steps = 0;
+	motor_counting = FALSE;
+	encoder_report = ENCODER_REPORT_STOPPED;
+	io_notice = TRUE;
+	return FALSE;
+}
+
+bit encoder_update() {
+	unsigned long t;
+	bit slowed = FALSE;
+
+	do {
+		t.high8 = TMR1H;
+		t.low8 = TMR1L;
+	} while (t.high8 != TMR1H);
+	t -= encoder_last;			// Timer1 wraps, the difference doesn't
+	encoder_last += t;
+
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+		encoder_position += t;
+	else
+		encoder_position -= t;
+
+	if (!encoder_steps)
+		encoder_counted = 0;	// nothing was asked of it, whatever turned the shaft isn't checked
+	else {
+		encoder_counted += t;
+		if (encoder_steps < encoder_window && (motor_enable || motor_counting))
+			return FALSE;
+
+		if (encoder_counted + ENCODER_SLACK < encoder_expected)
+			slowed = encoder_stall(encoder_expected - encoder_counted);
+		else
+			encoder_backoffs = 0;
+		encoder_reset();
+	}
+
+	if (!motor_enable && !motor_counting)
+		encoder_restore();
+	return slowed;
+}
+
+void encoder_restore() {
+	if (!encoder_period)
+		return;
+	motor_nextPeriod = encoder_period;
+	motor_pending = TRUE;
+	encoder_period = 0;
+}
+
+void encoder_print() {
+	if (encoder_report == ENCODER_REPORT_SLOWED) {
+		io_printStr(STR_STALLED_SLOWING);
+		io_print(toString(motor_nextPeriod));
+		io_printLater(STR_TICKS);
+	} else {
+		io_printStr(STR_STALLED_AT);
+		io_printInt(motor_position);
+		io_printLater(STR_STEPS);
+	}
+	encoder_report = ENCODER_REPORT_NONE;
+}
+
+#endif // ENCODER_ENABLE
+
+#endif // !_SOURCE_ENCODER
\ No newline at end of file
@@ -0,0 +1,87 @@
+/*
+
+	Encoder feedback.
+	One channel of an encoder on the motor shaft goes to T1CKI (RA5) and Timer1 counts its rising edges in hardware.
+	A stepper turns the way DIR says or not at all, so the count is taken in the direction of DIR.
+	Every window of steps the counts are compared with what the steps should have made. A window that is short
+	means the motor stalled: the missed steps are taken back out of the position (and put back into a step move),
+	and the motor is slowed down to twice the period, or stopped if that didn't help ENCODER_BACKOFFS times in a row.
+	The slowdown lasts for the move, the next one is made at the period speed asked for (unless speed was given since).
+	Only steps made in software are checked, ECCP runs (rate) aren't.
+
+*/
+
+#ifndef _HEAD_ENCODER
+#define _HEAD_ENCODER
+
+// Set to 1 if an encoder is connected (Timer1 counts it, so prof, cal and ECCP step counting have to be left out)
+#ifndef ENCODER_ENABLE
+#define ENCODER_ENABLE 0
+#endif
+
+#ifndef ENCODER_COUNTS
+#define ENCODER_COUNTS		4	// rising edges per full step, even (a half step makes half of them)
+#endif
+#define ENCODER_WINDOW		16	// steps per check until the stall command sets it
+#define ENCODER_SLACK		ENCODER_COUNTS	// counts a window may come up short, the rotor lags the step
+#define ENCODER_BACKOFFS	3	// stalled windows in a row that slow the motor down, the next one stops it
+
+#if ENCODER_ENABLE
+
+#if PROF_ENABLE || TIME_CALIBRATE || MOTOR_PWM && MOTOR_PWM_COUNT
+#error The encoder needs Timer1 to itself, build without prof, cal (TIME_CALIBRATE 0) and ECCP step counting
+#endif
+#if ENCODER_COUNTS % 2 || ENCODER_COUNTS > 256
+#error ENCODER_COUNTS must be even and no more than 256 (a window of 255 steps has to fit into Timer1)
+#endif
+
+// Position of the shaft in encoder counts, clockwise is positive as for motor_position
+extern int32 encoder_position;
+
+// Steps per check, 0 for none (the position is still counted)
+extern char encoder_window;
+
+// Number of stalls found
+extern unsigned long encoder_stalls;
+
+// Period to go back to once the move is over, 0 if a stall didn't slow it down
+extern unsigned long encoder_period;
+
+// What the console task is to report (see io_notice)
+#define ENCODER_REPORT_NONE		0
+#define ENCODER_REPORT_SLOWED	1	// down to motor_nextPeriod
+#define ENCODER_REPORT_STOPPED	2
+
+extern char encoder_report;
+
+// Start counting the encoder
+void encoder_init();
+
+// Is to be called for every step made in software, adds what it should make to the window
+void encoder_step();
+
+// Is to be called at every step boundary before the step (and motor_latch()), checks the window once it's full
+// or the motor stopped, returns 1 if it slowed the motor down
+bit encoder_update();
+
+// Start a new window, the steps so far aren't checked
+void encoder_reset();
+
+// Is to be called when nothing is stepping, the period a stall slowed the last move down from comes back
+void encoder_restore();
+
+// Prints encoder_report and clears it
+void encoder_print();
+
+// Is to be called when a new speed is asked for, it stays after the move
+#define encoder_forget()	encoder_period = 0
+
+#else
+
+#define encoder_step()
+#define encoder_restore()
+#define encoder_forget()
+
+#endif // ENCODER_ENABLE
+
+#endif // !_HEAD_ENCODER
\ No newline at end of file
@@ -0,0 +1,346 @@
+#include "language.h"
+
+#include <cstdio>
+
+namespace fuzz {
+
+std::string State::str() const {
+	char s[128];
+	snprintf(s, sizeof(s), "period %u %s %s quiet %s %s%s ack %s flow %s seq %u", period, ccw ? "cc" : "cw",
+		half ? "half" : "full", quiet ? "on" : "off", running ? "running" : "stopped", armed ? " armed" : "",
+		acks ? "on" : "off", flow ? "on" : "off", seq);
+	return s;
+}
+
+std::string Outcome::answer() const {
+	std::string n = std::to_string(seq);
+	if (empty)
+		return "";
+	if (acks && tooLong)
+		return "nak " + n + " 0";
+	if (acks && err)
+		return "nak " + n + " " + std::to_string(err);
+	if (acks)
+		return "ack " + n;
+	if (tooLong)
+		return "Line too long";
+	if (err)
+		return "err " + std::to_string(err);
+	return "";
+}
+
+std::vector<std::string> split(const std::string & line) {
+	std::vector<std::string> r(1);
+	bool start = true;
+	for (char c : line) {
+		if (c == '\0')
+			break;
+		if (c == ' ' && start)
+			continue;
+		start = false;
+		if (c == ';') {
+			r.emplace_back();
+			start = true;
+		} else
+			r.back() += c;
+	}
+	return r;
+}
+
+uint32_t number(const std::string & s) {
+	size_t i = 0;
+	uint32_t r = 0;
+	while (i < s.size() && s[i] == ' ')
+		i++;
+	for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++) {
+		uint32_t d = s[i] - '0';
+		if (r > 429496729 || (r == 429496729 && d > 5))
+			return 0;
+		r = r * 10 + d;
+	}
+	while (i < s.size() && s[i] == ' ')
+		i++;
+	return i < s.size() ? 0 : r;
+}
+
+// cmdcmp() of the firmware, the word and then the end or a space
+static bool word(const char * w, const std::string & s) {
+	size_t n = 0;
+	for (; w[n]; n++)
+		if (n >= s.size() || s[n] != w[n])
+			return false;
+	return n == s.size() || s[n] == ' ';
+}
+
+enum Command { NONE, HELP, INFO, START, STOP, SPEED, DIR, SIZE, STEP, PROF, CAL, QUIET, ARM, TASKS, ACK, FLOW, AT, TICK };
+
+// parseInput(), the command and what follows its word
+static Command parse(const std::string & s, std::string & arg) {
+	static const struct { const char * word; Command cmd; } words[] = {
+		{ "?", HELP }, { "help", HELP }, { "info", INFO }, { "start", START }, { "stop", STOP },
+		{ "speed", SPEED }, { "dir", DIR }, { "size", SIZE }, { "step", STEP }, { "prof", PROF },
+		{ "cal", CAL }, { "quiet", QUIET }, { "arm", ARM }, { "tasks", TASKS }, { "ack", ACK }, { "flow", FLOW },
+		{ "at", AT }, { "tick", TICK },
+	};
+	for (auto & w : words)
+		if (word(w.word, s)) {
+			arg = s.substr(std::string(w.word).size());
+			return w.cmd;
+		}
+	return NONE;
+}
+
+// parseAt(), the ticks to wait (from now if relative) and the command, false if either is wrong
+static bool at(const std::string & arg, bool & relative, uint32_t & ticks, std::string & command) {
+	size_t i = 0;
+	while (i < arg.size() && arg[i] == ' ')
+		i++;
+	relative = i < arg.size() && arg[i] == '+';
+	i += relative;
+	if (i == arg.size() || arg[i] < '0' || arg[i] > '9')
+		return false;
+	for (ticks = 0; i < arg.size() && arg[i] >= '0' && arg[i] <= '9'; i++)
+		if ((ticks = ticks * 10 + arg[i] - '0') > 65535)
+			return false;
+	if (i == arg.size() || arg[i] != ' ')
+		return false;
+	while (i < arg.size() && arg[i] == ' ')
+		i++;
+	if (relative && (!ticks || ticks > LANG_QUEUE_AHEAD))
+		return false;
+
+	command = arg.substr(i);
+	std::string a;
+	uint32_t n;
+	switch (parse(command, a)) {
+	case START:
+	case STOP:
+		return true;
+	case SPEED:
+		n = number(a);
+		return n >= LANG_MIN_PERIOD && n <= 65535;
+	case DIR:
+		return word(" cc", a) || word(" cw", a);
+	case SIZE:
+		return word(" full", a) || word(" half", a);
+	case STEP:
+		n = number(a);
+		return n && n <= 65535;
+	default:
+		return false;
+	}
+}
+
+// checkCommand(), ats counts the at commands checked so far (atBatch)
+static bool check(Command c, const std::string & arg, int & ats) {
+	uint32_t n = number(arg);
+	bool relative;
+	std::string command;
+	switch (c) {
+	case NONE:
+		return false;
+	case SPEED:
+		return arg.empty() || (n >= LANG_MIN_PERIOD && n <= 65535);
+	case DIR:
+		return arg.empty() || word(" cc", arg) || word(" cw", arg);
+	case SIZE:
+		return arg.empty() || word(" full", arg) || word(" half", arg);
+	case STEP:
+		return arg.empty() || n;
+	case QUIET:
+	case ACK:
+	case FLOW:
+		return arg.empty() || word(" on", arg) || word(" off", arg);
+	case AT:
+		if (arg.empty() || word(" clear", arg))
+			return true;
+		if (!at(arg, relative, n, command) || ats >= LANG_QUEUE_SIZE)	// the queue is empty before every line
+			return false;
+		ats++;
+		return true;
+	default:
+		return true;
+	}
+}
+
+// io_takeSeq(), the line without its sequence number
+static std::string takeSeq(State & s, std::string line) {
+	size_t i = 0;
+	unsigned n = 0;
+	for (; i < 4 && i < line.size() && line[i] >= '0' && line[i] <= '9'; i++)
+		n = n * 10 + line[i] - '0';
+	if (!i || n > 255 || (i < line.size() && line[i] != ' ')) {
+		s.seq++;
+		return line;
+	}
+	s.seq = n;
+	return line.replace(0, i, i, ' ');
+}
+
+// A command's effect, as runBatch() (or runQueued()) has it
+static void run(State & s, const std::string & command, Outcome & o) {
+	std::string arg;
+	uint32_t n;
+	switch (parse(command, arg)) {
+	case HELP:
+	case INFO:
+	case PROF:
+	case TASKS:
+	case TICK:
+		o.query = true;
+		break;
+	case CAL:
+		o.later = true;
+		break;
+	case START:
+		if (!s.armed)
+			s.running = true;
+		break;
+	case STOP:
+		s.running = false;
+		s.armed = false;
+		break;
+	case SPEED:
+		n = number(arg);
+		if (n >= LANG_MIN_PERIOD && n <= 65535)
+			s.period = n;
+		break;
+	case DIR:
+		if (word(" cc", arg))
+			s.ccw = true;
+		else if (word(" cw", arg))
+			s.ccw = false;
+		break;
+	case SIZE:
+		if (word(" full", arg))
+			s.half = false;
+		else if (word(" half", arg))
+			s.half = true;
+		break;
+	case STEP:
+		if (number(arg) && !s.armed)
+			s.running = false;	// a step move, it isn't motor_enable
+		break;
+	case QUIET:
+		if (word(" on", arg))
+			s.quiet = true;
+		else if (word(" off", arg))
+			s.quiet = false;
+		break;
+	case ARM:
+		s.running = false;
+		s.armed = true;
+		break;
+	case ACK:
+		if (word(" on", arg))
+			s.acks = true;
+		else if (word(" off", arg))
+			s.acks = false;
+		break;
+	case FLOW:
+		if (word(" on", arg))
+			s.flow = true;
+		else if (word(" off", arg))
+			s.flow = false;
+		break;
+	case AT:
+		o.query |= arg.empty();	// the list answers like a query
+		break;
+	default:
+		break;
+	}
+}
+
+Outcome apply(State & s, const std::string & whole) {
+	Outcome o;
+	if (whole.empty() || whole[0] == '\0' || whole[0] == '\n' || whole[0] == '\r') {
+		o.empty = true;		// io_getInput() skips it, there's no seq and no answer
+		return o;
+	}
+	std::string line = takeSeq(s, whole.substr(0, LANG_SIZE_IN - 1));	// what fits is all it sees
+	o.acks = s.acks;
+	o.seq = s.seq;
+	if (whole.size() > LANG_SIZE_IN - 1) {
+		o.tooLong = true;
+		return o;
+	}
+
+	std::vector<std::string> commands = split(line);
+	std::string arg, command;
+	bool relative;
+	uint32_t ticks, last = 0;
+	int ats = 0;
+	o.commands = commands.size();
+
+	// The at commands to run once the line is done, in the order they'll run if the model can tell
+	std::vector<std::string> queued;
+	for (auto & c : commands) {
+		if (parse(c, arg) != AT || arg.empty())
+			continue;
+		if (word(" clear", arg)) {
+			queued.clear();
+			last = 0;
+		} else if (at(arg, relative, ticks, command)) {
+			o.queued++;
+			o.timed |= !relative || ticks > LANG_AT_SOON || ticks < last;
+			last = ticks;
+			queued.push_back(command);
+		}
+	}
+
+	if (o.commands > 1 || s.acks)
+		for (size_t i = 0; i < commands.size(); i++)
+			if (!commands[i].empty() && !check(parse(commands[i], arg), arg, ats)) {
+				o.err = i + 1;
+				return o;
+			}
+
+	for (auto & c : commands)
+		run(s, c, o);
+	for (auto & c : queued)
+		run(s, c, o);
+	return o;
+}
+
+std::vector<std::string> corpus() {
+	return {
+		"", "?", "help", "info", "start", "stop", "prof", "prof reset", "tasks", "tasks reset", "cal",
+
+		"speed", "speed 100", "speed 3", "speed 2", "speed 0", "speed 65535", "speed 65536", "speed 4294967295",
+		"speed 4294967296", "speed 99999999999", "speed  200 ", "speed 5x", "speed x", "speed -5", "speed +5",
+		"speedx 5", "speed\t5",
+
+		"dir", "dir cc", "dir cw", "dir ccw", "dir cc extra", "dir  cc", "dir c", "dir ", "dirt",
+		"size", "size full", "size half", "size fu", "size halfx", "sizes",
+
+		"step", "step 1", "step 0", "step 10 ", "step 4294967295", "step 4294967296", "step -1", "stepper", "step 1 2",
+		"quiet", "quiet on", "quiet off", "quiet maybe", "quieter", "quiet on", "quiet off",
+
+		"arm", "start", "step 5", "stop", "arm", "stop",
+
+		"stopwatch", "start now", "x", " ", "  info", ";", ";;;", "info;", ";info",
+
+		"speed 200;dir cc;size half", "speed 300 ; dir cw ;size full", "speed 1;dir cc", "dir cc;speed 1",
+		"speed 400;bogus", "speed 400;;dir cw", "start;stop", "arm;start;stop", "quiet on;speed 500;quiet off",
+		"step 0;start", "size half;step 20;stop", "help;speed 600", "info;tasks", "dir cw;dir cc;dir cw;dir cc",
+
+		"speed 700;dir cc;size half;step 5;stop;info;q",
+		"speed 100 and then some more characters to overflow the input",
+		"0123456789012345678901234567890123456789012345",
+		"01234567890123456789012345678901234567890123456",
+		"012345678901234567890123456789012345678901234567",
+		"speed 800                                      ",
+
+		"7 info", "255 speed 300", "256 speed 301", "12speed 5", "3", "42", "1 2 speed 9", "0 ;dir cw",
+		"ack", "ack on", "speed 2", "bogus", "9 dir cc;x", "ack x", "01234567890123456789012345678901234567890123456789",
+		"ack off", "flow", "flow on", "speed 310", "flowers", "flow off", "ack on;flow on", "ack off;flow off",
+
+		"tick", "tick 5", "ticks", "at", "at clear", "at clears", "at +1 stop", "at +5 speed 320", "at +3 start;stop",
+		"at +10 dir cc;dir cw", "at +2 size half;at +2 size full", "at +4 step 3", "at +8 start;at +9 stop", "at +0 stop",
+		"at +32768 stop", "at +2 bogus", "at +2 speed", "at +2 speed 2", "at +2 step 65536", "at +2 dir ccw", "at x",
+		"at +1 at +1 stop", "at +1", "at +1stop", "at  +2  speed 330", "at +2 stop;at +2 stop;at +2 stop;at +2 stop",
+		"at 5 stop", "at +20000 speed 340", "at +9 stop;at +3 start",
+	};
+}
+
+} // namespace fuzz
\ No newline at end of file
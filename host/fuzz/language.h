@@ -0,0 +1,84 @@
+/*
+
+	The console's command language, as a model to check the firmware against.
+	It follows the firmware's own rules: a line may start with its sequence number, io_split() for the commands
+	of a line, a word has to end in a space or the end of the command, stoi() takes spaces around the number and
+	nothing else, a batch (or any line with acks on) is checked as a whole and runs all or nothing. Lines longer
+	than the firmware's io_in are dropped.
+
+	A timed command (at) runs once the line is done. The model only follows one that's a few ticks off and
+	can't end up ahead of one before it in the line, the others depend on the tick the line came on.
+
+	Written for the firmware parsebench runs (BUS_ENABLE 0, PROF_ENABLE 1, the rest as they come), it only
+	knows the commands that build has.
+
+*/
+
+#ifndef _HEAD_FUZZ_LANGUAGE
+#define _HEAD_FUZZ_LANGUAGE
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fuzz {
+
+#define LANG_SIZE_IN		48		// IO_SIZE_IN, a line has to fit with its '\0'
+#define LANG_MIN_PERIOD		3		// MOTOR_MIN_PERIOD
+#define LANG_START_PERIOD	781		// what main() starts with
+#define LANG_QUEUE_SIZE		4		// QUEUE_SIZE
+#define LANG_QUEUE_AHEAD	32767	// QUEUE_AHEAD
+#define LANG_AT_SOON		16		// an at this many ticks off has run before the line is answered
+
+// What the commands change, as far as the host can tell
+struct State {
+	uint16_t period = LANG_START_PERIOD;	// motor_nextPeriod
+	bool ccw = false;			// motor_nextDirection
+	bool half = false;			// !motor_nextSize
+	bool quiet = false;
+	bool running = false;		// motor_enable, a step move isn't (it ends on its own)
+	bool armed = false;			// trigger_phase isn't TRIGGER_IDLE
+	bool acks = false;			// io_acks
+	bool flow = false;			// io_xon
+	uint8_t seq = 0;			// io_seq
+
+	bool operator == (const State & o) const {
+		return period == o.period && ccw == o.ccw && half == o.half && quiet == o.quiet &&
+			running == o.running && armed == o.armed && acks == o.acks && flow == o.flow && seq == o.seq;
+	}
+	bool operator != (const State & o) const { return !(*this == o); }
+	std::string str() const;
+};
+
+// What a line should do
+struct Outcome {
+	bool empty = false;			// not a line at all, nothing in it
+	bool tooLong = false;		// answered with "Line too long" (or "nak <seq> 0"), nothing ran
+	int err = 0;				// answered with "err <n>" (or "nak <seq> <n>"), nothing ran
+	bool acks = false;			// acks were on when it came, so the answer is "ack <seq>" or a nak
+	uint8_t seq = 0;
+	int commands = 0;			// commands in it, as io_split() counts them
+	bool query = false;			// something in it answers even in quiet mode
+	bool later = false;			// something in it answers later on (cal, once it has measured)
+	int queued = 0;				// at commands in it that have something to run
+	bool timed = false;			// what it does depends on the tick it came on, the model can't tell
+
+	// The line that tells whether it ran, empty if none does
+	std::string answer() const;
+};
+
+// The commands and their arguments in a line, the way io_split() cuts it
+std::vector<std::string> split(const std::string & line);
+
+// stoi() of the firmware
+uint32_t number(const std::string & s);
+
+// The line's effect on the state
+Outcome apply(State & s, const std::string & line);
+
+// Lines that cover every command with good, edge and bad arguments
+std::vector<std::string> corpus();
+
+} // namespace fuzz
+
+#endif // !_HEAD_FUZZ_LANGUAGE
\ No newline at end of file
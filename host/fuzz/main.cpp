@@ -0,0 +1,441 @@
+/*
+
+	parsebench, feeds the console parser of the firmware (running in the simulator) a corpus of commands and
+	random lines, and checks what every line did against a model of the command language (language.h).
+
+	usage:
+		parsebench                      the corpus, 20000 fuzzed lines, then the timing, stream and windowed runs
+		parsebench --seed 7 --fuzz 100000
+		parsebench --window 8           keep up to 8 lines unacked in the windowed runs (4 by default)
+		parsebench --trace              print every line with what came back
+
+	A line is a misparse when the controller's settings after it aren't the model's, or it answered "err <n>"
+	or "Line too long" when it shouldn't have (or didn't when it should). A hang is a line after which the
+	controller doesn't go quiet, or is left with input or a command pending. Either makes it exit with 1.
+
+	The timing run sends the corpus with quiet on twice and reads the prof sample after each line: cycles to
+	split and check a line (prof check) and to run it (prof cmd), the firmware measures one region at a time. Those are the simulator's estimates of the code's
+	cost (see pic.h), the commands per second figure is what the core loop could take if that was all it did.
+	The stream run sends the corpus back to back without waiting, as fast as the link takes it. The windowed
+	runs send it numbered with acks on: one line at a time, then a window of them with no flow control (to show
+	the overruns), with XON/XOFF and with the CTS line.
+
+*/
+
+#include "language.h"
+#include "rig.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// The firmware's globals, the one controller's copy is in place after it ran (see Pic::swapIn())
+namespace fw_prof {
+	extern const sim::Firmware firmware;
+	extern uns16 motor_nextPeriod;
+	extern bit motor_nextDirection, motor_nextSize, motor_enable, quiet, sched_line, sched_reply, io_acks, io_xon;
+	extern char trigger_phase, inputPos, io_seq, queue_count;
+	extern uns16 prof_last;
+}
+
+#define CAL_SPARE_MS	400		// cal measures for TIME_CAL_TICKS, the result comes a while after
+#define SEQ_ROOM		(LANG_SIZE_IN - 5)	// longest line that fits with a sequence number in front
+
+static void usage() {
+	fprintf(stderr, "usage: parsebench [--seed N] [--fuzz N] [--window N] [--trace]\n");
+	exit(2);
+}
+
+// What the firmware has now, as the model keeps it
+static fuzz::State firmwareState() {
+	fuzz::State s;
+	s.period = fw_prof::motor_nextPeriod;
+	s.ccw = fw_prof::motor_nextDirection;	// MOTOR_COUNTERCLOCKWISE is 1
+	s.half = !fw_prof::motor_nextSize;		// MOTOR_FULL_STEP is 1
+	s.quiet = fw_prof::quiet;
+	s.running = fw_prof::motor_enable;
+	s.armed = fw_prof::trigger_phase != 0;	// TRIGGER_IDLE
+	s.acks = fw_prof::io_acks;
+	s.flow = fw_prof::io_xon;
+	s.seq = fw_prof::io_seq;
+	return s;
+}
+
+class Bench {
+public:
+	Bench(bool trace) : rig(fw_prof::firmware, 1, false, 64), trace(trace) {
+		rig.run(rig.ms(SIM_STARTUP_MS));
+		quietCycles = rig.quiet();
+	}
+
+	uint64_t calMs() const { return (uint64_t)rig.firmware.calTicks * rig.firmware.tickUs / 1000 + CAL_SPARE_MS; }
+
+	// Sends a line and checks what it did, returns false if it wasn't what the model says
+	bool line(const std::string & l) {
+		fuzz::Outcome o = fuzz::apply(model, l);
+		lines++;
+		commands += o.tooLong ? 0 : o.commands;
+
+		rig.send(1, l);
+		bool settled = rig.settle(quietCycles, rig.ms(SIM_REPLY_MS) * std::max(o.commands, 1));	// help takes a while
+		if (o.later && settled && !o.err) {
+			rig.run(rig.ms(calMs()));	// the result would run into the next line otherwise
+			settled = rig.settle(quietCycles, rig.ms(SIM_REPLY_MS));
+		}
+		std::string reply = rig.heard(0);
+		rig.heard(0).clear();
+		if (trace)
+			printf("> %s\n%s", printable(l).c_str(), reply.c_str());
+		if (o.timed && settled) {
+			// it's up to the tick, whatever it did the queue is emptied and the model goes on from the firmware
+			rig.send(1, "at clear");
+			settled = rig.settle(quietCycles, rig.ms(SIM_REPLY_MS));
+			rig.heard(0).clear();
+			if (settled && !fw_prof::inputPos && !fw_prof::sched_line && !fw_prof::sched_reply && !rig.xoff) {
+				model = firmwareState();
+				return true;
+			}
+		}
+
+		std::string problem;
+		std::string answer = o.answer();
+		if (!settled || fw_prof::inputPos || fw_prof::sched_line || fw_prof::sched_reply || rig.xoff || fw_prof::queue_count) {
+			hangs++;
+			problem = !settled ? "still talking after " + std::to_string(SIM_REPLY_MS) + " ms" :
+				rig.xoff ? "no XON" : fw_prof::queue_count ? "left with a command queued" :
+				fw_prof::sched_reply ? "left with a reply going out" : "left with input pending";
+		} else if (!answered(reply, answer, problem))
+			;
+		else if (firmwareState() != model)
+			problem = "firmware has " + firmwareState().str() + ", expected " + model.str();
+		if (problem.empty())
+			return true;
+
+		misparses += settled;
+		printf("\"%s\": %s\n", printable(l).c_str(), problem.c_str());
+		if (!reply.empty())
+			printf("  replied \"%s\"\n", printable(reply).c_str());
+		model = firmwareState();	// go on from where the firmware is
+		return false;
+	}
+
+	// Whether the reply has the answer and no other (an ack, a nak, an err or "Line too long"), and if not why
+	static bool answered(const std::string & reply, const std::string & answer, std::string & problem) {
+		static const char * const answers[] = { "ack ", "nak ", "err ", "Line too long" };	// "ack [on/off]" is help
+		bool found = answer.empty();
+		size_t at = 0;
+		while (at < reply.size()) {
+			size_t end = reply.find("\r\n", at);
+			std::string l = reply.substr(at, end - at);
+			at = end == std::string::npos ? reply.size() : end + 2;
+			if (l == answer) {
+				found = true;
+				continue;
+			}
+			for (const char * a : answers)
+				if (l.compare(0, strlen(a), a) == 0 && (l.size() == strlen(a) || isdigit((unsigned char)l[strlen(a)]))) {
+					problem = "\"" + l + "\"" + (answer.empty() ? "" : ", expected \"" + answer + "\"");
+					return false;
+				}
+		}
+		if (!found)
+			problem = "no \"" + answer + "\"";
+		return found;
+	}
+
+	static std::string printable(const std::string & s) {
+		std::string r;
+		char hex[8];
+		for (unsigned char c : s) {
+			if (c >= ' ' && c < 0x7F)
+				r += c;
+			else {
+				snprintf(hex, sizeof(hex), "\\x%02X", c);
+				r += hex;
+			}
+		}
+		return r;
+	}
+
+	sim::Rig rig;
+	fuzz::State model;
+	bool trace;
+	uint64_t quietCycles;
+	uint64_t lines = 0, commands = 0;
+	uint64_t misparses = 0, hangs = 0;
+};
+
+// A corpus line with a few characters changed, dropped, doubled or put in
+static std::string mutate(std::mt19937 & rng, std::string s) {
+	static const char alphabet[] = " ;0123456789abcdefghijklmnopqrstuvwxyz?-+";
+	int edits = 1 + rng() % 3;
+	for (int i = 0; i < edits; i++) {
+		size_t at = s.empty() ? 0 : rng() % (s.size() + 1);
+		char c = alphabet[rng() % (sizeof(alphabet) - 1)];
+		switch (rng() % 4) {
+		case 0:
+			s.insert(s.begin() + at, c);
+			break;
+		case 1:
+			if (at < s.size())
+				s.erase(at, 1);
+			break;
+		case 2:
+			if (at < s.size())
+				s[at] = c;
+			break;
+		default:
+			if (at < s.size())
+				s.insert(s.begin() + at, s[at]);
+			break;
+		}
+	}
+	return s;
+}
+
+// Bytes the firmware may get on the line, anything but the ones that end it
+static std::string noise(std::mt19937 & rng, size_t n) {
+	std::string s;
+	while (s.size() < n) {
+		char c = rng() & 0xFF;
+		if (c != '\0' && c != '\r' && c != '\n')
+			s += c;
+	}
+	return s;
+}
+
+static std::string fuzzLine(std::mt19937 & rng, const std::vector<std::string> & corpus) {
+	const std::string & a = corpus[rng() % corpus.size()];
+	std::string s;
+	switch (rng() % 6) {
+	case 0:
+	case 1:
+		return mutate(rng, a);
+
+	case 2:
+		// a batch of good and bad commands
+		s = a;
+		for (int n = rng() % 4; n >= 0; n--)
+			s += (rng() % 2 ? ";" : " ; ") + corpus[rng() % corpus.size()];
+		return s;
+
+	case 3:
+		return noise(rng, rng() % 60);
+
+	case 4:
+		// around the length that still fits
+		s = a;
+		while (s.size() < LANG_SIZE_IN - 3 + rng() % 6)
+			s += ' ';
+		return s;
+
+	default:
+		// a word that goes on, or trails off
+		return a + (rng() % 2 ? noise(rng, 1 + rng() % 3) : std::string(1 + rng() % 3, ' '));
+	}
+}
+
+/*
+	Sends the lines with sequence numbers, keeping at most window of them unanswered, and checks that each one
+	is acked in turn. Acks are to be on, and quiet too: the acks are all that comes back then.
+	must is false for a run that's only there to show what goes wrong without flow control, its naks aren't
+	counted as misparses.
+*/
+static void windowed(Bench & b, const std::vector<std::string> & lines, size_t window, const char * how, bool must) {
+	std::string & heard = b.rig.heard(0);
+	uint64_t overruns = b.rig.chips[0]->stats.overruns;
+	uint64_t start = b.rig.now();
+	uint64_t last = start;		// when the last answer came, a line that's lost never gets one
+	size_t sent = 0, answered = 0, acked = 0, commands = 0;
+	std::vector<uint8_t> seqs;
+
+	while (answered < lines.size() && b.rig.now() - last < b.rig.ms(SIM_REPLY_MS)) {
+		while (sent < lines.size() && sent - answered < window) {
+			std::string l = std::to_string(sent % 256) + " " + lines[sent];
+			fuzz::Outcome o = fuzz::apply(b.model, l);
+			seqs.push_back(o.seq);
+			commands += o.commands;
+			b.rig.send(1, l);
+			sent++;
+		}
+		b.rig.run(b.rig.bitCycles());
+
+		size_t n;
+		while ((n = heard.find("\r\n")) != std::string::npos) {
+			std::string l = heard.substr(0, n);
+			heard.erase(0, n + 2);
+			bool ack = l.compare(0, 4, "ack ") == 0;
+			if (must && !ack)
+				printf("%s: \"%s\" for \"%s\"\n", how, Bench::printable(l).c_str(),
+					lines[std::min(answered, lines.size() - 1)].c_str());
+			if (!ack && l.compare(0, 4, "nak ") != 0)
+				continue;	// anything else isn't an answer at all
+
+			// the line it answers, the ones before it that weren't are lost
+			long seq = atol(l.c_str() + 4);
+			size_t j = answered;
+			while (j < sent && seqs[j] != seq)
+				j++;
+			if (j == sent)
+				continue;
+			answered = j + 1;
+			acked += ack;
+			last = b.rig.now();
+		}
+	}
+	bool settled = b.rig.settle(b.quietCycles, b.rig.ms(SIM_REPLY_MS));
+	double seconds = (double)(b.rig.now() - start - (settled ? b.quietCycles : 0)) / b.rig.cyclesPerSecond();
+	overruns = b.rig.chips[0]->stats.overruns - overruns;
+	heard.clear();
+
+	printf("window %zu, %s: %zu of %zu acked in %.3f s, %.0f lines/s, %.0f commands/s, %llu overruns\n", window, how,
+		acked, lines.size(), seconds, lines.size() / seconds, commands / seconds, (unsigned long long)overruns);
+	if (!must) {
+		// a line that lost its end leaves its start in the firmware, an empty one ends it
+		b.rig.send(1, "");
+		b.rig.settle(b.quietCycles, b.rig.ms(SIM_REPLY_MS));
+		heard.clear();
+		b.model = firmwareState();	// whatever made it through
+		return;
+	}
+	b.lines += lines.size();
+	b.commands += commands;
+	if (!settled || answered < lines.size() || b.rig.xoff)
+		b.hangs++;
+	else if (acked < lines.size() || firmwareState() != b.model) {
+		b.misparses++;
+		printf("%s: firmware has %s, expected %s\n", how, firmwareState().str().c_str(), b.model.str().c_str());
+	}
+	b.model = firmwareState();
+}
+
+int main(int argc, char ** argv) {
+	uint32_t seed = 1;
+	long fuzzLines = 20000;
+	size_t window = 4;
+	bool trace = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "--seed" && i + 1 < argc)
+			seed = strtoul(argv[++i], nullptr, 0);
+		else if (a == "--fuzz" && i + 1 < argc)
+			fuzzLines = atol(argv[++i]);
+		else if (a == "--window" && i + 1 < argc)
+			window = atoi(argv[++i]);
+		else if (a == "--trace")
+			trace = true;
+		else
+			usage();
+	}
+	if (fuzzLines < 0 || window < 1 || window > 256)
+		usage();
+
+	Bench b(trace);
+	if (b.rig.firmware.sizeIn != LANG_SIZE_IN || b.rig.firmware.minPeriod != LANG_MIN_PERIOD) {
+		fprintf(stderr, "the model (language.h) doesn't match the firmware's IO_SIZE_IN or MOTOR_MIN_PERIOD\n");
+		return 2;
+	}
+	std::vector<std::string> corpus = fuzz::corpus();
+	std::mt19937 rng(seed);
+
+	for (auto & l : corpus)
+		b.line(l);
+	printf("corpus: %llu lines, %llu misparses, %llu hangs\n", (unsigned long long)b.lines,
+		(unsigned long long)b.misparses, (unsigned long long)b.hangs);
+
+	for (long i = 0; i < fuzzLines; i++)
+		b.line(fuzzLine(rng, corpus));
+	printf("fuzz: %llu lines (seed %u), %llu misparses, %llu hangs\n", (unsigned long long)b.lines, seed,
+		(unsigned long long)b.misparses, (unsigned long long)b.hangs);
+
+	// The lines that don't answer with quiet on, a reply would hold up the input (or cal take Timer1 from prof)
+	std::vector<std::string> silent;
+	fuzz::State s;
+	for (auto & l : corpus) {
+		fuzz::Outcome o = fuzz::apply(s, l);
+		if (!o.tooLong && !o.err && !o.query && !o.later && !o.queued && l.find("quiet") == std::string::npos &&
+				l.find("ack") == std::string::npos && l.find("flow") == std::string::npos && l.size() <= SEQ_ROOM)
+			silent.push_back(l);
+	}
+
+	// Timing, every line that reaches runBatch() leaves a sample
+	uint64_t parse = 0, cmd = 0, worst = 0, commands = 0;
+	std::vector<uint64_t> checked;
+	b.line("stop;speed 781;quiet on;ack off;flow off");
+	b.line("prof check");
+	for (auto & l : silent) {
+		b.line(l);
+		checked.push_back(fw_prof::prof_last);
+		parse += fw_prof::prof_last;
+		commands += fuzz::split(l).size();
+	}
+	b.line("stop;speed 781;prof cmd");
+	for (size_t i = 0; i < silent.size(); i++) {
+		b.line(silent[i]);
+		cmd += fw_prof::prof_last;
+		worst = std::max(worst, checked[i] + fw_prof::prof_last);
+	}
+	b.line("stop;speed 781");
+	double cps = b.rig.cyclesPerSecond();
+	printf("timing: %zu lines, %.0f cycles to split and check, %.0f to run, %llu at most\n", silent.size(),
+		(double)parse / silent.size(), (double)cmd / silent.size(), (unsigned long long)worst);
+	printf("        %.0f commands/s, %.0f lines/s of parsing and running alone\n", commands * cps / (parse + cmd),
+		silent.size() * cps / (parse + cmd));
+
+	// Stream, the same lines back to back
+	fuzz::State expect = b.model;
+	for (auto & l : silent)
+		fuzz::apply(expect, l);
+	uint64_t overruns = b.rig.chips[0]->stats.overruns;
+	uint64_t start = b.rig.now();
+	for (auto & l : silent)
+		b.rig.send(1, l);
+	bool settled = b.rig.settle(b.quietCycles, b.rig.ms(SIM_REPLY_MS) * silent.size());
+	double seconds = (b.rig.now() - start - (settled ? b.quietCycles : 0)) / cps;
+	overruns = b.rig.chips[0]->stats.overruns - overruns;
+	b.rig.heard(0).clear();
+	printf("stream: %zu lines in %.3f s, %.0f lines/s, %.0f commands/s, %llu overruns\n", silent.size(), seconds,
+		silent.size() / seconds, commands / seconds, (unsigned long long)overruns);
+	if (!settled)
+		b.hangs++;
+	else if (firmwareState() != expect) {
+		b.misparses += !overruns;	// a line that lost characters isn't the line the model ran
+		printf("stream: firmware has %s, expected %s%s\n", firmwareState().str().c_str(), expect.str().c_str(),
+			overruns ? " (with characters lost to overruns)" : "");
+	}
+	if (overruns) {
+		b.rig.send(1, "");	// ends what's left of a line whose '\r' was lost
+		b.rig.settle(b.quietCycles, b.rig.ms(SIM_REPLY_MS));
+		b.rig.heard(0).clear();
+	}
+	b.model = firmwareState();
+
+	// The same lines numbered and acked, one at a time and then several in flight. With acks on a single
+	// command is checked too, the ones that would be nak'd with a number in front are left out
+	std::vector<std::string> acked;
+	s = fuzz::State();
+	s.acks = true;
+	for (auto & l : silent)
+		if (!fuzz::apply(s, "0 " + l).err)
+			acked.push_back(l);
+	b.line("stop;speed 781;ack on");
+	windowed(b, acked, 1, "stop and wait", true);
+	windowed(b, acked, window, "no flow control", false);
+	b.line("stop;speed 781;flow on");
+	windowed(b, acked, window, "XON/XOFF", true);
+	b.line("stop;speed 781;flow off");
+	b.rig.chips[0]->board.cts = true;
+	windowed(b, acked, window, "CTS", true);
+	b.rig.chips[0]->board.cts = false;
+
+	printf("%llu lines, %llu commands, %llu misparses, %llu hangs\n", (unsigned long long)b.lines,
+		(unsigned long long)b.commands, (unsigned long long)b.misparses, (unsigned long long)b.hangs);
+	return b.misparses || b.hangs ? 1 : 0;
+}
\ No newline at end of file
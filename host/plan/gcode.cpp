@@ -0,0 +1,140 @@
+#include "gcode.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+namespace plan {
+
+#define MM_PER_INCH		25.4
+
+ParseError::ParseError(int line, const std::string & what)
+	: std::runtime_error("line " + std::to_string(line) + ": " + what), line(line) {}
+
+// The line without comments, upper case
+static std::string clean(const std::string & l) {
+	std::string out;
+	int paren = 0;
+	for (char c : l) {
+		if (c == ';' && !paren)
+			break;
+		if (c == '(')
+			paren++;
+		else if (c == ')' && paren)
+			paren--;
+		else if (!paren)
+			out += toupper((unsigned char)c);
+	}
+	return out;
+}
+
+std::vector<Block> parseGcode(std::istream & in, const std::string & axes) {
+	if (axes.size() > PLAN_MAX_AXES)
+		throw ParseError(0, "more than " + std::to_string(PLAN_MAX_AXES) + " axes");
+	std::vector<Block> blocks;
+	std::string l;
+	int number = 0;
+
+	double position[PLAN_MAX_AXES] = {};
+	double scale = 1;			// mm per unit
+	bool relative = false;
+	int motion = 0;				// G0 until told otherwise
+	double feed = 0;			// mm/s, none until an F
+
+	while (std::getline(in, l)) {
+		number++;
+		std::string s = clean(l);
+
+		bool dwell = false, end = false, moves = false;
+		double word[PLAN_MAX_AXES];
+		bool has[PLAN_MAX_AXES] = {};
+		double p = -1, sec = -1;
+
+		for (size_t i = 0; i < s.size(); ) {
+			char letter = s[i++];
+			if (isspace((unsigned char)letter) || letter == '%')
+				continue;
+			if (!isalpha((unsigned char)letter))
+				throw ParseError(number, std::string("unexpected '") + letter + "'");
+			while (i < s.size() && isspace((unsigned char)s[i]))
+				i++;
+			const char * start = s.c_str() + i;
+			char * stop;
+			double value = strtod(start, &stop);
+			if (stop == start)
+				throw ParseError(number, std::string(1, letter) + " without a number");
+			i += stop - start;
+
+			size_t axis = axes.find(letter);
+			if (axis != std::string::npos) {
+				word[axis] = value;
+				has[axis] = true;
+				moves = true;
+				continue;
+			}
+			int code = (int)lround(value);
+			switch (letter) {
+			case 'G':
+				if (fabs(value - code) > 1e-9)
+					throw ParseError(number, "G" + std::to_string(value) + " isn't supported");
+				switch (code) {
+				case 0: case 1: motion = code; break;
+				case 4: dwell = true; break;
+				case 20: scale = MM_PER_INCH; break;
+				case 21: scale = 1; break;
+				case 90: relative = false; break;
+				case 91: relative = true; break;
+				default: throw ParseError(number, "G" + std::to_string(code) + " isn't supported");
+				}
+				break;
+			case 'M':
+				end = end || code == 2 || code == 30;
+				break;
+			case 'F':
+				if (value <= 0)
+					throw ParseError(number, "feed rate must be positive");
+				feed = value * scale / 60;
+				break;
+			case 'P': p = value; break;
+			case 'S': sec = value; break;
+			case 'N': case 'T': break;
+			case 'X': case 'Y': case 'Z': case 'A': case 'B': case 'C': case 'U': case 'V': case 'W':
+				throw ParseError(number, std::string("the machine has no ") + letter + " axis");
+			default:
+				throw ParseError(number, std::string("unknown word ") + letter);
+			}
+		}
+
+		if (dwell) {
+			if (moves)
+				throw ParseError(number, "G4 with a move");
+			double t = p >= 0 ? p / 1000 : sec;
+			if (t < 0)
+				throw ParseError(number, "G4 needs P (ms) or S (s)");
+			Block b = {};
+			b.kind = Block::DWELL;
+			b.line = number;
+			b.seconds = t;
+			blocks.push_back(b);
+		} else if (moves) {
+			if (motion == 1 && feed <= 0)
+				throw ParseError(number, "G1 without a feed rate");
+			Block b = {};
+			b.kind = Block::MOVE;
+			b.line = number;
+			for (size_t a = 0; a < axes.size(); a++) {
+				if (has[a])
+					position[a] = relative ? position[a] + word[a] * scale : word[a] * scale;
+				b.target[a] = position[a];
+			}
+			b.rapid = motion == 0;
+			b.feed = feed;
+			blocks.push_back(b);
+		}
+		if (end)
+			break;
+	}
+	return blocks;
+}
+
+} // namespace plan
\ No newline at end of file
@@ -0,0 +1,47 @@
+/*
+
+	G-code reader, the subset a controller of ours can do something with:
+		G0, G1 X.. Y.. F..       rapid and feed moves (F in units per minute, modal)
+		G4 P.. / G4 S..          dwell, P in milliseconds, S in seconds
+		G20, G21                 inches, millimetres
+		G90, G91                 absolute, relative coordinates
+		M2, M30                  end of program, the rest is ignored
+	Comments in parentheses or after ';', line numbers (N) and other M codes are skipped.
+
+*/
+
+#ifndef _HEAD_PLAN_GCODE
+#define _HEAD_PLAN_GCODE
+
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace plan {
+
+#define PLAN_MAX_AXES	6
+
+struct Block {
+	enum Kind { MOVE, DWELL };
+
+	Kind kind;
+	int line;						// where it came from, for messages
+	double target[PLAN_MAX_AXES];	// mm, absolute, in the order of the axes given to parseGcode()
+	bool rapid;						// G0, as fast as the machine goes
+	double feed;					// mm/s, for G1
+	double seconds;					// for a dwell
+};
+
+class ParseError : public std::runtime_error {
+public:
+	ParseError(int line, const std::string & what);
+	const int line;
+};
+
+// Read a program, axes names the axis letters the machine has ("XY"), any other axis word is an error
+std::vector<Block> parseGcode(std::istream &, const std::string & axes);
+
+} // namespace plan
+
+#endif // !_HEAD_PLAN_GCODE
\ No newline at end of file
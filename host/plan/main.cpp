@@ -0,0 +1,251 @@
+/*
+
+	gcodeplan, compiles G-code into timed command lines for a set of controllers.
+
+	usage:
+		gcodeplan [options] [program.gcode]          the stream to stdout (or -o file), see stream.h for the format
+		gcodeplan --dry-run [options] program.gcode  plays the stream to simulated controllers and checks the result
+
+	options:
+		--axis X:1:80[:accel][:inv]   axis letter, bus ID, steps per mm, mm/s^2 (default 100), inverted
+		--plain                       a single controller on a point to point link instead of a bus
+		--baud N                      line speed (9600)
+		--start-rate N                steps/s a motor may start and stop at (100)
+		--rapid N                     mm/s for G0 (as fast as the firmware steps)
+		--margin N                    ticks between a move ending and the next command landing (1)
+		--drift N                     ppm a controller's tick may run slow, the next move waits for that (5000)
+		--no-merge, --no-batch, --no-pipeline   leave out a part of the planning, for comparison
+		--compare                     also print what the stream would be with none of them
+		--trace                       print every character of the dry run, as motorsim
+
+*/
+
+#include "gcode.h"
+#include "planner.h"
+#include "stream.h"
+
+#include "rig.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace fw_plain { extern const sim::Firmware firmware; }
+namespace fw_bus { extern const sim::Firmware firmware; }
+
+#define DEFAULT_ACCEL	100		// mm/s^2
+#define SETTLE_MS		1000	// longest the simulated job may run over the plan
+
+static void usage() {
+	fprintf(stderr,
+		"usage: gcodeplan [--axis X:ID:STEPS_PER_MM[:ACCEL][:inv]]... [--plain] [--baud N] [--start-rate N]\n"
+		"                 [--rapid N] [--margin N] [--drift N] [--no-merge] [--no-batch] [--no-pipeline]\n"
+		"                 [--compare] [--dry-run] [--trace] [-o out] [program.gcode]\n");
+	exit(2);
+}
+
+static plan::Axis parseAxis(const std::string & s) {
+	plan::Axis a = { 0, 0, 0, DEFAULT_ACCEL, false };
+	std::vector<std::string> f;
+	std::stringstream in(s);
+	std::string part;
+	while (std::getline(in, part, ':'))
+		f.push_back(part);
+	if (f.size() < 3 || f[0].size() != 1 || !isalpha((unsigned char)f[0][0]))
+		usage();
+	a.name = toupper((unsigned char)f[0][0]);
+	a.id = atoi(f[1].c_str());
+	a.stepsPerMm = atof(f[2].c_str());
+	for (size_t i = 3; i < f.size(); i++) {
+		if (f[i] == "inv")
+			a.invert = true;
+		else
+			a.accel = atof(f[i].c_str());
+	}
+	if (a.id < 1 || a.id > 254 || a.stepsPerMm <= 0 || a.accel <= 0)
+		usage();
+	return a;
+}
+
+static void summary(const char * what, const plan::Job & job) {
+	size_t chars = 0;
+	int commands = 0;
+	for (const plan::Line & l : job.lines) {
+		chars += l.text.size() + 1;
+		commands += l.commands;
+	}
+	printf("%-9s %.3f s, %d runs of %d blocks, %d speed levels (%d late), %zu lines, %d commands, %zu characters\n",
+		what, job.ms / 1000, job.runs, job.blocks, job.levels, job.late, job.lines.size(), commands, chars);
+}
+
+// What the firmware can do, from its build, and how long its answer to "quiet on" is, from asking it
+static plan::Limits limitsOf(const sim::Firmware & fw) {
+	plan::Limits l;
+	l.tickUs = fw.tickUs;
+	l.minPeriod = fw.minPeriod;
+	l.maxLine = fw.sizeIn - 1;
+
+	sim::Rig rig(fw_plain::firmware, 1, false, 64);
+	rig.run(rig.ms(SIM_STARTUP_MS));
+	rig.heard(0).clear();
+	rig.send(1, "quiet on");
+	rig.settle(rig.quiet(), rig.ms(SIM_REPLY_MS));
+	l.quietReply = rig.heard(0).size();
+	return l;
+}
+
+// Play the job to simulated controllers at the planned times, returns 0 if every one ended up where it should
+static int dryRun(const plan::Job & job, const plan::Machine & m, bool trace) {
+	int chips = 1;
+	if (m.bus)
+		for (const plan::Axis & a : m.axes)
+			chips = std::max(chips, a.id);
+	sim::Rig rig(m.bus ? fw_bus::firmware : fw_plain::firmware, chips, m.bus, 64);
+	rig.trace = trace;
+	rig.run(rig.ms(SIM_STARTUP_MS));
+	double perMs = rig.cyclesPerSecond() / 1000.0;
+	uint64_t start = rig.now();
+
+	for (const plan::Line & l : job.lines) {
+		uint64_t at = start + (uint64_t)llround(l.at * perMs);
+		if (at > rig.now())
+			rig.run(at - rig.now());
+		if (l.id == PLAN_TRIGGER_ID)
+			rig.address(rig.firmware.busTrigger);
+		else
+			rig.send(l.id, l.text);
+	}
+
+	// let the last moves run out
+	auto chipOf = [&](const plan::Axis & a) { return m.bus ? a.id - 1 : 0; };
+	uint64_t limit = start + (uint64_t)llround(job.ms * perMs) + rig.ms(SETTLE_MS);
+	for (;;) {
+		bool there = true;
+		for (size_t i = 0; i < m.axes.size(); i++)
+			there = there && rig.chips[chipOf(m.axes[i])]->stats.position == job.position[i];
+		if ((there && rig.now() > start + job.ms * perMs) || rig.now() >= limit)
+			break;
+		rig.run(rig.ms(1));
+	}
+	rig.settle(rig.quiet(), rig.ms(SETTLE_MS));	// for the answer to "quiet off"
+
+	int bad = 0;
+	uint64_t last = start;
+	for (size_t i = 0; i < m.axes.size(); i++) {
+		const sim::Stats & s = rig.chips[chipOf(m.axes[i])]->stats;
+		bool ok = s.position == job.position[i];
+		bad += !ok;
+		last = std::max(last, s.lastStep);
+		std::string said = rig.heard(chipOf(m.axes[i]));
+		for (char & c : said)
+			if (c == '\r' || c == '\n')
+				c = ' ';
+		if (!said.empty())
+			printf("%c @%-3d said \"%s\"\n", m.axes[i].name, m.axes[i].id, said.c_str());
+		printf("%c @%-3d position %lld, planned %lld, %s, overruns %llu, framing %llu\n", m.axes[i].name, m.axes[i].id,
+			(long long)s.position, (long long)job.position[i], ok ? "ok" : "WRONG",
+			(unsigned long long)s.overruns, (unsigned long long)s.framing);
+	}
+	printf("simulated %.3f s to the last step (planned %.3f s)", (last - start) / perMs / 1000, job.ms / 1000);
+	if (m.bus)
+		printf(", line collisions %u", rig.wire.collisions);	// a point to point link has a wire each way
+	printf("\n");
+	return bad || (m.bus && rig.wire.collisions) ? 1 : 0;
+}
+
+int main(int argc, char ** argv) {
+	plan::Machine m;
+	plan::Options o;
+	bool dry = false, compare = false, trace = false;
+	const char * path = nullptr;
+	const char * out = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		bool more = i + 1 < argc;
+		if (a == "--axis" && more)
+			m.axes.push_back(parseAxis(argv[++i]));
+		else if (a == "--plain")
+			m.bus = false;
+		else if (a == "--baud" && more)
+			m.baud = atof(argv[++i]);
+		else if (a == "--start-rate" && more)
+			m.startRate = atof(argv[++i]);
+		else if (a == "--rapid" && more)
+			m.rapid = atof(argv[++i]);
+		else if (a == "--margin" && more)
+			o.margin = atof(argv[++i]);
+		else if (a == "--drift" && more)
+			m.drift = atof(argv[++i]);
+		else if (a == "--no-merge")
+			o.merge = false;
+		else if (a == "--no-batch")
+			o.batch = false;
+		else if (a == "--no-pipeline")
+			o.pipeline = false;
+		else if (a == "--compare")
+			compare = true;
+		else if (a == "--dry-run")
+			dry = true;
+		else if (a == "--trace")
+			trace = true;
+		else if (a == "-o" && more)
+			out = argv[++i];
+		else if (a[0] == '-' || path)
+			usage();
+		else
+			path = argv[i];
+	}
+	if (m.axes.empty())
+		m.axes.push_back(parseAxis("X:1:10"));
+	if (m.baud <= 0 || m.startRate <= 0 || m.rapid < 0 || o.margin < 0 || m.drift < 0 || (!m.bus && m.axes.size() > 1))
+		usage();
+	m.fw = limitsOf(m.bus ? fw_bus::firmware : fw_plain::firmware);
+	std::string names;
+	for (const plan::Axis & a : m.axes)
+		names += a.name;
+
+	std::vector<plan::Block> blocks;
+	try {
+		if (path) {
+			std::ifstream f(path);
+			if (!f) {
+				perror(path);
+				return 1;
+			}
+			blocks = plan::parseGcode(f, names);
+		} else
+			blocks = plan::parseGcode(std::cin, names);
+	} catch (const plan::ParseError & e) {
+		fprintf(stderr, "%s: %s\n", path ? path : "stdin", e.what());
+		return 1;
+	}
+
+	plan::Job job = plan::streamRuns(plan::planRuns(blocks, m, o), m, o);
+
+	if (!dry || out) {
+		std::ofstream f;
+		if (out) {
+			f.open(out);
+			if (!f) {
+				perror(out);
+				return 1;
+			}
+		}
+		plan::writeJob(out ? f : std::cout, job, m);
+	}
+	if (compare || dry)
+		summary("planned", job);
+	if (compare) {
+		plan::Options naive = o;
+		naive.merge = naive.batch = naive.pipeline = false;
+		summary("naive", plan::streamRuns(plan::planRuns(blocks, m, naive), m, naive));
+	}
+	return dry ? dryRun(job, m, trace) : 0;
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "planner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace plan {
+
+#define PARALLEL_COS	0.9999		// moves closer than this to one direction run together
+
+// A G-code move in steps
+struct Move {
+	std::vector<int64_t> steps;
+	std::vector<double> delta;	// mm, as programmed (steps are rounded, short moves would seem to turn)
+	double mm;				// length of the path
+	double speed;			// mm/s, 0 for as fast as it goes
+	int line;
+};
+
+// A move as part of a run, in steps of the run's dominant axis
+struct Segment {
+	double steps;
+	double rate;			// highest steps/s
+	double accel;			// steps/s^2
+	double entry;			// steps/s at its start, from the passes
+};
+
+static bool together(const Move & a, const Move & b) {
+	double dot = 0, na = 0, nb = 0;
+	for (size_t i = 0; i < a.steps.size(); i++) {
+		if ((a.steps[i] > 0 && b.steps[i] < 0) || (a.steps[i] < 0 && b.steps[i] > 0))
+			return false;
+		dot += a.delta[i] * b.delta[i];
+		na += a.delta[i] * a.delta[i];
+		nb += b.delta[i] * b.delta[i];
+	}
+	return dot >= PARALLEL_COS * sqrt(na * nb);
+}
+
+static std::vector<Move> toSteps(const std::vector<Block> & blocks, const Machine & m, std::vector<double> & dwells) {
+	std::vector<Move> moves;
+	size_t n = m.axes.size();
+	std::vector<int64_t> at(n, 0);
+	std::vector<double> was(n, 0);
+	double dwell = 0;
+
+	for (const Block & b : blocks) {
+		if (b.kind == Block::DWELL) {
+			dwell += b.seconds;
+			continue;
+		}
+		Move mv;
+		mv.steps.resize(n);
+		mv.delta.resize(n);
+		mv.mm = 0;
+		mv.line = b.line;
+		bool any = false;
+		for (size_t i = 0; i < n; i++) {
+			int64_t to = llround(b.target[i] * m.axes[i].stepsPerMm);
+			mv.steps[i] = to - at[i];
+			at[i] = to;
+			mv.delta[i] = b.target[i] - was[i];
+			was[i] = b.target[i];
+			double mm = mv.steps[i] / m.axes[i].stepsPerMm;
+			mv.mm += mm * mm;
+			any = any || mv.steps[i];
+		}
+		if (!any)
+			continue;				// shorter than a step
+		mv.mm = sqrt(mv.mm);
+		mv.speed = b.rapid ? m.rapid : b.feed;
+		moves.push_back(mv);
+		dwells.push_back(dwell);
+		dwell = 0;
+	}
+	dwells.push_back(dwell);		// after the last move
+	return moves;
+}
+
+// Trapezoid over the segments, as a period of the dominant axis for each of its steps
+static void profile(Run & run, std::vector<Segment> & segs, const Machine & m) {
+	size_t n = segs.size();
+	std::vector<double> exit(n);
+	double start = std::min(m.startRate, segs[0].rate);
+	segs[0].entry = start;
+	for (size_t j = 1; j < n; j++)
+		segs[j].entry = std::min(segs[j - 1].rate, segs[j].rate);	// in one direction there's no corner to slow for
+	exit[n - 1] = std::min(m.startRate, segs[n - 1].rate);
+
+	// backward: slow enough to stop in time, forward: no faster than it can get to
+	for (size_t j = n; j-- > 0; ) {
+		double out = j + 1 < n ? segs[j + 1].entry : exit[n - 1];
+		segs[j].entry = std::min(segs[j].entry, sqrt(out * out + 2 * segs[j].accel * segs[j].steps));
+	}
+	segs[0].entry = std::min(segs[0].entry, start);
+	for (size_t j = 0; j < n; j++) {
+		double reach = sqrt(segs[j].entry * segs[j].entry + 2 * segs[j].accel * segs[j].steps);
+		if (j + 1 < n)
+			segs[j + 1].entry = std::min(segs[j + 1].entry, reach);
+		else
+			exit[j] = std::min(exit[j], reach);
+	}
+
+	int64_t k = 0;
+	for (size_t j = 0; j < n; j++) {
+		double in = segs[j].entry, out = j + 1 < n ? segs[j + 1].entry : exit[j];
+		int64_t count = llround(segs[j].steps);
+		for (int64_t s = 0; s < count; s++, k++) {
+			double x = s + 0.5;
+			double v = std::min(segs[j].rate, std::min(sqrt(in * in + 2 * segs[j].accel * x),
+				sqrt(std::max(0.0, out * out + 2 * segs[j].accel * (segs[j].steps - x)))));
+			// never faster than planned
+			double p = ceil(rateOf(m, v) - 1e-9);
+			uint32_t period = (uint32_t)std::min<double>(PLAN_MAX_PERIOD, std::max<double>(m.fw.minPeriod, p));
+			if (run.levels.empty() || run.levels.back().period != period)
+				run.levels.push_back({ k, period });
+		}
+	}
+	if (run.levels.empty())
+		run.levels.push_back({ 0, (uint32_t)std::max<double>(m.fw.minPeriod, ceil(rateOf(m, start))) });
+}
+
+static Run makeRun(const std::vector<Move> & moves, size_t from, size_t to, double dwell, const Machine & m) {
+	size_t n = m.axes.size();
+	Run run;
+	run.steps.assign(n, 0);
+	run.dwell = dwell;
+	run.blocks = to - from;
+	for (size_t j = from; j < to; j++)
+		for (size_t i = 0; i < n; i++)
+			run.steps[i] += moves[j].steps[i];
+	run.dominant = 0;
+	for (size_t i = 1; i < n; i++)
+		if (llabs(run.steps[i]) > llabs(run.steps[run.dominant]))
+			run.dominant = i;
+	int d = run.dominant;
+
+	double fastest = rateOf(m, m.fw.minPeriod);
+	std::vector<Segment> segs;
+	for (size_t j = from; j < to; j++) {
+		const Move & mv = moves[j];
+		Segment s;
+		s.steps = llabs(mv.steps[d]);
+		if (!s.steps)
+			continue;				// a step or so on another axis only, it goes along with the rest
+		double perMm = s.steps / mv.mm;
+		s.rate = mv.speed > 0 ? std::min(fastest, mv.speed * perMm) : fastest;
+
+		// the axis that gets there first sets the acceleration along the path
+		double accel = INFINITY;
+		for (size_t i = 0; i < n; i++)
+			if (mv.steps[i])
+				accel = std::min(accel, m.axes[i].accel * mv.mm * m.axes[i].stepsPerMm / llabs(mv.steps[i]));
+		s.accel = accel * perMm;
+		segs.push_back(s);
+	}
+	profile(run, segs, m);
+	return run;
+}
+
+std::vector<Run> planRuns(const std::vector<Block> & blocks, const Machine & m, const Options & o) {
+	std::vector<double> dwells;
+	std::vector<Move> moves = toSteps(blocks, m, dwells);
+	std::vector<Run> runs;
+
+	size_t from = 0;
+	std::vector<int64_t> total(m.axes.size(), 0);
+	for (size_t j = 0; j < moves.size(); j++) {
+		for (size_t i = 0; i < m.axes.size(); i++) {
+			if (llabs(moves[j].steps[i]) > PLAN_MAX_STEPS)
+				throw std::runtime_error("line " + std::to_string(moves[j].line) + ": more steps than a move can take");
+			total[i] += moves[j].steps[i];
+		}
+		bool fits = true;
+		for (size_t i = 0; i < m.axes.size(); i++)
+			fits = fits && llabs(total[i]) <= PLAN_MAX_STEPS;
+
+		if (j > from && (!o.merge || dwells[j] > 0 || !fits || !together(moves[j - 1], moves[j]))) {
+			runs.push_back(makeRun(moves, from, j, dwells[from], m));
+			from = j;
+			total = moves[j].steps;
+		}
+	}
+	if (from < moves.size())
+		runs.push_back(makeRun(moves, from, moves.size(), dwells[from], m));
+
+	if (dwells.back() > 0) {
+		// a dwell at the end is a run that doesn't move
+		Run r;
+		r.steps.assign(m.axes.size(), 0);
+		r.dominant = 0;
+		r.dwell = dwells.back();
+		r.blocks = 0;
+		runs.push_back(r);
+	}
+	return runs;
+}
+
+} // namespace plan
\ No newline at end of file
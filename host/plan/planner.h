@@ -0,0 +1,84 @@
+/*
+
+	Motion planner, turns G-code blocks into moves a set of controllers can make.
+
+	Every axis is a controller of its own, and a controller makes one counted move at a time at a period
+	of whole ticks. So the planner:
+		- runs consecutive moves in the same direction together as one move (look-ahead), the controllers
+		  have to stop between moves that aren't, to start the next one in step with each other
+		- plans a trapezoid over each such run, through every block in it, with forward and backward passes
+		  over the junction speeds
+		- cuts the profile into periods of the dominant axis (the one with the most steps), each a level
+		  that starts at a given step, the other axes follow at their own share of it
+
+*/
+
+#ifndef _HEAD_PLAN_PLANNER
+#define _HEAD_PLAN_PLANNER
+
+#include "gcode.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace plan {
+
+#define PLAN_MAX_PERIOD		65535
+#define PLAN_MAX_STEPS		4294967295LL			// "step" takes 32 bits
+
+// What the firmware can do, gcodeplan takes it from the build it links (see sim::Firmware)
+struct Limits {
+	double tickUs = 0;		// TIME_TICK_US
+	uint32_t minPeriod = 0;	// MOTOR_MIN_PERIOD
+	size_t maxLine = 0;		// characters before the '\r', IO_SIZE_IN - 1
+	size_t quietReply = 0;	// characters in the answer to "quiet on"
+};
+
+struct Axis {
+	char name;
+	int id;					// bus ID of its controller
+	double stepsPerMm;
+	double accel;			// mm/s^2
+	bool invert;			// positive moves turn counterclockwise
+};
+
+struct Machine {
+	std::vector<Axis> axes;
+	bool bus = true;		// addressed frames, trigger for moves on more than one axis
+	double baud = 9600;
+	double startRate = 100;	// steps/s a motor starts and stops at without a ramp
+	double rapid = 0;		// mm/s of G0, 0 for as fast as the firmware steps
+	double drift = 5000;	// ppm a controller's tick may be longer than TIME_TICK_US (trim, oscillator), see lastStep()
+	Limits fw;
+};
+
+struct Options {
+	bool merge = true;		// run moves in the same direction together
+	bool batch = true;		// commands for a controller in one line, settings it already has left out
+	bool pipeline = true;	// send the next move while the last one is running, to land as it ends
+	double margin = 1;		// ticks between the end of a move and the next command landing
+};
+
+// A period of the dominant axis from a given step on
+struct Level {
+	int64_t step;
+	uint32_t period;
+};
+
+// One counted move per axis, all starting together
+struct Run {
+	std::vector<int64_t> steps;	// per axis, signed, 0 for an axis that stays
+	int dominant;
+	std::vector<Level> levels;	// the first at step 0
+	double dwell;				// seconds to wait before it, after everything stopped (G4)
+	int blocks;					// G-code moves it was made of
+};
+
+// Steps per second of a period
+inline double rateOf(const Machine & m, double period) { return 1e6 / m.fw.tickUs / period; }
+
+std::vector<Run> planRuns(const std::vector<Block> &, const Machine &, const Options &);
+
+} // namespace plan
+
+#endif // !_HEAD_PLAN_PLANNER
\ No newline at end of file
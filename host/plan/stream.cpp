@@ -0,0 +1,311 @@
+#include "stream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace plan {
+
+#define TICK_MS		(m.fw.tickUs / 1000.0)
+#define TRIGGER_MS(m)	(11 * 1000.0 / (m).baud)		// the trigger byte alone
+#define REPLY_TICKS		4							// from a line landing to the reply being on its way
+#define COMMAND_TICKS	3.5							// a command's pass and the ticks in between
+#define EVERYONE		-1							// send() to every controller at once
+
+// What the host knows of a controller
+struct Controller {
+	uint32_t period = 0;		// 0 for don't know
+	int direction = -1;			// 0 clockwise, 1 counterclockwise (as DIR), -1 for don't know
+	double end = 0;				// ms of its last step
+	double busy = 0;			// until it's done with the last line it got
+};
+
+// A period an axis gets during a run, it takes it at the first step after it got through the line
+struct Update {
+	double at;
+	uint32_t period;
+};
+
+double lineMs(const Machine & m, const std::string & text) {
+	return (text.size() + 1 + (m.bus ? 1 : 0)) * (m.bus ? 11 : 10) * 1000.0 / m.baud;
+}
+
+class Streamer {
+public:
+	Streamer(const Machine & m, const Options & o) : m(m), o(o), ctl(m.axes.size()) {
+		job.position.assign(m.axes.size(), 0);
+		margin = o.margin * TICK_MS;
+	}
+
+	Job job;
+
+	void preamble();
+	void run(const Run &);
+	void finish();
+
+private:
+	const Machine & m;
+	const Options & o;
+	std::vector<Controller> ctl;
+	double free = 0;			// the host's line is free from here
+	double margin;
+
+	double charMs() const { return (m.bus ? 11 : 10) * 1000.0 / m.baud; }
+	double earliest(int axis) const;
+	double send(double land, int axis, const std::string & text, int commands);
+	double trigger(double land);
+	double settled() const;
+	uint32_t periodOf(const Run &, size_t axis, uint32_t dominant) const;
+	double levelMs(const Run &, const std::vector<size_t> & moving, const std::vector<uint32_t> & now, uint32_t period) const;
+	double lastStep(double t0, int64_t steps, uint32_t period, const std::vector<Update> &, bool worst) const;
+};
+
+// When a line to an axis may start, its controller is to be done with the last one before the receiver fills up
+double Streamer::earliest(int axis) const {
+	double busy = 0;
+	for (size_t i = 0; i < ctl.size(); i++)
+		if (axis == EVERYONE || (int)i == axis)
+			busy = std::max(busy, ctl[i].busy);
+	return std::max(free, busy - charMs());
+}
+
+// Queue a line to land at the given time, or as soon after as it can, returns when it lands
+double Streamer::send(double land, int axis, const std::string & text, int commands) {
+	if (text.size() > m.fw.maxLine)
+		throw std::logic_error("line too long for a controller: " + text);
+	double took = lineMs(m, text);
+	double at = std::max(earliest(axis), land - took);
+	int id = axis != EVERYONE ? m.axes[axis].id : m.bus ? 0 : m.axes[0].id;
+	job.lines.push_back({ at, id, text, commands });
+	free = at + took;
+	for (size_t i = 0; i < ctl.size(); i++)
+		if (axis == EVERYONE || (int)i == axis)
+			ctl[i].busy = free + commands * COMMAND_TICKS * TICK_MS;
+	return free;
+}
+
+// The trigger is taken in the interrupt, it only has to wait for the line
+double Streamer::trigger(double land) {
+	double at = std::max(free, land - TRIGGER_MS(m));
+	job.lines.push_back({ at, PLAN_TRIGGER_ID, "", 0 });
+	free = at + TRIGGER_MS(m);
+	return free;
+}
+
+double Streamer::settled() const {
+	double t = 0;
+	for (const Controller & c : ctl)
+		t = std::max(t, c.end);
+	return t;
+}
+
+uint32_t Streamer::periodOf(const Run & r, size_t axis, uint32_t dominant) const {
+	if ((int)axis == r.dominant)
+		return dominant;
+	double p = round((double)dominant * llabs(r.steps[r.dominant]) / llabs(r.steps[axis]));
+	return (uint32_t)std::min<double>(PLAN_MAX_PERIOD, std::max<double>(m.fw.minPeriod, p));
+}
+
+// Time the lines of a level take, for the axes whose period changes
+double Streamer::levelMs(const Run & r, const std::vector<size_t> & moving, const std::vector<uint32_t> & now, uint32_t period) const {
+	double t = 0;
+	for (size_t i : moving) {
+		uint32_t p = periodOf(r, i, period);
+		if (p != now[i])
+			t += lineMs(m, "speed " + std::to_string(p));
+	}
+	return t;
+}
+
+/*
+	When the last step of an axis is made. The dominant axis has its periods well before the step they're for,
+	the others just take them at some step, so with worst set each is taken a step off the way that ends later.
+	The controller's tick is taken to be Machine::drift slow: its steps fall behind and the lines, timed by the
+	host, come in at earlier steps. Slowing down early ends a move later still.
+*/
+double Streamer::lastStep(double t0, int64_t steps, uint32_t period, const std::vector<Update> & updates, bool worst) const {
+	double slow = 1 + m.drift / 1e6;
+	double t = t0;
+	int64_t left = steps - 1;
+	for (const Update & u : updates) {
+		double at = t0 + (u.at - t0) / slow;	// on the controller's clock
+		double n = at <= t ? 0 : ceil((at - t) / (period * TICK_MS) - 1e-9);
+		if (worst)
+			n = u.period > period ? std::max(0.0, n - 1) : n + 1;
+		if (n >= left)
+			break;
+		t += n * period * TICK_MS;
+		left -= (int64_t)n;
+		period = u.period;
+	}
+	return t0 + (t + left * period * TICK_MS - t0) * slow;
+}
+
+void Streamer::preamble() {
+	// broadcast isn't answered, a controller of its own answers and doesn't read the line while it does
+	send(0, EVERYONE, "quiet on", 1);
+	if (!m.bus)
+		free += REPLY_TICKS * TICK_MS + m.fw.quietReply * 10 * 1000.0 / m.baud;
+	for (Controller & c : ctl)
+		c.end = free;
+}
+
+void Streamer::run(const Run & r) {
+	job.runs++;
+	job.blocks += r.blocks;
+	if (r.dwell > 0) {
+		double until = settled() + r.dwell * 1000;
+		for (Controller & c : ctl)
+			c.end = until;
+	}
+	if (!o.pipeline)
+		free = std::max(free, settled() + margin);	// wait for everything to stop, then start sending
+
+	std::vector<size_t> moving;
+	moving.push_back(r.dominant);
+	for (size_t i = 0; i < r.steps.size(); i++)
+		if (r.steps[i] && (int)i != r.dominant)
+			moving.push_back(i);
+	if (!r.steps[r.dominant])
+		return;						// a dwell at the end
+
+	// the start, on every axis at once
+	bool synchronized = m.bus && moving.size() > 1;
+	for (size_t i : moving) {
+		uint32_t p = periodOf(r, i, r.levels[0].period);
+		int dir = (r.steps[i] < 0) != m.axes[i].invert;
+		std::vector<std::string> commands;
+		if (synchronized)
+			commands.push_back("arm");
+		if (!o.batch || ctl[i].period != p)
+			commands.push_back("speed " + std::to_string(p));
+		if (!o.batch || ctl[i].direction != dir)
+			commands.push_back(dir ? "dir cc" : "dir cw");
+		commands.push_back("step " + std::to_string(llabs(r.steps[i])));
+
+		double ready = ctl[i].end + margin;
+		if (o.batch) {
+			std::string text;
+			for (const std::string & c : commands)
+				text += (text.empty() ? "" : ";") + c;
+			send(ready, i, text, commands.size());
+		} else
+			for (const std::string & c : commands)
+				send(ready, i, c, 1);
+		ctl[i].period = p;
+		ctl[i].direction = dir;
+		job.position[i] += m.axes[i].invert ? -r.steps[i] : r.steps[i];
+	}
+	// the first step is made on the first tick after the trigger (once every controller took its move),
+	// or after the controller got through the line
+	double taken = 0;
+	for (size_t i : moving)
+		taken = std::max(taken, ctl[i].busy);
+	double t0 = (synchronized ? trigger(taken + margin) : taken) + TICK_MS;
+
+	// speed levels, timed by the dominant axis
+	std::vector<std::vector<Update>> updates(m.axes.size());
+	std::vector<uint32_t> now(m.axes.size());
+	for (size_t i : moving)
+		now[i] = ctl[i].period;
+	int64_t steps = llabs(r.steps[r.dominant]);
+	int64_t at = 0;					// the step the period in effect started at
+	uint32_t period = r.levels[0].period;
+	double t = t0;
+
+	for (size_t l = 1; l < r.levels.size(); ) {
+		int64_t k = r.levels[l].step;
+		uint32_t p = r.levels[l].period;
+		size_t next = l + 1;
+		if (k >= steps - 1)
+			break;					// after the last step there's nothing to time
+		double due = t + (k - at) * period * TICK_MS;
+
+		if (p > period) {
+			// slowing down: the levels that follow too closely for lines of their own go with this one
+			while (next < r.levels.size() && r.levels[next].step < steps - 1 &&
+				(r.levels[next].step - k) * p * TICK_MS < levelMs(r, moving, now, p) + margin + COMMAND_TICKS * TICK_MS)
+				p = std::max(p, r.levels[next++].period);
+		}
+
+		if (p == period) {
+			l = next;				// merged back to what it has
+			continue;
+		}
+
+		std::string text = "speed " + std::to_string(p);
+		double land = due - margin - COMMAND_TICKS * TICK_MS;
+		if (earliest(r.dominant) + lineMs(m, text) > land) {
+			if (p < period) {
+				l = next;			// speeding up can wait for a later level
+				continue;
+			}
+			job.late++;
+		}
+
+		double landing = send(land, r.dominant, text, 1);
+		double has = ctl[r.dominant].busy;
+		if (landing > land) {
+			// late, it's taken at the first step after that
+			k = at + (int64_t)ceil((has - t) / (period * TICK_MS) - 1e-9);
+			if (k >= steps - 1)
+				break;
+			due = t + (k - at) * period * TICK_MS;
+		}
+		updates[r.dominant].push_back({ has, p });
+		now[r.dominant] = p;
+		for (size_t i : moving) {
+			uint32_t q = periodOf(r, i, p);
+			if ((int)i == r.dominant || q == now[i])
+				continue;
+			send(0, i, "speed " + std::to_string(q), 1);
+			updates[i].push_back({ ctl[i].busy, q });
+			now[i] = q;
+		}
+		job.levels++;
+		at = k;
+		t = due;
+		period = p;
+		l = next;
+	}
+
+	for (size_t i : moving) {
+		ctl[i].end = lastStep(t0, llabs(r.steps[i]), ctl[i].period, updates[i], (int)i != r.dominant);
+		ctl[i].period = now[i];
+	}
+}
+
+void Streamer::finish() {
+	job.ms = settled();
+	send(job.ms + margin, EVERYONE, "quiet off", 1);
+}
+
+Job streamRuns(const std::vector<Run> & runs, const Machine & m, const Options & o) {
+	if (m.axes.empty())
+		throw std::invalid_argument("no axes");
+	if (!m.bus && m.axes.size() > 1)
+		throw std::invalid_argument("more than one axis needs a bus");
+	Streamer s(m, o);
+	s.preamble();
+	for (const Run & r : runs)
+		s.run(r);
+	s.finish();
+	return s.job;
+}
+
+void writeJob(std::ostream & out, const Job & job, const Machine & m) {
+	char at[32];
+	for (const Line & l : job.lines) {
+		snprintf(at, sizeof(at), "%.3f ", l.at);
+		out << at;
+		if (l.id == PLAN_TRIGGER_ID)
+			out << "trigger\n";
+		else if (m.bus)
+			out << "@" << l.id << " " << l.text << "\n";
+		else
+			out << l.text << "\n";
+	}
+}
+
+} // namespace plan
\ No newline at end of file
@@ -0,0 +1,56 @@
+/*
+
+	Command stream, the runs of the planner as timed lines for the controllers.
+
+	A run starts with a batch for every axis that moves in it: "arm;speed P;dir cw;step N" on a bus followed
+	by the trigger byte once all of them landed, "speed P;dir cw;step N" when a single axis moves. A speed
+	level is a "speed P" to each axis whose period changes, sent so that the dominant axis has it a tick
+	before the step it starts at (speed is double buffered, it's taken at the next step). Levels too close
+	for the line to carry are merged: speeding up waits for a later one, slowing down takes the slowest of
+	the close ones early. So the motors are never faster than planned, only slower.
+
+	With pipelining the start of the next run is sent while the last one is still running, to land a
+	margin after its last step, reckoned on a controller clock Machine::drift slow. Controllers run quiet (told by broadcast, which isn't answered) so the
+	line is the host's alone.
+
+*/
+
+#ifndef _HEAD_PLAN_STREAM
+#define _HEAD_PLAN_STREAM
+
+#include "planner.h"
+
+#include <ostream>
+#include <string>
+
+namespace plan {
+
+#define PLAN_TRIGGER_ID		-1		// Line::id of the trigger byte
+
+struct Line {
+	double at;				// ms from the start of the job, when the host starts sending it
+	int id;					// controller, 0 for all of them, PLAN_TRIGGER_ID for the trigger
+	std::string text;
+	int commands;
+};
+
+struct Job {
+	std::vector<Line> lines;
+	std::vector<int64_t> position;	// where each axis' controller ends up, as its "position" counts
+	double ms = 0;					// when the last step is made
+	int runs = 0, blocks = 0;
+	int levels = 0;					// speed levels sent
+	int late = 0;					// levels that couldn't land in time to slow down where planned
+};
+
+// How long a line (without the '\r') takes on the wire, in ms
+double lineMs(const Machine &, const std::string &);
+
+Job streamRuns(const std::vector<Run> &, const Machine &, const Options &);
+
+// One line per line of the job: "<ms> @<id> <text>" ("<ms> <text>" without a bus, "<ms> trigger")
+void writeJob(std::ostream &, const Job &, const Machine &);
+
+} // namespace plan
+
+#endif // !_HEAD_PLAN_STREAM
\ No newline at end of file
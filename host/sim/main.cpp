@@ -0,0 +1,342 @@
+/*
+
+	motorsim, runs the controller firmware on a simulated PIC16F690, or many of them on one bus.
+
+	usage:
+		motorsim [script]                      one controller, lines from the script (or stdin) go to it
+		motorsim --nodes 8 [script]            8 controllers on a bus, script lines are "@<id> <command>"
+		motorsim --nodes 8 --bench 50          50 rounds of a batch to every controller, prints commands per second
+		motorsim --nodes 8 --bench 50 --stream the same without waiting for replies, controllers run quiet
+		motorsim --encoder --pullout 2500 [script]  one controller with an encoder, on a motor that stalls
+		                                       at steps closer together than 2500 us
+		motorsim --pwm [script]                one controller that has ECCP make the steps of a continuous run
+		motorsim --limit [script]              one controller with limit and home switches
+
+	Script lines are sent as they are (to @<id> on a bus, @0 is broadcast), a reply is whatever comes back
+	until the line has been quiet for a while. "wait <ms>" lets time pass, lines starting with # are skipped.
+	"trigger" fires armed controllers (the trigger byte on a bus, the trigger line otherwise), "pin" always
+	pulls the line, "skew" prints when each controller made its first step after the last trigger.
+	"rotor" prints where each shaft really is, next to the steps the controller made, and the level of STEP.
+	"travel <ccw> <home> <cw>" puts the switches along the way of each shaft, at steps from where it is now:
+	the counterclockwise limit closes at <ccw> and below, home at <home> and below, the clockwise limit at <cw>
+	and above. "travel off" opens them all again.
+
+*/
+
+#include "rig.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fw_plain { extern const sim::Firmware firmware; }
+namespace fw_bus { extern const sim::Firmware firmware; }
+namespace fw_encoder { extern const sim::Firmware firmware; }
+namespace fw_pwm { extern const sim::Firmware firmware; }
+namespace fw_limit { extern const sim::Firmware firmware; }
+
+static void usage() {
+	fprintf(stderr,
+		"usage: motorsim [--nodes N] [--bus] [--quantum C] [--trace] [script]\n"
+		"       motorsim --encoder [--pullout US] [--quantum C] [--trace] [script]\n"
+		"       motorsim --pwm | --limit [--quantum C] [--trace] [script]\n"
+		"       motorsim --nodes N --bench ROUNDS [--stream] [--batch \"cmd;cmd\"]\n");
+	exit(2);
+}
+
+// When each controller made its first step since the trigger at the given cycle, and how far apart they were
+static void printSkew(sim::Rig & rig, uint64_t trigger) {
+	double us = 1e6 / rig.cyclesPerSecond();
+	uint64_t first = UINT64_MAX, last = 0;
+	for (size_t i = 0; i < rig.chips.size(); i++) {
+		uint64_t t = rig.chips[i]->stats.firstStep;
+		if (!t) {
+			printf("# @%zu didn't step\n", i + 1);
+			continue;
+		}
+		printf("# @%zu first step %.1f us after the trigger\n", i + 1, (t - trigger) * us);
+		first = std::min(first, t);
+		last = std::max(last, t);
+	}
+	if (last)
+		printf("# skew %.1f us\n", (last - first) * us);
+}
+
+// Where each shaft is and what the controller did to get it there
+static void printRotor(sim::Rig & rig) {
+	for (size_t i = 0; i < rig.chips.size(); i++) {
+		const sim::Stats & s = rig.chips[i]->stats;
+		printf("# @%zu rotor at %lld, %lld stepped, %llu lost, STEP %s\n", i + 1, (long long)s.rotor, (long long)s.position,
+			(unsigned long long)s.missed, rig.chips[i]->stepHigh() ? "high" : "low");
+	}
+}
+
+// How long each controller spent in sleep since the last time, in ticks to hold against what info says
+static void printAsleep(sim::Rig & rig, std::vector<uint64_t> & since) {
+	for (size_t i = 0; i < rig.chips.size(); i++) {
+		const sim::Stats & s = rig.chips[i]->stats;
+		double seconds = (double)(s.asleep - since[i]) / rig.cyclesPerSecond();
+		since[i] = s.asleep;
+		printf("# @%zu asleep for %.3f s, %.0f ticks\n", i + 1, seconds, seconds * 1e6 / rig.firmware.tickUs);
+	}
+}
+
+// Switches along the way of each shaft, or left open
+static void setTravel(sim::Rig & rig, const std::string & args) {
+	long long ccw, home, cw;
+	bool on = sscanf(args.c_str(), "%lld %lld %lld", &ccw, &home, &cw) == 3;
+	for (auto & c : rig.chips) {
+		sim::Board & b = c->board;
+		b.travel = on;
+		b.ccwEnd = c->stats.rotor + ccw;
+		b.homeAt = c->stats.rotor + home;
+		b.cwEnd = c->stats.rotor + cw;
+		b.limitCcw = !on || ccw < 0;
+		b.home = !on || home < 0;
+		b.limitCw = !on || cw > 0;
+	}
+}
+
+// Reply text as lines, for printing
+static void printReply(const std::string & who, std::string text) {
+	std::istringstream in(text);
+	std::string l;
+	while (std::getline(in, l)) {
+		if (!l.empty() && l.back() == '\r')
+			l.pop_back();
+		printf("<%s %s\n", who.c_str(), l.c_str());
+	}
+}
+
+static int script(sim::Rig & rig, std::istream & in) {
+	std::string l;
+	uint64_t quiet = rig.quiet();
+	uint64_t trigger = 0;
+	std::vector<uint64_t> asleep(rig.chips.size());
+
+	while (std::getline(in, l)) {
+		if (!l.empty() && l.back() == '\r')
+			l.pop_back();
+		if (l.empty() || l[0] == '#')
+			continue;
+		if (l.compare(0, 5, "wait ") == 0) {
+			rig.run(rig.ms(atoi(l.c_str() + 5)));
+			continue;
+		}
+		if (l == "trigger" || l == "pin") {
+			printf("> %s\n", l.c_str());
+			for (auto & c : rig.chips)
+				c->stats.firstStep = 0;
+			trigger = rig.now();
+			if (rig.bus && l == "trigger")
+				rig.address(rig.firmware.busTrigger);
+			else
+				rig.pulse();
+			continue;
+		}
+		if (l == "skew") {
+			printSkew(rig, trigger);
+			continue;
+		}
+		if (l == "rotor") {
+			printRotor(rig);
+			continue;
+		}
+		if (l.compare(0, 7, "travel ") == 0) {
+			printf("> %s\n", l.c_str());
+			setTravel(rig, l.substr(7));
+			continue;
+		}
+		if (l == "asleep") {
+			printAsleep(rig, asleep);
+			continue;
+		}
+
+		int id = 1;
+		if (l[0] == '@') {
+			size_t n = l.find(' ');
+			id = atoi(l.c_str() + 1);
+			l = n == std::string::npos ? "" : l.substr(n + 1);
+		}
+		if (rig.bus)
+			printf("> @%d %s\n", id, l.c_str());
+		else
+			printf("> %s\n", l.c_str());
+		rig.send(id, l);
+		if (!rig.settle(quiet, rig.ms(SIM_REPLY_MS)))
+			printf("# still talking after %d ms\n", SIM_REPLY_MS);
+
+		for (size_t i = 0; i < rig.chips.size(); i++) {
+			if (rig.heard(i).empty())
+				continue;
+			printReply(rig.bus ? "@" + std::to_string(i + 1) : "", rig.heard(i));
+			rig.heard(i).clear();
+		}
+	}
+	return 0;
+}
+
+// The batch with its speed changed, so that the last one each controller got can be checked
+static std::string batch(const std::string & pattern, int round) {
+	std::string s = pattern;
+	size_t n = s.find("speed");
+	if (n != std::string::npos) {
+		size_t e = s.find(';', n);
+		s.replace(n, (e == std::string::npos ? s.size() : e) - n, "speed " + std::to_string(100 + round % 900));
+	}
+	return s;
+}
+
+static int bench(sim::Rig & rig, int rounds, bool stream, const std::string & pattern) {
+	int nodes = rig.chips.size();
+	int commands = 1;
+	for (char c : pattern)
+		commands += c == ';';
+	int ok = 0, failed = 0;
+	uint64_t limit = rig.ms(SIM_REPLY_MS);
+	std::vector<sim::Stats> before;
+
+	if (stream)
+		for (int i = 0; i < nodes; i++) {
+			rig.send(i + 1, "quiet on");
+			rig.line(i, limit);
+		}
+
+	auto wall = std::chrono::steady_clock::now();
+	for (auto & c : rig.chips)
+		before.push_back(c->stats);
+	uint64_t start = rig.now();
+	uint64_t chars = rig.hostChars;
+
+	for (int r = 0; r < rounds; r++)
+		for (int i = 0; i < nodes; i++) {
+			rig.send(i + 1, batch(pattern, r));
+			if (stream)
+				continue;
+			std::string reply = rig.line(i, limit);
+			if (reply.compare(0, 3, "ok ") == 0)
+				ok++;
+			else {
+				failed++;
+				fprintf(stderr, "@%d: \"%s\"\n", i + 1, reply.c_str());
+			}
+		}
+	rig.settle(11 * rig.bitCycles(), limit * nodes);
+	uint64_t took = rig.now() - start;
+	chars = rig.hostChars - chars;
+
+	if (stream) {
+		// every controller should have taken every batch, so they all end up at the last speed
+		std::string expect = std::to_string(100 + (rounds - 1) % 900);
+		for (int i = 0; i < nodes; i++) {
+			rig.send(i + 1, "quiet off");
+			rig.settle(11 * rig.bitCycles(), limit);
+			rig.send(i + 1, "speed");
+			std::string reply = rig.line(i, limit);
+			if (reply.find(" " + expect + " ") != std::string::npos)
+				ok += rounds;
+			else {
+				failed += rounds;
+				fprintf(stderr, "@%d: \"%s\", expected speed %s\n", i + 1, reply.c_str(), expect.c_str());
+			}
+		}
+	}
+	double seconds = (double)took / rig.cyclesPerSecond();
+	double real = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall).count();
+
+	printf("%d controllers, %u cycles per bit, %s\n", nodes, rig.bitCycles(), stream ? "streamed (no replies)" : "each batch waits for its reply");
+	printf("%d batches of %d commands in %.3f s simulated (%.2f s real)\n", rounds * nodes, commands, seconds, real);
+	printf("%.1f commands/s, %.1f batches/s, %d ok, %d failed\n", rounds * nodes * commands / seconds, rounds * nodes / seconds, ok, failed);
+	printf("host sent %llu characters, line collisions %u\n", (unsigned long long)chars, rig.wire.collisions);
+	printf("chip   taken  overruns  framing  interrupts\n");
+	for (int i = 0; i < nodes; i++) {
+		const sim::Stats & s = rig.chips[i]->stats;
+		printf("@%-4d %6llu %9llu %8llu %11llu\n", i + 1,
+			(unsigned long long)(s.taken - before[i].taken), (unsigned long long)(s.overruns - before[i].overruns),
+			(unsigned long long)(s.framing - before[i].framing), (unsigned long long)(s.interrupts - before[i].interrupts));
+	}
+	return failed ? 1 : 0;
+}
+
+int main(int argc, char ** argv) {
+	int nodes = 1;
+	bool bus = false;
+	uint32_t quantum = 64;
+	int rounds = 0;
+	bool stream = false;
+	bool trace = false;
+	bool encoder = false;
+	bool pwm = false;
+	bool limit = false;
+	double pullOut = 0;
+	std::string pattern = "speed 100;dir cw;size full";
+	const char * path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "--nodes" && i + 1 < argc)
+			nodes = atoi(argv[++i]);
+		else if (a == "--bus")
+			bus = true;
+		else if (a == "--quantum" && i + 1 < argc)
+			quantum = atoi(argv[++i]);
+		else if (a == "--bench" && i + 1 < argc)
+			rounds = atoi(argv[++i]);
+		else if (a == "--stream")
+			stream = true;
+		else if (a == "--batch" && i + 1 < argc)
+			pattern = argv[++i];
+		else if (a == "--trace")
+			trace = true;
+		else if (a == "--encoder")
+			encoder = true;
+		else if (a == "--pwm")
+			pwm = true;
+		else if (a == "--limit")
+			limit = true;
+		else if (a == "--pullout" && i + 1 < argc)
+			pullOut = atof(argv[++i]);
+		else if (a[0] == '-' || path)
+			usage();
+		else
+			path = argv[i];
+	}
+	if (nodes < 1 || nodes > 254 || quantum < 1 || pullOut < 0)
+		usage();
+	bus = bus || nodes > 1;
+	if ((encoder || pwm || limit) && bus || encoder + pwm + limit > 1)
+		usage();				// those builds are point to point, and one feature each
+
+	const sim::Firmware & firmware = encoder ? fw_encoder::firmware : pwm ? fw_pwm::firmware : limit ? fw_limit::firmware :
+		bus ? fw_bus::firmware : fw_plain::firmware;
+	sim::Rig rig(firmware, nodes, bus, quantum);
+	rig.trace = trace;
+	for (auto & c : rig.chips) {
+		c->board.encoder = encoder ? rig.firmware.encoderCounts : 0;
+		c->board.pullOut = (uint64_t)(pullOut * rig.cyclesPerSecond() / 1e6);
+	}
+	rig.run(rig.ms(SIM_STARTUP_MS));
+
+	if (rounds) {
+		if (!bus)
+			usage();
+		return bench(rig, rounds, stream, pattern);
+	}
+	if (path) {
+		std::ifstream f(path);
+		if (!f) {
+			perror(path);
+			return 1;
+		}
+		return script(rig, f);
+	}
+	return script(rig, std::cin);
+}
\ No newline at end of file
@@ -0,0 +1,679 @@
+#include "model.h"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" char __start_fw_ram[], __stop_fw_ram[];
+
+namespace sim {
+
+Pic * current;
+
+#define STACK_SIZE		(256 * 1024)
+#define WAKE_CYCLES		10		// HFINTOSC start-up and the wake-up itself
+#define IRQ_CYCLES		4		// from the flag to the first instruction of int_server()
+#define RETFIE_CYCLES	2
+#define EE_WRITE_MS		4
+#define LFINTOSC		31000	// Hz, the watchdog's clock
+
+/* *********************************** */
+/*            WIRE                     */
+/* *********************************** */
+
+bool Frame::level(uint64_t t) const {
+	if (t < start || t >= end())
+		return true;
+	uint64_t k = (t - start) / bitCycles;
+	if (k == 0)
+		return false;			// start bit
+	if (k <= bits)
+		return data >> (k - 1) & 1;
+	return true;				// stop bit
+}
+
+void Wire::publish(std::vector<Frame> & sent) {
+	if (sent.empty())
+		return;
+	std::sort(sent.begin(), sent.end(), [](const Frame & a, const Frame & b) { return a.start < b.start; });
+
+	// frames before the first new one that could still overlap it
+	size_t first = after(sent[0].start);
+	while (first && frames[first - 1].end() > sent[0].start)
+		first--;
+	size_t old = frames.size();
+	frames.insert(frames.end(), sent.begin(), sent.end());
+	std::inplace_merge(frames.begin() + first, frames.begin() + old, frames.end(),
+		[](const Frame & a, const Frame & b) { return a.start < b.start; });
+
+	for (size_t i = first; i < frames.size() && !duplex; i++)
+		for (size_t j = i + 1; j < frames.size() && frames[j].start < frames[i].end(); j++)
+			if (frames[j].from != frames[i].from && !(frames[i].garbled && frames[j].garbled)) {
+				frames[i].garbled = true;
+				frames[j].garbled = true;
+				collisions++;
+			}
+	sent.clear();
+}
+
+bool Wire::level(uint64_t t) const {
+	// drivers fight, a low wins (good enough for RS-485 contention)
+	bool l = true;
+	for (size_t i = after(t); i > 0; i--) {
+		const Frame & f = frames[i - 1];
+		if (f.end() + 16 * f.bitCycles < t)
+			break;				// frames are sorted by start and none is longer than that
+		l = l && f.level(t);
+	}
+	return l;
+}
+
+size_t Wire::after(uint64_t t) const {
+	return std::upper_bound(frames.begin(), frames.end(), t, [](uint64_t t, const Frame & f) { return t < f.start; }) - frames.begin();
+}
+
+/* *********************************** */
+/*            CHIP                     */
+/* *********************************** */
+
+static std::vector<char> & ramImage() {
+	// the globals as static initialization left them, every chip starts from this
+	static std::vector<char> image(__start_fw_ram, __stop_fw_ram);
+	return image;
+}
+
+Pic::Pic(const Firmware & fw, Wire & wire, int index, const Board & board) :
+	board(board), index(index), fw(fw), wire(wire), ram(ramImage()), stack(STACK_SIZE) {
+	memset(eeprom, 0xFF, sizeof(eeprom));
+	memset(sfr, 0, sizeof(sfr));
+
+	// power-on values
+	sfr[R_STATUS] = 0x18;
+	sfr[R_OPTION] = 0xFF;
+	sfr[R_WDTCON] = 0x08;
+	sfr[R_TRISA] = 0x3F;
+	sfr[R_TRISB] = 0xF0;
+	sfr[R_TRISC] = 0xFF;
+	sfr[R_ANSEL] = 0xFF;
+	sfr[R_ANSELH] = 0x0F;
+	sfr[R_PR2] = 0xFF;
+	sfr[R_OSCCON] = 0x60;
+	sfr[R_TXSTA] = 0x02;
+	sfr[R_WPUA] = 0x37;
+	sfr[R_WPUB] = 0xF0;
+}
+
+Pic::~Pic() {
+}
+
+uint32_t Pic::cyclesPerSecond() const {
+	static const uint32_t f[8] = { 31000, 125000, 250000, 500000, 1000000, 2000000, 4000000, 8000000 };
+	return f[sfr[R_OSCCON] >> 4 & 7] / 4;
+}
+
+uint32_t Pic::bitCycles() const {
+	uint32_t brg = sfr[R_SPBRG];
+	uint32_t mult;
+	bool brgh = sfr[R_TXSTA] & 0x04;
+	if (sfr[R_BAUDCTL] & 0x08) {
+		brg |= sfr[R_SPBRGH] << 8;
+		mult = brgh ? 4 : 16;
+	} else
+		mult = brgh ? 16 : 64;
+	return mult * (brg + 1) / 4;
+}
+
+void Pic::entry() {
+	current->fw.main();
+	while (1) {				// main() isn't supposed to return, if it does the chip just stops
+		current->now = current->end;
+		current->yield();
+	}
+}
+
+void Pic::run(uint64_t until) {
+	end = until;
+	if (!started) {
+		getcontext(&context);
+		context.uc_stack.ss_sp = stack.data();
+		context.uc_stack.ss_size = stack.size();
+		context.uc_link = nullptr;
+		makecontext(&context, entry, 0);
+		started = true;
+	}
+	due = 0;				// the wire changed, look at it first thing
+	current = this;
+	swapIn();
+	swapcontext(&caller, &context);
+	swapOut();
+	current = nullptr;
+}
+
+void Pic::yield() {
+	swapcontext(&context, &caller);
+}
+
+void Pic::swapIn() {
+	memcpy(__start_fw_ram, ram.data(), ram.size());
+}
+
+void Pic::swapOut() {
+	memcpy(ram.data(), __start_fw_ram, ram.size());
+}
+
+void Pic::catchUp() {
+	sync();
+	if (!inIsr && (sfr[R_INTCON] & 0x80) && pending()) {
+		inIsr = true;
+		sfr[R_INTCON] &= ~0x80;
+		now += IRQ_CYCLES;
+		stats.interrupts++;
+		fw.isr();
+		now += RETFIE_CYCLES;
+		sfr[R_INTCON] |= 0x80;
+		inIsr = false;
+		sync();
+	}
+	if (now >= end)
+		yield();
+	schedule();
+}
+
+void Pic::schedule() {
+	uint64_t t = end;
+
+	if (!sleeping) {
+		if (!(sfr[R_OPTION] & 0x20)) {
+			uint32_t div = sfr[R_OPTION] & 0x08 ? 1 : 2 << (sfr[R_OPTION] & 7);
+			t = std::min(t, std::max(now, t0Inhibit) + (256 - sfr[R_TMR0]) * div - t0Prescale);
+		}
+		if (sfr[R_T2CON] & 0x04) {
+			uint32_t pre = sfr[R_T2CON] & 2 ? 16 : sfr[R_T2CON] & 1 ? 4 : 1;
+			uint32_t post = (sfr[R_T2CON] >> 3 & 15) + 1;
+			uint32_t pr = sfr[R_PR2], tmr = sfr[R_TMR2];
+			uint64_t ticks = (tmr <= pr ? pr - tmr + 1 : 256 - tmr + pr + 1) + (uint64_t)(post - 1 - t2Postscale) * (pr + 1);
+			t = std::min(t, now + ticks * pre - t2Prescale);
+		}
+	}
+	if (rxNext < wire.frames.size()) {
+		uint32_t bits = sfr[R_RCSTA] & 0x40 ? 9 : 8;	// RCIF comes with the stop bit sample (see receive())
+		t = std::min(t, std::max(now, wire.frames[rxNext].start + (uint64_t)(bits + 1) * bitCycles() + bitCycles() / 2));
+	}
+
+	if (!inIsr && (sfr[R_INTCON] & 0x80) && pending())
+		t = now;
+	due = t;
+}
+
+bool Pic::pending() const {
+	uint8_t i = sfr[R_INTCON];
+	if ((i & 0x20 && i & 0x04) || (i & 0x10 && i & 0x02) || (i & 0x08 && i & 0x01))
+		return true;
+	return i & 0x40 && sfr[R_PIE1] & pir1();
+}
+
+bool Pic::wake() const {
+	return pending();		// GIE only decides whether int_server() runs after the wake-up
+}
+
+// Level of the PWM output, high from the start of a Timer2 period until the duty cycle is over
+bool Pic::p1d() const {
+	uint32_t duty = sfr[R_CCPR1L] << 2 | (sfr[R_CCP1CON] >> 4 & 3);
+	return (sfr[R_CCP1CON] & 0x0C) == 0x0C && sfr[R_T2CON] & 0x04 && (uint32_t)sfr[R_TMR2] << 2 < duty;
+}
+
+uint8_t Pic::pir1() const {
+	return (sfr[R_PIR1] & ~0x30) | (txFull ? 0 : 0x10) | (rxFifo.empty() ? 0 : 0x20);
+}
+
+void Pic::sync() {
+	if (now > synced) {
+		uint64_t from = synced;
+		synced = now;
+		if (!sleeping) {	// the instruction clock stops in sleep, and the timers with it
+			timer0(from);
+			timer1(from);
+			timer2(from);
+		}
+		while (txFull && tsrEnd <= now) {
+			txFull = false;
+			transmit(txBuf9, tsrEnd);
+		}
+	}
+	changes();				// frames get published late, one may have started before we got to see it
+	receive();
+}
+
+void Pic::timer0(uint64_t from) {
+	uint64_t elapsed = now - from;
+	if (sfr[R_OPTION] & 0x20)
+		return;				// T0CKI, nothing is connected there
+	if (t0Inhibit > from)
+		elapsed -= std::min(elapsed, t0Inhibit - from);
+	uint32_t div = sfr[R_OPTION] & 0x08 ? 1 : 2 << (sfr[R_OPTION] & 7);
+	uint64_t total = t0Prescale + elapsed;
+	uint64_t v = sfr[R_TMR0] + total / div;
+	t0Prescale = total % div;
+	if (v > 0xFF)
+		sfr[R_INTCON] |= 0x04;
+	sfr[R_TMR0] = v;
+}
+
+void Pic::timer1(uint64_t from) {
+	uint8_t c = sfr[R_T1CON];
+	if (!(c & 0x01) || c & 0x02)
+		return;				// off, or counting T1CKI (see pulses())
+	uint32_t pre = 1 << (c >> 4 & 3);
+	uint64_t total = t1Prescale + (now - from);
+	uint64_t v = tmr1 + total / pre;
+	t1Prescale = total % pre;
+	if (v > 0xFFFF)
+		sfr[R_PIR1] |= 0x01;
+	tmr1 = v;
+}
+
+void Pic::timer2(uint64_t from) {
+	uint8_t c = sfr[R_T2CON];
+	if (!(c & 0x04))
+		return;
+	uint32_t pre = c & 2 ? 16 : c & 1 ? 4 : 1;
+	uint32_t post = (c >> 3 & 15) + 1;
+	uint64_t total = t2Prescale + (now - from);
+	uint64_t ticks = total / pre;
+	t2Prescale = total % pre;
+
+	uint32_t pr = sfr[R_PR2], tmr = sfr[R_TMR2];
+	uint32_t first = tmr <= pr ? pr - tmr + 1 : 256 - tmr + pr + 1;	// counts to the next match
+	if (ticks < first) {
+		sfr[R_TMR2] = tmr + ticks;
+		return;
+	}
+	ticks -= first;
+	uint64_t matches = 1 + ticks / (pr + 1);
+	sfr[R_TMR2] = ticks % (pr + 1);
+
+	uint64_t periods = t2Postscale + matches;
+	if (periods >= post)
+		sfr[R_PIR1] |= 0x02;
+	t2Postscale = periods % post;
+
+	// every period of a PWM with some duty starts with a rising edge, if P1D is steered to the pin
+	uint32_t duty = sfr[R_CCPR1L] << 2 | (sfr[R_CCP1CON] >> 4 & 3);
+	if ((sfr[R_CCP1CON] & 0x0C) == 0x0C && sfr[R_PSTRCON] & 0x08 && duty)
+		pulses(matches);
+}
+
+void Pic::pulses(uint64_t n) {
+	uint64_t gap = stats.lastStep ? (now - stats.lastStep) / n : UINT64_MAX;
+	bool ccw = sfr[R_PORTC] & 0x02;
+	if (!stats.firstStep)
+		stats.firstStep = now;
+	stats.lastStep = now;
+	stats.steps += n;
+	stats.position += ccw ? -(int64_t)n : n;
+
+	// the motor loses steps that come too close together, and takes twice as far apart to pick them up again
+	if (board.pullOut)
+		stalled = stalled ? gap < 2 * board.pullOut : gap < board.pullOut;
+	if (stalled)
+		stats.missed += n;
+	else
+		stats.rotor += ccw ? -(int64_t)n : n;
+	if (board.travel) {
+		board.limitCcw = stats.rotor > board.ccwEnd;
+		board.home = stats.rotor > board.homeAt;
+		board.limitCw = stats.rotor < board.cwEnd;
+	}
+
+	// the encoder turns with the shaft, without one RC2 is wired to T1CKI (RA5) for counting hardware steps
+	uint64_t edges = n;
+	if (board.encoder) {
+		encoderHalves += stalled ? 0 : n * board.encoder * (sfr[R_PORTC] & 0x01 ? 2 : 1);
+		edges = encoderHalves / 2;
+		encoderHalves %= 2;
+	}
+	if ((sfr[R_T1CON] & 0x03) == 0x03) {
+		uint64_t v = tmr1 + edges;
+		if (v > 0xFFFF)
+			sfr[R_PIR1] |= 0x01;
+		tmr1 = v;
+	}
+}
+
+void Pic::transmit(uint16_t data, uint64_t t) {
+	Frame f;
+	f.start = t;
+	f.bits = sfr[R_TXSTA] & 0x40 ? 9 : 8;
+	f.data = data & ((1 << f.bits) - 1);
+	f.bitCycles = bitCycles();
+	f.from = index;
+	f.garbled = false;
+	tsrEnd = f.end();
+	stats.sent++;
+	if (!board.bus || (sfr[R_PORTC] & 0x08 && !(sfr[R_TRISC] & 0x08)))
+		out.push_back(f);
+}
+
+void Pic::receive() {
+	const std::vector<Frame> & frames = wire.frames;
+	uint32_t bc = bitCycles();
+	bool nine = sfr[R_RCSTA] & 0x40;
+	uint32_t bits = nine ? 9 : 8;
+
+	while (rxNext < frames.size()) {
+		const Frame & f = frames[rxNext];
+		if (!board.bus && f.from == index) {
+			rxNext++;		// point to point, our TX isn't our RX
+			continue;
+		}
+		uint64_t stop = f.start + (uint64_t)(bits + 1) * bc + bc / 2;	// where the stop bit is sampled
+		if (stop > now)
+			break;
+		rxNext++;
+
+		uint8_t c = sfr[R_RCSTA];
+		if (!(c & 0x80) || !(c & 0x10) || crenSince > f.start || oerr)
+			continue;		// the receiver wasn't on when it started
+		while (rxNext < frames.size() && frames[rxNext].start < stop)
+			rxNext++;		// overlapping frames are one character to us
+
+		// sample the line in the middle of every bit, as EUSART does
+		Rx r;
+		uint16_t v = 0;
+		for (uint32_t k = 0; k < bits; k++)
+			if (board.bus ? wire.level(f.start + (k + 1) * bc + bc / 2) : f.level(f.start + (k + 1) * bc + bc / 2))
+				v |= 1 << k;
+		r.data = v;
+		r.ninth = nine && v >> 8 & 1;
+		r.ferr = !(board.bus ? wire.level(stop) : f.level(stop));
+
+		if (nine && c & 0x08 && !r.ninth)
+			continue;		// ADDEN, data characters don't even get to RCREG
+		if (rxFifo.size() >= 2) {
+			oerr = true;
+			stats.overruns++;
+			continue;
+		}
+		if (r.ferr)
+			stats.framing++;
+		stats.taken++;
+		rxFifo.push_back(r);
+	}
+}
+
+bool Pic::receiving() {
+	if ((sfr[R_RCSTA] & 0x90) != 0x90)
+		return false;
+	// receive() took every frame whose stop bit has been sampled, one that started since is on its way in
+	for (size_t i = rxNext; i < wire.frames.size() && wire.frames[i].start <= now; i++)
+		if (board.bus || wire.frames[i].from != index)
+			return crenSince <= wire.frames[i].start;
+	return false;
+}
+
+void Pic::changes() {
+	uint8_t a = sfr[R_IOCA] & 0x3F, b = sfr[R_IOCB] & 0xF0;
+
+	// a start bit may have come and gone since we last looked
+	bool start = false;
+	while (iocNext < wire.frames.size() && wire.frames[iocNext].start <= now) {
+		if (board.bus || wire.frames[iocNext].from != index)
+			start = true;
+		iocNext++;
+	}
+	if (!a && !b)
+		return;
+	bool change = ((pins(R_PORTA) ^ latchA) & a) || ((pins(R_PORTB) ^ latchB) & b);
+	if (b & 0x20 && latchB & 0x20 && start)
+		change = true;
+	if (change)
+		sfr[R_INTCON] |= 0x01;
+}
+
+void Pic::setTrigger(bool level) {
+	bool rising = sfr[R_OPTION] & 0x40;
+	if (level != board.trigger && level == rising)
+		sfr[R_INTCON] |= 0x02;
+	board.trigger = level;
+}
+
+uint8_t Pic::pins(uint8_t port) {
+	uint8_t in = 0, analog = 0, latch = sfr[port], tris;
+	uint8_t an = sfr[R_ANSEL], anh = sfr[R_ANSELH];
+
+	switch (port) {
+	case R_PORTA:
+		tris = sfr[R_TRISA];
+		in = board.trigger << 2 | board.home << 3;
+		analog = (an & 0x07) | (an & 0x08) << 1;
+		break;
+	case R_PORTB: {
+		tris = sfr[R_TRISB];
+		bool rx;
+		if (board.bus)
+			rx = wire.level(now);
+		else {
+			rx = true;
+			for (size_t i = wire.after(now); i > 0; i--) {
+				const Frame & f = wire.frames[i - 1];
+				if (f.end() + 16 * f.bitCycles < now)
+					break;
+				if (f.from != index)
+					rx = rx && f.level(now);
+			}
+		}
+		in = board.limitCcw << 4 | rx << 5 | board.limitCw << 6 | 1 << 7;
+		analog = (anh & 0x0C) << 2;
+		break;
+	}
+	default:
+		tris = sfr[R_TRISC];
+		in = !(board.jumpers & 1) << 6 | !(board.jumpers & 2) << 7;
+		analog = (an & 0xF0) >> 4 | (anh & 0x03) << 6;
+		if (sfr[R_PSTRCON] & 0x08)
+			latch = (latch & ~0x04) | p1d() << 2;	// P1D owns RC2, a bit write of PORTC copies its level into the latch
+		break;
+	}
+	in &= ~analog;				// analog inputs read as 0
+	return (latch & ~tris) | (in & tris);
+}
+
+uint8_t Pic::readReg(uint8_t r) {
+	uint8_t v;
+	sync();
+
+	switch (r) {
+	case R_PORTA:
+		v = pins(r);
+		latchA = v;			// a read ends the mismatch condition
+		return v;
+	case R_PORTB:
+		v = pins(r);
+		latchB = v;
+		return v;
+	case R_PORTC:
+		return pins(r);
+	case R_PIR1:
+		return pir1();
+	case R_TMR1L:
+		return tmr1;
+	case R_TMR1H:
+		return tmr1 >> 8;
+	case R_RCSTA:
+		v = sfr[r] & 0xF8;
+		if (oerr)
+			v |= 0x02;
+		if (!rxFifo.empty())
+			v |= rxFifo.front().ferr << 2 | rxFifo.front().ninth;
+		return v;
+	case R_RCREG:
+		if (!rxFifo.empty()) {
+			rxLast = rxFifo.front().data;
+			rxFifo.pop_front();
+		}
+		return rxLast;
+	case R_TXSTA:
+		return (sfr[r] & ~0x02) | (!txFull && tsrEnd <= now ? 0x02 : 0);
+	case R_BAUDCTL:
+		return (sfr[r] & ~0x40) | (receiving() ? 0 : 0x40);	// RCIDL
+	case R_OSCCON:
+		return sfr[r] | 0x04;	// HTS, the oscillator is stable right away
+	case R_EECON1:
+		return (sfr[r] & ~0x03) | (eeDone > now ? 0x02 : 0);
+	default:
+		return sfr[r];
+	}
+}
+
+void Pic::writeReg(uint8_t r, uint8_t v) {
+	uint8_t old = sfr[r];
+	sync();
+
+	switch (r) {
+	case R_TMR0:
+		sfr[r] = v;
+		if (!(sfr[R_OPTION] & 0x08))
+			t0Prescale = 0;		// a write clears the prescaler
+		t0Inhibit = now + 2;
+		break;
+	case R_PORTC:
+		sfr[r] = v;
+		if (!(old & 0x04) && v & 0x04 && !(sfr[R_TRISC] & 0x04) && !(sfr[R_PSTRCON] & 0x08))
+			pulses(1);			// a step made in software
+		break;
+	case R_PSTRCON:
+		sfr[r] = v;
+		if (old & 0x08 && !(v & 0x08) && sfr[R_PORTC] & 0x04 && !(sfr[R_TRISC] & 0x04) && !p1d())
+			pulses(1);			// RC2 goes back to a latch that was left high
+		break;
+	case R_PIR1:
+		sfr[r] = v & ~0x30;		// TXIF and RCIF follow the EUSART
+		break;
+	case R_TMR1L:
+		tmr1 = (tmr1 & 0xFF00) | v;
+		break;
+	case R_TMR1H:
+		tmr1 = (tmr1 & 0x00FF) | v << 8;
+		break;
+	case R_TMR2:
+	case R_T2CON:
+		sfr[r] = v;
+		t2Prescale = 0;
+		t2Postscale = 0;
+		break;
+	case R_RCSTA:
+		sfr[r] = v & 0xF8;
+		if (old & 0x10 && !(v & 0x10))
+			oerr = false;		// clearing CREN is the only way out of an overrun
+		if ((v & 0x90) == 0x90 && (old & 0x90) != 0x90)
+			crenSince = now;
+		break;
+	case R_TXREG:
+		if ((sfr[R_TXSTA] & 0x20) && (sfr[R_RCSTA] & 0x80)) {
+			uint16_t d = v | (sfr[R_TXSTA] & 0x01) << 8;
+			if (!txFull && tsrEnd <= now)
+				transmit(d, now);
+			else {
+				txFull = true;
+				txBuf9 = d;
+			}
+		}
+		break;
+	case R_TXSTA:
+		sfr[r] = v & ~0x02;
+		break;
+	case R_OPTION:
+		sfr[r] = v;
+		t0Prescale = 0;
+		break;
+	case R_EECON1:
+		sfr[r] = v & ~0x03;
+		if (v & 0x01)
+			sfr[R_EEDAT] = eeprom[sfr[R_EEADR]];
+		if (v & 0x02 && v & 0x04 && eeUnlock == 2 && eeDone <= now) {
+			eeprom[sfr[R_EEADR]] = sfr[R_EEDAT];
+			eeDone = now + (uint64_t)cyclesPerSecond() * EE_WRITE_MS / 1000;
+		}
+		eeUnlock = 0;
+		break;
+	case R_EECON2:
+		eeUnlock = v == 0x55 ? 1 : v == 0xAA && eeUnlock == 1 ? 2 : 0;
+		break;
+	default:
+		sfr[r] = v;
+		break;
+	}
+	due = now;				// whatever changed, an interrupt may be due now
+}
+
+void Pic::sleep() {
+	sync();
+	now++;
+	sfr[R_STATUS] = (sfr[R_STATUS] | 0x10) & ~0x08;	// TO set, PD clear
+	if (wake())
+		return;				// SLEEP is a NOP with a wake-up pending
+	stats.sleeps++;
+	sleeping = true;
+	uint64_t from = now;
+	// SLEEP clears the watchdog, with SWDTEN set it times out after 32 << WDTPS LFINTOSC cycles (the prescaler is Timer0's)
+	uint64_t watchdog = UINT64_MAX;
+	if (sfr[R_WDTCON] & 1)
+		watchdog = now + ((uint64_t)32 << std::min(sfr[R_WDTCON] >> 1 & 15, 11)) * cyclesPerSecond() / LFINTOSC;
+	while (1) {
+		uint64_t next = std::min(end, watchdog);
+		if (sfr[R_IOCB] & 0x20 && sfr[R_INTCON] & 0x08 && iocNext < wire.frames.size())
+			next = std::min(next, wire.frames[iocNext].start);
+		now = std::max(now, next);
+		sync();
+		if (wake())
+			break;
+		if (now >= watchdog) {
+			sfr[R_STATUS] &= ~0x10;	// a time-out in sleep wakes the chip, TO tells
+			break;
+		}
+		if (now >= end)
+			yield();
+	}
+	stats.asleep += now - from;
+	sleeping = false;
+	now += WAKE_CYCLES;
+	sync();
+}
+
+/* *********************************** */
+/*            FIRMWARE SIDE            */
+/* *********************************** */
+
+// An access past the end of the quantum waits for the next one, the line may have changed by then
+uint8_t read(uint8_t r) {
+	current->now++;
+	if (current->now >= current->due)
+		current->catchUp();
+	return current->readReg(r);
+}
+
+void write(uint8_t r, uint8_t v) {
+	current->now++;
+	if (current->now >= current->due)
+		current->catchUp();
+	current->writeReg(r, v);
+}
+
+void cycles(unsigned n) {
+	current->now += n;
+	if (current->now >= current->due)
+		current->catchUp();
+}
+
+void sleep() {
+	current->sleep();
+}
+
+void setCarry(bool c) {
+	current->carry = c;
+}
+
+bool carry() {
+	return current->carry;
+}
+
+} // namespace sim
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*
+
+	Peripheral model of a PIC16F690 running the firmware, and the serial line between such chips and a host.
+
+	Every chip runs the firmware on its own stack (ucontext), one at a time, for a quantum of cycles.
+	Characters one of them sends are published to the others when the quantum ends, so the line has
+	a delay of one quantum. Quanta much shorter than a character keep that out of the results.
+
+*/
+
+#ifndef _HEAD_SIM_MODEL
+#define _HEAD_SIM_MODEL
+
+#include "pic.h"
+
+#include <deque>
+#include <vector>
+#include <ucontext.h>
+
+namespace sim {
+
+#define SIM_HOST	(-1)	// Frame::from of characters the host sent
+
+// A character on the line
+struct Frame {
+	uint64_t start;			// cycle of the falling edge of the start bit
+	uint16_t data;			// 9th bit included, if there is one
+	uint8_t bits;			// data bits, 8 or 9
+	uint32_t bitCycles;
+	int from;				// chip index, or SIM_HOST
+	bool garbled;			// someone else was talking at the same time
+
+	uint64_t end() const { return start + (uint64_t)(bits + 2) * bitCycles; }
+	bool level(uint64_t t) const;
+};
+
+// The serial line, half duplex: whoever transmits is heard by everyone, themselves included
+// Point to point it's two of them, one each way, and the host and the chip don't talk over each other
+class Wire {
+public:
+	std::vector<Frame> frames;	// sorted by start
+	unsigned collisions = 0;
+	bool duplex = false;
+
+	// Add frames sent during a quantum, marking the ones that overlap frames of someone else
+	void publish(std::vector<Frame> & sent);
+
+	// Level of the line at t, 1 when idle
+	bool level(uint64_t t) const;
+
+	// Index of the first frame starting after t
+	size_t after(uint64_t t) const;
+};
+
+// Inputs the firmware reads from the board
+struct Board {
+	bool limitCw = true;		// RB6, low when hit
+	bool limitCcw = true;		// RB4
+	bool home = true;			// RA3
+	bool travel = false;		// the switches follow the shaft instead of staying as set above:
+	int64_t ccwEnd = 0;			// the counterclockwise limit is closed at rotor positions up to here,
+	int64_t homeAt = 0;			// home up to here,
+	int64_t cwEnd = 0;			// and the clockwise limit from here on
+	bool trigger = true;		// RA2/INT, the trigger line all chips share (see trigger.h)
+	uint8_t jumpers = 0;		// ID jumpers fitted, bit 0 is RC6, bit 1 is RC7
+	bool bus = false;			// RS-485 transceiver: TX only reaches the line while DE (RC3) is high, RX hears our own TX
+	uint32_t encoder = 0;		// encoder edges per full step on T1CKI (RA5), 0 for none (STEP is wired there then)
+	uint64_t pullOut = 0;		// steps closer together than this many cycles stall the motor, 0 for never
+	bool cts = false;			// RC4 goes to the host's CTS (see io.h)
+};
+
+struct Stats {
+	uint64_t interrupts = 0;
+	uint64_t sleeps = 0;
+	uint64_t asleep = 0;		// cycles spent in sleep
+	uint64_t taken = 0;			// characters EUSART put in RCREG
+	uint64_t overruns = 0;		// characters lost to a full RCREG
+	uint64_t framing = 0;		// characters received with a framing error
+	uint64_t sent = 0;
+	uint64_t steps = 0;			// rising edges on RC2, from software or ECCP
+	int64_t position = 0;		// steps counted by the DIR pin, clockwise (DIR low) is positive
+	uint64_t firstStep = 0;		// cycle of the first step since this was last cleared, 0 until there is one
+	uint64_t lastStep = 0;		// cycle of the latest step
+	int64_t rotor = 0;			// steps the shaft actually made, as position
+	uint64_t missed = 0;		// steps made while the motor was stalled
+};
+
+class Pic {
+public:
+	Pic(const Firmware &, Wire &, int index, const Board &);
+	~Pic();
+
+	// Run the firmware until the cycle count reaches end
+	void run(uint64_t end);
+
+	// Characters sent since the last call, to be published on the wire
+	std::vector<Frame> & sent() { return out; }
+
+	// Instruction cycles per second, from OSCCON
+	uint32_t cyclesPerSecond() const;
+
+	// Drive the trigger line (RA2/INT), sets INTF on the edge INTEDG asks for
+	void setTrigger(bool level);
+
+	// The host is to hold off: RC4 is wired to its CTS and drives it high
+	bool holdsOff() const { return board.cts && !(sfr[R_TRISC] & 0x10) && sfr[R_PORTC] & 0x10; }
+
+	// Level of the STEP output (RC2)
+	bool stepHigh() { return pins(R_PORTC) & 0x04; }
+
+	// Cycles per bit the EUSART is set to
+	uint32_t bitCycles() const;
+	bool nineBit() const { return sfr[R_TXSTA] & 0x40; }
+
+	uint64_t now = 0;
+	uint8_t eeprom[256];
+	Board board;
+	Stats stats;
+	const int index;
+
+	// Used by the firmware through pic.h
+	uint8_t readReg(uint8_t);
+	void writeReg(uint8_t, uint8_t);
+	void catchUp();
+	void sleep();
+	uint64_t due = 0;			// catchUp() is needed once now gets here
+	bool carry = false;
+
+private:
+	struct Rx {
+		uint8_t data;
+		bool ninth;
+		bool ferr;
+	};
+
+	const Firmware & fw;
+	Wire & wire;
+	uint8_t sfr[R_COUNT];
+	uint64_t synced = 0;		// peripherals are up to date until here
+	uint64_t end = 0;			// end of the quantum
+	bool sleeping = false;
+	bool inIsr = false;
+
+	// Timer0
+	uint32_t t0Prescale = 0;
+	uint64_t t0Inhibit = 0;		// a write to TMR0 holds it for two cycles
+	// Timer1
+	uint16_t tmr1 = 0;
+	uint32_t t1Prescale = 0;
+	// Motor and encoder
+	bool stalled = false;
+	uint32_t encoderHalves = 0;	// half edges, a half step makes half of what a full one does
+	// Timer2 and ECCP
+	uint32_t t2Prescale = 0;
+	uint8_t t2Postscale = 0;
+	// EUSART
+	uint64_t tsrEnd = 0;		// shift register empty from here
+	bool txFull = false;
+	uint8_t txBuf = 0;
+	uint16_t txBuf9 = 0;
+	std::deque<Rx> rxFifo;
+	uint8_t rxLast = 0;
+	size_t rxNext = 0;			// next frame on the wire to look at
+	size_t iocNext = 0;			// next frame whose start bit interrupt-on-change hasn't seen
+	uint64_t crenSince = 0;
+	bool oerr = false;
+	// Interrupt on change
+	uint8_t latchA = 0, latchB = 0;
+	// EEPROM
+	uint64_t eeDone = 0;
+	uint8_t eeUnlock = 0;
+
+	std::vector<Frame> out;
+	std::vector<char> ram;		// our copy of the firmware globals
+	ucontext_t context, caller;
+	std::vector<char> stack;
+	bool started = false;
+
+	static void entry();
+	void yield();
+	void sync();
+	void timer0(uint64_t);
+	void timer1(uint64_t);
+	void timer2(uint64_t);
+	void pulses(uint64_t);
+	void transmit(uint16_t, uint64_t);
+	void receive();
+	bool receiving();
+	void changes();
+	uint8_t pins(uint8_t port);
+	bool p1d() const;
+	uint8_t pir1() const;
+	bool wake() const;
+	bool pending() const;
+	void schedule();
+	void swapIn();
+	void swapOut();
+};
+
+extern Pic * current;
+
+} // namespace sim
+
+#endif // !_HEAD_SIM_MODEL
\ No newline at end of file
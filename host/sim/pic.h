@@ -0,0 +1,255 @@
+/*
+
+	The part of a PIC16F690 the firmware sees, for running it on a PC.
+	host/sim/translate.py turns MotorController.c into C++ that includes this instead of deps/16F690.h:
+	SFRs and their bits become proxies that keep the peripherals up to date, CYC() lets time pass.
+
+	Time is counted in instruction cycles (CONFIG_F_OSC / 4). Peripherals are modelled from the datasheet
+	and are as exact as the firmware needs them, the cost of the firmware's own code is only estimated
+	(see translate.py), so cycle counts of command handling are approximate.
+
+*/
+
+#ifndef _HEAD_SIM_PIC
+#define _HEAD_SIM_PIC
+
+#include <cstdint>
+
+// Cc5x types, unsigned long is 16 bits there
+typedef uint8_t		uns8;
+typedef int8_t		int8;
+typedef uint16_t	uns16;
+typedef int16_t		int16;
+typedef uint32_t	uns24;
+typedef int32_t		int24;
+typedef uint32_t	uns32;
+typedef int32_t		int32;
+typedef bool		bit;
+
+#define size2
+#define int_save_registers
+#define int_restore_registers
+
+// Firmware globals live here, a node's copy is swapped in while it runs (see Pic::swapIn())
+#define FW_RAM		__attribute__((section("fw_ram"), used))
+
+namespace sim {
+
+// Registers, by the names the firmware uses
+enum Sfr {
+	R_TMR0, R_PCL, R_STATUS, R_PORTA, R_PORTB, R_PORTC, R_INTCON, R_PIR1, R_PIR2,
+	R_TMR1L, R_TMR1H, R_T1CON, R_TMR2, R_T2CON, R_CCPR1L, R_CCPR1H, R_CCP1CON,
+	R_PWM1CON, R_ECCPAS, R_RCSTA, R_TXREG, R_RCREG, R_ADRESH, R_ADCON0,
+	R_OPTION, R_TRISA, R_TRISB, R_TRISC, R_PIE1, R_PIE2, R_PCON, R_OSCCON, R_OSCTUNE,
+	R_PR2, R_MSK, R_WPUA, R_IOCA, R_WDTCON, R_TXSTA, R_SPBRG, R_SPBRGH, R_BAUDCTL,
+	R_EEDAT, R_EEADR, R_EEDATH, R_EEADRH, R_WPUB, R_IOCB, R_VRCON, R_CM1CON0, R_CM2CON0,
+	R_CM2CON1, R_ANSEL, R_ANSELH, R_EECON1, R_EECON2, R_PSTRCON, R_SRCON,
+	R_COUNT
+};
+
+uint8_t read(uint8_t);
+void write(uint8_t, uint8_t);
+void cycles(unsigned);
+void sleep();
+void setCarry(bool);
+bool carry();
+
+// An SFR, every access goes through the peripheral model and costs a cycle
+struct Reg {
+	uint8_t r;
+
+	operator uint8_t() const { return read(r); }
+	Reg & operator = (unsigned v) { write(r, v); return *this; }
+	Reg & operator = (const Reg & o) { write(r, read(o.r)); return *this; }
+	Reg & operator += (unsigned v) { write(r, read(r) + v); return *this; }
+	Reg & operator -= (unsigned v) { write(r, read(r) - v); return *this; }
+	Reg & operator |= (unsigned v) { write(r, read(r) | v); return *this; }
+	Reg & operator &= (unsigned v) { write(r, read(r) & v); return *this; }
+	Reg & operator ^= (unsigned v) { write(r, read(r) ^ v); return *this; }
+	Reg & operator ++ () { return *this += 1; }
+	Reg & operator -- () { return *this -= 1; }
+	uint8_t operator ++ (int) { uint8_t v = read(r); write(r, v + 1); return v; }
+	uint8_t operator -- (int) { uint8_t v = read(r); write(r, v - 1); return v; }
+};
+
+// A bit of an SFR, writes are read-modify-write like BSF/BCF
+struct RegBit {
+	uint8_t r, n;
+
+	operator bool() const { return read(r) >> n & 1; }
+	RegBit & operator = (bool v) {
+		uint8_t x = read(r);
+		write(r, v ? x | 1 << n : x & ~(1 << n));
+		return *this;
+	}
+	RegBit & operator = (const RegBit & o) { return *this = (bool)o; }
+};
+
+// A bit of a variable (c.7 in Cc5x)
+template <class T> struct VarBit {
+	T & v;
+	uint8_t n;
+
+	operator bool() const { return v >> n & 1; }
+	VarBit & operator = (bool b) {
+		if (b)
+			v |= (T)1 << n;
+		else
+			v &= ~((T)1 << n);
+		return *this;
+	}
+	VarBit & operator = (const VarBit & o) { return *this = (bool)o; }
+};
+
+inline RegBit bitOf(Reg r, uint8_t n) { return RegBit{r.r, n}; }
+template <class T> VarBit<T> bitOf(T & v, uint8_t n) { return VarBit<T>{v, n}; }
+
+// A byte or word of a wider variable (.low8, .high16 and so on in Cc5x)
+template <class P, int S, class T> struct Part {
+	T & v;
+
+	operator P() const { return (P)(v >> S); }
+	Part & operator = (P p) {
+		v = (T)((v & ~((T)(P)~(P)0 << S)) | (T)p << S);
+		return *this;
+	}
+	Part & operator = (const Part & o) { return *this = (P)o; }
+	Part & operator += (P p) { return *this = (P)(*this + p); }
+	Part & operator -= (P p) { return *this = (P)(*this - p); }
+	Part & operator ++ () { return *this += 1; }
+	Part & operator -- () { return *this -= 1; }
+	P operator ++ (int) { P p = *this; *this += 1; return p; }
+	P operator -- (int) { P p = *this; *this -= 1; return p; }
+};
+
+template <class P, int S, class T> Part<P, S, T> part(T & v) { return Part<P, S, T>{v}; }
+
+// X += Y; if (Carry) in Cc5x, the add that sets the flag
+template <class T> T addCarry(T a, T b) {
+	uint64_t s = (uint64_t)a + b;
+	setCarry(s >> (8 * sizeof(T)));
+	return (T)s;
+}
+
+// What the translated firmware hands to the simulator, and the figures of it the host tools go by
+struct Firmware {
+	void (*main)();
+	void (*isr)();
+	unsigned tickUs;			// TIME_TICK_US
+	unsigned calTicks;			// TIME_CAL_TICKS
+	unsigned minPeriod;			// MOTOR_MIN_PERIOD
+	unsigned sizeIn;			// IO_SIZE_IN, characters of a line with its '\r'
+	unsigned busTrigger;		// BUS_TRIGGER
+	unsigned encoderCounts;		// ENCODER_COUNTS
+};
+
+} // namespace sim
+
+#define CYC(n)		sim::cycles(n)
+#define BIT(x, n)	sim::bitOf(x, n)
+#define LOW8(x)		sim::part<uint8_t, 0>(x)
+#define HIGH8(x)	sim::part<uint8_t, 8>(x)
+#define LOW16(x)	sim::part<uint16_t, 0>(x)
+#define HIGH16(x)	sim::part<uint16_t, 16>(x)
+
+#define REG(r)		(sim::Reg{sim::R_##r})
+#define REGBIT(r, n)	(sim::RegBit{sim::R_##r, n})
+
+// Registers
+#define TMR0		REG(TMR0)
+#define STATUS		REG(STATUS)
+#define PORTA		REG(PORTA)
+#define PORTB		REG(PORTB)
+#define PORTC		REG(PORTC)
+#define INTCON		REG(INTCON)
+#define PIR1		REG(PIR1)
+#define PIR2		REG(PIR2)
+#define TMR1L		REG(TMR1L)
+#define TMR1H		REG(TMR1H)
+#define T1CON		REG(T1CON)
+#define TMR2		REG(TMR2)
+#define T2CON		REG(T2CON)
+#define CCPR1L		REG(CCPR1L)
+#define CCPR1H		REG(CCPR1H)
+#define CCP1CON		REG(CCP1CON)
+#define PWM1CON		REG(PWM1CON)
+#define ECCPAS		REG(ECCPAS)
+#define RCSTA		REG(RCSTA)
+#define TXREG		REG(TXREG)
+#define RCREG		REG(RCREG)
+#define OPTION		REG(OPTION)
+#define TRISA		REG(TRISA)
+#define TRISB		REG(TRISB)
+#define TRISC		REG(TRISC)
+#define PIE1		REG(PIE1)
+#define PIE2		REG(PIE2)
+#define OSCCON		REG(OSCCON)
+#define OSCTUNE		REG(OSCTUNE)
+#define PR2			REG(PR2)
+#define WPUA		REG(WPUA)
+#define IOCA		REG(IOCA)
+#define WDTCON		REG(WDTCON)
+#define TXSTA		REG(TXSTA)
+#define SPBRG		REG(SPBRG)
+#define SPBRGH		REG(SPBRGH)
+#define BAUDCTL		REG(BAUDCTL)
+#define EEDAT		REG(EEDAT)
+#define EEADR		REG(EEADR)
+#define WPUB		REG(WPUB)
+#define IOCB		REG(IOCB)
+#define ANSEL		REG(ANSEL)
+#define ANSELH		REG(ANSELH)
+#define EECON1		REG(EECON1)
+#define EECON2		REG(EECON2)
+#define PSTRCON		REG(PSTRCON)
+
+// Bits
+#define TO			REGBIT(STATUS, 4)
+#define RA5			REGBIT(PORTA, 5)
+#define GIE			REGBIT(INTCON, 7)
+#define PEIE		REGBIT(INTCON, 6)
+#define T0IE		REGBIT(INTCON, 5)
+#define INTE		REGBIT(INTCON, 4)
+#define RABIE		REGBIT(INTCON, 3)
+#define T0IF		REGBIT(INTCON, 2)
+#define INTF		REGBIT(INTCON, 1)
+#define RABIF		REGBIT(INTCON, 0)
+#define RCIF		REGBIT(PIR1, 5)
+#define TXIF		REGBIT(PIR1, 4)
+#define CCP1IF		REGBIT(PIR1, 2)
+#define TMR2IF		REGBIT(PIR1, 1)
+#define TMR1IF		REGBIT(PIR1, 0)
+#define RCIE		REGBIT(PIE1, 5)
+#define TXIE		REGBIT(PIE1, 4)
+#define CCP1IE		REGBIT(PIE1, 2)
+#define TMR2IE		REGBIT(PIE1, 1)
+#define TMR1IE		REGBIT(PIE1, 0)
+#define TMR1ON		REGBIT(T1CON, 0)
+#define TMR1CS		REGBIT(T1CON, 1)
+#define TMR2ON		REGBIT(T2CON, 2)
+#define T0CS		REGBIT(OPTION, 5)
+#define PSA			REGBIT(OPTION, 3)
+#define HTS			REGBIT(OSCCON, 2)
+#define SPEN		REGBIT(RCSTA, 7)
+#define RX9			REGBIT(RCSTA, 6)
+#define CREN		REGBIT(RCSTA, 4)
+#define ADDEN		REGBIT(RCSTA, 3)
+#define FERR		REGBIT(RCSTA, 2)
+#define OERR		REGBIT(RCSTA, 1)
+#define RX9D		REGBIT(RCSTA, 0)
+#define TX9			REGBIT(TXSTA, 6)
+#define TXEN		REGBIT(TXSTA, 5)
+#define SYNC		REGBIT(TXSTA, 4)
+#define BRGH		REGBIT(TXSTA, 2)
+#define TRMT		REGBIT(TXSTA, 1)
+#define TX9D		REGBIT(TXSTA, 0)
+#define RCIDL		REGBIT(BAUDCTL, 6)
+#define BRG16		REGBIT(BAUDCTL, 3)
+#define WUE			REGBIT(BAUDCTL, 1)
+#define EEPGD		REGBIT(EECON1, 7)
+#define WREN		REGBIT(EECON1, 2)
+#define WR			REGBIT(EECON1, 1)
+#define RD			REGBIT(EECON1, 0)
+#define Carry		(sim::carry())
+
+#endif // !_HEAD_SIM_PIC
\ No newline at end of file
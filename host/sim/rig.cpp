@@ -0,0 +1,125 @@
+#include "rig.h"
+
+#include <cstdio>
+
+namespace sim {
+
+Rig::Rig(const Firmware & fw, int count, bool bus, uint32_t quantum) : firmware(fw), bus(bus), quantum(quantum), rx(count) {
+	wire.duplex = !bus;
+	for (int i = 0; i < count; i++) {
+		Board board;
+		board.bus = bus;
+		board.jumpers = i < 4 ? i : 0;
+		chips.emplace_back(new Pic(fw, wire, i, board));
+		if (i >= 4)
+			chips.back()->eeprom[0] = i + 1;	// BUS_EE_ID
+	}
+}
+
+void Rig::send(int id, const std::string & line) {
+	if (bus)
+		txQueue.push_back(0x100 | id);
+	for (char c : line)
+		txQueue.push_back((uint8_t)c);
+	txQueue.push_back('\r');
+}
+
+void Rig::address(int id) {
+	if (bus)
+		txQueue.push_back(0x100 | id);
+}
+
+void Rig::pulse() {
+	for (auto & c : chips)
+		c->setTrigger(false);
+	step();
+	for (auto & c : chips)
+		c->setTrigger(true);
+}
+
+void Rig::step() {
+	uint64_t end = time + quantum;
+
+	// what the host sends during this quantum
+	bool hold = !bus && xoff;
+	for (auto & c : chips)
+		hold = hold || (!bus && c->holdsOff());
+	while (!hold && !txQueue.empty() && txFree < end) {
+		Frame f;
+		f.start = std::max(txFree, time);
+		f.data = txQueue.front();
+		f.bits = bus ? 9 : 8;
+		f.bitCycles = bitCycles();
+		f.from = SIM_HOST;
+		f.garbled = false;
+		txFree = f.end();
+		txQueue.pop_front();
+		pending.push_back(f);
+		busy += f.end() - f.start;
+		hostChars++;
+	}
+	wire.publish(pending);
+
+	for (auto & c : chips) {
+		c->run(end);
+		for (Frame f : c->sent()) {
+			f.start += quantum;		// the line's delay, nobody can hear it within this quantum anymore
+			pending.push_back(f);
+			busy += f.end() - f.start;
+		}
+		c->sent().clear();
+	}
+	time = end;
+
+	// what the host heard
+	while (rxNext < wire.frames.size() && wire.frames[rxNext].end() <= time) {
+		const Frame & f = wire.frames[rxNext++];
+		if (trace)
+			printf("%10.6f %c%d %03X%s\n", (double)f.start / cyclesPerSecond(), f.from == SIM_HOST ? 'h' : '#', f.from + 1,
+				f.data, f.garbled ? " collision" : "");
+		if (f.from == SIM_HOST)
+			continue;
+		lastHeard = time;
+		if (!bus && !f.garbled && (f.data == SIM_XON || f.data == SIM_XOFF)) {
+			xoff = f.data == SIM_XOFF;
+			continue;
+		}
+		rx[f.from] += f.garbled ? '?' : (char)f.data;
+	}
+}
+
+void Rig::run(uint64_t cycles) {
+	uint64_t end = time + cycles;
+	while (time < end)
+		step();
+}
+
+bool Rig::settle(uint64_t quiet, uint64_t limit) {
+	uint64_t end = time + limit;
+	while (time < end) {
+		step();
+		if (txQueue.empty() && txFree <= time && time - std::max(lastHeard, txFree) >= quiet)
+			return true;
+	}
+	return false;
+}
+
+std::string Rig::line(int chip, uint64_t limit) {
+	uint64_t end = time + limit;
+	while (1) {
+		std::string & s = rx[chip];
+		size_t n = s.find('\n');
+		if (n != std::string::npos) {
+			std::string l = s.substr(0, n);
+			s.erase(0, n + 1);
+			if (!l.empty() && l.back() == '\r')
+				l.pop_back();
+			return l;
+		}
+		if (time >= end)
+			return "";
+		step();
+	}
+}
+
+} // namespace sim
\ No newline at end of file
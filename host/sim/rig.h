@@ -0,0 +1,90 @@
+/*
+
+	A host and a number of controllers on one serial line.
+	In bus mode the host talks in addressed frames (see bus.h), with a single controller and no bus
+	it is a plain point to point link. There the host holds off between XOFF and XON, and while a
+	controller wired to its CTS holds it off. It starts no new character after it heard either, the one
+	on its way goes on.
+
+*/
+
+#ifndef _HEAD_SIM_RIG
+#define _HEAD_SIM_RIG
+
+#include "model.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+#define SIM_XON		0x11	// see io.h
+#define SIM_XOFF	0x13
+
+// How the tools talk to a controller
+#define SIM_STARTUP_MS		20		// before the host says anything
+#define SIM_QUIET_CHARS		30		// a reply is over after this many character times of silence
+#define SIM_REPLY_MS		2000	// longest a reply may take to start and finish
+
+class Rig {
+public:
+	// Controller i gets ID i + 1: from the jumpers for the first four, from EEPROM for the rest
+	Rig(const Firmware &, int chips, bool bus, uint32_t quantum);
+
+	// Queue a line for the controller with the given ID (0 is broadcast), the ID is ignored without a bus
+	void send(int id, const std::string & line);
+
+	// Queue a lone address byte (bus only), such as the trigger
+	void address(int id);
+
+	// Pull the trigger line low for a quantum, on every controller at once
+	void pulse();
+
+	// Run for a number of cycles
+	void run(uint64_t cycles);
+
+	// Run until the host has sent everything and nothing was heard for quiet cycles, or until limit cycles passed
+	// Returns false on the limit
+	bool settle(uint64_t quiet, uint64_t limit);
+
+	// Run until controller i sent a whole line, or until limit cycles passed
+	// Returns the line without "\r\n", or an empty string on the limit
+	std::string line(int chip, uint64_t limit);
+
+	// Whatever controller i sent that wasn't taken by line() yet
+	std::string & heard(int chip) { return rx[chip]; }
+
+	uint64_t now() const { return time; }
+	uint32_t cyclesPerSecond() const { return chips[0]->cyclesPerSecond(); }
+	uint32_t bitCycles() const { return chips[0]->bitCycles(); }
+	uint64_t ms(uint64_t n) const { return n * cyclesPerSecond() / 1000; }
+	uint64_t quiet() const { return SIM_QUIET_CHARS * 11 * bitCycles(); }	// once the firmware has set the baud rate
+
+	const Firmware & firmware;
+
+	Wire wire;
+	std::vector<std::unique_ptr<Pic>> chips;
+	bool bus;
+	bool trace = false;			// print every character on the line
+	uint64_t busy = 0;			// cycles the host's or anyone's characters took on the line
+	uint64_t hostChars = 0;
+	bool xoff = false;			// XOFF heard and no XON yet, XON and XOFF don't go into heard()
+
+private:
+	uint32_t quantum;
+	uint64_t time = 0;			// start of the next quantum
+	std::deque<uint16_t> txQueue;
+	uint64_t txFree = 0;		// the host's transmitter is free from here
+	uint64_t lastHeard = 0;
+	size_t rxNext = 0;
+	std::vector<std::string> rx;
+	std::vector<Frame> pending;
+
+	void step();
+};
+
+} // namespace sim
+
+#endif // !_HEAD_SIM_RIG
\ No newline at end of file
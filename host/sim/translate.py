@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+"""
+	Turns MotorController.c into C++ that runs against the PIC model in pic.h.
+
+	Only what Cc5x has and C++ doesn't is rewritten, the firmware is otherwise compiled as it is:
+		#pragma bit X @ REG.n           #define X BIT(REG, n)
+		x.3, x.low8, x.high16           BIT(x, 3), LOW8(x), HIGH16(x)
+		unsigned long, long, int        uns16, int16, int8
+		interrupt, main, sleep()        plain functions the simulator calls, sim::sleep()
+		X += Y; if (Carry)              X = sim::addCarry(X, Y); if (Carry)
+	Globals (and local arrays, which the firmware may return pointers to) go to the fw_ram section,
+	so that every simulated chip can have its own copy.
+
+	Statements and loop conditions cost a few cycles each (CYC), register accesses one more.
+	That is a rough estimate of the code Cc5x makes, it's there so that the firmware takes time the way
+	it would on the chip, the peripherals it waits for are what set the pace.
+
+	usage:
+		host/sim/translate.py MotorController.c -o firmware.cpp
+"""
+
+import argparse
+import re
+import sys
+
+STATEMENT_CYCLES = 3
+CONDITION_CYCLES = 2
+
+RE_PRAGMA_BIT = re.compile(r'^#pragma\s+bit\s+(\w+)\s+@\s+(\w+)(?:\.(\d))?(.*)$')
+RE_PART = re.compile(r'\b(\w+(?:\[[^\]]*\])?)\.(low8|high8|low16|high16)\b')
+RE_BIT = re.compile(r'\b([A-Za-z_]\w*(?:\[[^\]]*\])?)\.([0-7])\b')
+RE_LOCAL_ARRAY = re.compile(r'^(\s*)((?:char|uns\d+|int\d*|unsigned\s+long|long|bit)\s+\w+\s*\[[^\]]+\]\s*;)')
+RE_CARRY_ADD = re.compile(r'^(\s*)(\w+)\s*\+=\s*(\w+)\s*;')
+
+
+def segments(line):
+	"""Splits a line into (kind, text), kind being 'code', 'str' or 'comment'."""
+	out = []
+	i = 0
+	code = ''
+	while i < len(line):
+		c = line[i]
+		if c in '"\'':
+			j = i + 1
+			while j < len(line) and line[j] != c:
+				j += 2 if line[j] == '\\' else 1
+			out.append(('code', code))
+			out.append(('str', line[i:j + 1]))
+			code = ''
+			i = j + 1
+		elif line.startswith('//', i):
+			out.append(('code', code))
+			out.append(('comment', line[i:]))
+			return out
+		elif line.startswith('/*', i):
+			j = line.find('*/', i + 2)
+			j = len(line) if j < 0 else j + 2
+			out.append(('code', code))
+			out.append(('comment', line[i:j]))
+			code = ''
+			i = j
+		else:
+			code += c
+			i += 1
+	out.append(('code', code))
+	return out
+
+
+def map_code(line, f):
+	return ''.join(f(t) if k == 'code' else t for k, t in segments(line))
+
+
+def code_of(line):
+	"""The line without strings and comments, as far as structure goes."""
+	return ''.join(t if k == 'code' else ('""' if k == 'str' else ' ') for k, t in segments(line)).strip()
+
+
+def rewrite(code):
+	code = re.sub(r'\bunsigned\s+long\b', 'uns16', code)
+	code = re.sub(r'\blong\b', 'int16', code)
+	code = re.sub(r'\bint\b', 'int8', code)
+	code = re.sub(r'\binterrupt\s+int_server\b', 'void int_server', code)
+	code = re.sub(r'\bvoid\s+main\s*\(', 'void firmware_main(', code)
+	code = re.sub(r'\bsleep\s*\(\s*\)', 'sim::sleep()', code)
+	code = re.sub(r'\bnop\s*\(\s*\)', 'CYC(1)', code)
+	code = RE_PART.sub(lambda m: '%s(%s)' % (m.group(2).upper(), m.group(1)), code)
+	code = RE_BIT.sub(r'BIT(\1, \2)', code)
+	return code
+
+
+def charge_condition(line):
+	"""Loop and if conditions cost cycles too, that's also what keeps empty polling loops moving."""
+	def f(code):
+		code = re.sub(r'\b(if|while)\s*\(', r'\1 (CYC(%d), ' % CONDITION_CYCLES, code)
+		m = re.search(r'\bfor\s*\((.*)\)', code)
+		if m:
+			parts = m.group(1).split(';')
+			if len(parts) == 3:
+				step = parts[2].strip()
+				parts[2] = ' CYC(%d)%s' % (CONDITION_CYCLES, ', ' + step if step else '')
+				code = code[:m.start(1)] + ';'.join(parts) + code[m.end(1):]
+		return code
+	return map_code(line, f)
+
+
+def translate(text):
+	lines = text.split('\n')
+	out = []
+	depth = 0
+	function = False		# inside a function body, as opposed to an initializer or an enum
+	comment = False
+	continued = False		# previous line ended with a backslash
+	previous = ';'			# last code line that mattered, for telling where statements start
+	branches = []			# [depth at #if, depth at the end of its first branch]
+
+	for n, line in enumerate(lines):
+		if continued:
+			continued = line.rstrip().endswith('\\')
+			out.append(map_code(line, rewrite))
+			continue
+		if comment:
+			if '*/' in line:
+				comment = False
+			out.append(line)
+			continue
+
+		stripped = line.strip()
+		if stripped.startswith('#'):
+			continued = stripped.endswith('\\')
+
+			# branches of an #if may each open a brace (if (a) { #else if (b) {), only one of them counts
+			d = re.match(r'#\s*(\w+)', stripped)
+			d = d.group(1) if d else ''
+			if d in ('if', 'ifdef', 'ifndef'):
+				branches.append([depth, None])
+			elif d in ('else', 'elif') and branches:
+				if branches[-1][1] is None:
+					branches[-1][1] = depth
+				depth = branches[-1][0]
+			elif d == 'endif' and branches:
+				taken = branches.pop()[1]
+				if taken is not None:
+					depth = taken
+			m = RE_PRAGMA_BIT.match(stripped)
+			if m:
+				target = 'BIT(%s, %s)' % (m.group(2), m.group(3)) if m.group(3) else m.group(2)
+				out.append('#define %s %s%s' % (m.group(1), target, m.group(4)))
+			elif stripped.startswith('#pragma'):
+				out.append('// ' + line)
+			elif re.match(r'#include\s+"deps/', stripped):
+				out.append('// ' + line)
+			else:
+				out.append(map_code(line, rewrite))
+			continue
+
+		code = code_of(line)
+		if code.startswith('/*') and '*/' not in code:
+			comment = True
+			out.append(line)
+			continue
+
+		# Carry after an add is the only flag the firmware looks at
+		m = RE_CARRY_ADD.match(line)
+		if m and n + 1 < len(lines) and 'Carry' in lines[n + 1]:
+			line = '%s%s = sim::addCarry<decltype(%s)>(%s, %s);' % (m.group(1), m.group(2), m.group(2), m.group(2), m.group(3))
+
+		line = map_code(line, rewrite)
+
+		if depth == 0:
+			# const tables are in ROM, every chip can share them
+			if code.endswith(';') and not code.startswith(('extern', 'typedef', '}', 'const')) and '(' not in code:
+				line = 'FW_RAM ' + line
+			if '{' in code:
+				function = '(' in code and '=' not in code.split('{')[0]
+		elif function and code:
+			if RE_LOCAL_ARRAY.match(line):
+				line = RE_LOCAL_ARRAY.sub(r'\1static FW_RAM \2', line)
+			line = charge_condition(line)
+			starts = previous[-1:] in (';', '{', '}', ':')
+			if starts and not re.match(r'(else|case|default)\b|[{}]', code):
+				indent = line[:len(line) - len(line.lstrip())]
+				line = '%sCYC(%d); %s' % (indent, STATEMENT_CYCLES, line.lstrip())
+
+		if code:
+			previous = code
+		depth += code.count('{') - code.count('}')
+		if depth == 0:
+			function = False
+		out.append(line)
+
+	return out
+
+
+def main():
+	ap = argparse.ArgumentParser(description='Translate the Cc5x firmware into C++ for the simulator')
+	ap.add_argument('source', help='MotorController.c')
+	ap.add_argument('-o', '--output', required=True)
+	args = ap.parse_args()
+
+	with open(args.source) as f:
+		text = f.read()
+
+	body = translate(text)
+	with open(args.output, 'w') as f:
+		f.write('// Generated from %s by host/sim/translate.py, don\'t edit\n' % args.source.split('/')[-1])
+		f.write('#include "pic.h"\n\n')
+		f.write('namespace FW_NAMESPACE {\n\n')
+		f.write('\n'.join(body))
+		f.write('\n\nextern const sim::Firmware firmware = { firmware_main, int_server,\n')
+		f.write('\tTIME_TICK_US, TIME_CAL_TICKS, MOTOR_MIN_PERIOD, IO_SIZE_IN, BUS_TRIGGER, ENCODER_COUNTS };\n\n')
+		f.write('} // namespace FW_NAMESPACE\n')
+
+
+if __name__ == '__main__':
+	main()
\ No newline at end of file
@@ -0,0 +1,9 @@
+; A square with a pause and a rapid back, for gcodeplan --dry-run (see CMakeLists.txt)
+G21 G90
+G1 X10 Y0 F600
+G1 X20 Y0
+G1 X20 Y10
+G4 P200
+G1 X0 Y10 F1200
+G0 X0 Y0
+M2
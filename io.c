@@ -1,102 +1,478 @@
 #ifndef _SOURCE_IO
 #define _SOURCE_IO
 
-char inputPos;
+char inputPos;					// where the next character goes
+char io_lineAt;					// where the line coming in starts, the ones before it are whole
+char io_nextAt;					// where what came in behind the running line starts
+char io_lines;					// whole lines waiting behind it
+char io_lostLines;				// bit n is set if the nth of them lost characters
+bit io_busy;					// the line at the front of io_in is running or replying
+bit io_held;					// the host is held off
+bit io_tooLong;					// the line didn't fit, it's dropped once it ends
+bit io_lost;					// the receiver overran while the line came in
 char io_in[IO_SIZE_IN];
+char io_pending;
+bit io_dropped;
+bit io_notice;
 bit io_echo;
+char io_out[IO_SIZE_OUT];
+char io_outAt;					// where the next character comes out of io_out
+char io_outCount;				// characters in it
+bit io_later;
+bit io_laterMsg;				// the io_printLater() message hasn't all gone out
+unsigned long io_laterAt;		// where io_printMore() is in str_table
+unsigned long io_laterFrag;		// and in the fragment it's in, if io_laterInFrag
+bit io_laterInFrag;
+char io_seq;
+bit io_acks;
+bit io_xon;
+bit io_xoff;					// XOFF went out, XON is due
+
+#define IO_LINES	8			// whole lines that can wait, one bit each in io_lostLines
+
+// Nowhere for the next character to go until the running line is done, the receiver holds it meanwhile
+#define IO_FULL		(io_busy && (inputPos >= IO_SIZE_IN - 1 || io_lines == IO_LINES))
 
 void io_init() {
 	
 	io_echo = FALSE;
+	io_dropped = FALSE;
+	io_notice = FALSE;
+	io_outAt = 0;
+	io_outCount = 0;
+	io_later = FALSE;
+	io_laterMsg = FALSE;
+	io_pending = 0;
+	inputPos = 0;
+	io_lineAt = 0;
+	io_lines = 0;
+	io_lostLines = 0;
+	io_busy = FALSE;
+	io_held = FALSE;
+	io_tooLong = FALSE;
+	io_lost = FALSE;
+	io_seq = 0;
+	io_acks = FALSE;
+	io_xon = FALSE;
+	io_xoff = FALSE;
 	
 	// Enable pins, EUSART will reconfigure them as necessary
 	TRISB.6 = 1;
 	TRISB.7 = 1;
+#if IO_CTS_ENABLE
+	PORT_IO_CTS = 0;
+	TRISC.4 = 0;
+#endif
 	
 	/*
 		To calculate baud rate period:
-		T = Main oscilator time (4 MHz in our case)
-		D = Desired baud rate (9600 in our case)
-		p = period, value we're calculating
+		T = Main oscilator frequency (CONFIG_F_OSC)
+		D = Desired baud rate (CONFIG_BAUD)
+		p = period, value we're calculating (IO_BRG)
 		
-		D = T/(16 *(p+1))
+		D = T/(4 *(p+1))
 		
-		p = T/D/16-1
-		p = 4 000 000 / 6900 / 16 - 1 = 25
+		p = T/D/4-1
+		p = 4 000 000 / 9600 / 4 - 1 = 103 (9615 baud, 0.16% off)
 	*/
-	BRGH = 1;	// Make period more precise (divide D by 16 not 64)
-	SPBRGH = 0;	// high byte of desired baud rate 
-	SPBRG = 25;	// specify our period
+	BRG16 = 1;	// 16-bit period, so that slow clocks and fast rates still get a close divisor
+	BRGH = 1;	// Make period more precise (divide D by 4 not 16)
+	SPBRGH = IO_BRG >> 8;	// high byte of our period
+	SPBRG = IO_BRG & 0xFF;	// specify our period
 	
+#if BUS_ENABLE
+	TX9 = 1;	// use 9-bit characters on the bus, ours are never addresses
+	TX9D = 0;
+#else
 	TX9 = 0;	// use 8-bit characters
+#endif
 	SYNC = 0;	// set it to asynchrounous transmishion
 	TXEN = 1;	// enable UART circuitry
 	
 	SPEN = 1;	// enable EUSART and automatically configure TX/CK as output
 	
 	CREN = 1;	// enable reciever circuitry
+#if BUS_ENABLE
+	RX9 = 1;	// the 9th bit marks address bytes, bus_init() turns address detection on
+#else
 	RX9 = 0;	// use 8-bit characters
+#endif
+}
+
+void io_takeSeq() {
+	char i = 0;
+	unsigned long n = 0;
+	
+	while (i < 4 && io_in[i] >= '0' && io_in[i] <= '9') {	// a fourth digit is enough to tell it's too big
+		n = n * 10 + io_in[i] - '0';
+		i++;
+	}
+	if (!i || n > 255 || (io_in[i] && io_in[i] != ' ')) {
+		io_seq++;	// no number, one that's too big to be a seq, or one that goes on into a command
+		return;
+	}
+	io_seq = n;
+	while (i) {
+		i--;
+		io_in[i] = ' ';		// io_split() drops it with the spaces
+	}
+}
+
+#if BUS_ENABLE
+#define io_flow()		// the line is shared, the host waits for the reply before it sends the next one
+#else
+// Holds the host off once the lines behind the running one are close to filling io_in, and lets it go again
+// when the running line is done and they have moved up
+void io_flow() {
+	if (io_busy && (inputPos >= IO_SIZE_IN - 1 - IO_HOLD_ROOM || io_lines >= IO_LINES - 2)) {
+		if (io_held)
+			return;
+		io_held = TRUE;
+#if IO_CTS_ENABLE
+		PORT_IO_CTS = 1;
+#endif
+		if (io_xon) {
+			while (!TXIF);	// a reply may be in TXREG
+			TXREG = IO_XOFF;
+			io_xoff = TRUE;
+		}
+	} else if (io_held) {
+		io_held = FALSE;
+#if IO_CTS_ENABLE
+		PORT_IO_CTS = 0;
+#endif
+		if (io_xoff) {		// even if a line turned flow control off, the host is waiting for it
+			while (!TXIF);
+			TXREG = IO_XON;
+			io_xoff = FALSE;
+		}
+	}
+}
+#endif
+
+// Hands out the line at the front of io_in, it stays there until io_resume()
+const char * io_takeLine() {
+	char i = 0;
+	bit lost = io_lostLines.0;
+	
+	while (io_in[i])
+		i++;
+	io_nextAt = i + 1;
+	io_busy = TRUE;
+	io_lines--;
+	io_lostLines >>= 1;
+	io_flow();
+	io_takeSeq();
+	if (io_tooLong || (lost && io_acks))
+		io_dropped = TRUE;	// what's left of it could be a command of its own, none of it runs
+	io_tooLong = FALSE;
+	return io_in;
 }
 
 const char * io_getInput() {
+	char c, i;
+	
+	if (OERR) {	// an overrun stops the receiver until CREN is cleared
+		sched_overruns[SCHED_INPUT]++;
+		CREN = 0;
+		CREN = 1;
+		io_lost = TRUE;
+	}
 	
-	CREN = 1;	// Just in case an error occured
+#if TRIGGER_ENABLE && BUS_ENABLE
+	if (trigger_heard) {	// an address byte the interrupt took while armed
+		trigger_heard = 0;
+		bus_address(trigger_address);
+		return 0;
+	}
+#endif
+	
+	if (io_lines && !io_busy)
+		return io_takeLine();	// it came in while the last one ran
+	if (IO_FULL)
+		return 0;
 	
 	// Receiveing data
-	if (RCIF) {
-		if (inputPos >= IO_SIZE_IN)
-			inputPos = 0;	// silently wrap around, bad practice but functional
-
-		io_in[inputPos] = RCREG;	// read input here
+#if TRIGGER_ENABLE && BUS_ENABLE
+	if ((RCIF && !RCIE) || io_pending) {	// while RCIE is on the receiver is the interrupt's (see trigger.h)
+#else
+	if (RCIF || io_pending) {
+#endif
+		if (io_pending) {
+			c = io_pending;	// it came first, so it goes first
+			io_pending = 0;
+		} else {
+#if BUS_ENABLE
+			if (RX9D) {		// 9th bit comes first, RCREG moves on to the next character
+				bus_address(RCREG);
+				return 0;
+			}
+#endif
+			c = RCREG;	// read input here
+		}
 		if (io_echo)
-			TXREG = io_in[inputPos];
-		if (io_in[inputPos] == '\0' || io_in[inputPos] == '\n' || io_in[inputPos] == '\r') {
+			TXREG = c;
+		if (c == '\0' || c == '\n' || c == '\r') {
+#if BUS_ENABLE
+			bus_lineEnd();	// our own reply echoes back on a half duplex line, it has to be kept out
+#endif
+			if (inputPos == io_lineAt && !io_lost)
+				return 0;	// nothing in it, like the '\n' of "\r\n": no seq, no ack
 			io_in[inputPos] = '\0';
-			inputPos = 0;
-			return io_in;
-		} else
 			inputPos++;
+			io_lineAt = inputPos;
+			if (io_lost) {
+				c = 1;		// the line's bit in io_lostLines
+				for (i = io_lines; i; i--)
+					c <<= 1;
+				io_lostLines |= c;
+			}
+			io_lost = FALSE;
+			io_lines++;
+			if (!io_busy)
+				return io_takeLine();
+			io_flow();
+			return 0;
+		}
+		if (inputPos < IO_SIZE_IN - 1) {	// the last one is for the '\0'
+			io_in[inputPos] = c;
+			inputPos++;
+			io_flow();
+		} else
+			io_tooLong = TRUE;	// a line with nothing ahead of it, one behind the running line waits for room
 	}
 	
 	return 0;
 }
 
+bit io_idle() {
+	if (!RCIDL)
+		return FALSE;	// a character is on its way in, sleeping now would cut it off
+	if (inputPos || RCIF || io_pending)	// after RCIDL, one that just came in is in RCIF by now
+		return FALSE;
+	return TRUE;
+}
+
+bit io_received() {
+	if (io_lines && !io_busy)
+		return TRUE;	// a line came in while the last one ran
+#if TRIGGER_ENABLE && BUS_ENABLE
+	if (trigger_heard)
+		return TRUE;
+	if (RCIE)
+		return OERR || io_pending;	// the receiver is the interrupt's
+#endif
+	if (IO_FULL)
+		return OERR;
+	return RCIF || OERR || io_pending;
+}
+
+char io_split() {
+	char r = 0;		// where we read
+	char w = 0;		// where we write, never ahead of r
+	char n = 1;
+	char c;
+	bit start = TRUE;
+	
+	while (1) {
+		c = io_in[r];
+		r++;
+		if (c == ' ' && start)
+			continue;
+		start = FALSE;
+		if (c == ';') {
+			c = '\0';
+			n++;
+			start = TRUE;
+		} else if (!c)
+			break;	// the end of the line
+		io_in[w] = c;
+		w++;
+	}
+	io_in[w] = '\0';
+	return n;
+}
+
+void io_resume() {
+	char i;
+	
+	io_lineAt -= io_nextAt;
+	inputPos -= io_nextAt;
+	for (i = 0; i < inputPos; i++)
+		io_in[i] = io_in[i + io_nextAt];
+	io_busy = FALSE;
+	io_flow();
+}
+
+void io_printAck() {
+	io_printStr(STR_ACK);
+	io_print(toString(io_seq));
+	io_printLater(STR_NEWLINE);
+}
+
+void io_printNak(char n) {
+	io_printStr(STR_NAK);
+	io_print(toString(io_seq));
+	io_printStr(STR_SPACE);
+	io_print(toString(n));
+	io_printLater(STR_NEWLINE);
+}
+
+const char * io_next(const char * s) {
+	while (*s)
+		s++;
+	return s + 1;
+}
+
+// Puts a character into io_out, only a part that doesn't fit waits for the transmitter
+void io_put(char c) {
+	if (io_outCount == IO_SIZE_OUT) {
+		while (!TXIF);
+		TXREG = io_out[io_outAt];
+		io_outAt = (io_outAt + 1) & (IO_SIZE_OUT - 1);
+		io_outCount--;
+	}
+	io_out[(io_outAt + io_outCount) & (IO_SIZE_OUT - 1)] = c;
+	io_outCount++;
+	io_later = TRUE;
+}
+
 void io_print(const char * s) {
+#if BUS_ENABLE
+	if (!bus_talk)
+		return;		// nobody asked, the line may be someone else's
+	PORT_BUS_DE = 1;
+#endif
 	while (*s) {
-		while (!TRMT);	// wait until character is transmitted
-		TXREG = *s;
+		io_put(*s);
+		s++;
+	}
+}
+
+void io_printStr(unsigned long s) {
+	char c;
+	unsigned long f;
+	
+#if BUS_ENABLE
+	if (!bus_talk)
+		return;
+	PORT_BUS_DE = 1;
+#endif
+	
+	while (c = str_table[s]) {
+		if (c & 0x80) {
+			// a fragment, these only ever contain plain characters
+			f = str_frag[c & 0x7F];
+			while (c = str_table[f]) {
+				io_put(c);
+				f++;
+			}
+		} else
+			io_put(c);
 		s++;
 	}
 }
 
-bit strcmp(const char * a, const char * b) {
-	char ac, bc;
+void io_printLater(unsigned long s) {
+#if BUS_ENABLE
+	if (!bus_talk)
+		return;
+	PORT_BUS_DE = 1;
+#endif
+	io_laterAt = s;
+	io_laterInFrag = FALSE;
+	io_laterMsg = TRUE;
+	io_later = TRUE;
+}
+
+bit io_printMore() {
+	char c;
+	
+	if (io_outCount) {	// io_out came first
+		if (TXIF) {
+			TXREG = io_out[io_outAt];
+			io_outAt = (io_outAt + 1) & (IO_SIZE_OUT - 1);
+			io_outCount--;
+		}
+		return FALSE;
+	}
+	
+	while (io_laterMsg) {
+		if (io_laterInFrag) {
+			c = str_table[io_laterFrag];
+			if (!c) {
+				io_laterInFrag = FALSE;	// back to the message
+				continue;
+			}
+		} else {
+			c = str_table[io_laterAt];
+			if (!c) {
+				io_laterMsg = FALSE;
+				break;
+			}
+			if (c & 0x80) {
+				io_laterAt++;
+				io_laterFrag = str_frag[c & 0x7F];
+				io_laterInFrag = TRUE;
+				continue;
+			}
+		}
+		
+		// one at a time, TXIF only clears a cycle after TXREG is written
+		if (!TXIF)
+			return FALSE;
+		TXREG = c;
+		if (io_laterInFrag)
+			io_laterFrag++;
+		else
+			io_laterAt++;
+		return FALSE;
+	}
+	io_later = FALSE;
+	return TRUE;
+}
+
+bit cmdcmp(const char * a, const char * b) {
 	while (*a) {
-		ac = *a;
-		bc = *b;
-		if (ac != bc)
-			return FALSE;	// Hit a different char
+		if (*a != *b)
+			return FALSE;
 		a++;
 		b++;
 	}
-	return TRUE;	// Hit a null-char
+	return !*b || *b == ' ';	// not just the start of a longer word
 }
 
-unsigned long stoi(const char * s) {
-	unsigned long r = 0;
-	while (*s) {
-		// abuse ASCII notation, numbers follow each other
-		if (*s >= '0' && *s <= '9') {
-			r *= 10;
-			r += *s - '0';
-		}
+uns32 stoi(const char * s) {
+	uns32 r = 0;
+	char d;
+	while (*s == ' ')
+		s++;
+	// abuse ASCII notation, numbers follow each other
+	while (*s >= '0' && *s <= '9') {
+		d = *s - '0';
+		if (r > 429496729 || (r == 429496729 && d > 5))
+			return 0;	// r * 10 + d would wrap around
+		r *= 10;
+		r += d;
 		s++;
 	}
+	while (*s == ' ')
+		s++;
+	if (*s)
+		return 0;	// there's more to it than a number
 	return r;
 }
 
-size2 const char * toString(unsigned long n) {
-	char str[12];	// 6 + 6, because str[5] is somehow broken (no idea why) 65535 is max value, which requires 5 chars + 1 null char
+void io_printInt(int32 n) {
+	if (n < 0) {
+		io_printStr(STR_MINUS);
+		n = -n;
+	}
+	io_print(toString(n));
+}
+
+size2 const char * toString(uns32 n) {
+	char str[12];	// 4294967295 is max value, which requires 10 chars + 1 null char (and one more, as str[5] was somehow broken before)
 	str[11] = '\0';
 	int i = 10;
 	int t;
@@ -11,28 +11,125 @@
 #ifndef _HEAD_IO
 #define _HEAD_IO
 
-// Max size of the input string (should be of length |max legal command| + 1)
-#define IO_SIZE_IN 16
+// Baud rate generator value for CONFIG_BAUD, with BRG16 and BRGH set: baud = F_OSC / (4 * (IO_BRG + 1))
+#define IO_BRG				((CONFIG_F_OSC + 2 * CONFIG_BAUD) / (4 * CONFIG_BAUD) - 1)
+#define IO_BAUD_ACTUAL		(CONFIG_F_OSC / 4 / (IO_BRG + 1))
+
+#if IO_BAUD_ACTUAL * 1000 > CONFIG_BAUD * (1000 + CONFIG_BAUD_TOLERANCE) || IO_BAUD_ACTUAL * 1000 < CONFIG_BAUD * (1000 - CONFIG_BAUD_TOLERANCE)
+#error CONFIG_BAUD can't be made within CONFIG_BAUD_TOLERANCE at CONFIG_F_OSC
+#endif
+
+// Max size of the input string, a line can hold several commands separated by ';'
+// A longer line is dropped as a whole and answered with "Line too long"
+// The lines that come in while one runs and replies wait behind it in the same buffer
+#define IO_SIZE_IN 48
+
+/*
+	Output. Nothing waits for the transmitter: io_print() and io_printStr() put what they print into io_out, and
+	io_printMore() (the console task) sends it a character at a time whenever TXREG has room. Replies are printed a
+	part at a time, a few numbers and words that fit into io_out and one io_printLater() message at the end, the
+	next part only once the last one is out. A part that doesn't fit waits for the transmitter.
+*/
+#define IO_SIZE_OUT 32	// a power of two, the index wraps with it
+
+/*
+	Flow control. The next lines come in behind the one that runs and replies, until they fill io_in (or
+	make 8 lines). Nothing reads the receiver then until the running line's reply is out and they move up,
+	and a host that goes on sending overruns it. The host can be held off with XOFF/XON (the flow command)
+	or with a CTS line, RC4 is high while it's held. That happens IO_HOLD_ROOM characters before io_in is
+	full, and it has to stop within those and the two characters the receiver holds. Neither can be used
+	on a bus, the line is shared there and the host waits for each reply.
+*/
+#define IO_HOLD_ROOM		4	// an XOFF can wait for TXREG and the character being sent before it goes out
+#ifndef IO_CTS_ENABLE
+#define IO_CTS_ENABLE 0
+#endif
+
+#define IO_XON				0x11
+#define IO_XOFF				0x13
+
+#pragma bit PORT_IO_CTS		@ PORTC.4	// to the host's CTS, high while it's to hold off
 
 // An input string buffer, is to be used by parsing functions
 extern char io_in[IO_SIZE_IN];	
 
+// A character received outside of EUSART (see power_sleep()), 0 if there's none
+extern char io_pending;
+
+// Sequence number of the last line: the number it started with (0-255, followed by a space), or one more than
+// the one before. A bigger number isn't a sequence number, it stays in the line
+extern char io_seq;
+
+// While set, every line is answered with "ack <seq>" once it's checked, or "nak <seq> <n>" if command n is wrong
+// (0 for the line itself: too long, or characters were lost) and it doesn't run (ack command)
+extern bit io_acks;
+
+// While set, XOFF goes out when io_in is about to fill up and XON once it has room again (flow command, not on a bus)
+extern bit io_xon;
+
+// Is to be called once a line has run and its reply is written, the lines behind it move up to the front
+void io_resume();
+
 // Initialize everything IO-related (uart ports, control registers and interrupts)
 void io_init();
 
 // Will return pointer to the first character of input string, or 0 if still receiveing input
+// The line stays at the front of io_in until io_resume(), what comes in meanwhile waits behind it
 const char * io_getInput();
 
-// Returns 1 if strings are the same until a becomes null
-// Will always return 1 if compares a null pointer to anything
-bit strcmp(const char * a, const char * b);
+// The line io_getInput() returned is to be answered with "Line too long" (or nak with acks on) and not run
+extern bit io_dropped;
+
+// Something came up in the tick task that the console task is to print once no reply is going out
+// (a limit switch, a stall, the result of cal), whatever sets it has a flag of its own that says what
+extern bit io_notice;
+
+// Returns 1 if no line is being received and nothing is waiting in or coming into the receiver
+bit io_idle();
+
+// Returns 1 if io_getInput() has something to do: a character, an overrun to clear or an address byte
+bit io_received();
+
+// Splits the line in io_in into commands at ';' (and drops the spaces they start with), returns how many there are
+char io_split();
+
+// Prints "ack <seq>"
+void io_printAck();
+
+// Prints "nak <seq> <n>"
+void io_printNak(char);
 
-// Retuns a number, represented by provided string (assumed it's base 10) or 0 if the string is garbage
-unsigned long stoi(const char *);
+// Returns the command after the given one, in a line split by io_split()
+const char * io_next(const char *);
 
-// Simply prints the given string
+// Returns 1 if b is the word a, on its own or followed by a space and whatever comes after it
+// ("speed 5" is speed, "speedy" isn't)
+bit cmdcmp(const char * a, const char * b);
+
+// Retuns a number, represented by provided string (assumed it's base 10, spaces around it are fine) or 0 if
+// the string is garbage or the number doesn't fit into 32 bits
+uns32 stoi(const char *);
+
+// Puts the given string into io_out
 void io_print(const char *);
 
-size2 const char * toString(unsigned long);
+// Prints a signed number
+void io_printInt(int32);
+
+// Puts a message from the string table into io_out, takes one of the STR_ ids from strings.h
+void io_printStr(unsigned long);
+
+// Something printed is still going out, from io_out or the io_printLater() message
+extern bit io_later;
+
+// Starts printing a message from the string table after what's in io_out, however long it is, it's the last thing
+// in a part
+void io_printLater(unsigned long);
+
+// Puts out the next character if the transmitter has room for it, io_out first and then the io_printLater()
+// message, returns 1 once all of it is out
+bit io_printMore();
+
+size2 const char * toString(uns32);
 
 #endif // !_HEAD_IO
\ No newline at end of file
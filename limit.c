@@ -0,0 +1,160 @@
+#ifndef _SOURCE_LIMIT
+#define _SOURCE_LIMIT
+
+#if LIMIT_ENABLE
+
+char limit_phase;
+char limit_report;
+bit limit_cw;					// clockwise limit switch closed since the last limit_check()
+bit limit_ccw;					// counterclockwise limit switch closed since the last limit_check()
+bit limit_atHome;				// home switch closed since homing last looked at it
+bit limit_direction;			// direction to go back to after homing
+unsigned long limit_period;		// period to go back to after homing
+
+void limit_init() {
+	char t;
+	
+	limit_phase = LIMIT_IDLE;
+	limit_report = LIMIT_REPORT_NONE;
+	limit_cw = 0;
+	limit_ccw = 0;
+	limit_atHome = 0;
+	
+	OPTION.7 = 0;				// enable weak pull-ups on PORTA/PORTB
+	WPUB.4 = 1;
+	WPUB.6 = 1;
+	
+	IOCB.4 = 1;					// interrupt on change for all the switches
+	IOCB.6 = 1;
+	IOCA.3 = 1;
+	
+	t = PORTA;					// end the mismatch condition
+	t = PORTB;
+	RABIF = 0;
+	RABIE = 1;
+}
+
+void limit_update() {
+#if MOTOR_PWM
+	bit hit;
+#endif
+	
+	// reading the pins ends the mismatch condition as well
+	if (!PORT_LIMIT_CW)
+		limit_cw = 1;
+	if (!PORT_LIMIT_CCW)
+		limit_ccw = 1;
+	if (!PORT_HOME)
+		limit_atHome = 1;
+	
+#if MOTOR_PWM
+	// ECCP doesn't wait for the core loop, so cut the step output right away
+	// the core loop will see the latched switch and do the rest
+	// the same way as motor_pwmStop(), the RC2 latch holds whatever level a PORTC write last found there
+	if (motor_pwm) {
+		hit = limit_ccw;
+		if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+			hit = limit_cw;
+		if (hit) {
+			TMR2IE = 0;
+			PORT_MOTOR_STEP = 0;
+			PSTRCON = 0;
+		}
+	}
+#endif
+}
+
+bit limit_check() {
+	bit hit = FALSE;
+	
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE) {
+		if (limit_cw || !PORT_LIMIT_CW)
+			hit = TRUE;
+	} else if (limit_ccw || !PORT_LIMIT_CCW)
+		hit = TRUE;
+	
+	limit_cw = 0;
+	limit_ccw = 0;
+	return hit;
+}
+
+void limit_home() {
+	limit_cancel();
+	motor_pwmStop();
+	
+	motor_steps = 0;
+	motor_counting = FALSE;
+	motor_enable = FALSE;
+	
+	// homing drives the motor through the same double buffer as commands do
+	limit_direction = motor_nextDirection;
+	limit_period = motor_nextPeriod;
+	motor_nextDirection = LIMIT_HOME_DIRECTION;
+	motor_nextPeriod = LIMIT_HOME_FAST;
+	motor_latch();
+	motor_enable = TRUE;
+	
+	limit_atHome = 0;
+	limit_phase = LIMIT_SEEK;
+}
+
+void limit_homeUpdate() {
+	if (limit_phase == LIMIT_SEEK) {
+		if (limit_atHome || !PORT_HOME) {
+			motor_nextDirection = !LIMIT_HOME_DIRECTION;
+			motor_latch();
+			motor_enable = FALSE;
+			motor_steps = LIMIT_BACKOFF_STEPS;
+			motor_counting = TRUE;
+			limit_phase = LIMIT_BACKOFF;
+		}
+	} else if (limit_phase == LIMIT_BACKOFF) {
+		if (motor_counting)
+			return;
+		if (!PORT_HOME) {
+			motor_steps = 1;	// still on the switch, keep going
+			motor_counting = TRUE;
+			return;
+		}
+		motor_nextDirection = LIMIT_HOME_DIRECTION;
+		motor_nextPeriod = LIMIT_HOME_SLOW;
+		motor_latch();
+		motor_enable = TRUE;
+		limit_atHome = 0;
+		limit_phase = LIMIT_CREEP;
+	} else if (limit_phase == LIMIT_CREEP) {
+		if (limit_atHome || !PORT_HOME) {
+			motor_position = 0;
+			limit_cancel();
+			limit_report = LIMIT_REPORT_HOMED;
+			io_notice = TRUE;
+		}
+	}
+}
+
+void limit_cancel() {
+	if (limit_phase == LIMIT_IDLE)
+		return;
+	
+	motor_enable = FALSE;
+	motor_steps = 0;
+	motor_counting = FALSE;
+	motor_nextDirection = limit_direction;
+	motor_nextPeriod = limit_period;
+	motor_latch();
+	limit_phase = LIMIT_IDLE;
+}
+
+void limit_print() {
+	if (limit_report == LIMIT_REPORT_HOMED)
+		io_printLater(STR_HOMED);
+	else if (limit_report == LIMIT_REPORT_FAILED)
+		io_printLater(STR_HOME_FAILED);
+	else
+		io_printLater(STR_LIMIT_HIT);
+	limit_report = LIMIT_REPORT_NONE;
+}
+
+#endif // LIMIT_ENABLE
+
+#endif // !_SOURCE_LIMIT
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*
+
+	Limit and home switches.
+	Stops the motor before it runs into a limit switch and finds the home position.
+	All switches are active low (closed switch pulls the pin to ground).
+
+*/
+
+#ifndef _HEAD_LIMIT
+#define _HEAD_LIMIT
+
+// Set to 1 if the switches are connected (unconnected pins would stop the motor at random)
+#ifndef LIMIT_ENABLE
+#define LIMIT_ENABLE 0
+#endif
+
+#define LIMIT_HOME_DIRECTION	MOTOR_COUNTERCLOCKWISE	// direction in which the home switch is
+#define LIMIT_HOME_FAST			6		// period while looking for the home switch
+#define LIMIT_HOME_SLOW			40		// period while approaching it for the second time
+#define LIMIT_BACKOFF_STEPS		MOTOR_HALF_REVOLUTION	// steps to move away from the switch between the two
+
+#pragma bit PORT_LIMIT_CCW	@ PORTB.4	// 0 when at the counterclockwise end of travel
+#pragma bit PORT_LIMIT_CW	@ PORTB.6	// 0 when at the clockwise end of travel
+#pragma bit PORT_HOME		@ PORTA.3	// 0 when at home, needs an external pull-up
+
+// Homing phases
+#define LIMIT_IDLE		0
+#define LIMIT_SEEK		1	// fast towards the switch
+#define LIMIT_BACKOFF	2	// away from the switch
+#define LIMIT_CREEP		3	// slowly back to the switch
+
+#if LIMIT_ENABLE
+
+extern char limit_phase;
+
+// What the console task is to report (see io_notice)
+#define LIMIT_REPORT_NONE	0
+#define LIMIT_REPORT_HOMED	1
+#define LIMIT_REPORT_FAILED	2	// homing ran into a limit switch
+#define LIMIT_REPORT_HIT	3
+
+extern char limit_report;
+
+// Initialize switch pins and their interrupt-on-change
+void limit_init();
+
+// Is to be called on RABIF interrupt, latches the switches that closed
+void limit_update();
+
+// Returns 1 if the next step in the current direction would go past a limit switch
+// Clears whatever limit_update() latched
+bit limit_check();
+
+// Start homing, the motor will run towards the home switch
+void limit_home();
+
+// Is to be called every motor period (at the step boundary), advances homing
+void limit_homeUpdate();
+
+// Stop homing (if it's in progress) and go back to the speed and direction from before
+void limit_cancel();
+
+// Prints limit_report and clears it
+void limit_print();
+
+#else
+
+#define limit_phase		LIMIT_IDLE
+#define limit_cancel()
+
+#endif // LIMIT_ENABLE
+
+#endif // !_HEAD_LIMIT
\ No newline at end of file
@@ -24,9 +24,19 @@
 
 
 // Header includes before interrupt routine
+#include "config.h"
 #include "time.h"
 #include "io.h"
 #include "motor.h"
+#include "bus.h"
+#include "trigger.h"
+#include "power.h"
+#include "prof.h"
+#include "sched.h"
+#include "limit.h"
+#include "encoder.h"
+#include "queue.h"
+#include "strings.h"
 
 
 
@@ -40,7 +50,20 @@ typedef enum {
 	CMD_SPEED,
 	CMD_DIR,
 	CMD_SIZE,
-	CMD_STEP
+	CMD_STEP,
+	CMD_PROF,
+	CMD_HOME,
+	CMD_RATE,
+	CMD_CAL,
+	CMD_QUIET,
+	CMD_ID,
+	CMD_ARM,
+	CMD_TASKS,
+	CMD_STALL,
+	CMD_ACK,
+	CMD_FLOW,
+	CMD_AT,
+	CMD_TICK
 } Command;
 #define TRUE	1
 #define FALSE	0
@@ -49,27 +72,97 @@ typedef enum {
 
 // Variable definitions
 bit motor_enable;				// start command sets this to 1 until stop or step command
-unsigned long motor_steps;		// step command will set this to some value, that will go down with each motor tick
+uns32 motor_steps;				// step command will set this to some value, that will go down with each motor tick
+bit motor_counting;				// motor_steps isn't 0, one bit is cheaper to test than 4 bytes
 unsigned long motor_period;		// period of the motor's step
 const char * pArg;				// pointer to the first char of argument in input string
 Command cmd;					// command enum, necessary due to compiler limitation
+bit quiet;						// quiet command, no replies but to queries
+unsigned long motor_tick;		// ticks into the current step period
+// The reply to the line that ran, the console task puts it out a part at a time (see replyNext())
+const char * replyAt;			// the command it's answering
+char replyLeft;					// commands still to answer, that one too
+char replyPart;					// the part of the answer that's next
+char replyBad;					// the command that was wrong, 0 for the line itself
+bit replyHead;					// the ack, nak, err or "Line too long" is still to go
+bit replyRan;					// the line ran, otherwise replyBad says why not
+bit replyAck;					// acks were on when the line came
+bit replyQuiet;					// only queries answer: it's a batch, or quiet was on
+bit replyNoted;					// the command had something to say before its answer
+bit replyStatus;				// the batch status line is still to go
+unsigned long replyNote;		// what that was
+char noticePart;				// the part of a notice that's going out, 0 between them
+// The line the command task is on, it checks or runs a command of it a pass (see runBatch())
+bit batchChecking;				// its commands are being checked
+bit batchRunning;				// and then run
+bit batchChecked;				// it was checked before it ran
+bit batchStopped;				// nothing was stepping when it started to run
+#if MOTOR_PWM
+bit batchRetune, batchRetuneSpeed;	// it changed what ECCP is making
+#endif
+char batchCount;				// commands in it
+char batchLeft;					// still to check or run
+#define HELP_PARTS		15
+#define INFO_PARTS		15		// and then the queue
+#if QUEUE_ENABLE
+unsigned long atTick;			// what parseAt() read
+unsigned long atWait;			// ticks from then to atTick
+unsigned long atArg;
+char atBatch;					// at commands of the line checked so far, they need that much room in the queue
+#endif
 
 
 // Function definitions
 void parseInput(const char *);
+bit checkCommand();
+bit printStatus(char);
+void runTick();
+bit runBatch();
+void runQueued();
+bit parseAt();
+bit atAhead();
+void replyAlso(unsigned long);
+void replyInstead(unsigned long);
+bit replyNext();
+bit replyPrint();
+bit helpNext();
+bit infoNext();
+void noticeNext();
 
 
 // Interrupt routine, because of the compiler spicifics, we need to define it before any other code...
 #pragma origin 4
 interrupt int_server() {
 	int_save_registers
+	PROF_BEGIN(PROF_ISR);
 	/* New interrupts are automaticaly disabled            */
 	/* "Interrupt on change" at pin RA1 from PK2 UART-tool */
 
+#if TRIGGER_ENABLE
+	// first, so that the trigger takes the same number of cycles on every controller
+	if (INTF && INTE)
+		trigger_fire();
+#if BUS_ENABLE
+	if (RCIF && RCIE)
+		trigger_receive();
+#endif
+#endif
+
 	if (IF_TIME)
 		time_update();
 
+#if LIMIT_ENABLE
+	if (RABIF)
+		limit_update();
+#endif
+
+#if MOTOR_PWM
+	if (TMR2IF && TMR2IE)
+		motor_pwmUpdate();
+#endif
+
 	RABIF = 0;    /* Reset the RABIF-flag before leaving   */
+	PROF_END(PROF_ISR);
 	int_restore_registers
 }
 
@@ -78,8 +171,17 @@ interrupt int_server() {
 // Source file definitions
 // In standard C this would not be necessary, but Cc5x is not a standard compiler, so we assist it a little
 #include "time.c"
+#include "strings.c"
 #include "io.c"
 #include "motor.c"
+#include "power.c"
+#include "prof.c"
+#include "sched.c"
+#include "limit.c"
+#include "encoder.c"
+#include "queue.c"
+#include "bus.c"
+#include "trigger.c"
 
 
 
@@ -89,212 +191,1387 @@ void main(void) {
 	time_init();
 	io_init();
 	motor_init();
+	power_init();
+#if PROF_ENABLE
+	prof_init();
+#endif
+#if LIMIT_ENABLE
+	limit_init();
+#endif
+#if TRIGGER_ENABLE
+	trigger_init();
+#endif
+#if ENCODER_ENABLE
+	encoder_init();
+#endif
+#if QUEUE_ENABLE
+	queue_init();
+#endif
 	
 	ANSEL = 0;	// we don't need any AD-inputs
 	ANSELH = 0;
+#if BUS_ENABLE
+	bus_init();	// after ANSELH, the ID jumpers are on analog pins
+#endif
 	GIE = 1;	// enable interrupts
 	
 	motor_enable = FALSE;
 	motor_steps = 0;
-	PORT_MOTOR_DIRECTION = MOTOR_CLOCKWISE;
-	PORT_MOTOR_STEP_SIZE = MOTOR_FULL_STEP;
-	
-	motor_period = 790;	// half second period
-	
-	unsigned long motor_tick = 0;	// the tick for motor
-	unsigned long lastTick = 0;
-	unsigned long arg;
+	motor_counting = FALSE;
+	motor_nextDirection = MOTOR_CLOCKWISE;
+	motor_nextSize = MOTOR_FULL_STEP;
+	motor_nextPeriod = 781;	// half second period
+	motor_latch();
 	
+	sched_init();
+	sched_tick = time_now();
+	sched_line = FALSE;
+	sched_reply = FALSE;
+	batchChecking = FALSE;
+	batchRunning = FALSE;
+	motor_tick = 0;
+	noticePart = 0;
 	io_echo = FALSE;
+	quiet = FALSE;
 	
-	const char * input;
-	
-	// Core loop
+	// Core loop, see sched.h for the tasks
 	while (1) {
 		PORTC.5 = RCIF;
-		input = io_getInput();
-		
-		if (input) {
-			// parseInput updates cmd (this is due to compiler limitations, otherwise I'd make it return a value)
-			parseInput(input);
-			if (cmd) {
-				switch (cmd) {
-				
-				case CMD_HELP:
-					io_print("Availabe commands:\r\n");
-					io_print("?/help - displays this message\r\n");
-					io_print("info - displays motor info\r\n");
-					io_print("start - starts the motor\r\n");
-					io_print("stop - stops the motor\r\n");
-					io_print("speed [x] - sets the speed of the motor to x (3-65535)\r\n");
-					io_print("dir [x] - sets the direction to x (\"cc\" or \"cw\")\r\n");
-					io_print("size [x] - sets the step size to x (\"full\" or \"half)\"\r\n");
-					io_print("step [x] - makes motor step x (1-65535) times\r\n");
-				break;
-				
-				case CMD_INFO:
-					io_print("Motor is ");
-					if (motor_enable || motor_steps)
-						io_print("ON\r\n");
-					else
-						io_print("OFF\r\n");
-					
-					io_print("Period = ");
-					io_print(toString(motor_period));
-					
-					io_print(" ticks (tickrate = 1580 Hz)\r\n");
-					io_print("Direction is ");
-					if (PORT_MOTOR_DIRECTION == MOTOR_COUNTERCLOCKWISE)
-						io_print("counter ");
-					io_print("clockwise\r\n");
-					
-					io_print("Step size is ");
-					if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
-						io_print("full");
-					else
-						io_print("half");
-					io_print(" steps\r\n");
-				break;
-				
-				case CMD_START:
-					motor_enable = TRUE;
-				break;
-				
-				case CMD_STOP:
-					motor_enable = FALSE;
-					motor_steps = 0;
-				break;
-				
-				case CMD_SPEED:
-					arg = stoi(pArg);
-					if (arg >= 3) {		// speeds lower than 3 are below rated pulserate
-						motor_period = arg;
-						motor_tick = 0;	// reset motor tick, so that the new speed applies
-					}
-					
-					io_print("Stepping every ");
-					io_print(toString(motor_period));
-					io_print(" ticks\r\n");
-				break;
-				
-				case CMD_DIR:
-					if (*pArg)
-						if (strcmp(" cc", pArg))
-							PORT_MOTOR_DIRECTION = MOTOR_COUNTERCLOCKWISE;
-						else if (strcmp(" cw", pArg))
-							PORT_MOTOR_DIRECTION = MOTOR_CLOCKWISE;
-						else
-							io_print("Unknown direction\r\n");
-					
-					io_print("Motor direction is ");
-					if (PORT_MOTOR_DIRECTION == MOTOR_COUNTERCLOCKWISE)
-						io_print("counter ");
-					io_print("clockwise\r\n");
-				break;
-				
-				case CMD_SIZE:
-					if (*pArg)
-						if (strcmp(" full", pArg))
-							PORT_MOTOR_STEP_SIZE = MOTOR_FULL_STEP;
-						else if (strcmp(" half", pArg))
-							PORT_MOTOR_STEP_SIZE = MOTOR_HALF_STEP;
-						else
-							io_print("Unknown step size\r\n");
-					
-					io_print("Stepping with ");
-					if (PORT_MOTOR_STEP_SIZE == MOTOR_FULL_STEP)
-						io_print("full");
-					else
-						io_print("half");
-					io_print(" steps\r\n");
-				break;
-				
-				case CMD_STEP:
-					arg = stoi(pArg);
-					if (arg) {
-						motor_steps = arg;
-						motor_enable = FALSE;
-					}
-					
-					io_print("Stepping for another ");
-					io_print(toString(motor_steps));
-					io_print(" steps\n");
-				break;
+		trigger_listen();
+		
+		switch (sched_next()) {
+		
+		case SCHED_TICK:
+			runTick();
+		break;
+		
+		case SCHED_INPUT:
+			if (io_getInput()) {
+				sched_line = TRUE;
+				sched_since[SCHED_COMMAND] = time_now();
+			}
+		break;
+		
+		case SCHED_COMMAND:
+			sched_account(SCHED_COMMAND);
+			if (runBatch())
+				sched_since[SCHED_COMMAND] = time_now();	// the next command of it, after whatever is due first
+			else {
+				sched_line = FALSE;
+				sched_reply = TRUE;
+				sched_since[SCHED_CONSOLE] = time_now();
+			}
+		break;
+		
+		case SCHED_CONSOLE:
+			if (sched_reply)
+				sched_account(SCHED_CONSOLE);	// nobody waits on a notice
+			if (io_printMore()) {	// all of the part is out
+				if (noticePart || !sched_reply)
+					noticeNext();	// one that has begun goes on, new ones wait for the reply
+				else if (!replyNext()) {
+					sched_reply = FALSE;
+					bus_release();	// that was the last of it
+					io_resume();
 				}
 			}
+			sched_since[SCHED_CONSOLE] = time_now();
+		break;
+		
+		case SCHED_IDLE:
+#if POWER_IDLE_SLEEP
+			// Nothing to step and nothing to receive, so there's no point in spinning
+#if TIME_CALIBRATE
+			if (!motor_enable && !motor_counting && io_idle() && !sched_reply && !io_later && !io_notice && !time_calRunning && trigger_phase == TRIGGER_IDLE && limit_phase == LIMIT_IDLE && !queue_timed) {	// the timers stop in sleep
+#else
+			if (!motor_enable && !motor_counting && io_idle() && !sched_reply && !io_later && !io_notice && trigger_phase == TRIGGER_IDLE && limit_phase == LIMIT_IDLE && !queue_timed) {
+#endif
+				power_sleep();
+				sched_tick = time_now();	// ticks didn't run while asleep
+			}
+#endif
+		break;
 		}
+	}
+}
+
+// Everything that happens once a tick, the step first of all
+void runTick() {
+	unsigned long now;
+	unsigned long elapsed;	// ticks since the last run, more than one when a task below took long
+	
+	sched_since[SCHED_TICK] = sched_tick + 1;
+	sched_account(SCHED_TICK);
+	now = time_now();		// once, both have to be of the same tick
+	elapsed = now - sched_tick;
+	sched_tick = now;		// right away, a step takes until the next tick (MOTOR_DELAY) and that one counts too
+	
+	PROF_BEGIN(PROF_TICK);
+	
+	if (!motor_enable && !motor_counting)
+		power_idleTicks++;
+	
+#if TIME_CALIBRATE
+	if (time_calRunning && time_calDone)
+		time_calFinish();
+#endif
+	
+#if TRIGGER_ENABLE
+	if (trigger_phase == TRIGGER_DUE) {
+		trigger_release();
+		motor_tick = motor_period - 1;	// so the first step is on this tick, the first one after the trigger
+	}
+#endif
+	
+#if QUEUE_ENABLE
+	// Timed commands, before the step so that a move they start makes its first step on their tick
+	// (a batch that is part way runs to the end first)
+	while (!batchRunning && queue_due(sched_tick))
+		runQueued();
+#endif
+	
+	// Ticks a task below kept us from count too, a step is late then but the ones after it aren't
+	// A move a batch starts from standstill waits for all of it to run (see runBatch())
+	motor_tick += elapsed;
+	if (motor_tick >= motor_period && !(batchRunning && batchStopped)) {	// not ==, so that a shorter period can't be skipped past
+		motor_tick -= motor_period;
+		
+#if ENCODER_ENABLE
+		if (encoder_update())
+			sched_tick = time_now();	// it fell behind as it was, the ticks that took aren't caught up on
+#endif
 		
-		// Run io_update again, but ignore everything else
-		if (lastTick == time_tick)
-			continue;
+#if LIMIT_ENABLE
+		limit_homeUpdate();
 		
-		// We assume time_tick is equal to lastTick + 1
-		if (++motor_tick == motor_period) {
-			motor_tick = 0;
+		if ((motor_enable || motor_counting) && limit_check()) {
+			motor_pwmStop();
+			motor_enable = FALSE;
+			motor_steps = 0;
+			motor_counting = FALSE;
+			
+			if (limit_phase)
+				limit_report = LIMIT_REPORT_FAILED;
+			else
+				limit_report = LIMIT_REPORT_HIT;
+			io_notice = TRUE;
+			limit_cancel();
+		}
+#endif
 
-			if (motor_enable)
-				motor_step();
+		// Step boundary, switch to whatever the commands asked for, a batch once all of it has run
+#if MOTOR_PWM
+		if (motor_pending && !batchRunning && !motor_pwm)	// ECCP switches on its own, in motor_pwmUpdate()
+#else
+		if (motor_pending && !batchRunning)
+#endif
+			motor_latch();
+		if (motor_tick > motor_period - MOTOR_MIN_PERIOD)
+			motor_tick = motor_period - MOTOR_MIN_PERIOD;	// catching up, but never two steps closer than the driver takes
 
-			if (motor_steps) {
-				motor_steps--;
-				motor_step();
-			}
+#if MOTOR_PWM
+		if (motor_enable && !motor_pwm)
+#else
+		if (motor_enable)
+#endif
+			motor_step();
+
+		if (motor_counting) {
+			// only the low half changes on most steps, the high half just takes the borrow
+			if (!motor_steps.low16)
+				motor_steps.high16--;
+			motor_steps.low16--;
+			if (!motor_steps.low16 && !motor_steps.high16)
+				motor_counting = FALSE;
+			motor_step();
 		}
-		lastTick = time_tick;
 	}
+	
+	PROF_END(PROF_TICK);
+}
+
+// Checks or runs the next command of the line in io_in, one a pass so that the tick goes on in between, returns 0
+// once all of it is done and the console task can put out its reply (see replyNext())
+bit runBatch() {
+	uns32 arg;
+	unsigned long behind;
+	
+	if (batchChecking) {
+		PROF_RESUME(PROF_CHECK);
+		// parseInput updates cmd (this is due to compiler limitations, otherwise I'd make it return a value)
+		parseInput(replyAt);
+		if (*replyAt && !checkCommand()) {
+			replyBad = batchCount - batchLeft + 1;
+			batchChecking = FALSE;
+			replyAt = io_in;
+			PROF_END(PROF_CHECK);
+			return FALSE;
+		}
+		replyAt = io_next(replyAt);
+		batchLeft--;
+		if (batchLeft) {
+			PROF_PAUSE(PROF_CHECK);
+			return TRUE;
+		}
+		PROF_END(PROF_CHECK);
+		batchChecking = FALSE;
+		batchRunning = TRUE;	// all of it is right, the next pass runs it from the start
+		batchLeft = batchCount;
+		replyAt = io_in;
+		return TRUE;
+	}
+	
+	if (!batchRunning) {	// the line has just come
+		replyAt = io_in;
+		replyLeft = 0;
+		replyPart = 0;
+		replyBad = 0;
+		replyHead = TRUE;
+		replyRan = FALSE;
+		replyAck = io_acks;		// "ack on" doesn't ack its own line
+		replyNoted = FALSE;
+		replyStatus = FALSE;
+		if (io_dropped) {
+			io_dropped = FALSE;
+			return FALSE;
+		}
+		
+		// A line can hold several commands separated by ';', a batch runs all or nothing
+		// so it's checked as a whole before any of it runs (with acks on, so is a single command)
+		PROF_BEGIN(PROF_CHECK);
+		batchCount = io_split();
+		batchLeft = batchCount;
+		batchChecked = batchCount > 1 || io_acks;
+		batchChecking = batchChecked;
+		batchRunning = !batchChecked;
+#if QUEUE_ENABLE
+		atBatch = 0;
+#endif
+		if (batchChecked) {
+			PROF_PAUSE(PROF_CHECK);
+		} else {
+			PROF_END(PROF_CHECK);
+		}
+		return TRUE;
+	}
+	
+	if (batchLeft == batchCount) {	// the first command to run
+		PROF_BEGIN(PROF_CMD);
+		replyRan = TRUE;
+		replyLeft = batchCount;
+		replyQuiet = batchCount > 1 || quiet;	// a batch gets one status line instead
+#if MOTOR_PWM
+		batchRetune = FALSE;
+		batchRetuneSpeed = FALSE;
+#endif
+		batchStopped = !motor_enable && !motor_counting;
+		if (batchStopped)
+			encoder_restore();
+	} else {
+		PROF_RESUME(PROF_CMD);
+	}
+	parseInput(replyAt);
+	replyAt = io_next(replyAt);
+	
+	// Help, info and the other queries only print, replyPrint() has the rest of what each command says
+	switch (cmd) {
+	
+	case CMD_START:
+		limit_cancel();
+#if TRIGGER_ENABLE
+		if (trigger_phase != TRIGGER_IDLE) {
+			trigger_start = TRUE;	// trigger_release() starts it
+			trigger_steps = 0;
+			replyInstead(STR_ARMED);
+			break;
+		}
+#endif
+		motor_enable = TRUE;
+#if MOTOR_PWM
+		// if ECCP can't make this period, the core loop will do the stepping
+		if (motor_nextPeriod <= MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES)
+			motor_pwmStart(motor_nextPeriod * TIME_TICK_CYCLES);
+#endif
+	break;
+	
+	case CMD_STOP:
+		limit_cancel();
+		trigger_disarm();
+		motor_pwmStop();
+		motor_enable = FALSE;
+		motor_steps = 0;
+		motor_counting = FALSE;
+	break;
+	
+	case CMD_SPEED:
+		arg = stoi(pArg);
+		if (arg >= MOTOR_MIN_PERIOD && arg <= 65535) {		// shorter periods are above rated pulserate
+			limit_cancel();
+			encoder_forget();
+			motor_nextPeriod = arg;	// the current period runs out first
+			motor_pending = TRUE;
+#if MOTOR_PWM
+			batchRetune = TRUE;
+			batchRetuneSpeed = TRUE;
+#endif
+		}
+	break;
+	
+	case CMD_DIR:
+		if (*pArg) {
+			limit_cancel();
+			if (cmdcmp(" cc", pArg))
+				motor_nextDirection = MOTOR_COUNTERCLOCKWISE;
+			else if (cmdcmp(" cw", pArg))
+				motor_nextDirection = MOTOR_CLOCKWISE;
+			else
+				replyAlso(STR_UNKNOWN_DIRECTION);
+			motor_pending = TRUE;
+#if MOTOR_PWM
+			batchRetune = TRUE;
+#endif
+		}
+	break;
+	
+	case CMD_SIZE:
+		if (*pArg) {
+			limit_cancel();
+			if (cmdcmp(" full", pArg))
+				motor_nextSize = MOTOR_FULL_STEP;
+			else if (cmdcmp(" half", pArg))
+				motor_nextSize = MOTOR_HALF_STEP;
+			else
+				replyAlso(STR_UNKNOWN_STEP_SIZE);
+			motor_pending = TRUE;
+#if MOTOR_PWM
+			batchRetune = TRUE;
+#endif
+		}
+	break;
+	
+	case CMD_STEP:
+		arg = stoi(pArg);
+#if TRIGGER_ENABLE
+		if (arg && trigger_phase != TRIGGER_IDLE) {
+			trigger_steps = arg;	// trigger_release() runs them
+			trigger_start = FALSE;
+			replyInstead(STR_ARMED);
+			break;
+		}
+#endif
+		if (arg) {
+			limit_cancel();
+			motor_pwmStop();
+			motor_steps = arg;
+			motor_counting = TRUE;
+			motor_enable = FALSE;
+		} else if (*pArg)
+			replyAlso(STR_STEPS_RANGE);
+	break;
+	
+#if PROF_ENABLE
+	case CMD_PROF:
+		if (cmdcmp(" isr", pArg))
+			prof_select(PROF_ISR);
+		else if (cmdcmp(" check", pArg))
+			prof_select(PROF_CHECK);
+		else if (cmdcmp(" cmd", pArg))
+			prof_select(PROF_CMD);
+		else if (cmdcmp(" tick", pArg))
+			prof_select(PROF_TICK);
+		else if (cmdcmp(" reset", pArg))
+			prof_select(prof_region & ~PROF_WAIT);
+	break;
+#endif
+	
+#if LIMIT_ENABLE
+	case CMD_HOME:
+		limit_home();
+	break;
+#endif
+	
+#if MOTOR_PWM
+	case CMD_RATE:
+		arg = stoi(pArg);
+		if (arg >= MOTOR_PWM_MIN_RATE && arg <= MOTOR_PWM_MAX_RATE) {
+			limit_cancel();
+			motor_steps = 0;
+			motor_counting = FALSE;
+			motor_enable = TRUE;
+			motor_pwmStart(TIME_CYCLE_RATE / arg);
+		}
+	break;
+#endif
+	
+#if TIME_CALIBRATE
+	case CMD_CAL:
+#if MOTOR_PWM && MOTOR_PWM_COUNT
+		if (motor_pwm) {
+			replyInstead(STR_CAL_BUSY);
+			break;
+		}
+#endif
+		time_calStart();
+	break;
+#endif
+	
+#if ENCODER_ENABLE
+	case CMD_STALL:
+		arg = stoi(pArg);
+		if (*pArg && arg <= 0xFF) {
+			encoder_window = arg;
+			encoder_reset();
+		}
+	break;
+#endif
+	
+	case CMD_TASKS:
+		if (cmdcmp(" reset", pArg))
+			sched_init();
+	break;
+	
+	case CMD_QUIET:
+		if (cmdcmp(" on", pArg))
+			quiet = TRUE;
+		else if (cmdcmp(" off", pArg))
+			quiet = FALSE;
+	break;
+	
+	case CMD_ACK:
+		if (cmdcmp(" on", pArg))
+			io_acks = TRUE;
+		else if (cmdcmp(" off", pArg))
+			io_acks = FALSE;
+	break;
+	
+#if !BUS_ENABLE
+	case CMD_FLOW:
+		if (cmdcmp(" on", pArg))
+			io_xon = TRUE;		// XON goes out once this line is done
+		else if (cmdcmp(" off", pArg))
+			io_xon = FALSE;
+	break;
+#endif
+	
+#if BUS_ENABLE
+	case CMD_ID:
+		arg = stoi(pArg);
+		if (arg && arg <= 0xFF)
+			bus_setId(arg);
+	break;
+#endif
+	
+#if TRIGGER_ENABLE
+	case CMD_ARM:
+		limit_cancel();
+		trigger_arm();
+	break;
+#endif
+	
+#if QUEUE_ENABLE
+	case CMD_AT:
+		queue_timed = TRUE;	// until at clear, the host plans against the tick
+		if (!*pArg)
+			break;	// a query then
+		if (cmdcmp(" clear", pArg))
+			queue_clear();
+		else if (!parseAt() || (!batchChecked && !atAhead()))
+			replyAlso(STR_AT_RANGE);
+		else if (!queue_add(atTick, cmd, atArg))	// a checked deadline that has passed since runs on the next tick
+			replyAlso(STR_QUEUE_FULL);
+	break;
+	
+	case CMD_TICK:
+		queue_timed = TRUE;
+	break;
+#endif
+	}
+	
+	batchLeft--;
+	if (batchLeft) {
+		PROF_PAUSE(PROF_CMD);
+		return TRUE;
+	}
+	batchRunning = FALSE;
+	replyAt = io_in;
+	
+#if MOTOR_PWM
+	// All of the batch goes to ECCP in one switch, if it can't make the new period the core loop takes over
+	if (motor_pwm && batchRetune) {
+		if (!batchRetuneSpeed)
+			motor_pwmRetune(motor_pwmCycles);
+		else if (motor_nextPeriod > MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES || !motor_pwmRetune(motor_nextPeriod * TIME_TICK_CYCLES))
+			motor_pwmStop();
+	}
+#endif
+	
+	// Nothing is stepping (or was until now), so there's no step to wait for
+	if (motor_pending && (batchStopped || (!motor_enable && !motor_counting)))
+		motor_latch();
+	
+	// A move from standstill makes its first step on the next tick, not whenever the idle period runs out,
+	// the ticks the batch took came before the move and runTick() isn't to catch up on them
+	if (batchStopped) {
+		behind = time_now() - sched_tick;	// as runTick() counts them
+		motor_tick = motor_period - 1 - behind;
+	}
+	
+	replyStatus = batchCount > 1 && !quiet;
+	PROF_END(PROF_CMD);
+	return FALSE;
+}
+
+// The command has something to say before its answer, only a single one with quiet off says it
+void replyAlso(unsigned long s) {
+	if (replyQuiet)
+		return;
+	replyNoted = TRUE;
+	replyNote = s;
+}
+
+// The same, in place of its answer
+void replyInstead(unsigned long s) {
+	replyAlso(s);
+	if (!replyQuiet)
+		replyLeft = 0;
+}
+
+// Starts the next part of the reply to the line runBatch() ran, returns 0 once there's none left
+bit replyNext() {
+	bit more;
+	
+	if (replyHead) {
+		replyHead = FALSE;
+		if (!replyRan) {
+			// what's left of a line that was dropped could be a command of its own, none of it ran
+			if (replyAck)
+				io_printNak(replyBad);
+			else if (replyBad) {
+				io_printStr(STR_ERR);
+				io_print(toString(replyBad));
+				io_printLater(STR_NEWLINE);
+			} else
+				io_printLater(STR_LINE_TOO_LONG);
+			return TRUE;
+		}
+		if (replyAck) {
+			io_printAck();	// before the replies
+			return TRUE;
+		}
+	}
+	
+	if (replyNoted) {
+		replyNoted = FALSE;
+		io_printLater(replyNote);
+		return TRUE;
+	}
+	
+	while (replyLeft) {
+		if (!replyPart)
+			parseInput(replyAt);
+		if (cmd == CMD_HELP)
+			more = helpNext();
+		else if (cmd == CMD_INFO)
+			more = infoNext();
+		else
+			more = replyPrint();
+		if (more) {
+			replyPart++;
+			return TRUE;
+		}
+		replyPart = 0;
+		replyAt = io_next(replyAt);
+		replyLeft--;
+	}
+	
+	if (replyStatus) {
+		if (printStatus(replyPart)) {
+			replyPart++;
+			return TRUE;
+		}
+		replyStatus = FALSE;
+	}
+	return FALSE;
+}
+
+// Starts the next part of the answer to cmd (but help and info), returns 0 once there's none left
+bit replyPrint() {
+	uns32 a;
+	
+	// Queries answer in a batch and with quiet on as well
+	switch (cmd) {
+	
+#if PROF_ENABLE
+	case CMD_PROF:
+		return prof_print(replyPart);
+#endif
+	
+	case CMD_TASKS:
+		return sched_print(replyPart);
+	
+#if QUEUE_ENABLE
+	case CMD_AT:
+		if (*pArg && replyQuiet)
+			return FALSE;
+		return queue_print(replyPart, !*pArg);	// the query lists what's waiting
+	
+	case CMD_TICK:
+		if (replyPart)
+			return FALSE;
+		io_printStr(STR_TICK_IS);
+		io_print(toString(time_now()));
+		io_printLater(STR_NEWLINE);
+		return TRUE;
+#endif
+	}
+	
+	// The others answer in one part
+	if (replyQuiet || replyPart)
+		return FALSE;
+	
+	switch (cmd) {
+	
+	case CMD_SPEED:
+		io_printStr(STR_STEPPING_EVERY);
+		io_print(toString(motor_nextPeriod));
+		io_printLater(STR_TICKS);
+	break;
+	
+	case CMD_DIR:
+		io_printStr(STR_MOTOR_DIRECTION_IS);
+		if (motor_nextDirection == MOTOR_COUNTERCLOCKWISE)
+			io_printStr(STR_COUNTER);
+		io_printLater(STR_CLOCKWISE);
+	break;
+	
+	case CMD_SIZE:
+		io_printStr(STR_STEPPING_WITH);
+		if (motor_nextSize == MOTOR_FULL_STEP)
+			io_printStr(STR_FULL);
+		else
+			io_printStr(STR_HALF);
+		io_printLater(STR_STEPS);
+	break;
+	
+	case CMD_STEP:
+		io_printStr(STR_STEPPING_FOR);
+		io_print(toString(motor_steps));
+		io_printLater(STR_STEPS);
+	break;
+	
+#if LIMIT_ENABLE
+	case CMD_HOME:
+		io_printLater(STR_HOMING);
+	break;
+#endif
+	
+#if MOTOR_PWM
+	case CMD_RATE:
+		a = stoi(pArg);
+		if (a >= MOTOR_PWM_MIN_RATE && a <= MOTOR_PWM_MAX_RATE) {
+			io_printStr(STR_HARDWARE_EVERY);
+			io_print(toString(motor_pwmCycles));
+			io_printLater(STR_CYCLES);
+		} else {
+			io_printStr(STR_RATE_RANGE);
+			io_print(toString(MOTOR_PWM_MIN_RATE));
+			io_printStr(STR_MINUS);
+			io_print(toString(MOTOR_PWM_MAX_RATE));
+			io_printLater(STR_NEWLINE);
+		}
+	break;
+#endif
+	
+#if TIME_CALIBRATE
+	case CMD_CAL:
+		io_printLater(STR_CALIBRATING);
+	break;
+#endif
+	
+#if ENCODER_ENABLE
+	case CMD_STALL:
+		if (encoder_window) {
+			io_printStr(STR_CHECKING_EVERY);
+			io_print(toString(encoder_window));
+			io_printLater(STR_STEPS);
+		} else
+			io_printLater(STR_NOT_CHECKING);
+	break;
+#endif
+	
+	case CMD_QUIET:
+		io_printStr(STR_QUIET_IS);
+		if (quiet)
+			io_printLater(STR_ON);
+		else
+			io_printLater(STR_OFF);
+	break;
+	
+	case CMD_ACK:
+		io_printStr(STR_ACKS_ARE);
+		if (io_acks)
+			io_printLater(STR_ON);
+		else
+			io_printLater(STR_OFF);
+	break;
+	
+#if !BUS_ENABLE
+	case CMD_FLOW:
+		io_printStr(STR_FLOW_IS);
+		if (io_xon)
+			io_printLater(STR_ON);
+		else
+			io_printLater(STR_OFF);
+	break;
+#endif
+	
+#if BUS_ENABLE
+	case CMD_ID:
+		io_printStr(STR_BUS_ID_IS);
+		io_print(toString(bus_id));
+		io_printLater(STR_NEWLINE);
+	break;
+#endif
+	
+#if TRIGGER_ENABLE
+	case CMD_ARM:
+		io_printLater(STR_ARMED);
+	break;
+#endif
+	
+	default:
+		return FALSE;	// start, stop and empty commands say nothing
+	}
+	return TRUE;
+}
+
+#if QUEUE_ENABLE
+
+// Runs the next timed command the way runBatch() would, only without a reply
+void runQueued() {
+	bit stopped;
+	
+	stopped = !motor_enable && !motor_counting;
+	if (stopped)
+		encoder_restore();
+	queue_take(sched_tick);
+	switch (queue_nextCmd) {
+	
+	case CMD_START:
+		limit_cancel();
+#if TRIGGER_ENABLE
+		if (trigger_phase != TRIGGER_IDLE) {
+			trigger_start = TRUE;
+			trigger_steps = 0;
+			break;
+		}
+#endif
+		motor_enable = TRUE;
+#if MOTOR_PWM
+		if (motor_nextPeriod <= MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES)
+			motor_pwmStart(motor_nextPeriod * TIME_TICK_CYCLES);
+#endif
+	break;
+	
+	case CMD_STOP:
+		limit_cancel();
+		trigger_disarm();
+		motor_pwmStop();
+		motor_enable = FALSE;
+		motor_steps = 0;
+		motor_counting = FALSE;
+	break;
+	
+	case CMD_SPEED:
+		limit_cancel();
+		encoder_forget();
+		motor_nextPeriod = queue_nextArg;
+		motor_pending = TRUE;
+#if MOTOR_PWM
+		if (motor_pwm && (motor_nextPeriod > MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES || !motor_pwmRetune(motor_nextPeriod * TIME_TICK_CYCLES)))
+			motor_pwmStop();
+#endif
+	break;
+	
+	case CMD_DIR:
+	case CMD_SIZE:
+		limit_cancel();
+		if (queue_nextCmd == CMD_DIR)
+			motor_nextDirection = queue_nextArg == MOTOR_COUNTERCLOCKWISE;
+		else
+			motor_nextSize = queue_nextArg == MOTOR_FULL_STEP;
+		motor_pending = TRUE;
+#if MOTOR_PWM
+		if (motor_pwm)
+			motor_pwmRetune(motor_pwmCycles);
+#endif
+	break;
+	
+	case CMD_STEP:
+#if TRIGGER_ENABLE
+		if (trigger_phase != TRIGGER_IDLE) {
+			trigger_steps = queue_nextArg;
+			trigger_start = FALSE;
+			break;
+		}
+#endif
+		limit_cancel();
+		motor_pwmStop();
+		motor_steps = queue_nextArg;
+		motor_counting = TRUE;
+		motor_enable = FALSE;
+	break;
+	}
+	
+	if (motor_pending && (stopped || (!motor_enable && !motor_counting)))
+		motor_latch();
+	if (stopped && (motor_enable || motor_counting))
+		motor_tick = motor_period - 1;	// a move from standstill makes its first step on this tick
+}
+
+// Reads "<tick> <command>" or "+<n> <command>" after at into atTick, cmd and atArg, returns 0 if it's wrong
+bit parseAt() {
+	const char * s = pArg;
+	unsigned long n = 0;
+	uns32 a;
+	char d;
+	bit relative;
+	
+	while (*s == ' ')
+		s++;
+	relative = *s == '+';
+	if (relative)
+		s++;
+	if (*s < '0' || *s > '9')
+		return FALSE;
+	while (*s >= '0' && *s <= '9') {
+		d = *s - '0';
+		if (n > 6553 || (n == 6553 && d > 5))
+			return FALSE;	// n * 10 + d would wrap around
+		n *= 10;
+		n += d;
+		s++;
+	}
+	if (*s != ' ')
+		return FALSE;
+	while (*s == ' ')
+		s++;
+	atTick = time_now();	// read once, the tick may go on in between
+	if (relative) {
+		atWait = n;
+		atTick += n;
+	} else {
+		atWait = n - atTick;
+		atTick = n;
+	}
+	
+	// Only the commands that move the motor, with the argument they take (a step move of up to 65535)
+	parseInput(s);
+	switch (cmd) {
+	
+	case CMD_START:
+	case CMD_STOP:
+		return TRUE;
+	
+	case CMD_SPEED:
+		a = stoi(pArg);
+		atArg = a;
+		return a >= MOTOR_MIN_PERIOD && a <= 65535;
+	
+	case CMD_DIR:
+		atArg = MOTOR_COUNTERCLOCKWISE;
+		if (cmdcmp(" cc", pArg))
+			return TRUE;
+		atArg = MOTOR_CLOCKWISE;
+		return cmdcmp(" cw", pArg);
+	
+	case CMD_SIZE:
+		atArg = MOTOR_FULL_STEP;
+		if (cmdcmp(" full", pArg))
+			return TRUE;
+		atArg = MOTOR_HALF_STEP;
+		return cmdcmp(" half", pArg);
+	
+	case CMD_STEP:
+		a = stoi(pArg);
+		atArg = a;
+		return a && a <= 65535;
+	}
+	return FALSE;
+}
+
+// Returns 1 if atTick was 1 to QUEUE_AHEAD ticks away when parseAt() read it
+bit atAhead() {
+	return atWait && atWait <= QUEUE_AHEAD;
+}
+
+#endif // QUEUE_ENABLE
+
+// Starts the next part of help, returns 0 once there's none left
+bit helpNext() {
+	while (replyPart < HELP_PARTS) {
+		switch (replyPart) {
+		
+		case 0:
+			io_printLater(STR_HELP);
+			return TRUE;
+		
+		case 1:
+			io_print(toString(MOTOR_MIN_PERIOD));
+			io_printLater(STR_HELP_END);
+			return TRUE;
+		
+#if PROF_ENABLE
+		case 2:
+			io_printLater(STR_HELP_PROF);
+			return TRUE;
+#endif
+		
+#if LIMIT_ENABLE
+		case 3:
+			io_printLater(STR_HELP_HOME);
+			return TRUE;
+#endif
+		
+#if MOTOR_PWM
+		case 4:
+			io_printLater(STR_HELP_RATE);
+			return TRUE;
+		
+		case 5:
+			io_print(toString(MOTOR_PWM_MIN_RATE));
+			io_printStr(STR_MINUS);
+			io_print(toString(MOTOR_PWM_MAX_RATE));
+			io_printLater(STR_HELP_RATE_END);
+			return TRUE;
+#endif
+		
+#if TIME_CALIBRATE
+		case 6:
+			io_printLater(STR_HELP_CAL);
+			return TRUE;
+#endif
+		
+#if BUS_ENABLE
+		case 7:
+			io_printLater(STR_HELP_ID);
+			return TRUE;
+#endif
+		
+#if TRIGGER_ENABLE
+		case 8:
+			io_printLater(STR_HELP_ARM);
+			return TRUE;
+#endif
+		
+#if ENCODER_ENABLE
+		case 9:
+			io_printLater(STR_HELP_STALL);
+			return TRUE;
+#endif
+		
+		case 10:
+			io_printLater(STR_HELP_TASKS);
+			return TRUE;
+		
+		case 11:
+			io_printLater(STR_HELP_ACK);
+			return TRUE;
+		
+#if !BUS_ENABLE
+		case 12:
+			io_printLater(STR_HELP_FLOW);
+			return TRUE;
+#endif
+		
+#if QUEUE_ENABLE
+		case 13:
+			io_printLater(STR_HELP_AT);
+			return TRUE;
+#endif
+		
+		case 14:
+			io_printLater(STR_HELP_BATCH);
+			return TRUE;
+		}
+		replyPart++;	// a part that isn't built in
+	}
+	return FALSE;
+}
+
+// Starts the next part of info, returns 0 once there's none left
+bit infoNext() {
+	while (replyPart < INFO_PARTS) {
+		switch (replyPart) {
+		
+		case 0:
+			io_printStr(STR_MOTOR_IS);
+			if (motor_enable || motor_counting)
+				io_printLater(STR_ON);
+			else
+				io_printLater(STR_OFF);
+			return TRUE;
+		
+		case 1:
+			io_printStr(STR_PERIOD);
+			io_print(toString(motor_nextPeriod));
+			io_printStr(STR_TICKS_OF);
+			io_print(toString(TIME_TICK_US));
+			io_printLater(STR_US_EACH);
+			return TRUE;
+		
+#if MOTOR_PWM
+		case 2:
+			if (!motor_pwm)
+				break;
+			io_printStr(STR_HARDWARE_EVERY);
+			io_print(toString(motor_pwmCycles));
+			io_printLater(STR_CYCLES);
+			return TRUE;
+#endif
+		
+		case 3:
+			io_printStr(STR_DIRECTION_IS);
+			if (motor_nextDirection == MOTOR_COUNTERCLOCKWISE)
+				io_printStr(STR_COUNTER);
+			io_printLater(STR_CLOCKWISE);
+			return TRUE;
+		
+		case 4:
+			io_printStr(STR_STEP_SIZE_IS);
+			if (motor_nextSize == MOTOR_FULL_STEP)
+				io_printStr(STR_FULL);
+			else
+				io_printStr(STR_HALF);
+			io_printLater(STR_STEPS);
+			return TRUE;
+		
+		case 5:
+			io_printStr(STR_POSITION);
+			io_printInt(motor_position);
+			io_printLater(STR_STEPS);
+			return TRUE;
+		
+		case 6:
+			io_printStr(STR_IDLE_FOR);
+			io_print(toString(power_idleTicks));
+			io_printLater(STR_TICKS_SLEPT);
+			return TRUE;
+		
+		case 7:
+			io_print(toString(power_sleeps));
+			io_printLater(STR_TIMES_FOR);
+			return TRUE;
+		
+		case 8:
+			io_print(toString(power_asleep));
+			io_printLater(STR_TICKS);
+			return TRUE;
+		
+#if ENCODER_ENABLE
+		case 9:
+			io_printStr(STR_ENCODER_IS);
+			io_printInt(encoder_position);
+			io_printLater(STR_COUNTS_STALLED);
+			return TRUE;
+		
+		case 10:
+			io_print(toString(encoder_stalls));
+			io_printLater(STR_TIMES);
+			return TRUE;
+#endif
+		
+#if TIME_CALIBRATE
+		case 11:
+		case 12:
+			return time_calPrint(replyPart - 11);
+#endif
+		
+#if BUS_ENABLE
+		case 13:
+			io_printStr(STR_BUS_ID_IS);
+			io_print(toString(bus_id));
+			io_printLater(STR_NEWLINE);
+			return TRUE;
+#endif
+		
+#if TRIGGER_ENABLE
+		case 14:
+			if (trigger_phase == TRIGGER_IDLE)
+				break;
+			io_printLater(STR_ARMED);
+			return TRUE;
+#endif
+		}
+		replyPart++;
+	}
+#if QUEUE_ENABLE
+	return queue_print(replyPart - INFO_PARTS, TRUE);
+#else
+	return FALSE;
+#endif
+}
+
+// Starts the next part of what the tick task had to report, clears io_notice once there's none left
+void noticeNext() {
+#if TIME_CALIBRATE
+	if (time_calNew) {
+		if (time_calPrint(noticePart)) {
+			noticePart++;
+			return;
+		}
+		time_calNew = FALSE;
+		noticePart = 0;
+		return;
+	}
+#endif
+#if LIMIT_ENABLE
+	if (limit_report) {
+		limit_print();
+		return;
+	}
+#endif
+#if ENCODER_ENABLE
+	if (encoder_report) {
+		encoder_print();
+		return;
+	}
+#endif
+	io_notice = FALSE;
 }
 
 void parseInput(const char * s) {
 	cmd = CMD_NULL;
 	
-	if (strcmp("?", s)) {
+	if (cmdcmp("?", s)) {
 		cmd = CMD_HELP;
 		return;
 	}
 	
-	if (strcmp("help", s)){
+	if (cmdcmp("help", s)){
 		cmd = CMD_HELP;
 		return;
 	}
 	
-	if (strcmp("info", s)){
+	if (cmdcmp("info", s)){
 		cmd = CMD_INFO;
 		return;
 	}
 	
-	if (strcmp("start", s)){
+	if (cmdcmp("start", s)){
 		cmd = CMD_START;
 		return;
 	}
 		
-	if (strcmp("stop", s)){
+	if (cmdcmp("stop", s)){
 		cmd = CMD_STOP;
 		return;
 	}
 	
-	if (strcmp("speed", s)){
+	if (cmdcmp("speed", s)){
 		cmd = CMD_SPEED;
 		pArg = &s[5];
 		return;
 	}
 	
-	if (strcmp("dir", s)){
+	if (cmdcmp("dir", s)){
 		cmd = CMD_DIR;
 		pArg = &s[3];
 		return;
 	}
 	
-	if (strcmp("size", s)) {
+	if (cmdcmp("size", s)) {
 		cmd = CMD_SIZE;
 		pArg = &s[4];
 		return;
 	}
 	
-	if (strcmp("step", s)){
+	if (cmdcmp("step", s)){
 		cmd = CMD_STEP;
 		pArg = &s[4];
 		return;
 	}
+	
+#if PROF_ENABLE
+	if (cmdcmp("prof", s)) {
+		cmd = CMD_PROF;
+		pArg = &s[4];
+		return;
+	}
+#endif
+	
+#if LIMIT_ENABLE
+	if (cmdcmp("home", s)) {
+		cmd = CMD_HOME;
+		return;
+	}
+#endif
+	
+#if MOTOR_PWM
+	if (cmdcmp("rate", s)) {
+		cmd = CMD_RATE;
+		pArg = &s[4];
+		return;
+	}
+#endif
+
+#if TIME_CALIBRATE
+	if (cmdcmp("cal", s)) {
+		cmd = CMD_CAL;
+		return;
+	}
+#endif
+	
+	if (cmdcmp("quiet", s)) {
+		cmd = CMD_QUIET;
+		pArg = &s[5];
+		return;
+	}
+	
+#if BUS_ENABLE
+	if (cmdcmp("id", s)) {
+		cmd = CMD_ID;
+		pArg = &s[2];
+		return;
+	}
+#endif
+	
+#if TRIGGER_ENABLE
+	if (cmdcmp("arm", s)) {
+		cmd = CMD_ARM;
+		return;
+	}
+#endif
+	
+	if (cmdcmp("tasks", s)) {
+		cmd = CMD_TASKS;
+		pArg = &s[5];
+		return;
+	}
+	
+#if ENCODER_ENABLE
+	if (cmdcmp("stall", s)) {
+		cmd = CMD_STALL;
+		pArg = &s[5];
+		return;
+	}
+#endif
+	
+	if (cmdcmp("ack", s)) {
+		cmd = CMD_ACK;
+		pArg = &s[3];
+		return;
+	}
+	
+#if !BUS_ENABLE
+	if (cmdcmp("flow", s)) {
+		cmd = CMD_FLOW;
+		pArg = &s[4];
+		return;
+	}
+#endif
+	
+#if QUEUE_ENABLE
+	if (cmdcmp("at", s)) {
+		cmd = CMD_AT;
+		pArg = &s[2];
+		return;
+	}
+	
+	if (cmdcmp("tick", s)) {
+		cmd = CMD_TICK;
+		return;
+	}
+#endif
+}
+
+bit checkCommand() {
+	uns32 a;
+	
+	// A missing argument is fine, the command just reports the setting then
+	switch (cmd) {
+	
+	case CMD_NULL:
+		return FALSE;
+	
+	case CMD_SPEED:
+		a = stoi(pArg);
+		return !*pArg || (a >= MOTOR_MIN_PERIOD && a <= 65535);
+	
+	case CMD_DIR:
+		return !*pArg || cmdcmp(" cc", pArg) || cmdcmp(" cw", pArg);
+	
+	case CMD_SIZE:
+		return !*pArg || cmdcmp(" full", pArg) || cmdcmp(" half", pArg);
+	
+	case CMD_STEP:
+		return !*pArg || stoi(pArg);
+	
+#if MOTOR_PWM
+	case CMD_RATE:
+		a = stoi(pArg);
+		return a >= MOTOR_PWM_MIN_RATE && a <= MOTOR_PWM_MAX_RATE;
+#endif
+	
+	case CMD_QUIET:
+	case CMD_ACK:
+	case CMD_FLOW:
+		return !*pArg || cmdcmp(" on", pArg) || cmdcmp(" off", pArg);
+	
+#if BUS_ENABLE
+	case CMD_ID:
+		a = stoi(pArg);
+		return !*pArg || (a && a <= 0xFF);
+#endif
+	
+#if ENCODER_ENABLE
+	case CMD_STALL:
+		return !*pArg || stoi(pArg) <= 0xFF;
+#endif
+	
+#if QUEUE_ENABLE
+	case CMD_AT:
+		if (!*pArg || cmdcmp(" clear", pArg))
+			return TRUE;
+		if (!parseAt() || !atAhead() || queue_count + atBatch >= QUEUE_SIZE)
+			return FALSE;
+		atBatch++;	// its room is taken, for the ones after it in the line
+		return TRUE;
+#endif
+	}
+	return TRUE;
+}
+
+// Prints the given part of the batch status line, returns 0 past the last one
+bit printStatus(char part) {
+	// ok <on/off> <cw/cc> <full/half> <period> <steps left> <position>
+	if (part == 1) {
+		io_printStr(STR_SPACE);
+		io_print(toString(motor_steps));
+		io_printStr(STR_SPACE);
+		io_printInt(motor_position);
+		io_printLater(STR_NEWLINE);
+		return TRUE;
+	}
+	if (part)
+		return FALSE;
+	
+	io_printStr(STR_OK);
+	if (motor_enable || motor_counting)
+		io_printStr(STR_RUN_ON);
+	else
+		io_printStr(STR_RUN_OFF);
+	if (motor_nextDirection == MOTOR_COUNTERCLOCKWISE)
+		io_printStr(STR_RUN_CC);
+	else
+		io_printStr(STR_RUN_CW);
+	if (motor_nextSize == MOTOR_FULL_STEP)
+		io_printStr(STR_FULL);
+	else
+		io_printStr(STR_HALF);
+	io_printStr(STR_SPACE);
+	io_print(toString(motor_nextPeriod));
+	return TRUE;
 }
 
 /* *********************************** */
@@ -304,14 +1581,26 @@ void parseInput(const char * s) {
 /*           _____________  _____________ 
             |             \/             |
       +5V---|Vdd        16F690        Vss|---Gnd
-			|RA5            RA0/AN0/(PGD)|
-			|RA4/AN3            RA1/(PGC)|
-            |RA3/!MCLR/(Vpp)  RA2/AN2/INT|
-            |RC5/CCP                  RC0|->-!STEP
+    T1CKI->-|RA5            RA0/AN0/(PGD)|
+            |RA4/AN3            RA1/(PGC)|
+     HOME->-|RA3/!MCLR/(Vpp)  RA2/AN2/INT|-<-TRIGGER
+            |RC5/CCP                  RC0|->-!HSM
             |RC4                      RC1|->-DIR
-            |RC3/AN7                  RC2|->-!HSM
-            |RC6/AN8             AN10/RB4|
-            |RC7/AN9               RB5/Rx|-<-UART_IN
- UART_OUT-<-|RB7/Tx                   RB6|
+       DE-<-|RC3/AN7                  RC2|->-!STEP
+      ID0->-|RC6/AN8             AN10/RB4|-<-LIMIT_CCW
+      ID1->-|RC7/AN9               RB5/Rx|-<-UART_IN
+ UART_OUT-<-|RB7/Tx                   RB6|-<-LIMIT_CW
+            |____________________________|                                      
+*/ 
+/*           _____________  _____________ 
+            |             \/             |
+    COIL<---|PB2        PBD3517       VCC|---+6V
+    COIL<---|PB1                      VSS|
+      Gnd---|GND                       LB|
+    COIL<---|PA1                       LA|
+    COIL<---|PA2                       RC|
+      RC1->-|DIR                      INH|---Gnd
+      RC2->-|!STEP                   !HSM|-<-RC0
+            |OB                        OA|
             |____________________________|                                      
-*/ 
\ No newline at end of file
+*/
\ No newline at end of file
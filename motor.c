@@ -3,7 +3,53 @@
 
 #define MOTOR_DELAY() time_wait(1)
 
+int32 motor_position;
+unsigned long motor_nextPeriod;
+bit motor_nextDirection;
+bit motor_nextSize;
+bit motor_pending;
+
+#if MOTOR_PWM
+bit motor_pwm;
+unsigned long motor_pwmCycles;
+
+// Register values for the next period, worked out by motor_pwmPrepare() so that the interrupt only copies them
+unsigned long motor_pwmNextCycles;
+char motor_pwmPR2;
+char motor_pwmT2CON;
+char motor_pwmDuty;			// CCPR1L
+bit motor_pwmDC1B;			// DC1B1, DC1B0 is always 0 for 50% duty
+bit motor_pwmSecond;		// motor_pwmUpdate() did the first half of the switch
+
+#if MOTOR_PWM_COUNT
+unsigned long motor_pwmSteps;	// used by the interrupt only
+
+// Add the steps Timer1 counted to motor_position, n is a 16-bit variable to use
+#define MOTOR_PWM_COUNT_STEPS(n)	T1CON.0 = 0;				\
+									n.high8 = TMR1H;			\
+									n.low8 = TMR1L;				\
+									TMR1H = 0;					\
+									TMR1L = 0;					\
+									T1CON.0 = 1;				\
+									if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)	\
+										motor_position += n;	\
+									else						\
+										motor_position -= n
+#else
+#define MOTOR_PWM_COUNT_STEPS(n)
+#endif // MOTOR_PWM_COUNT
+
+#endif // MOTOR_PWM
+
 void motor_init() {
+	motor_position = 0;
+	motor_pending = 0;
+	
+#if MOTOR_PWM
+	motor_pwm = 0;
+	PSTRCON = 0;		// RC2 belongs to PORTC until a hardware run is started
+#endif
+	
 	TRISC &= ~0b111;	// '11111000' for outputs at motor-related pins
 	PORTC &= ~0b111;	// 'xxxxx000' for initial value
 }
@@ -12,6 +58,167 @@ void motor_step() {
 	PORT_MOTOR_STEP = 1;
 	MOTOR_DELAY();
 	PORT_MOTOR_STEP = 0;
+	
+	if (PORT_MOTOR_DIRECTION == MOTOR_CLOCKWISE)
+		motor_position++;
+	else
+		motor_position--;
+	encoder_step();
+}
+
+void motor_latch() {
+	char i;
+	
+	motor_period = motor_nextPeriod;
+	motor_pending = 0;
+	
+	if (PORT_MOTOR_DIRECTION == motor_nextDirection && PORT_MOTOR_STEP_SIZE == motor_nextSize)
+		return;
+	
+	PORT_MOTOR_DIRECTION = motor_nextDirection;
+	PORT_MOTOR_STEP_SIZE = motor_nextSize;
+	for (i = MOTOR_SETTLE; i; i--);	// setup time of the driver
+}
+
+#if MOTOR_PWM
+
+// Works out register values for the given period, returns 0 if ECCP can't make it
+bit motor_pwmPrepare(unsigned long cycles) {
+	char prescale = 0b00;
+	
+	if (cycles < MOTOR_PWM_MIN_CYCLES || cycles > MOTOR_PWM_MAX_CYCLES)
+		return FALSE;
+	
+	motor_pwmNextCycles = cycles;
+	
+	// Timer2 counts to 256 at most, so slow periods need the prescaler
+	if (cycles > 1024) {
+		cycles >>= 4;
+		prescale = 0b10;	// 1:16
+	} else if (cycles > 256) {
+		cycles >>= 2;
+		prescale = 0b01;	// 1:4
+	}
+	
+	/*
+		Period = (PR2 + 1) * prescale cycles
+		Duty = (CCPR1L:DC1B) / 4 * prescale cycles, so for 50% duty CCPR1L:DC1B = 2 * (PR2 + 1)
+	*/
+	motor_pwmPR2 = cycles - 1;
+	motor_pwmT2CON = 0b100 | prescale;
+	motor_pwmDuty = cycles >> 1;
+	motor_pwmDC1B = cycles & 1;
+	return TRUE;
 }
 
+bit motor_pwmStart(unsigned long cycles) {
+	if (!motor_pwmPrepare(cycles))
+		return FALSE;
+	
+	motor_pwmStop();
+	motor_latch();
+	
+	motor_pwmCycles = cycles;
+	PR2 = motor_pwmPR2;
+	CCPR1L = motor_pwmDuty;
+	CCP1CON = 0b00001100;	// single output PWM, active high
+	CCP1CON.5 = motor_pwmDC1B;
+	
+#if MOTOR_PWM_COUNT
+	time_calCancel();		// Timer1 is ours now
+	TRISA.5 = 1;
+	TMR1H = 0;
+	TMR1L = 0;
+	T1CON = 0b00000011;		// Timer1 on, counting rising edges on T1CKI
+#endif
+	
+	TMR2 = 0;
+	TMR2IF = 0;
+	TMR2IE = 0;
+	PEIE = 1;
+	T2CON = motor_pwmT2CON;
+	PSTRCON = 0b00011000;	// steer the output to P1D (RC2), starting with the next period
+	
+	motor_pwm = 1;
+	return TRUE;
+}
+
+bit motor_pwmRetune(unsigned long cycles) {
+	while (TMR2IE);			// let a switch in progress finish (two periods at most), it's using the prepared values
+	
+	if (!motor_pwmPrepare(cycles))
+		return FALSE;
+	
+	motor_pwmSecond = 0;
+	TMR2IF = 0;				// start at the next period boundary
+	TMR2IE = 1;
+	return TRUE;
+}
+
+void motor_pwmUpdate() {
+	/*
+		The rising edge of a period is the step. Duty (CCPR1L:DC1B) is double buffered and
+		only used from the period after the one that just started, while PR2 is used right away.
+		So duty is written on one boundary and PR2 on the next, and both apply to the same period.
+		If DIR or !HSM change, that period is made without a pulse and they change at its start,
+		a whole period before the next step.
+	*/
+	TMR2IF = 0;
+	
+	if (!motor_pwmSecond) {
+		if (PORT_MOTOR_DIRECTION != motor_nextDirection || PORT_MOTOR_STEP_SIZE != motor_nextSize) {
+			CCPR1L = 0;
+			CCP1CON.5 = 0;
+		} else {
+			CCPR1L = motor_pwmDuty;
+			CCP1CON.5 = motor_pwmDC1B;
+		}
+		motor_pwmSecond = 1;
+		return;
+	}
+	
+	T2CON = motor_pwmT2CON;
+	PR2 = motor_pwmPR2;
+	if (TMR2 >= motor_pwmPR2)
+		TMR2 = motor_pwmPR2;	// we got here too late for a short period, end it now rather than after a wrap
+	
+	if (PORT_MOTOR_DIRECTION != motor_nextDirection || PORT_MOTOR_STEP_SIZE != motor_nextSize) {
+		MOTOR_PWM_COUNT_STEPS(motor_pwmSteps);	// no pulse in this period, so the count is settled
+		PORT_MOTOR_DIRECTION = motor_nextDirection;
+		PORT_MOTOR_STEP_SIZE = motor_nextSize;
+		CCPR1L = motor_pwmDuty;
+		CCP1CON.5 = motor_pwmDC1B;
+	}
+	
+	motor_pwmCycles = motor_pwmNextCycles;
+	motor_pwmSecond = 0;
+	TMR2IE = 0;
+}
+
+void motor_pwmStop() {
+#if MOTOR_PWM_COUNT
+	unsigned long n;
+#endif
+	
+	if (!motor_pwm)
+		return;
+	
+	// Any bit write of PORTC while P1D drove RC2 copied its level into the latch, so the latch is cleared
+	// before the pin goes back to it, with the interrupt that writes DIR and HSM out of the way
+	TMR2IE = 0;
+	PORT_MOTOR_STEP = 0;
+	PSTRCON = 0;			// RC2 is PORT_MOTOR_STEP again
+	CCP1CON = 0;
+	T2CON = 0;
+	
+	MOTOR_PWM_COUNT_STEPS(n);
+#if MOTOR_PWM_COUNT
+	T1CON = 0;
+#endif
+	motor_pwm = 0;
+	motor_pwmSecond = 0;
+}
+
+#endif // MOTOR_PWM
+
 #endif // !_SOURCE_MOTOR
\ No newline at end of file
@@ -19,12 +19,80 @@
 
 #pragma bit PORT_MOTOR_STEP_SIZE	@ PORTC.0	// Should be either MOTOR_FULL_STEP or MOTOR_HALF_STEP
 #pragma bit PORT_MOTOR_DIRECTION	@ PORTC.1	// Should be either MOTOR_CLOCKWISE or MOTOR_COUNTERCLOCKWISE
-#pragma bit PORT_MOTOR_STEP			@ PORTC.2	// Used internally by motor_step()
+#pragma bit PORT_MOTOR_STEP			@ PORTC.2	// Used internally by motor_step(), also P1D output of ECCP
+
+#define MOTOR_SETTLE_US		15		// time between changing DIR or !HSM and the next step
+#define MOTOR_SETTLE		((MOTOR_SETTLE_US * (TIME_CYCLE_RATE / 1000) + 2999) / 3000)	// delay loop passes (3 cycles each)
+
+#define MOTOR_MIN_STEP_US	1920	// shortest step period the motor is rated for
+#define MOTOR_MIN_PERIOD	((MOTOR_MIN_STEP_US + TIME_TICK_US - 1) / TIME_TICK_US)	// the same in ticks
+
+// Set to 1 to let ECCP generate the steps of continuous runs that are fast enough
+#ifndef MOTOR_PWM
+#define MOTOR_PWM 0
+#endif
+
+// Set to 0 if STEP (RC2) isn't wired to T1CKI (RA5), steps made by ECCP won't be counted in motor_position then
+#ifndef MOTOR_PWM_COUNT
+#define MOTOR_PWM_COUNT 1
+#endif
+
+#define MOTOR_PWM_MIN_CYCLES	64		// shortest step period ECCP is allowed to make (in instruction cycles)
+#define MOTOR_PWM_MAX_CYCLES	4096	// longest step period ECCP can make (Timer2 with 1:16 prescale)
+#define MOTOR_PWM_MIN_RATE		(TIME_CYCLE_RATE / MOTOR_PWM_MAX_CYCLES + 1)	// rate command range, in steps per second
+#define MOTOR_PWM_MAX_RATE		(TIME_CYCLE_RATE / MOTOR_PWM_MIN_CYCLES)
+
+#if MOTOR_PWM && MOTOR_PWM_MAX_RATE > 65535
+#error The rate command can't take rates ECCP makes at CONFIG_F_OSC, raise MOTOR_PWM_MIN_CYCLES
+#endif
+
+// Position in steps, counted up for clockwise steps and down for counterclockwise ones
+extern int32 motor_position;
+
+/*
+	Commands don't touch the period, DIR and !HSM directly, they set these and motor_pending instead.
+	The step engine switches to them at the next step (motor_latch()), so no step is cut short or made with DIR changing.
+*/
+extern unsigned long motor_nextPeriod;
+extern bit motor_nextDirection;
+extern bit motor_nextSize;
+extern bit motor_pending;
 
 // Initialize motor-related pins
 void motor_init();
 
-// Run a single step
+// Run a single step and count it in motor_position
 void motor_step();
 
+// Switch to the next period, direction and step size, is to be called right before a step (or while stopped)
+void motor_latch();
+
+#if MOTOR_PWM
+
+// 1 while ECCP is generating steps
+extern bit motor_pwm;
+
+// Step period ECCP is running with (in instruction cycles)
+extern unsigned long motor_pwmCycles;
+
+// Start generating a step every given number of instruction cycles in hardware
+// Returns 0 (and leaves the motor alone) if ECCP can't make that period
+bit motor_pwmStart(unsigned long cycles);
+
+// Switch a running ECCP to the given period and to the next direction and step size at a period boundary
+// Returns 0 (and changes nothing) if ECCP can't make that period
+bit motor_pwmRetune(unsigned long cycles);
+
+// Is to be called on Timer2 interrupt, does the switching for motor_pwmRetune()
+void motor_pwmUpdate();
+
+// Stop generating steps and count the ones that were made
+void motor_pwmStop();
+
+#else
+
+#define motor_pwmStop()
+
+#endif // MOTOR_PWM
+
 #endif // !_HEAD_MOTOR
\ No newline at end of file
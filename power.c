@@ -0,0 +1,118 @@
+#ifndef _SOURCE_POWER
+#define _SOURCE_POWER
+
+uns32 power_sleeps;
+uns32 power_idleTicks;
+uns32 power_asleep;
+
+void power_init() {
+	power_sleeps = 0;
+	power_idleTicks = 0;
+	power_asleep = 0;
+}
+
+void power_sleep() {
+	char c, i;
+	bit slept = 0;
+#if BUS_ENABLE
+	bit address;
+#endif
+	bit rabie = RABIE;	// limit switches may be using interrupt-on-change too
+	
+	while (!TRMT);		// let the last character leave the shift register
+	
+	T0IE = 0;			// stop the tick, nothing needs it while we sleep
+	GIE = 0;			// wake up right after SLEEP instead of going to int_server()
+	if (!RCIDL || RCIF) {	// a character started coming in since io_idle(), it's EUSART's
+		T0IE = 1;
+		GIE = 1;
+		return;
+	}
+	CREN = 0;			// EUSART can't catch a start bit across the wake-up, we'll receive the first byte ourselves
+	
+	/*
+		We wake up on interrupt-on-change of RB5/Rx, that is on the falling edge of the start bit.
+		EUSART's own wake-up (WUE) would throw the first byte away, so we don't use it.
+		The watchdog wakes us up every POWER_WDT_TICKS or so as well, counting those tells how long we slept.
+	*/
+	WDTCON = POWER_WDTCON;
+	c = PORTB;			// end the mismatch condition
+	RABIF = 0;
+	IOCB.5 = 1;
+	RABIE = 1;
+	
+	// Timer2 will overflow once every bit, first time in the middle of the start bit.
+	// It's loaded before we sleep, all there's left to do after the wake-up is to start it.
+	PR2 = POWER_BIT_CYCLES - 1;
+	TMR2 = POWER_BIT_CYCLES / 2 + POWER_WAKE_CYCLES;
+	TMR2IF = 0;
+	
+	if (c.5) {			// unless the line is low already, then a start bit is under way and we go straight on
+		for (;;) {
+			sleep();
+			T2CON = 0b100;	// 1:1 prescale and postscale, timer on
+			if (TO)
+				break;	// SLEEP set it and the watchdog didn't clear it, so it's the start bit
+			power_asleep += POWER_WDT_TICKS;
+			if (RABIF)
+				break;	// it came while the watchdog woke us, a little after where Timer2 counts from
+			T2CON = 0;
+			TMR2 = POWER_BIT_CYCLES / 2 + POWER_WAKE_CYCLES;
+		}
+		slept = 1;
+	} else
+		T2CON = 0b100;
+	
+	while (!TMR2IF);
+	TMR2IF = 0;
+	
+	if (!PORTB.5) {		// still low, so it's a start bit and not a glitch
+		c = 0;
+		for (i = 0; i < 8; i++) {
+			while (!TMR2IF);
+			TMR2IF = 0;
+			c >>= 1;	// LSB comes first
+			if (PORTB.5)
+				c.7 = 1;
+		}
+		
+#if BUS_ENABLE
+		while (!TMR2IF);	// 9th bit, set for address bytes
+		TMR2IF = 0;
+		address = PORTB.5;
+#endif
+		
+		while (!TMR2IF);	// middle of the stop bit
+#if BUS_ENABLE
+		if (PORTB.5) {
+			if (address)
+				bus_address(c);
+			else if (!ADDEN)
+				io_pending = c;	// part of a frame for us, the rest of it comes through EUSART
+		}
+#else
+		if (PORTB.5)
+			io_pending = c;	// io_getInput() will pick it up before anything else
+#endif
+	}
+	
+	T2CON = 0;
+	CREN = 1;			// we're in the stop bit, EUSART will see the next start bit
+	WDTCON = POWER_WDTCON & ~1;	// SLEEP cleared it, a byte takes no time next to its period
+	
+	IOCB.5 = 0;
+	RABIE = rabie;
+	c = PORTB;
+	RABIF = 0;
+	
+	TMR0 = TIME_RESET;	// restart the tick
+	IF_TIME = 0;
+	T0IE = 1;
+	GIE = 1;
+	
+	power_sleeps++;
+	if (slept)
+		power_asleep += POWER_WDT_TICKS / 2;	// the start bit came about halfway through a period
+}
+
+#endif // !_SOURCE_POWER
\ No newline at end of file
@@ -0,0 +1,54 @@
+/*
+
+	Power management.
+	Puts the controller to sleep while the motor is stopped and nothing is being received.
+	
+*/
+
+#ifndef _HEAD_POWER
+#define _HEAD_POWER
+
+// Set to 0 to keep the core loop spinning while the motor is stopped
+// On a bus every character would wake us, address detection only spares the ones awake (see bus.h)
+#ifndef POWER_IDLE_SLEEP
+#if BUS_ENABLE
+#define POWER_IDLE_SLEEP 0
+#else
+#define POWER_IDLE_SLEEP 1
+#endif
+#endif
+
+#define POWER_BIT_CYCLES	(IO_BRG + 1)	// instruction cycles per UART bit, the same as EUSART's (see IO_BRG)
+#define POWER_WAKE_CYCLES	12		// rough cycles between the start bit edge and the first instruction after SLEEP
+
+/*
+	The tick stops in sleep, the watchdog times it instead. It runs on LFINTOSC (31 kHz, 15% either way), so the
+	time asleep is a rough figure: whole watchdog periods and half of the one the start bit came in. Every time-out
+	wakes the controller for a few instructions, a longer period makes fewer of them but a rougher figure.
+*/
+#define POWER_WDTPS			7		// watchdog period 32 << 7 LFINTOSC cycles, about 132 ms
+#define POWER_WDTCON		((POWER_WDTPS << 1) | 1)	// SWDTEN, the configuration word leaves the watchdog off
+#define POWER_LFINTOSC		31000
+#define POWER_WDT_TICKS		(((32L << POWER_WDTPS) * 1000000 / POWER_LFINTOSC + TIME_TICK_US / 2) / TIME_TICK_US)	// 206
+
+#if POWER_IDLE_SLEEP && POWER_BIT_CYCLES > 256
+#error A UART bit is too long for Timer2 at CONFIG_F_OSC and CONFIG_BAUD, set POWER_IDLE_SLEEP to 0
+#endif
+
+// Number of times the controller slept until a character came
+extern uns32 power_sleeps;
+
+// Number of ticks the controller spent awake with nothing to do
+extern uns32 power_idleTicks;
+
+// About how many ticks it would have counted while asleep
+extern uns32 power_asleep;
+
+// Initialize the counters
+void power_init();
+
+// Stop the tick and sleep until a byte starts arriving on RX, then receive that byte in software
+// Returns with the tick running again and the byte handed to io_getInput(), or right away if EUSART already has one coming in
+void power_sleep();
+
+#endif // !_HEAD_POWER
\ No newline at end of file
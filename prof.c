@@ -0,0 +1,51 @@
+#ifndef _SOURCE_PROF
+#define _SOURCE_PROF
+
+#if PROF_ENABLE
+
+char prof_region;
+unsigned long prof_min;
+unsigned long prof_max;
+unsigned long prof_start;
+unsigned long prof_last;
+
+void prof_init() {
+	T1CON = 0b00000001;		// Timer1 on, internal clock (one count per instruction cycle), 1:1 prescale
+	prof_select(PROF_ISR);
+}
+
+void prof_select(char r) {
+	prof_min = 0xFFFF;
+	prof_max = 0;
+	prof_region = r | PROF_WAIT;
+}
+
+bit prof_print(char part) {
+	char r;
+	
+	if (part)
+		return FALSE;
+	
+	r = prof_region & ~PROF_WAIT;
+	if (r == PROF_ISR)
+		io_printStr(STR_PROF_ISR);
+	else if (r == PROF_CHECK)
+		io_printStr(STR_PROF_CHECK);
+	else if (r == PROF_CMD)
+		io_printStr(STR_PROF_CMD);
+	else
+		io_printStr(STR_PROF_TICK);
+	
+	if (prof_max) {
+		io_print(toString(prof_min));
+		io_printStr(STR_SLASH);
+		io_print(toString(prof_max));
+		io_printLater(STR_PROF_CYCLES);
+	} else
+		io_printLater(STR_PROF_NO_SAMPLES);
+	return TRUE;
+}
+
+#endif // PROF_ENABLE
+
+#endif // !_SOURCE_PROF
\ No newline at end of file
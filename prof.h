@@ -0,0 +1,90 @@
+/*
+
+	Cycle profiling.
+	Measures how many instruction cycles regions of code take, using Timer1 as a cycle counter.
+	Everything here compiles to nothing unless PROF_ENABLE is set.
+	
+*/
+
+#ifndef _HEAD_PROF
+#define _HEAD_PROF
+
+// Set to 1 to build with profiling (uses Timer1)
+#ifndef PROF_ENABLE
+#define PROF_ENABLE 0
+#endif
+
+// Profiled regions
+#define PROF_ISR		0	// int_server()
+#define PROF_CHECK		1	// splitting a line and checking it before it runs (only a batch, or with acks on)
+#define PROF_CMD		2	// command handlers, all of a line's
+#define PROF_TICK		3	// tick section of the core loop
+#define PROF_REGIONS	4
+
+#if PROF_ENABLE
+
+#if MOTOR_PWM && MOTOR_PWM_COUNT
+#error "Profiling and counting hardware steps both need Timer1"
+#endif
+
+// One region is measured at a time, the prof command selects it
+// PROF_WAIT is set in prof_region until the region starts after that, so a half counted run isn't a sample
+#define PROF_WAIT		0x80
+extern char prof_region;
+
+// Cycle counts of the region, min and max are exact
+// Regions in the core loop include the time spent in int_server() while they ran
+// Counts wrap at 65536 cycles
+extern unsigned long prof_min;
+extern unsigned long prof_max;
+
+// Start stamp and last sample of the region, these are used by the macros below
+extern unsigned long prof_start;
+extern unsigned long prof_last;
+
+// Read Timer1 into a 16-bit variable, re-reading if the high byte changed underneath us
+#define PROF_READ(v)	do { v.high8 = TMR1H; v.low8 = TMR1L; } while (v.high8 != TMR1H)
+
+// These are macros and not functions, because Cc5x won't let int_server() share functions with main()
+#define PROF_BEGIN(r)	if ((prof_region | PROF_WAIT) == (r | PROF_WAIT)) {		\
+							prof_region = r;								\
+							PROF_READ(prof_start);							\
+						}
+#define PROF_END(r)		if (prof_region == r) {								\
+							PROF_READ(prof_last);							\
+							prof_last -= prof_start;						\
+							if (prof_last < prof_min)						\
+								prof_min = prof_last;						\
+							if (prof_last > prof_max)						\
+								prof_max = prof_last;						\
+						}
+
+// A region that runs over several passes of the core loop (a line's commands) stops counting in between
+#define PROF_PAUSE(r)	if (prof_region == r) {								\
+							PROF_READ(prof_last);							\
+							prof_last -= prof_start;						\
+						}
+#define PROF_RESUME(r)	if (prof_region == r) {								\
+							PROF_READ(prof_start);							\
+							prof_start -= prof_last;						\
+						}
+
+// Start Timer1 and measure the interrupt
+void prof_init();
+
+// Measures region r from its next start on, without what was counted so far
+void prof_select(char r);
+
+// Prints min/max of the region, returns 0 past that part
+bit prof_print(char part);
+
+#else
+
+#define PROF_BEGIN(r)
+#define PROF_END(r)
+#define PROF_PAUSE(r)
+#define PROF_RESUME(r)
+
+#endif // PROF_ENABLE
+
+#endif // !_HEAD_PROF
\ No newline at end of file
@@ -0,0 +1,138 @@
+#ifndef _SOURCE_QUEUE
+#define _SOURCE_QUEUE
+
+#if QUEUE_ENABLE
+
+char queue_count;
+unsigned long queue_tick[QUEUE_SIZE];
+char queue_cmd[QUEUE_SIZE];
+unsigned long queue_arg[QUEUE_SIZE];
+unsigned long queue_late;
+bit queue_timed;
+char queue_nextCmd;
+unsigned long queue_nextArg;
+
+void queue_init() {
+	queue_count = 0;
+	queue_late = 0;
+	queue_timed = FALSE;
+}
+
+void queue_clear() {
+	queue_count = 0;
+	queue_timed = FALSE;
+}
+
+// How far off a deadline is, one that has passed is due now
+unsigned long queue_ahead(unsigned long tick, unsigned long now) {
+	tick -= now;
+	if (tick & 0x8000)
+		return 0;
+	return tick;
+}
+
+bit queue_add(unsigned long tick, char cmd, unsigned long arg) {
+	char i;
+	unsigned long now = time_now();	// once, the interrupt moves it on
+	unsigned long ahead = queue_ahead(tick, now);
+
+	if (queue_count == QUEUE_SIZE)
+		return FALSE;
+
+	// The ones that are due sooner (or as soon, they came first) move up to make room
+	for (i = queue_count; i; i--) {
+		if (queue_ahead(queue_tick[i - 1], now) > ahead)
+			break;
+		queue_tick[i] = queue_tick[i - 1];
+		queue_cmd[i] = queue_cmd[i - 1];
+		queue_arg[i] = queue_arg[i - 1];
+	}
+	queue_tick[i] = tick;
+	queue_cmd[i] = cmd;
+	queue_arg[i] = arg;
+	queue_count++;
+	return TRUE;
+}
+
+bit queue_due(unsigned long tick) {
+	if (!queue_count)
+		return FALSE;
+	tick -= queue_tick[queue_count - 1];
+	return !(tick & 0x8000);	// it's not ahead of the tick
+}
+
+void queue_take(unsigned long tick) {
+	queue_count--;
+	if (queue_tick[queue_count] != tick)
+		queue_late++;
+	queue_nextCmd = queue_cmd[queue_count];
+	queue_nextArg = queue_arg[queue_count];
+}
+
+// Two parts for the count, then one for each command
+bit queue_print(char part, bit list) {
+	char i;
+
+	if (part == 0) {
+		io_printStr(STR_TICK_IS);
+		io_print(toString(time_now()));
+		io_printStr(STR_COMMA);
+		io_print(toString(queue_count));
+		io_printLater(STR_QUEUED_LATE);
+		return TRUE;
+	}
+	if (part == 1) {
+		io_print(toString(queue_late));
+		io_printLater(STR_TIMES);
+		return TRUE;
+	}
+	part -= 2;
+	if (!list || part >= queue_count)
+		return FALSE;	// the tick task may have taken some off since the first part
+
+	i = queue_count - 1 - part;
+	io_printStr(STR_AT);
+	io_print(toString(queue_tick[i]));
+	switch (queue_cmd[i]) {
+
+	case CMD_START:
+		io_printStr(STR_AT_START);
+	break;
+
+	case CMD_STOP:
+		io_printStr(STR_AT_STOP);
+	break;
+
+	case CMD_SPEED:
+		io_printStr(STR_AT_SPEED);
+		io_print(toString(queue_arg[i]));
+	break;
+
+	case CMD_DIR:
+		io_printStr(STR_AT_DIR);
+		if (queue_arg[i] == MOTOR_COUNTERCLOCKWISE)
+			io_printStr(STR_CC);
+		else
+			io_printStr(STR_CW);
+	break;
+
+	case CMD_SIZE:
+		io_printStr(STR_AT_SIZE);
+		if (queue_arg[i] == MOTOR_FULL_STEP)
+			io_printStr(STR_FULL);
+		else
+			io_printStr(STR_HALF);
+	break;
+
+	case CMD_STEP:
+		io_printStr(STR_AT_STEP);
+		io_print(toString(queue_arg[i]));
+	break;
+	}
+	io_printLater(STR_NEWLINE);
+	return TRUE;
+}
+
+#endif // QUEUE_ENABLE
+
+#endif // !_SOURCE_QUEUE
\ No newline at end of file
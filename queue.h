@@ -0,0 +1,78 @@
+/*
+
+	Timed commands.
+	"at <tick> <command>" holds a start, stop, speed, dir, size or step until time_tick gets to <tick>, and
+	"at +<n> <command>" until n ticks from now. The tick task runs it then, on the tick it's for however long
+	the line took to come in. It does what it does when typed, a new speed, direction or step size still
+	waits for the step that's under way, only a move from standstill makes its first step on that tick.
+	"tick" tells the host the current tick to plan against. It wraps every 65536 ticks (about 42 s), so a
+	deadline is to be 1 to QUEUE_AHEAD ticks away when it's queued.
+
+	Replies go out between ticks (see sched.h), but a line waits for the reply to the one before it, quiet on
+	keeps them short. The queue keeps count of commands that ran after their tick anyway.
+
+	The tick stops while the controller sleeps (see power.h). Once the host has read it with tick or at, the
+	controller stays awake so that the tick goes on counting with the host's clock, until "at clear" says
+	the host is done with it.
+
+	The queue is kept in order of deadline with the next one last, so the tick task only takes off the end.
+
+*/
+
+#ifndef _HEAD_QUEUE
+#define _HEAD_QUEUE
+
+// Set to 0 to leave out at and tick
+#ifndef QUEUE_ENABLE
+#define QUEUE_ENABLE 1
+#endif
+
+// Commands that may wait at once, every one takes 5 bytes of RAM
+#ifndef QUEUE_SIZE
+#define QUEUE_SIZE		4
+#endif
+
+#define QUEUE_AHEAD		32767	// furthest a deadline may be, half the wrap so that it can't be mistaken for a past one
+
+#if QUEUE_ENABLE
+
+extern char queue_count;
+extern unsigned long queue_tick[QUEUE_SIZE];	// deadlines, the next one at queue_count - 1
+extern char queue_cmd[QUEUE_SIZE];				// Command
+extern unsigned long queue_arg[QUEUE_SIZE];		// period, steps, or MOTOR_ direction or step size
+extern unsigned long queue_late;				// commands that ran after their tick
+extern bit queue_timed;							// the host reads the tick, it's to keep counting
+
+// What queue_take() took off
+extern char queue_nextCmd;
+extern unsigned long queue_nextArg;
+
+// Empty the queue and the count of late ones
+void queue_init();
+
+// Forget what's waiting, and that the host reads the tick
+void queue_clear();
+
+// Add a command to run on the given tick, after any that are for the same one (a tick that has passed counts as now),
+// returns 0 if it's full
+bit queue_add(unsigned long tick, char cmd, unsigned long arg);
+
+// Returns 1 if the next command is for the given tick or one before it
+bit queue_due(unsigned long tick);
+
+// Takes the next command off into queue_nextCmd and queue_nextArg, the tick is the one it's run on
+void queue_take(unsigned long tick);
+
+// Prints the given part of the current tick and how many are waiting, and with list set of what they are, in the
+// order they'll run, returns 0 past the last one
+bit queue_print(char part, bit list);
+
+#else
+
+#define queue_count		0
+#define queue_timed		0
+#define queue_clear()
+
+#endif // QUEUE_ENABLE
+
+#endif // !_HEAD_QUEUE
\ No newline at end of file
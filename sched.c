@@ -0,0 +1,78 @@
+#ifndef _SOURCE_SCHED
+#define _SOURCE_SCHED
+
+unsigned long sched_overruns[SCHED_TASKS];
+char sched_worst[SCHED_TASKS];
+unsigned long sched_since[SCHED_TASKS];
+unsigned long sched_tick;
+bit sched_line;
+bit sched_reply;
+
+const char sched_deadline[] = { SCHED_TICK_DEADLINE, 0, SCHED_COMMAND_DEADLINE, SCHED_CONSOLE_DEADLINE };
+
+void sched_init() {
+	char t;
+	
+	for (t = 0; t < SCHED_TASKS; t++) {
+		sched_overruns[t] = 0;
+		sched_worst[t] = 0;
+	}
+}
+
+char sched_next() {
+	if (sched_tick != time_now())
+		return SCHED_TICK;
+	if (io_received())
+		return SCHED_INPUT;		// even while a reply goes out, the next line waits behind it
+	if (sched_line)
+		return SCHED_COMMAND;
+	if ((sched_reply || io_later || io_notice) && TXIF)
+		return SCHED_CONSOLE;	// a notice goes out between replies
+	return SCHED_IDLE;
+}
+
+void sched_account(char task) {
+	unsigned long late = time_now() - sched_since[task];
+	
+	if (late > sched_deadline[task])
+		sched_overruns[task]++;
+	if (late > 0xFF)
+		late = 0xFF;
+	if (late.low8 > sched_worst[task])
+		sched_worst[task] = late.low8;
+}
+
+// Two parts per task, the overruns and the worst one
+bit sched_print(char part) {
+	char t = part >> 1;
+	
+	if (t >= SCHED_TASKS)
+		return FALSE;
+	
+	if (part & 1) {
+		if (t != SCHED_INPUT) {		// the receiver overran, by how much it can't tell
+			io_print(toString(sched_worst[t]));
+			io_printLater(STR_TICKS);
+		}
+		return TRUE;
+	}
+	
+	if (t == SCHED_TICK)
+		io_printStr(STR_TASK_TICK);
+	else if (t == SCHED_INPUT)
+		io_printStr(STR_TASK_INPUT);
+	else if (t == SCHED_COMMAND)
+		io_printStr(STR_TASK_COMMAND);
+	else
+		io_printStr(STR_TASK_CONSOLE);
+	
+	io_printStr(STR_LATE);
+	io_print(toString(sched_overruns[t]));
+	if (t == SCHED_INPUT)
+		io_printLater(STR_TIMES);
+	else
+		io_printLater(STR_TIMES_WORST);
+	return TRUE;
+}
+
+#endif // !_SOURCE_SCHED
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+
+	Core loop scheduler.
+	The core loop is a short list of tasks in order of priority. Every pass runs the first one that is ready and starts
+	over, so a task waits for the ones above it and for one run of one below it at most, nothing is preempted.
+	Stepping comes first and the console last, and only the console prints. The command task checks and runs a line a
+	command a pass, so the tick goes on in between, and leaves its reply to the console task, which prints it a part
+	at a time and sends it a character at a time whenever the transmitter has room for one (see io.h), so no reply
+	holds stepping up however long it is. What the tick task has to report (io_notice) goes out the same way, between
+	replies. Input goes on all the while, the next lines wait behind the one that runs in io_in and the command task
+	takes them once its reply is out.
+
+	Every task has a deadline, the ticks it may wait from becoming ready to running. Running later than that is an
+	overrun, the tasks command prints how many each task had and how late the worst one was.
+
+*/
+
+#ifndef _HEAD_SCHED
+#define _HEAD_SCHED
+
+// Tasks, in order of priority
+#define SCHED_TICK		0	// once a tick: the trigger, limit switches, calibration and the step
+#define SCHED_INPUT		1	// takes characters out of the receiver
+#define SCHED_COMMAND	2	// checks and runs a received line, a command at a time
+#define SCHED_CONSOLE	3	// puts out replies and notices
+#define SCHED_IDLE		4	// sleeps if it may, it runs when nothing else is ready
+#define SCHED_TASKS		4	// the ones with a deadline, idle has none
+
+// A character on the line in ticks, rounded up
+#if BUS_ENABLE
+#define SCHED_CHAR_TICKS	((11 * 1000000 / CONFIG_BAUD + TIME_TICK_US - 1) / TIME_TICK_US)
+#else
+#define SCHED_CHAR_TICKS	((10 * 1000000 / CONFIG_BAUD + TIME_TICK_US - 1) / TIME_TICK_US)
+#endif
+
+// Deadlines in ticks, input has none of its own, its overruns are the receiver's (OERR)
+#define SCHED_TICK_DEADLINE		0						// any later and a step is late
+#define SCHED_COMMAND_DEADLINE	(2 * SCHED_CHAR_TICKS)	// from its end, the end of the reply before it or its last pass
+#define SCHED_CONSOLE_DEADLINE	(2 * SCHED_CHAR_TICKS)	// from the last character of a reply, TXREG and the shift register run dry after that
+
+// Overruns per task, and the worst lateness in ticks (up to 255)
+extern unsigned long sched_overruns[SCHED_TASKS];
+extern char sched_worst[SCHED_TASKS];
+
+// The tick each task became ready at, whatever makes a task ready sets it
+extern unsigned long sched_since[SCHED_TASKS];
+
+// The last tick the tick task ran for
+extern unsigned long sched_tick;
+
+// A line is waiting for the command task, or it's part way through it
+extern bit sched_line;
+
+// The line has run and the console task is putting out its reply, the next line waits in io_in for it to end
+extern bit sched_reply;
+
+// Reset the counters
+void sched_init();
+
+// Returns the first task that is ready
+char sched_next();
+
+// Is to be called as a task runs, counts an overrun if it's past its deadline
+void sched_account(char task);
+
+// Prints the given part of the overruns of every task, returns 0 past the last one
+bit sched_print(char part);
+
+#endif // !_HEAD_SCHED
\ No newline at end of file
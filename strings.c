@@ -0,0 +1,240 @@
+#ifndef _SOURCE_STRINGS
+#define _SOURCE_STRINGS
+
+// Offsets of the fragments in str_table
+const unsigned long str_frag[] = {
+	487, 946, 751, 520, 659, 950, 758, 886, 668, 814, 533, 546,
+	765, 954, 772, 891, 820, 826, 958, 832, 677, 962, 896, 695,
+	703, 901, 906, 911, 966, 779, 786, 793
+};
+
+// Messages and fragments, a byte 0x80 + n stands for fragment n, a 0 ends an entry
+// The messages of features that can be left out follow in #if blocks, see strings.h for where each starts
+const char str_table[] = {
+	'-', '6', '5', '5', '3', '5', 0x9C, 'd', 'i', 'r', 0x80, 'd',
+	0x84, ' ', 0x8C, '"', 'c', 'c', '"', ' ', 0x81, '"', 'c', 'w',
+	'"', 0x9C, 0x8F, 0x80, 's', 0x85, ' ', 0x8F, ' ', 0x8C, '"', 0x9A,
+	'"', ' ', 0x81, '"', 0x99, '"', 0x9C, 's', 0x85, ' ', '[', 'x',
+	']', ' ', '-', ' ', 'm', 'a', 'k', 'e', 's', ' ', 'm', 'o',
+	't', 0x81, 's', 0x85, ' ', 'x', ' ', '(', 0x8A, ')', 0x86, '\r',
+	'\n', 'q', 'u', 'i', 'e', 't', 0x8B, 't', 'u', 'r', 'n', 's',
+	' ', 'r', 'e', 'p', 'l', 'i', 'e', 's', ' ', 't', 'o', ' ',
+	'c', 0x82, 's', 0x92, 'f', ' ', '(', 0x81, 'o', 'n', ')', ',',
+	' ', 'q', 'u', 'e', 'r', 'i', 'e', 's', ' ', 's', 't', 'i',
+	'l', 'l', ' ', 0x9E, '\r', '\n', 0x00, 'C', 0x82, 's', ' ', 's',
+	'e', 'p', 'a', 'r', 'a', 't', 'e', 'd', ' ', 'b', 'y', ' ',
+	'\'', ';', '\'', ' ', 'r', 'u', 'n', ' ', 't', 'o', 'g', 'e',
+	0x95, 'r', ' ', 0x9B, 'r', 'e', 'p', 'l', 'y', 0x89, '\r', '\n',
+	'o', 'k', ' ', '<', 'o', 'n', '/', 'o', 'f', 'f', 0x8D, 'c',
+	'w', '/', 'c', 'c', 0x8D, 0x9A, '/', 0x99, 0x8D, 'p', 'e', 'r',
+	'i', 'o', 'd', 0x8D, 's', 0x85, 's', ' ', 'l', 'e', 'f', 't',
+	0x8D, 'p', 0x97, '>', '\r', '\n', 0x81, 'e', 'r', 'r', ' ', '<',
+	'n', '>', ' ', '(', 0x9B, 'd', 'o', 0x98, ' ', 'a', 't', ' ',
+	'a', 'l', 'l', ')', ' ', 'i', 'f', ' ', 'c', 0x82, ' ', 'n',
+	0x87, 'w', 'r', 0x91, 0x00, 'A', 'v', 'a', 'i', 'l', 'a', 'b',
+	'e', ' ', 'c', 0x82, 's', ':', '\r', '\n', '?', '/', 'h', 'e',
+	'l', 'p', 0x83, 't', 'h', 'i', 's', ' ', 'm', 'e', 's', 's',
+	'a', 'g', 'e', '\r', '\n', 'i', 'n', 'f', 'o', 0x83, 'm', 'o',
+	't', 0x81, 'i', 'n', 'f', 'o', '\r', '\n', 0x90, ' ', '-', ' ',
+	0x90, 's', 0x88, 'o', 'r', '\r', '\n', 's', 't', 'o', 'p', ' ',
+	'-', ' ', 's', 't', 'o', 'p', 's', 0x88, 'o', 'r', '\r', '\n',
+	's', 'p', 'e', 'e', 'd', 0x80, 's', 'p', 'e', 'e', 'd', 0x92,
+	0x88, 0x81, 0x8C, 0x00, 'a', 'c', 'k', 0x8B, 0x9E, 's', 0x9F, 0x93,
+	0x89, ' ', 'a', 'c', 0x9D, '>', ',', ' ', 0x81, 'n', 'a', 0x9D,
+	0x8D, 'n', '>', ' ', 'i', 'f', ' ', 'c', 0x82, ' ', 'n', 0x87,
+	'w', 'r', 0x91, '(', '0', ' ', 'f', 0x81, 0x95, 0x93, ')', ' ',
+	0x9B, 'i', 't', ' ', 'd', 'o', 'e', 's', 0x98, ',', ' ', 'a',
+	0x93, ' ', 'm', 'a', 'y', ' ', 0x90, 0x89, ' ', 'i', 't', 's',
+	' ', 's', 'e', 'q', ' ', '(', '0', '-', '2', '5', '5', 0x9C,
+	0x00, 't', 'a', 's', 'k', 's', ' ', '[', 'r', 'e', 's', 'e',
+	't', ']', 0x83, '(', 0x81, 'r', 'e', 's', 'e', 't', 's', ')',
+	' ', 'h', 'o', 'w', 0x92, 't', 'e', 'n', ' ', 'e', 'a', 'c',
+	'h', ' ', 'p', 'a', 'r', 't', 0x92, ' ', 0x95, ' ', 'c', 'o',
+	'r', 'e', ' ', 'l', 'o', 'o', 'p', ' ', 'r', 'a', 'n', ' ',
+	'l', 'a', 't', 'e', '\r', '\n', 0x00, ' ', '[', 'x', ']', ' ',
+	'-', ' ', 's', 'e', 't', 's', ' ', 't', 'h', 'e', ' ', 0x00,
+	'S', 0x85, 's', ' ', 'm', 'u', 's', 't', ' ', 'b', 'e', ' ',
+	0x8A, '\r', '\n', 0x00, ' ', '-', ' ', 'd', 'i', 's', 'p', 'l',
+	'a', 'y', 's', ' ', 0x00, '1', '-', '4', '2', '9', '4', '9',
+	'6', '7', '2', '9', '5', 0x00, ' ', '[', 'o', 'n', '/', 'o',
+	'f', 'f', ']', ' ', '-', ' ', 0x00, 'S', 0x85, 0x96, ' ', 'f',
+	0x81, 'a', 'n', 'o', 0x95, 'r', ' ', 0x00, 'Q', 'u', 'i', 'e',
+	't', ' ', 'm', 'o', 'd', 'e', 0x87, 0x00, 'L', 'i', 'n', 'e',
+	' ', 't', 'o', 'o', ' ', 'l', 0x91, 0x00, 'c', 'l', 'o', 'c',
+	'k', 'w', 'i', 's', 'e', '\r', '\n', 0x00, 0x86, ' ', 'f', 0x81,
+	'a', 'b', 'o', 'u', 't', ' ', 0x00, 'P', 'e', 'r', 'i', 'o',
+	'd', ' ', '=', ' ', 0x00, 0x8E, ',', ' ', 's', 'l', 'e', 'p',
+	't', ' ', 0x00, 'A', 'c', 'k', 's', ' ', 'a', 'r', 'e', ' ',
+	0x00, 0x86, ',', ' ', 'w', 'o', 'r', 's', 't', ' ', 0x00, 'i',
+	'r', 'e', 'c', 't', 'i', 'o', 'n', 0x00, ' ', 't', 'h', 'e',
+	' ', 'm', 'o', 't', 0x00, 'U', 'n', 'k', 'n', 'o', 'w', 'n',
+	' ', 0x00, 'c', 'o', 'u', 'n', 't', 'e', 'r', ' ', 0x00, 'o',
+	's', 'i', 't', 'i', 'o', 'n', 0x00, 'n', '\'', 't', ' ', 'r',
+	'u', 'n', 0x00, 'M', 'o', 't', 0x81, 'i', 's', ' ', 0x00, 'I',
+	'd', 'l', 'e', ' ', 'f', 0x81, 0x00, 'M', 'o', 't', 0x81, 'd',
+	0x84, 0x87, 0x00, 0x94, 's', 0x85, ' ', 0x8F, '\r', '\n', 0x00, 'c',
+	'o', 'n', 's', 'o', 'l', 'e', 0x00, 'o', 'm', 'm', 'a', 'n',
+	'd', 0x00, ' ', 't', 'i', 'm', 'e', 's', 0x00, 't', 'o', ' ',
+	'x', ' ', '(', 0x00, ' ', 't', 'i', 'c', 'k', 's', 0x00, 'k',
+	' ', '<', 's', 'e', 'q', 0x00, 'a', 'n', 's', 'w', 'e', 'r',
+	0x00, ' ', 'e', 'v', 'e', 'r', 'y', 0x00, ' ', 'l', 'a', 't',
+	'e', ' ', 0x00, ' ', 's', 0x85, 's', '\r', '\n', 0x00, ' ', 'w',
+	'i', 't', 'h', 0x00, 's', 't', 'a', 'r', 't', 0x00, 'o', 'n',
+	'g', '\r', '\n', 0x00, ' ', 'l', 'i', 'n', 'e', 0x00, 'O', 'F',
+	'F', '\r', '\n', 0x00, ' ', 'u', 's', '\r', '\n', 0x00, 'S', 0x85,
+	' ', 0x8F, 0x87, 0x00, 'P', 0x97, ' ', '=', ' ', 0x00, 'S', 0x85,
+	0x96, 0x9F, ' ', 0x00, 0x94, 'd', 0x84, '\r', '\n', 0x00, 'S', 0x85,
+	0x96, 0x89, ' ', 0x00, 'i', 'n', 'p', 'u', 't', 0x00, ' ', 'i',
+	's', ' ', 0x00, 's', 'i', 'z', 'e', 0x00, 'p', 'i', 'n', 'g',
+	0x00, 'h', 'a', 'l', 'f', 0x00, 'f', 'u', 'l', 'l', 0x00, 'a',
+	'n', 'd', ' ', 0x00, 'O', 'N', '\r', '\n', 0x00, 'e', 'r', 'r',
+	' ', 0x00, 'o', 'f', 'f', ' ', 0x00, 'a', 'c', 'k', ' ', 0x00,
+	'n', 'a', 'k', ' ', 0x00, 't', 'i', 'c', 'k', 0x00, 'o', 'r',
+	' ', 0x00, 't', 'e', 'p', 0x00, '>', ' ', '<', 0x00, ' ', 'o',
+	'f', 0x00, 't', 'h', 'e', 0x00, ')', '\r', '\n', 0x00, 0x8E, 0x92,
+	' ', 0x00, 'D', 0x84, 0x87, 0x00, 0x86, '\r', '\n', 0x00, 0x8E, '\r',
+	'\n', 0x00, 'o', 'k', ' ', 0x00, 'o', 'n', ' ', 0x00, 'c', 'w',
+	' ', 0x00, 'c', 'c', ' ', 0x00, 'c', 0x82, 0x00, 0x9A, 0x00, 0x99,
+	0x00, '-', 0x00
+#if PROF_ENABLE
+	, 'p', 'r', 'o', 'f', ' ', '[', 'r', 'e', 's', 'e', 't', ']',
+	0x83, '(', 0x81, 'r', 'e', 's', 'e', 't', 's', ')', ' ', 'c',
+	'y', 'c', 'l', 'e', ' ', 'c', 'o', 'u', 'n', 't', 's', 0x92,
+	' ', 0x95, ' ', 'r', 'e', 'g', 'i', 'o', 'n', ' ', 'i', 't',
+	' ', 'm', 'e', 'a', 's', 'u', 'r', 'e', 's', ',', ' ', 'p',
+	'r', 'o', 'f', ' ', '<', 'r', 'e', 'g', 'i', 'o', 'n', '>',
+	' ', 'm', 'e', 'a', 's', 'u', 'r', 'e', 's', '\r', '\n', 'i',
+	's', 'r', ',', ' ', 'c', 'h', 'e', 'c', 'k', ' ', '(', 'a',
+	0x93, ' ', 'b', 'e', 'f', 'o', 'r', 'e', ' ', 'i', 't', ' ',
+	'r', 'u', 'n', 's', ')', ',', ' ', 'c', 'm', 'd', ' ', '(',
+	'i', 't', 's', ' ', 'c', 0x82, 's', ')', ' ', 0x81, 't', 'i',
+	'c', 'k', ' ', '(', 0x95, ' ', 't', 'i', 'c', 'k', '\'', 's',
+	' ', 'p', 'a', 'r', 't', 0x92, ' ', 0x95, ' ', 'l', 'o', 'o',
+	'p', ')', ' ', 'i', 'n', 's', 't', 'e', 'a', 'd', '\r', '\n',
+	0x00, ' ', 'c', 'y', 'c', 'l', 'e', 's', ' ', '(', 'm', 'i',
+	'n', '/', 'm', 'a', 'x', 0x9C, 0x00, 'n', 'o', ' ', 's', 'a',
+	'm', 'p', 'l', 'e', 's', '\r', '\n', 0x00, 'c', 'h', 'e', 'c',
+	'k', ':', ' ', 0x00, 't', 'i', 'c', 'k', ':', ' ', 0x00, 'i',
+	's', 'r', ':', ' ', 0x00, 'c', 'm', 'd', ':', ' ', 0x00, '/',
+	0x00
+#endif
+#if LIMIT_ENABLE
+	, 'H', 'o', 'm', 'i', 'n', 'g', ' ', 'f', 'a', 'i', 'l', 'e',
+	'd', ',', ' ', 's', 't', 'o', 'p', 'p', 'e', 'd', ' ', 'a',
+	't', ' ', 'a', ' ', 'l', 'i', 'm', 'i', 't', ' ', 's', 'w',
+	'i', 't', 'c', 'h', '\r', '\n', 0x00, 'h', 'o', 'm', 'e', ' ',
+	'-', ' ', 'f', 'i', 'n', 'd', 's', ' ', 0x95, ' ', 'h', 'o',
+	'm', 'e', ' ', 's', 'w', 'i', 't', 'c', 'h', ' ', 0x9B, 'z',
+	'e', 'r', 'o', 'e', 's', ' ', 0x95, ' ', 'p', 0x97, '\r', '\n',
+	0x00, 'S', 't', 'o', 'p', 'p', 'e', 'd', ' ', 'a', 't', ' ',
+	'a', ' ', 'l', 'i', 'm', 'i', 't', ' ', 's', 'w', 'i', 't',
+	'c', 'h', '\r', '\n', 0x00, 'H', 'o', 'm', 'e', 'd', ',', ' ',
+	'p', 0x97, 0x87, '0', '\r', '\n', 0x00, 'H', 'o', 'm', 'i', 'n',
+	'g', '\r', '\n', 0x00
+#endif
+#if MOTOR_PWM
+	, 'r', 'a', 't', 'e', ' ', '[', 'x', ']', ' ', '-', ' ', 'r',
+	'u', 'n', 's', 0x88, 0x81, 'i', 'n', ' ', 'h', 'a', 'r', 'd',
+	'w', 'a', 'r', 'e', ' ', 'a', 't', ' ', 'x', ' ', '(', 0x00,
+	')', ' ', 's', 0x85, 's', ' ', 'p', 'e', 'r', ' ', 's', 'e',
+	'c', 'o', 'n', 'd', '\r', '\n', 0x00, 'S', 0x85, 0x96, ' ', 'i',
+	'n', ' ', 'h', 'a', 'r', 'd', 'w', 'a', 'r', 'e', 0x9F, ' ',
+	0x00, 'R', 'a', 't', 'e', ' ', 'm', 'u', 's', 't', ' ', 'b',
+	'e', ' ', 0x00, ' ', 'c', 'y', 'c', 'l', 'e', 's', '\r', '\n',
+	0x00
+#endif
+#if TIME_CALIBRATE
+	, 'c', 'a', 'l', ' ', '-', ' ', 'm', 'e', 'a', 's', 'u', 'r',
+	'e', 's', ' ', 0x95, ' ', 't', 'i', 'c', 'k', ' ', 'r', 'a',
+	't', 'e', ' ', 'a', 'g', 'a', 'i', 'n', 's', 't', ' ', 'T',
+	'i', 'm', 'e', 'r', '1', ' ', 0x9B, 't', 'r', 'i', 'm', 's',
+	' ', 'i', 't', '\r', '\n', 0x00, 'M', 'e', 'a', 's', 'u', 'r',
+	'i', 'n', 'g', ' ', 0x95, ' ', 't', 'i', 'c', 'k', ' ', 'r',
+	'a', 't', 'e', '\r', '\n', 0x00, 'T', 'i', 'c', 'k', ' ', 'r',
+	'a', 't', 'e', ' ', 'e', 'r', 'r', 0x81, '=', ' ', 0x00, ' ',
+	'p', 'p', 'm', ',', ' ', 't', 'r', 'i', 'm', ' ', '=', ' ',
+	0x00, '/', '2', '5', '6', ' ', 'c', 'o', 'u', 'n', 't', '\r',
+	'\n', 0x00, 'u', 'n', 'k', 'n', 'o', 'w', 'n', 0x00
+#endif
+#if BUS_ENABLE
+	, 'i', 'd', 0x80, 'b', 'u', 's', ' ', 'a', 'd', 'd', 'r', 'e',
+	's', 's', ' ', 0x8C, '1', '-', '2', '5', '4', ')', ',', ' ',
+	'2', '5', '5', ' ', 'g', 'o', 'e', 's', ' ', 'b', 'a', 'c',
+	'k', ' ', 't', 'o', ' ', 0x95, ' ', 'j', 'u', 'm', 'p', 'e',
+	'r', 's', '\r', '\n', 0x00, 'B', 'u', 's', ' ', 'I', 'D', ' ',
+	'=', ' ', 0x00
+#endif
+#if TRIGGER_ENABLE
+	, 'a', 'r', 'm', ' ', '-', ' ', 's', 't', 'o', 'p', 's', 0x88,
+	'o', 'r', ',', ' ', 0x90, ' ', 0x9B, 's', 0x85, ' ', 0x95, 'n',
+	' ', 'w', 'a', 'i', 't', ' ', 'f', 0x81, 0x95, ' ', 't', 'r',
+	'i', 'g', 'g', 'e', 'r', '\r', '\n', 0x00, 'A', 'r', 'm', 'e',
+	'd', ',', ' ', 0x90, ' ', 0x9B, 's', 0x85, ' ', 'w', 'a', 'i',
+	't', ' ', 'f', 0x81, 0x95, ' ', 't', 'r', 'i', 'g', 'g', 'e',
+	'r', '\r', '\n', 0x00
+#endif
+#if ENCODER_ENABLE
+	, 's', 't', 'a', 'l', 'l', ' ', '[', 'x', ']', ' ', '-', ' ',
+	'c', 'h', 'e', 'c', 'k', 's', ' ', 0x95, ' ', 'e', 'n', 'c',
+	'o', 'd', 'e', 'r', 0x9F, ' ', 'x', ' ', '(', '1', '-', '2',
+	'5', '5', ')', ' ', 's', 0x85, 's', ',', ' ', '0', ' ', 't',
+	'u', 'r', 'n', 's', ' ', 't', 'h', 'a', 't', 0x92, 'f', '\r',
+	'\n', 0x00, 'S', 't', 'a', 'l', 'l', 'e', 'd', ',', ' ', 's',
+	'l', 'o', 'w', 'i', 'n', 'g', ' ', 'd', 'o', 'w', 'n', ' ',
+	't', 'o', ' ', 0x00, 'N', 'o', 't', ' ', 'c', 'h', 'e', 'c',
+	'k', 'i', 'n', 'g', ' ', 0x95, ' ', 'e', 'n', 'c', 'o', 'd',
+	'e', 'r', '\r', '\n', 0x00, 'C', 'h', 'e', 'c', 'k', 'i', 'n',
+	'g', ' ', 0x95, ' ', 'e', 'n', 'c', 'o', 'd', 'e', 'r', 0x9F,
+	' ', 0x00, 'S', 't', 'a', 'l', 'l', 'e', 'd', ',', ' ', 's',
+	't', 'o', 'p', 'p', 'e', 'd', ' ', 'a', 't', ' ', 0x00, ' ',
+	'c', 'o', 'u', 'n', 't', 's', ',', ' ', 's', 't', 'a', 'l',
+	'l', 'e', 'd', ' ', 0x00, 'E', 'n', 'c', 'o', 'd', 'e', 'r',
+	' ', '=', ' ', 0x00
+#endif
+#if !BUS_ENABLE
+	, 'f', 'l', 'o', 'w', 0x8B, 's', 'e', 'n', 'd', 's', ' ', 'X',
+	'O', 'F', 'F', ' ', 'w', 'h', 'e', 'n', ' ', 0x95, ' ', 'i',
+	'n', 'p', 'u', 't', ' ', 'b', 'u', 'f', 'f', 'e', 'r', 0x87,
+	'a', 'b', 'o', 'u', 't', ' ', 0x9A, ' ', 0x9B, 'X', 'O', 'N',
+	' ', 'o', 'n', 'c', 'e', ' ', 'i', 't', ' ', 'h', 'a', 's',
+	' ', 'r', 'o', 'o', 'm', '\r', '\n', 0x00, 'F', 'l', 'o', 'w',
+	' ', 'c', 'o', 'n', 't', 'r', 'o', 'l', 0x87, 0x00
+#endif
+#if QUEUE_ENABLE
+	, 'a', 't', ' ', '<', 't', 'i', 'c', 'k', 0x8D, 'c', 0x82, '>',
+	' ', '-', ' ', 'r', 'u', 'n', 's', ' ', 0x90, ',', ' ', 's',
+	't', 'o', 'p', ',', ' ', 's', 'p', 'e', 'e', 'd', ',', ' ',
+	'd', 'i', 'r', ',', ' ', 0x8F, ' ', 0x81, 's', 0x85, ' ', 'o',
+	'n', ' ', 't', 'h', 'a', 't', ' ', 't', 'i', 'c', 'k', ' ',
+	'(', 0x81, '+', 'n', ',', ' ', 'n', 0x8E, ' ', 'f', 'r', 'o',
+	'm', '\r', '\n', 'n', 'o', 'w', ',', ' ', '1', '-', '3', '2',
+	'7', '6', '7', ' ', 'a', 'h', 'e', 'a', 'd', ')', ',', ' ',
+	'a', 't', ' ', '[', 'c', 'l', 'e', 'a', 'r', ']', ' ', 'l',
+	'i', 's', 't', 's', ' ', '(', 0x81, 'e', 'm', 'p', 't', 'i',
+	'e', 's', ')', ' ', 'w', 'h', 'a', 't', '\'', 's', ' ', 'w',
+	'a', 'i', 't', 'i', 'n', 'g', ',', ' ', 't', 'i', 'c', 'k',
+	' ', 'd', 'i', 's', 'p', 'l', 'a', 'y', 's', ' ', 0x95, ' ',
+	't', 'i', 'c', 'k', '\r', '\n', 0x00, 'T', 'i', 'c', 'k', ' ',
+	'm', 'u', 's', 't', ' ', 'b', 'e', ' ', '1', '-', '3', '2',
+	'7', '6', '7', ' ', 'a', 'h', 'e', 'a', 'd', ',', ' ', 0x95,
+	'n', ' ', 0x90, ',', ' ', 's', 't', 'o', 'p', ',', ' ', 's',
+	'p', 'e', 'e', 'd', ' ', 'x', ',', ' ', 'd', 'i', 'r', ' ',
+	'x', ',', ' ', 0x8F, ' ', 'x', ' ', 0x81, 's', 0x85, ' ', 'x',
+	' ', '(', '1', '-', '6', '5', '5', '3', '5', 0x9C, 0x00, ' ',
+	'q', 'u', 'e', 'u', 'e', 'd', ',', ' ', 'r', 'a', 'n', ' ',
+	'l', 'a', 't', 'e', ' ', 0x00, 'Q', 'u', 'e', 'u', 'e', 0x87,
+	0x9A, '\r', '\n', 0x00, 'T', 'i', 'c', 'k', ' ', '=', ' ', 0x00,
+	' ', 's', 'p', 'e', 'e', 'd', ' ', 0x00, ' ', 's', 't', 'o',
+	'p', 0x00, ' ', 'd', 'i', 'r', ' ', 0x00, ' ', 's', 0x85, ' ',
+	0x00, 'a', 't', ' ', 0x00, ' ', 0x8F, ' ', 0x00, ',', ' ', 0x00,
+	' ', 0x90, 0x00, 'c', 'c', 0x00, 'c', 'w', 0x00
+#endif
+#if TIME_CALIBRATE && MOTOR_PWM && MOTOR_PWM_COUNT
+	, 'T', 'i', 'm', 'e', 'r', '1', 0x87, 'c', 'o', 'u', 'n', 't',
+	'i', 'n', 'g', ' ', 'h', 'a', 'r', 'd', 'w', 'a', 'r', 'e',
+	' ', 's', 0x85, 's', ',', ' ', 's', 't', 'o', 'p', 0x88, 0x81,
+	'f', 'i', 'r', 's', 't', '\r', '\n', 0x00
+#endif
+};
+
+#endif // !_SOURCE_STRINGS
\ No newline at end of file
@@ -0,0 +1,173 @@
+/*
+
+	Console messages.
+	Generated from strings.txt by tools/strings.py, edit that file and regenerate instead of editing this one.
+
+	2942 characters of text stored in 2437 words (2373 in the table, 1362 of them for features that can be left out,
+	64 for 32 fragment offsets)
+
+*/
+
+#ifndef _HEAD_STRINGS
+#define _HEAD_STRINGS
+
+// Message ids, to be passed to io_printStr()
+#define STR_HELP               245
+#define STR_HELP_END           0
+#define STR_HELP_TASKS         421
+#define STR_HELP_ACK           340
+#define STR_HELP_BATCH         127
+#define STR_MOTOR_IS           711
+#define STR_ON                 916
+#define STR_OFF                838
+#define STR_PERIOD             619
+#define STR_TICKS_OF           970
+#define STR_US_EACH            844
+#define STR_DIRECTION_IS       974
+#define STR_STEP_SIZE_IS       850
+#define STR_POSITION           856
+#define STR_IDLE_FOR           719
+#define STR_TICKS_SLEPT        629
+#define STR_TIMES              978
+#define STR_TIMES_FOR          608
+#define STR_STEPPING_EVERY     862
+#define STR_TICKS              982
+#define STR_UNKNOWN_DIRECTION  868
+#define STR_MOTOR_DIRECTION_IS 727
+#define STR_UNKNOWN_STEP_SIZE  735
+#define STR_STEPPING_WITH      874
+#define STR_STEPPING_FOR       559
+#define STR_STEPS_RANGE        504
+#define STR_OK                 986
+#define STR_ERR                921
+#define STR_RUN_ON             990
+#define STR_RUN_OFF            926
+#define STR_RUN_CW             994
+#define STR_RUN_CC             998
+#define STR_QUIET_IS           572
+#define STR_LINE_TOO_LONG      584
+#define STR_ACK                931
+#define STR_NAK                936
+#define STR_ACKS_ARE           639
+#define STR_TASK_TICK          941
+#define STR_TASK_INPUT         880
+#define STR_TASK_COMMAND       1002
+#define STR_TASK_CONSOLE       743
+#define STR_LATE               800
+#define STR_TIMES_WORST        649
+#define STR_COUNTER            686
+#define STR_CLOCKWISE          596
+#define STR_FULL               1005
+#define STR_HALF               1007
+#define STR_STEPS              807
+#define STR_MINUS              1009
+#define STR_SPACE              502
+#define STR_NEWLINE            124
+
+// Messages of features that can be left out
+#define STR_PART_0             1011
+#if PROF_ENABLE
+#define STR_HELP_PROF          (STR_PART_0 + 0)
+#define STR_PROF_ISR           (STR_PART_0 + 215)
+#define STR_PROF_CHECK         (STR_PART_0 + 200)
+#define STR_PROF_CMD           (STR_PART_0 + 221)
+#define STR_PROF_TICK          (STR_PART_0 + 208)
+#define STR_SLASH              (STR_PART_0 + 227)
+#define STR_PROF_CYCLES        (STR_PART_0 + 169)
+#define STR_PROF_NO_SAMPLES    (STR_PART_0 + 187)
+#define STR_PART_1             (STR_PART_0 + 229)
+#else
+#define STR_PART_1             STR_PART_0
+#endif
+#if LIMIT_ENABLE
+#define STR_HELP_HOME          (STR_PART_1 + 43)
+#define STR_HOMING             (STR_PART_1 + 127)
+#define STR_HOMED              (STR_PART_1 + 113)
+#define STR_HOME_FAILED        (STR_PART_1 + 0)
+#define STR_LIMIT_HIT          (STR_PART_1 + 85)
+#define STR_PART_2             (STR_PART_1 + 136)
+#else
+#define STR_PART_2             STR_PART_1
+#endif
+#if MOTOR_PWM
+#define STR_HELP_RATE          (STR_PART_2 + 0)
+#define STR_HELP_RATE_END      (STR_PART_2 + 36)
+#define STR_HARDWARE_EVERY     (STR_PART_2 + 55)
+#define STR_CYCLES             (STR_PART_2 + 87)
+#define STR_RATE_RANGE         (STR_PART_2 + 73)
+#define STR_PART_3             (STR_PART_2 + 97)
+#else
+#define STR_PART_3             STR_PART_2
+#endif
+#if TIME_CALIBRATE
+#define STR_HELP_CAL           (STR_PART_3 + 0)
+#define STR_TICK_ERROR         (STR_PART_3 + 78)
+#define STR_NOT_MEASURED       (STR_PART_3 + 122)
+#define STR_PPM_TRIM           (STR_PART_3 + 95)
+#define STR_TRIM_UNIT          (STR_PART_3 + 109)
+#define STR_CALIBRATING        (STR_PART_3 + 54)
+#define STR_PART_4             (STR_PART_3 + 130)
+#else
+#define STR_PART_4             STR_PART_3
+#endif
+#if BUS_ENABLE
+#define STR_HELP_ID            (STR_PART_4 + 0)
+#define STR_BUS_ID_IS          (STR_PART_4 + 53)
+#define STR_PART_5             (STR_PART_4 + 63)
+#else
+#define STR_PART_5             STR_PART_4
+#endif
+#if TRIGGER_ENABLE
+#define STR_HELP_ARM           (STR_PART_5 + 0)
+#define STR_ARMED              (STR_PART_5 + 44)
+#define STR_PART_6             (STR_PART_5 + 76)
+#else
+#define STR_PART_6             STR_PART_5
+#endif
+#if ENCODER_ENABLE
+#define STR_HELP_STALL         (STR_PART_6 + 0)
+#define STR_ENCODER_IS         (STR_PART_6 + 173)
+#define STR_COUNTS_STALLED     (STR_PART_6 + 155)
+#define STR_CHECKING_EVERY     (STR_PART_6 + 113)
+#define STR_NOT_CHECKING       (STR_PART_6 + 88)
+#define STR_STALLED_SLOWING    (STR_PART_6 + 62)
+#define STR_STALLED_AT         (STR_PART_6 + 134)
+#define STR_PART_7             (STR_PART_6 + 184)
+#else
+#define STR_PART_7             STR_PART_6
+#endif
+#if !BUS_ENABLE
+#define STR_HELP_FLOW          (STR_PART_7 + 0)
+#define STR_FLOW_IS            (STR_PART_7 + 68)
+#define STR_PART_8             (STR_PART_7 + 82)
+#else
+#define STR_PART_8             STR_PART_7
+#endif
+#if QUEUE_ENABLE
+#define STR_HELP_AT            (STR_PART_8 + 0)
+#define STR_TICK_IS            (STR_PART_8 + 268)
+#define STR_COMMA              (STR_PART_8 + 309)
+#define STR_QUEUED_LATE        (STR_PART_8 + 239)
+#define STR_AT                 (STR_PART_8 + 301)
+#define STR_AT_START           (STR_PART_8 + 312)
+#define STR_AT_STOP            (STR_PART_8 + 284)
+#define STR_AT_SPEED           (STR_PART_8 + 276)
+#define STR_AT_DIR             (STR_PART_8 + 290)
+#define STR_AT_SIZE            (STR_PART_8 + 305)
+#define STR_AT_STEP            (STR_PART_8 + 296)
+#define STR_CC                 (STR_PART_8 + 315)
+#define STR_CW                 (STR_PART_8 + 318)
+#define STR_AT_RANGE           (STR_PART_8 + 163)
+#define STR_QUEUE_FULL         (STR_PART_8 + 258)
+#define STR_PART_9             (STR_PART_8 + 321)
+#else
+#define STR_PART_9             STR_PART_8
+#endif
+#if TIME_CALIBRATE && MOTOR_PWM && MOTOR_PWM_COUNT
+#define STR_CAL_BUSY           (STR_PART_9 + 0)
+#define STR_PART_10            (STR_PART_9 + 44)
+#else
+#define STR_PART_10            STR_PART_9
+#endif
+
+#endif // !_HEAD_STRINGS
\ No newline at end of file
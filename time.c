@@ -1,10 +1,37 @@
 #ifndef _SOURCE_TIME
 #define _SOURCE_TIME
 
+#if TIME_CALIBRATE && (TIME_CAL_T1CON & 0b00001000) && (PROF_ENABLE || MOTOR_PWM && MOTOR_PWM_COUNT)
+#error A Timer1 crystal for cal takes RA5 and Timer1 away from prof and ECCP step counting
+#endif
+
 unsigned long time_tick;
+char time_trim;
+char time_trimAcc;
+
+#if TIME_CALIBRATE
+bit time_calRunning;
+bit time_calDone;
+bit time_calMeasured;		// time_calPpm holds a measurement
+bit time_calNew;
+unsigned long time_calTicks;
+unsigned long time_calLast;	// Timer1 at the previous tick
+uns24 time_calCounts;		// Timer1 counts since the first tick
+long time_calPpm;			// tick rate error of the last measurement
+#endif
 
 void time_init() {
+	OSCCON = CONFIG_OSCCON;		// switch the internal oscillator to CONFIG_F_OSC
+	while (!HTS);				// and wait for it to settle
+	
 	time_tick = 0;
+	time_trim = TIME_TRIM;
+	time_trimAcc = 0;
+#if TIME_CALIBRATE
+	time_calRunning = 0;
+	time_calMeasured = 0;
+	time_calNew = 0;
+#endif
 
 	T0CS = 0;					// Timer0 will use internal oscilator
 	TMR0 = 0;					// reset timer
@@ -18,9 +45,47 @@ void time_init() {
 }
 
 void time_update() {
+	/*
+		TMR0 kept counting while we were getting here, so the reload is added to it instead of written over it.
+		That way the interrupt latency doesn't make the tick longer, only the reload itself does (see TIME_TRIM).
+	*/
+	time_trimAcc += time_trim;
+	if (Carry)
+		TMR0 += TIME_RESET + 1;
+	else
+		TMR0 += TIME_RESET;
 	time_tick++;
-	TMR0 = TIME_RESET;	// This will give roughly 1/790th of a second period if used with 1:32 prescale
 	IF_TIME = 0;		// reset interrupt flag
+	
+#if TRIGGER_ENABLE
+	// not sooner, the core loop may have been halfway through the last tick when the trigger came
+	if (trigger_phase == TRIGGER_FIRED)
+		trigger_phase = TRIGGER_DUE;
+#endif
+	
+#if TIME_CALIBRATE
+	if (time_calRunning && !time_calDone) {
+		unsigned long t;
+		do {
+			t.high8 = TMR1H;
+			t.low8 = TMR1L;
+		} while (t.high8 != TMR1H);
+		
+		if (time_calTicks)
+			time_calCounts += (unsigned long)(t - time_calLast);	// Timer1 wraps, the difference doesn't
+		time_calLast = t;
+		if (++time_calTicks > TIME_CAL_TICKS)
+			time_calDone = 1;
+	}
+#endif
+}
+
+unsigned long time_now() {
+	unsigned long t;
+	do {
+		t = time_tick;
+	} while (t != time_tick);	// a tick is far longer than this, the second read can't be torn as well
+	return t;
 }
 
 void time_wait(unsigned long t) {
@@ -28,4 +93,68 @@ void time_wait(unsigned long t) {
 	while (time_tick != end);
 }
 
+#if TIME_CALIBRATE
+
+void time_calStart() {
+	time_calRunning = 0;		// keep the interrupt out while we set up
+	time_calTicks = 0;
+	time_calCounts = 0;
+	time_calDone = 0;
+	T1CON = TIME_CAL_T1CON;		// the same as prof_init() with the default reference, so prof keeps working
+	time_calRunning = 1;
+}
+
+void time_calFinish() {
+	int32 error;
+	int32 trim;
+	
+	time_calRunning = 0;
+#if !PROF_ENABLE
+	T1CON = 0;
+#endif
+	
+	// A slow tick takes more counts than it should. Error in ppm is (expected - counts) * 1000000 / counts,
+	// counts are shifted down by 6 (and 1000000 with them) to keep it within 32 bits
+	error = (int32)TIME_CAL_COUNTS - time_calCounts;
+	error = error * 15625 / (int32)(time_calCounts >> 6);
+	if (error > 32767)
+		error = 32767;
+	else if (error < -32767)
+		error = -32767;
+	time_calPpm = error;
+	time_calMeasured = 1;
+	
+	// Every 1/256th of a TMR0 count added per tick makes it shorter by 1 / (256 * (TIME_TICK_PERIOD + 1))
+	trim = error * ((TIME_TICK_PERIOD + 1) * 256 / 64) / (1000000 / 64);
+	trim = time_trim - trim;
+	if (trim < 0)
+		trim = 0;
+	else if (trim > 255)
+		trim = 255;		// out of reach of the trim, OSCTUNE is the next thing to look at
+	time_trim = trim;
+	
+	time_calNew = 1;
+	io_notice = 1;
+}
+
+bit time_calPrint(char part) {
+	if (part == 0) {
+		io_printStr(STR_TICK_ERROR);
+		if (!time_calMeasured)
+			io_printStr(STR_NOT_MEASURED);
+		else
+			io_printInt(time_calPpm);
+		io_printLater(STR_PPM_TRIM);
+		return 1;
+	}
+	if (part == 1) {
+		io_print(toString(time_trim));
+		io_printLater(STR_TRIM_UNIT);
+		return 1;
+	}
+	return 0;
+}
+
+#endif // TIME_CALIBRATE
+
 #endif // !_SOURCE_TIME
\ No newline at end of file
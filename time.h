@@ -12,20 +12,106 @@
 
 #pragma bit IF_TIME @ T0IF
 
-#define TIME_TICK_PERIOD	159
-#define TIME_PRESCALE		0b001	// 1:16
+// Speeds and delays are counted in ticks, so the tick is the same length at every clock, only the cycles in it change
+#define TIME_TICK_US		640		// tick length in microseconds (1562.5 Hz)
+#define TIME_CYCLE_RATE		(CONFIG_F_OSC / 4)	// instruction cycles per second
+#define TIME_TICK_CYCLES	(TIME_TICK_US * (CONFIG_F_OSC / 1000) / 4000)	// instruction cycles per tick
+
+#if TIME_TICK_US * (CONFIG_F_OSC / 1000) % 4000
+#error TIME_TICK_US isn't a whole number of instruction cycles at CONFIG_F_OSC
+#endif
+#if TIME_TICK_CYCLES < 320
+#error Fewer than 320 cycles per tick leave too little for the interrupt and the core loop
+#endif
+
+// Smallest Timer0 prescale that fits a tick into 256 counts, 1:4 at least so that TIME_TRIM fits in a count
+#if TIME_TICK_CYCLES <= 4 * 256
+#define TIME_PRESCALE		0b001	// 1:4
+#define TIME_PRESCALE_DIV	4
+#elif TIME_TICK_CYCLES <= 8 * 256
+#define TIME_PRESCALE		0b010	// 1:8
+#define TIME_PRESCALE_DIV	8
+#elif TIME_TICK_CYCLES <= 16 * 256
+#define TIME_PRESCALE		0b011	// 1:16
+#define TIME_PRESCALE_DIV	16
+#else
+#error A tick doesn't fit into Timer0 at CONFIG_F_OSC
+#endif
+
+#if TIME_TICK_CYCLES % TIME_PRESCALE_DIV
+#error A tick isn't a whole number of Timer0 counts at CONFIG_F_OSC
+#endif
+
+#define TIME_TICK_PERIOD	(TIME_TICK_CYCLES / TIME_PRESCALE_DIV - 1)
 #define TIME_RESET			(255 - TIME_TICK_PERIOD)	// this will make the timer overflow every tick period
 
-// Current tick (roughly 1/1580th of a second, because we want 2 ticks in 1 motor pulse (we presume motor's max pulserate is 790))
+/*
+	Reloading TMR0 costs cycles: it doesn't count for 2 cycles after the write and the write clears the prescaler,
+	which throws away another (prescale - 1) / 2 on average. time_trim adds that much back, as a fraction of a TMR0 count
+	(in 1/256ths) per tick. One step of it is 1 / (256 * (TIME_TICK_PERIOD + 1)) of the tick, about 24 ppm.
+*/
+#ifndef TIME_TRIM
+#define TIME_TRIM			((TIME_PRESCALE_DIV + 3) * 128 / TIME_PRESCALE_DIV)	// 224 (3.5 cycles) at 1:4
+#endif
+
+// Set to 0 to leave out the cal command (it borrows Timer1 while measuring)
+#ifndef TIME_CALIBRATE
+#define TIME_CALIBRATE 1
+#endif
+
+#define TIME_CAL_TICKS		4096	// ticks to measure over (about 2.6 seconds)
+
+/*
+	Timer1 is the reference. By default it counts instruction cycles, which shows what the reload loses, not how far off
+	the oscillator is. For that put a 32768 Hz crystal on T1OSO/T1OSI (RA4/RA5) and set TIME_CAL_T1CON to 0b00001111
+	and TIME_CAL_COUNTS to 85899 (the 32768 Hz counts TIME_CAL_TICKS of TIME_TICK_US take).
+*/
+#ifndef TIME_CAL_T1CON
+#define TIME_CAL_T1CON		0b00000001	// Timer1 on, internal clock, 1:1 prescale
+#define TIME_CAL_COUNTS		((uns24)TIME_CAL_TICKS * TIME_TICK_CYCLES)	// Timer1 counts of TIME_CAL_TICKS perfect ticks
+#endif
+
+// Current tick (1/1562.5th of a second, about 2 ticks in 1 pulse at motor's max pulserate of 790)
 extern unsigned long time_tick;
 
+// Fraction of a TMR0 count added to every tick (see TIME_TRIM), cal sets it
+extern char time_trim;
+
 // Initialized the timer and timer-related interrupt
 void time_init();
 
 // Is to be called on timer interrupt, this will update the tick
 void time_update();
 
+// Returns time_tick as it is now, read whole: the interrupt can move it on between the two bytes of a plain read,
+// which outside of the interrupt gives a value that is neither the old tick nor the new one
+unsigned long time_now();
+
 // Wait until provided number of ticks pass
 void time_wait(unsigned long);
 
+#if TIME_CALIBRATE
+
+extern bit time_calRunning;		// 1 from time_calStart() until the result is taken
+extern bit time_calDone;		// set by the interrupt once TIME_CAL_TICKS ticks are measured
+extern bit time_calNew;			// a result the console task is to print (see io_notice)
+
+// Start measuring the tick rate against Timer1, Timer1 must not be in use by anything else than prof
+void time_calStart();
+
+// Is to be called once time_calDone is set, sets time_trim from the measurement and leaves the result to be printed
+void time_calFinish();
+
+// Prints the given part of the last measured error and the trim, returns 0 past the last one
+bit time_calPrint(char part);
+
+// Give up on a measurement (something else needs Timer1)
+#define time_calCancel()	time_calRunning = 0
+
+#else
+
+#define time_calCancel()
+
+#endif // TIME_CALIBRATE
+
 #endif // !_HEAD_TIME
\ No newline at end of file
@@ -0,0 +1,387 @@
+#!/usr/bin/env python3
+"""
+	Generates the single file version of the project (MotorController.c) from main.c and the modules it includes.
+
+	Local includes ("time.h", "time.c", ...) are pasted in place with their include guards stripped,
+	everything else (deps/16F690.h and friends) is left for the compiler.
+
+	usage:
+		tools/amalgamate.py [-o MotorController.c]             regenerate the single file version
+		tools/amalgamate.py --check                            fail if MotorController.c is out of date
+		tools/amalgamate.py --strip-disabled -D PROF_ENABLE=1  also drop code of disabled features
+		tools/amalgamate.py --report [--listing main.lst]      print ROM words and RAM bytes per module,
+		                                                       without a Cc5x listing ROM is only the const tables,
+		                                                       fails if the globals don't leave RAM_LOCALS bytes free
+"""
+
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+RE_INCLUDE = re.compile(r'^\s*#include\s+"([^"]+)"')
+RE_GUARD_IF = re.compile(r'^#ifndef\s+(_(?:HEAD|SOURCE)_\w+)\s*$')
+RE_DIRECTIVE = re.compile(r'^\s*#\s*(\w+)\s*(.*?)\s*$')
+RE_DEFINE = re.compile(r'^(\w+)(\([^)]*\))?\s*(.*)$')
+
+HEADER = '''/*
+
+	A single file version of the project
+	Generated from main.c by tools/amalgamate.py, edit the modular sources and regenerate instead of editing this file
+	'''
+
+
+def title(name):
+	stem, ext = os.path.splitext(name)
+	stem = stem.upper() if len(stem) <= 2 else stem.capitalize()
+	return '// %s %s' % (stem, 'definitions' if ext == '.h' else 'source')
+
+
+def strip_comment(line):
+	return re.sub(r'//.*$', '', re.sub(r'/\*.*?\*/', '', line)).strip()
+
+
+def read_module(name):
+	"""Returns lines of a local file without its leading comment block and include guard."""
+	with open(os.path.join(ROOT, name)) as f:
+		lines = f.read().split('\n')
+
+	# leading /* ... */ block
+	if lines and lines[0].startswith('/*'):
+		end = next(i for i, l in enumerate(lines) if '*/' in l)
+		lines = lines[end + 1:]
+
+	# include guard
+	first = next((i for i, l in enumerate(lines) if l.strip()), None)
+	if first is not None:
+		m = RE_GUARD_IF.match(lines[first].strip())
+		if m:
+			last = max(i for i, l in enumerate(lines) if l.strip())
+			if not lines[first + 1].strip().startswith('#define ' + m.group(1)) or not lines[last].startswith('#endif'):
+				sys.exit('%s: malformed include guard' % name)
+			lines = lines[first + 2:last]
+
+	while lines and not lines[0].strip():
+		lines.pop(0)
+	while lines and not lines[-1].strip():
+		lines.pop()
+	return lines
+
+
+def amalgamate():
+	"""Returns a list of (module, line), module being the file the line came from."""
+	with open(os.path.join(ROOT, 'main.c')) as f:
+		main = f.read().split('\n')
+
+	out = []
+
+	# replace main.c's comment header, but keep what it says
+	assert main[0] == '/*'
+	out.extend(('main.c', l) for l in HEADER.rstrip('\n').split('\n'))
+	main = main[1:]
+	while main and not main[0].strip():
+		main.pop(0)
+
+	for line in main:
+		m = RE_INCLUDE.match(line)
+		if m and os.path.exists(os.path.join(ROOT, m.group(1))):
+			name = m.group(1)
+			out.append((name, title(name)))
+			out.extend((name, l) for l in read_module(name))
+			out.append((name, ''))
+			out.append((name, ''))
+		else:
+			out.append(('main.c', line))
+	return out
+
+
+def join(lines):
+	# no more than 3 blank lines in a row
+	return re.sub(r'\n(?:[ \t]*\n){4,}', '\n\n\n\n', '\n'.join(l for _, l in lines))
+
+
+class Preprocessor:
+	"""
+		Resolves #if/#ifdef/#ifndef blocks that depend only on integer macros.
+		Blocks that depend on anything else (function-like macros, compiler symbols) are left alone.
+	"""
+
+	def __init__(self, defines):
+		self.macros = dict(defines)
+		self.forced = set(defines)	# -D settings win over #define in the sources
+		self.unknown = set()
+
+	def value(self, expr, depth=0):
+		"""Returns the integer value of an #if expression, or None if it can't be known here."""
+		if depth > 16:
+			return None
+		expr = strip_comment(expr)
+
+		def defined(m):
+			name = m.group(1)
+			if name in self.unknown:
+				raise KeyError(name)
+			return '1' if name in self.macros else '0'
+
+		def ident(m):
+			name = m.group(0)
+			if name in self.unknown:
+				raise KeyError(name)
+			if name not in self.macros:
+				return '0'	# same as the C preprocessor
+			v = self.value(self.macros[name], depth + 1)
+			if v is None:
+				raise KeyError(name)
+			return '(%d)' % v
+
+		try:
+			expr = re.sub(r'\bdefined\s*\(?\s*(\w+)\s*\)?', defined, expr)
+			expr = re.sub(r'\b0[bB]([01]+)\b', lambda m: str(int(m.group(1), 2)), expr)
+			expr = re.sub(r'\b(\d+)[uUlL]+\b', r'\1', expr)
+			expr = re.sub(r'\b[A-Za-z_]\w*\b', ident, expr)
+			if not re.fullmatch(r'[\dxXa-fA-F\s()+\-*/%<>=!&|^~]*', expr):
+				return None
+			expr = expr.replace('&&', ' and ').replace('||', ' or ').replace('/', '//')
+			expr = re.sub(r'!(?!=)', ' not ', expr)
+			return int(eval(expr, {'__builtins__': {}}))
+		except Exception:
+			return None
+
+	def run(self, lines):
+		"""Takes and returns a list of (module, line)."""
+		out = []
+		stack = []	# [resolved, parent active, branch active, branch taken]
+
+		def active():
+			return not stack or (stack[-1][1] and stack[-1][2])
+
+		for item in lines:
+			line = item[1]
+			d = RE_DIRECTIVE.match(line)
+			kind, arg = (d.group(1), strip_comment(d.group(2))) if d else (None, None)
+
+			if kind in ('if', 'ifdef', 'ifndef'):
+				if kind == 'ifdef':
+					arg = 'defined(%s)' % arg
+				elif kind == 'ifndef':
+					arg = '!defined(%s)' % arg
+				v = self.value(arg) if active() else 0
+				if v is None:
+					stack.append([False, active(), True, False])
+					out.append(item)
+				else:
+					stack.append([True, active(), bool(v), bool(v)])
+			elif kind == 'elif':
+				frame = stack[-1]
+				if not frame[0]:
+					out.append(item)
+					continue
+				v = 0 if frame[3] else self.value(arg)
+				if v is None:
+					sys.exit('can\'t resolve "%s" after a resolved #if' % line.strip())
+				frame[2] = bool(v)
+				frame[3] = frame[3] or frame[2]
+			elif kind == 'else':
+				frame = stack[-1]
+				if not frame[0]:
+					out.append(item)
+					continue
+				frame[2] = not frame[3]
+				frame[3] = True
+			elif kind == 'endif':
+				if not stack.pop()[0]:
+					out.append(item)
+			elif not active():
+				continue
+			else:
+				if kind == 'define':
+					m = RE_DEFINE.match(d.group(2))
+					name = m.group(1)
+					if m.group(2) or not all(f[0] for f in stack):
+						self.unknown.add(name)	# function-like, or defined under a condition we don't know
+						self.macros.pop(name, None)
+					elif name not in self.forced:
+						self.macros[name] = m.group(3)
+						self.unknown.discard(name)
+				elif kind == 'undef':
+					self.macros.pop(arg, None)
+				out.append(item)
+
+		if stack:
+			sys.exit('unterminated #if')
+		return out
+
+
+# The 16F690, and the RAM its globals have to leave to the locals: main() -> runBatch() -> replyPrint() ->
+# queue_print() -> toString() take 31 bytes of them, int_server() 2 and int_save_registers 3
+ROM_WORDS = 4096
+RAM_BYTES = 256
+RAM_LOCALS = 36
+
+# Sizes of Cc5x types in bytes, bits are counted separately
+TYPES = [
+	(r'unsigned\s+long|uns16|int16|long', 2),
+	(r'uns24|int24', 3),
+	(r'uns32|int32', 4),
+	(r'unsigned\s+char|char|uns8|int8|int|Command', 1),
+]
+RE_GLOBAL = re.compile(r'^(?:static\s+)?(?:volatile\s+)?(?:const\s+)?(bit|[\w\s]+?)\s*(\*?)\s*(\w+\s*(?:\[[^\]]+\])?(?:\s*,\s*\w+\s*(?:\[[^\]]+\])?)*)\s*(?:=[^;]*)?;')
+RE_NAME = re.compile(r'\w+\s*(?:\[([^\]]+)\])?')
+
+
+def ram(lines, pre):
+	"""
+		Returns bytes and bits of global variables declared at column 0 (not extern).
+		Locals are left out, Cc5x overlays them (RAM_LOCALS is what they need) and its own report is the place to look for them.
+	"""
+	bits = 0
+	total = 0
+	for line in lines:
+		if not line or line[0] in ' \t#/' or line.startswith('extern') or '(' in strip_comment(line):
+			continue
+		m = RE_GLOBAL.match(line)
+		if not m:
+			continue
+		type_, pointer, names = m.groups()
+		if pointer:
+			size = 2	# Cc5x pointers that can reach both RAM and ROM
+		elif type_ == 'bit':
+			size = 0
+		else:
+			size = next((s for r, s in TYPES if re.fullmatch(r, type_.strip())), None)
+			if size is None:
+				continue
+		for name in RE_NAME.finditer(names):
+			n = pre.value(name.group(1)) if name.group(1) else 1
+			if n is None:
+				continue
+			if size:
+				total += size * n
+			else:
+				bits += n
+	return total, bits
+
+
+RE_TABLE = re.compile(r'^const\s+(.+?)\s+\w+\s*\[[^\]]*\]\s*=\s*\{(.*?)\};', re.S | re.M)
+RE_LITERAL = re.compile(r"'(?:\\.|[^'])'")
+
+
+def tables(lines):
+	"""
+		Returns program words of the const tables declared at column 0, Cc5x keeps them in ROM as one word per byte.
+		Unlike the code around them they can be counted from the source.
+	"""
+	words = 0
+	for m in RE_TABLE.finditer('\n'.join(strip_comment(l) if l[:1] not in ' \t' else l for l in lines)):
+		type_, body = m.groups()
+		size = next((s for r, s in TYPES if re.fullmatch(r, type_.strip())), 1)
+		body = RE_LITERAL.sub('0', re.sub(r'//.*', '', body))
+		words += size * len([v for v in body.split(',') if v.strip()])
+	return words
+
+
+RE_FUNCTION = re.compile(r'^(?:interrupt|[\w\s]+?)\s*\**\s*(\w+)\s*\([^;]*$')
+
+
+def functions(lines):
+	names = set()
+	for line in lines:
+		m = RE_FUNCTION.match(line)
+		if m and not line.startswith(('extern', '#', '\t', ' ', '/')):
+			names.add(m.group(1))
+	return names
+
+
+def rom(listing, owners):
+	"""
+		Counts program words per module from a listing.
+		A line that starts with an address and an opcode (4 hex digits each) is one program word,
+		a line that is just a known function name (a label) starts that function.
+	"""
+	words = {}
+	current = None
+	with open(listing, errors='replace') as f:
+		for line in f:
+			code = line.split(';')[0]
+			if re.match(r'^\s*(?:0x)?[0-9A-Fa-f]{4}\s+[0-9A-Fa-f]{4}\b', code):
+				words[current] = words.get(current, 0) + 1
+				continue
+			m = re.match(r'^\s*(?:\d+\s+)?(\w+):?\s*$', code)
+			if m and m.group(1) in owners:
+				current = owners[m.group(1)]
+	return words
+
+
+def report(lines, defines, listing):
+	pre = Preprocessor(defines)
+	lines = pre.run(lines)
+	owners = {}
+	rows = []
+	for name in dict.fromkeys(os.path.splitext(m)[0] for m, _ in lines):
+		module = [l for m, l in lines if os.path.splitext(m)[0] == name]
+		for f in functions(module):
+			owners[f] = name
+		rows.append((name, ram(module, pre), tables(module)))
+
+	words = rom(listing, owners) if listing else {}
+
+	print('%-12s %9s %9s' % ('module', 'ROM words', 'RAM bytes'))
+	for name, (b, bits), t in rows:
+		print('%-12s %9s %9d' % (name, words.get(name, 0) if listing else t or '-', b + (bits + 7) // 8))
+	if listing:
+		print('%-12s %9d' % ('(other)', words.get(None, 0)))
+	# Cc5x packs the bits of all the modules together
+	total = sum(b for _, (b, _), _ in rows) + (sum(bits for _, (_, bits), _ in rows) + 7) // 8
+	print('%-12s %9d %9d' % ('total', sum(words.values()) if listing else sum(t for _, _, t in rows), total))
+	print('%-12s %9d %9d' % ('16F690', ROM_WORDS, RAM_BYTES))
+	if not listing:
+		print('no listing given, ROM is only the const tables (exact), the code takes the rest, see --listing')
+	if total > RAM_BYTES - RAM_LOCALS:
+		sys.exit('globals take %d bytes, over the %d left beside the %d kept for locals' % (total, RAM_BYTES - RAM_LOCALS, RAM_LOCALS))
+	if listing and sum(words.values()) > ROM_WORDS:
+		sys.exit('code takes %d words, over the %d there are' % (sum(words.values()), ROM_WORDS))
+
+
+def parse_defines(items):
+	defines = {}
+	for item in items or []:
+		name, _, value = item.partition('=')
+		defines[name] = value or '1'
+	return defines
+
+
+def main():
+	ap = argparse.ArgumentParser(description='Generate MotorController.c from the modular sources')
+	ap.add_argument('-o', '--output', default=os.path.join(ROOT, 'MotorController.c'))
+	ap.add_argument('-D', dest='defines', action='append', metavar='NAME[=VALUE]', help='feature setting, as passed to the compiler')
+	ap.add_argument('--strip-disabled', action='store_true', help='drop code of disabled features (uses -D)')
+	ap.add_argument('--check', action='store_true', help='only check that the output is up to date')
+	ap.add_argument('--report', action='store_true', help='print ROM/RAM footprint per module instead')
+	ap.add_argument('--listing', help='compiler listing to take ROM words from (with --report)')
+	args = ap.parse_args()
+
+	defines = parse_defines(args.defines)
+	lines = amalgamate()
+
+	if args.report:
+		report(lines, defines, args.listing)
+		return
+
+	if args.strip_disabled:
+		lines = Preprocessor(defines).run(lines)
+	text = join(lines)
+
+	if args.check:
+		with open(args.output) as f:
+			if f.read() != text:
+				sys.exit('%s is out of date, run tools/amalgamate.py' % os.path.relpath(args.output))
+		return
+
+	with open(args.output, 'w') as f:
+		f.write(text)
+
+
+if __name__ == '__main__':
+	main()
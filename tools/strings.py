@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+"""
+	Compiles strings.txt into strings.h (message ids) and strings.c (the string table).
+
+	Identical messages are stored once, a message that is the tail of another one points into it,
+	and substrings that pay for themselves are stored once as fragments.
+	In the table a byte below 0x80 is a character, a byte 0x80 + n stands for fragment n and a 0 ends the message.
+	io_printStr() decodes it while transmitting.
+
+	strings.txt has one message per line: NAME "text", lines starting with a quote continue the previous message,
+	lines starting with # are comments. NAME [CONDITION] "text" is a message of a feature that can be left out,
+	CONDITION is a preprocessor expression (PROF_ENABLE, !BUS_ENABLE, ...). Such messages follow the rest of the
+	table in #if blocks, one per condition, and their ids add up the blocks before them that are built in.
+
+	usage:
+		tools/strings.py            regenerate strings.h and strings.c
+		tools/strings.py --check    fail if they are out of date
+"""
+
+import argparse
+import ast
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+MAX_FRAGMENTS = 0x80
+MIN_FRAGMENT = 3
+MAX_FRAGMENT = 32
+
+
+def load(path):
+	messages = []	# [name, text, condition or None]
+	with open(path) as f:
+		for n, line in enumerate(f, 1):
+			line = line.strip()
+			if not line or line.startswith('#'):
+				continue
+			m = re.fullmatch(r'(?:([A-Z][A-Z0-9_]*)(?:\s+\[([^\]]+)\])?\s+)?("(?:[^"\\]|\\.)*")', line)
+			if not m or (not m.group(1) and not messages):
+				sys.exit('%s:%d: expected NAME "text"' % (path, n))
+			text = ast.literal_eval(m.group(3))
+			if any(ord(c) == 0 or ord(c) >= 0x80 for c in text):
+				sys.exit('%s:%d: only 7-bit characters are allowed' % (path, n))
+			if m.group(1):
+				if any(m.group(1) == name for name, _, _ in messages):
+					sys.exit('%s:%d: %s is already defined' % (path, n, m.group(1)))
+				messages.append([m.group(1), text, m.group(2) and m.group(2).strip()])
+			else:
+				messages[-1][1] += text
+	return messages
+
+
+def occurrences(seq, sub):
+	"""Non-overlapping occurrences of sub in seq."""
+	n = i = 0
+	while True:
+		i = find(seq, sub, i)
+		if i < 0:
+			return n
+		n += 1
+		i += len(sub)
+
+
+def find(seq, sub, start=0):
+	for i in range(start, len(seq) - len(sub) + 1):
+		if seq[i:i + len(sub)] == sub:
+			return i
+	return -1
+
+
+def replace(seq, sub, token):
+	out = []
+	i = 0
+	while i < len(seq):
+		if seq[i:i + len(sub)] == sub:
+			out.append(token)
+			i += len(sub)
+		else:
+			out.append(seq[i])
+			i += 1
+	return out
+
+
+def compress(texts, optional):
+	"""
+		Returns (encoded messages, fragments), all as lists of byte values.
+		Fragments are picked for the texts that are always built in, the optional ones only use them.
+	"""
+	encoded = [[ord(c) for c in t] for t in texts]
+	extra = [[ord(c) for c in t] for t in optional]
+	fragments = []
+
+	def saving(sub, count):
+		# each use saves len - 1 words, storing it costs len + 1 words and 2 more for its offset
+		return count * (len(sub) - 1) - (len(sub) + 1) - 2
+
+	while len(fragments) < MAX_FRAGMENTS:
+		# overlapping counts are an upper bound, only the promising ones get counted properly
+		counts = {}
+		for seq in encoded:
+			for i in range(len(seq)):
+				for n in range(MIN_FRAGMENT, MAX_FRAGMENT + 1):
+					sub = tuple(seq[i:i + n])
+					# io_printStr doesn't expand fragments within fragments
+					if len(sub) < n or any(b >= 0x80 for b in sub):
+						break
+					counts[sub] = counts.get(sub, 0) + 1
+
+		best = None
+		for bound, sub in sorted(((saving(s, c), s) for s, c in counts.items()), reverse=True):
+			if bound <= 0 or (best is not None and bound <= best[0][0]):
+				break
+			exact = saving(sub, sum(occurrences(seq, list(sub)) for seq in encoded))
+			if exact > 0 and (best is None or (exact, sub) > best[0]):
+				best = ((exact, sub), sub)
+
+		if best is None:
+			break
+		sub = list(best[1])
+		encoded = [replace(seq, sub, 0x80 + len(fragments)) for seq in encoded]
+		extra = [replace(seq, sub, 0x80 + len(fragments)) for seq in extra]
+		fragments.append(sub)
+
+	return encoded + extra, fragments
+
+
+def tail(placed, e):
+	"""Offset of e as the tail of an entry already placed, or None."""
+	for start, p in placed:
+		if len(p) >= len(e) and p[len(p) - len(e):] == e:
+			return start + len(p) - len(e)
+	return None
+
+
+def layout(entries, shared=()):
+	"""
+		Places entries (lists of bytes) in one table, each followed by a 0.
+		Returns (table, offsets, placed), an entry that is the tail of a longer one shares its bytes.
+		An entry that is the tail of one of shared (an earlier table's placed) gets None and is left out.
+	"""
+	order = sorted(range(len(entries)), key=lambda i: -len(entries[i]))
+	table = []
+	offsets = [None] * len(entries)
+	placed = []	# (offset, bytes)
+	for i in order:
+		e = entries[i]
+		if tail(shared, e) is not None:
+			continue
+		offsets[i] = tail(placed, e)
+		if offsets[i] is None:
+			offsets[i] = len(table)
+			placed.append((len(table), e))
+			table.extend(e + [0])
+	return table, offsets, placed
+
+
+def literal(b):
+	if b >= 0x80:
+		return '0x%02X' % b
+	c = chr(b)
+	if c == "'" or c == '\\':
+		return "'\\%s'" % c
+	if c == '\r':
+		return "'\\r'"
+	if c == '\n':
+		return "'\\n'"
+	if b < 0x20 or b == 0x7F:
+		return '0x%02X' % b
+	return "'%s'" % c
+
+
+def rows(values, per_row=12):
+	return ',\n'.join('\t' + ', '.join(values[i:i + per_row]) for i in range(0, len(values), per_row))
+
+
+def generate(messages):
+	always = [(n, t) for n, t, c in messages if not c]
+	optional = [(n, t, c) for n, t, c in messages if c]
+	conditions = list(dict.fromkeys(c for _, _, c in optional))
+	raw = sum(len(t) + 1 for _, t, _ in messages)
+
+	encoded, fragments = compress([t for _, t in always], [t for _, t, _ in optional])
+	table, offsets, placed = layout(fragments + encoded[:len(always)])
+	frag_offsets = offsets[:len(fragments)]
+	ids = dict(zip((n for n, _ in always), (str(o) for o in offsets[len(fragments):])))
+
+	# A part of the table per condition, it starts where the parts before it that are built in end
+	parts = []
+	for p, c in enumerate(conditions):
+		names, entries = zip(*((n, e) for (n, _, cond), e in zip(optional, encoded[len(always):]) if cond == c))
+		part, local, _ = layout(list(entries), placed)
+		parts.append((c, part, names))
+		for n, e, o in zip(names, entries, local):
+			ids[n] = str(tail(placed, e)) if o is None else '(STR_PART_%d + %d)' % (p, o)
+	size = len(table) + sum(len(part) for _, part, _ in parts)
+
+	width = max(len('STR_' + n) for n, _, _ in messages) + 1
+
+	def define(name, value):
+		return '#define %s%s' % (name.ljust(width), value)
+
+	lines = [define('STR_' + n, ids[n]) for n, _ in always]
+	if parts:
+		lines += ['', '// Messages of features that can be left out', define('STR_PART_0', len(table))]
+	for p, (c, part, names) in enumerate(parts):
+		lines.append('#if %s' % c)
+		lines += [define('STR_' + n, ids[n]) for n in names]
+		lines += [define('STR_PART_%d' % (p + 1), '(STR_PART_%d + %d)' % (p, len(part))), '#else']
+		lines += [define('STR_PART_%d' % (p + 1), 'STR_PART_%d' % p), '#endif']
+
+	header = '''/*
+
+	Console messages.
+	Generated from strings.txt by tools/strings.py, edit that file and regenerate instead of editing this one.
+
+	%d characters of text stored in %d words (%d in the table, %d of them for features that can be left out,
+	%d for %d fragment offsets)
+
+*/
+
+#ifndef _HEAD_STRINGS
+#define _HEAD_STRINGS
+
+// Message ids, to be passed to io_printStr()
+%s
+
+#endif // !_HEAD_STRINGS''' % (
+		raw, size + 2 * len(fragments), size, size - len(table), 2 * len(fragments), len(fragments), '\n'.join(lines))
+
+	# Each part starts with the comma after the one before it, so that the last one built in has none
+	body = rows([literal(b) for b in table])
+	for c, part, _ in parts:
+		if part:
+			body += '\n#if %s\n\t, %s\n#endif' % (c, rows([literal(b) for b in part])[1:])
+
+	source = '''#ifndef _SOURCE_STRINGS
+#define _SOURCE_STRINGS
+
+// Offsets of the fragments in str_table
+const unsigned long str_frag[] = {
+%s
+};
+
+// Messages and fragments, a byte 0x80 + n stands for fragment n, a 0 ends an entry
+// The messages of features that can be left out follow in #if blocks, see strings.h for where each starts
+const char str_table[] = {
+%s
+};
+
+#endif // !_SOURCE_STRINGS''' % (
+		rows([str(o) for o in frag_offsets] or ['0']),
+		body)
+
+	return header, source
+
+
+def main():
+	ap = argparse.ArgumentParser(description='Compile strings.txt into strings.h and strings.c')
+	ap.add_argument('--check', action='store_true', help='only check that the output is up to date')
+	args = ap.parse_args()
+
+	header, source = generate(load(os.path.join(ROOT, 'strings.txt')))
+	outputs = {'strings.h': header, 'strings.c': source}
+
+	for name, text in outputs.items():
+		path = os.path.join(ROOT, name)
+		if args.check:
+			with open(path) as f:
+				if f.read() != text:
+					sys.exit('%s is out of date, run tools/strings.py' % name)
+		else:
+			with open(path, 'w') as f:
+				f.write(text)
+
+
+if __name__ == '__main__':
+	main()
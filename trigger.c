@@ -0,0 +1,113 @@
+#ifndef _SOURCE_TRIGGER
+#define _SOURCE_TRIGGER
+
+#if TRIGGER_ENABLE
+
+char trigger_phase;
+bit trigger_start;
+uns32 trigger_steps;
+
+#if BUS_ENABLE
+bit trigger_heard;
+char trigger_address;
+#endif
+
+void trigger_init() {
+	trigger_phase = TRIGGER_IDLE;
+	trigger_start = 0;
+	trigger_steps = 0;
+#if BUS_ENABLE
+	trigger_heard = 0;
+#endif
+
+	TRISA.2 = 1;
+	OPTION.7 = 0;				// enable weak pull-ups on PORTA/PORTB
+	WPUA.2 = 1;
+	OPTION.6 = 0;				// INT on the falling edge
+	INTE = 0;
+}
+
+void trigger_arm() {
+	motor_pwmStop();
+	motor_enable = FALSE;
+	motor_steps = 0;
+	motor_counting = FALSE;
+
+	trigger_start = 0;
+	trigger_steps = 0;
+	trigger_phase = TRIGGER_ARMED;
+	INTF = 0;					// an edge from before doesn't count
+	INTE = 1;
+#if BUS_ENABLE
+	PEIE = 1;
+	trigger_listen();
+#endif
+}
+
+void trigger_disarm() {
+	INTE = 0;
+#if BUS_ENABLE
+	RCIE = 0;
+#endif
+	trigger_phase = TRIGGER_IDLE;
+	trigger_start = 0;
+	trigger_steps = 0;
+}
+
+void trigger_fire() {
+	/*
+		The tick starts over, the one that was due is dropped with it.
+		The interrupt gets here in the same number of cycles on every controller, so their ticks line up
+		to within a cycle or two of the trigger.
+	*/
+	TMR0 = TIME_RESET;
+	IF_TIME = 0;
+	INTE = 0;
+	INTF = 0;
+#if BUS_ENABLE
+	RCIE = 0;
+#endif
+	trigger_phase = TRIGGER_FIRED;	// time_update() moves it on
+}
+
+void trigger_release() {
+	trigger_phase = TRIGGER_IDLE;
+	if (trigger_start) {
+		motor_enable = TRUE;
+#if MOTOR_PWM
+		if (motor_nextPeriod <= MOTOR_PWM_MAX_CYCLES / TIME_TICK_CYCLES)
+			motor_pwmStart(motor_nextPeriod * TIME_TICK_CYCLES);
+#endif
+	} else if (trigger_steps) {
+		motor_steps = trigger_steps;
+		motor_counting = TRUE;
+	}
+	trigger_start = 0;
+	trigger_steps = 0;
+}
+
+#if BUS_ENABLE
+
+void trigger_receive() {
+	RCIE = 0;					// trigger_listen() turns it back on
+	if (!RX9D)
+		return;					// data of a frame for us, io_getInput() reads it
+	trigger_address = RCREG;
+	if (trigger_address == BUS_TRIGGER) {
+		if (trigger_phase == TRIGGER_ARMED)
+			trigger_fire();
+		return;
+	}
+	trigger_heard = 1;
+}
+
+void trigger_listen() {
+	if (trigger_phase == TRIGGER_ARMED && !RCIF && !trigger_heard)
+		RCIE = 1;
+}
+
+#endif // BUS_ENABLE
+
+#endif // TRIGGER_ENABLE
+
+#endif // !_SOURCE_TRIGGER
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+
+	Synchronized start.
+	"arm" stops the motor and makes start and step wait for a trigger instead of running right away.
+	The trigger is a falling edge on RA2/INT (one line to every controller in a rack, pulled low by the host),
+	or on a bus the address byte BUS_TRIGGER, which every controller gets at the same moment.
+	Either one is taken in the interrupt, which starts the tick over, so every armed controller ticks in step
+	from there and makes its first step on the first tick after the trigger.
+
+*/
+
+#ifndef _HEAD_TRIGGER
+#define _HEAD_TRIGGER
+
+// Set to 0 to leave out arm and the trigger
+#ifndef TRIGGER_ENABLE
+#define TRIGGER_ENABLE 1
+#endif
+
+#pragma bit PORT_TRIGGER	@ PORTA.2	// trigger line, active low, has the weak pull-up so it may be left open
+
+// Trigger phases
+#define TRIGGER_IDLE	0
+#define TRIGGER_ARMED	1	// waiting for the trigger
+#define TRIGGER_FIRED	2	// the interrupt saw it, the tick started over
+#define TRIGGER_DUE		3	// the first tick after it came, the core loop starts the move
+
+#if TRIGGER_ENABLE
+
+extern char trigger_phase;
+extern bit trigger_start;		// the move is a start
+extern uns32 trigger_steps;		// or this many steps, no move if neither
+
+// Set up the trigger pin
+void trigger_init();
+
+// Stop the motor and wait for the trigger, start and step load the move from here on
+void trigger_arm();
+
+// Stop waiting and forget the move
+void trigger_disarm();
+
+// Is to be called on INT interrupt (and by trigger_receive()), starts the tick over
+void trigger_fire();
+
+// Is to be called by the core loop once the phase is TRIGGER_DUE, starts the move
+void trigger_release();
+
+#if BUS_ENABLE
+
+/*
+	While armed the receive interrupt is on, so that BUS_TRIGGER is seen the moment it arrives.
+	The interrupt takes address bytes only, data is left in the receiver for io_getInput() as usual.
+*/
+extern bit trigger_heard;		// an address byte other than BUS_TRIGGER is waiting in trigger_address
+extern char trigger_address;
+
+// Is to be called on RCIF interrupt
+void trigger_receive();
+
+// Is to be called from the core loop, turns the receive interrupt back on once the receiver is empty
+void trigger_listen();
+
+#else
+
+#define trigger_listen()
+
+#endif // BUS_ENABLE
+
+#else
+
+#define trigger_phase		TRIGGER_IDLE
+#define trigger_disarm()
+#define trigger_listen()
+
+#endif // TRIGGER_ENABLE
+
+#endif // !_HEAD_TRIGGER
\ No newline at end of file